@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 namespace multipass
 {
@@ -41,6 +42,11 @@ template <typename Instances>
 Instances sorted(const Instances& instances);
 
 void filter_aliases(google::protobuf::RepeatedPtrField<multipass::FindReply_AliasInfo>& aliases);
+
+// Single IDs as "host:instance" and ranges as "first-last:instance", with "default" for the default instance ID
+std::vector<std::string>
+id_mappings_for(const google::protobuf::Map<google::protobuf::int32, google::protobuf::int32>& id_map,
+                const google::protobuf::RepeatedPtrField<multipass::IdRange>& id_ranges);
 } // namespace format
 }
 
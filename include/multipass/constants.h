@@ -34,6 +34,10 @@ constexpr auto default_cpu_cores = min_cpu_cores;
 constexpr auto home_automount_dir = "Home";
 
 constexpr auto driver_env_var = "MULTIPASS_VM_DRIVER";
+// These hand the mount settings over from multipassd to sshfs_server
+constexpr auto sftp_workers_env_var = "MULTIPASS_SFTP_WORKERS"; // number of threads serving each mount, 0 to disable
+constexpr auto sftp_write_buffer_env_var = "MULTIPASS_SFTP_WRITE_BUFFER"; // bytes held back per open file, 0 to disable
+constexpr auto sftp_attribute_cache_env_var = "MULTIPASS_SFTP_ATTRIBUTE_CACHE"; // 1 to cache attributes on the host
 
 constexpr auto winterm_profile_guid =
     "{aaaa9e6d-1e09-4be6-b76c-82b4ba1885fb}"; // identifies the primary Multipass profile in Windows Terminal
@@ -41,9 +45,16 @@ constexpr auto winterm_profile_guid =
 constexpr auto petenv_key = "client.primary-name";     // This will eventually be moved to some dynamic settings schema
 constexpr auto driver_key = "local.driver";            // idem
 constexpr auto autostart_key = "client.gui.autostart"; // idem
-constexpr auto winterm_key = "client.apps.windows-terminal.profiles"; // idem
-constexpr auto hotkey_key = "client.gui.hotkey";                      // idem
-constexpr auto hotkey_default = "Ctrl+Alt+U";                         // idem; translates to Cmd+Opt+U on macOS
+constexpr auto winterm_key = "client.apps.windows-terminal.profiles";     // idem
+constexpr auto hotkey_key = "client.gui.hotkey";                          // idem
+constexpr auto image_overlays_key = "local.image-overlays";               // idem
+constexpr auto image_prefetch_key = "local.image-prefetch";               // idem
+constexpr auto instance_pool_key = "local.instance-pool";                 // idem
+constexpr auto telemetry_interval_key = "local.telemetry-interval";       // idem
+constexpr auto mount_workers_key = "local.mount-workers";                 // idem
+constexpr auto mount_write_buffer_key = "local.mount-write-buffer";       // idem
+constexpr auto mount_attribute_cache_key = "local.mount-attribute-cache"; // idem
+constexpr auto hotkey_default = "Ctrl+Alt+U";                             // idem; translates to Cmd+Opt+U on macOS
 } // namespace multipass
 
 #endif // MULTIPASS_CONSTANTS_H
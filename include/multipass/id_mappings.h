@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_ID_MAPPINGS_H
+#define MULTIPASS_ID_MAPPINGS_H
+
+#include <multipass/optional.h>
+
+#include <QString>
+
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+// Maps host user or group IDs to instance ones, as ranges of consecutive IDs. The ranges are kept sorted in one flat
+// vector, with neighbouring ones that continue each other merged, so a lookup is a binary search however many IDs
+// are mapped.
+class IdMappings
+{
+public:
+    struct Range
+    {
+        int host_id;     // first host ID of the range
+        int instance_id; // instance ID the first one maps to, or default_id to map all of them to the default one
+        int count;
+    };
+
+    friend bool operator==(const IdMappings& a, const IdMappings& b);
+    friend bool operator!=(const IdMappings& a, const IdMappings& b);
+
+    IdMappings() = default;
+    IdMappings(std::initializer_list<std::pair<int, int>> id_map);
+    IdMappings(const std::unordered_map<int, int>& id_map); // NOLINT: converts implicitly, like a map it replaces
+
+    // Throws std::invalid_argument if the range overlaps one already added or runs past the largest ID
+    void add(int host_id, int instance_id, int count = 1);
+
+    // The instance ID host_id maps to, which may be default_id
+    optional<int> instance_id_for(int host_id) const;
+
+    const std::vector<Range>& ranges() const;
+    bool empty() const;
+
+    // The form sshfs_server takes them in: comma separated "host:instance" or "first-last:instance" entries
+    QString to_string() const;
+    static IdMappings from_string(const QString& in);
+
+    // Identical mappings share a single table for as long as anyone uses it
+    static std::shared_ptr<const IdMappings> intern(const IdMappings& mappings);
+
+private:
+    std::vector<Range> sorted_ranges;
+};
+
+bool operator==(const IdMappings& a, const IdMappings& b);
+bool operator!=(const IdMappings& a, const IdMappings& b);
+} // namespace multipass
+
+#endif // MULTIPASS_ID_MAPPINGS_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_IMAGE_BLOB_STORE_H
+#define MULTIPASS_IMAGE_BLOB_STORE_H
+
+#include <multipass/days.h>
+#include <multipass/path.h>
+
+#include <QDir>
+#include <QString>
+
+namespace multipass
+{
+namespace vault
+{
+// Keeps a single copy of each image, named after its SHA-256, that the vaults of all backends link their images to.
+// Images are hard linked where possible, so the link count of a blob tells how many images still refer to it.
+class ImageBlobStore
+{
+public:
+    explicit ImageBlobStore(const Path& store_path);
+
+    // Links image_path to the blob for hash; returns false if there is no such blob
+    bool fetch(const QString& hash, const Path& image_path) const;
+
+    // Keeps the image at image_path as the blob for hash, unless there is one already
+    void add(const QString& hash, const Path& image_path);
+
+    // The number of images that link to the blob for hash
+    int reference_count(const QString& hash) const;
+
+    // Removes the blobs no image has linked to for days_to_expire
+    void prune(const days& days_to_expire);
+
+private:
+    QString blob_path_for(const QString& hash) const;
+
+    const QDir store_dir;
+};
+} // namespace vault
+} // namespace multipass
+#endif // MULTIPASS_IMAGE_BLOB_STORE_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_IMAGE_DOWNLOAD_PIPELINE_H
+#define MULTIPASS_IMAGE_DOWNLOAD_PIPELINE_H
+
+#include <multipass/auto_join_thread.h>
+#include <multipass/path.h>
+#include <multipass/xz_image_decoder.h>
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace multipass
+{
+namespace vault
+{
+// Processes an image while it is being downloaded: one thread hashes the data as it arrives while another writes it
+// to the image file, decoding it on the way if it is xz compressed and leaving holes where it is all zeros. The
+// threads are fed through bounded queues, so a slow disk holds back the download instead of piling the image up in
+// memory.
+class ImageDownloadPipeline
+{
+public:
+    // An empty image_hash skips verification
+    ImageDownloadPipeline(const Path& image_path, const QString& image_hash, bool xz_compressed);
+    ~ImageDownloadPipeline();
+
+    // Returns false once processing failed, so that the download can be stopped
+    bool push(const QByteArray& data);
+
+    // Rethrows what processing failed with, if it did
+    void throw_if_failed();
+
+    // Waits for everything pushed to be processed, then throws if that failed, the xz stream is incomplete or the
+    // hash does not match
+    void finish();
+
+private:
+    class ChunkQueue
+    {
+    public:
+        bool push(const QByteArray& chunk);
+        bool pop(QByteArray& chunk);
+        void close();
+
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<QByteArray> chunks;
+        bool closed{false};
+    };
+
+    void hash_data();
+    void write_data();
+    void stop();
+
+    QFile image_file;
+    const QString image_hash;
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    std::unique_ptr<XzStreamDecoder> xz_decoder;
+    bool stream_ended{false};
+
+    ChunkQueue hash_queue;
+    ChunkQueue write_queue;
+    std::exception_ptr error;
+    std::atomic_bool failed{false};
+
+    std::unique_ptr<AutoJoinThread> hash_thread;
+    std::unique_ptr<AutoJoinThread> write_thread;
+};
+} // namespace vault
+} // namespace multipass
+#endif // MULTIPASS_IMAGE_DOWNLOAD_PIPELINE_H
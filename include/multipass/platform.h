@@ -59,12 +59,18 @@ VirtualMachineFactory::UPtr vm_backend(const Path& data_dir);
 logging::Logger::UPtr make_logger(logging::Level level);
 UpdatePrompt::UPtr make_update_prompt();
 std::unique_ptr<Process> make_sshfs_server_process(const SSHFSServerConfig& config);
+void update_sshfs_server_policy(const SSHFSServerConfig& config); // for a process running with an older config
 std::unique_ptr<Process> make_process(std::unique_ptr<ProcessSpec>&& process_spec);
 int chown(const char* path, unsigned int uid, unsigned int gid);
 bool symlink(const char* target, const char* link, bool is_dir);
 bool link(const char* target, const char* link);
 int utime(const char* path, int atime, int mtime);
 int symlink_attr_from(const char* path, sftp_attributes_struct* attr);
+long long pread(int fd, void* buf, std::size_t count, long long offset);
+long long pwrite(int fd, const void* buf, std::size_t count, long long offset);
+int fsync(int fd);
+// Lowers the I/O priority of the calling thread to idle, or restores its default
+void set_background_io_priority(bool background);
 bool is_alias_supported(const std::string& alias, const std::string& remote);
 bool is_remote_supported(const std::string& remote);
 bool is_image_url_supported();
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_QCOW2_IMAGE_H
+#define MULTIPASS_QCOW2_IMAGE_H
+
+#include <multipass/optional.h>
+#include <multipass/path.h>
+
+#include <QString>
+
+namespace multipass
+{
+namespace vault
+{
+struct ImageInfo
+{
+    QString format; // "qcow2" or "raw"
+    qint64 virtual_size;
+    QString backing_file; // empty if there is none
+};
+
+// Tells what qemu-img info would about qcow2 and raw images, without running it. Images in other formats, and those
+// that cannot be read, give nullopt and are left to qemu-img.
+optional<ImageInfo> read_image_info(const Path& image_path);
+
+// Grows a raw image, or a qcow2 image whose L1 table has room for the new size, in place. Returns false if it is up
+// to qemu-img to resize this image.
+bool grow_image(const Path& image_path, qint64 size);
+
+// Writes a qcow2 version of a raw image, leaving out the clusters that are all zeros
+void convert_raw_to_qcow2(const Path& raw_path, const Path& qcow2_path);
+} // namespace vault
+} // namespace multipass
+#endif // MULTIPASS_QCOW2_IMAGE_H
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SPARSE_FILE_H
+#define MULTIPASS_SPARSE_FILE_H
+
+#include <QFileDevice>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace multipass
+{
+constexpr qint64 sparse_block_size = 4096;
+
+// Writes like QFileDevice::write, but seeks over whole blocks of zeros instead of writing them. In a newly created or
+// truncated file, or in one that was resized to be written into, they are left as holes that read back as zeros and
+// take no space. Returns false if writing failed.
+inline bool write_sparse(QFileDevice& file, const char* data, qint64 size)
+{
+    static const std::array<char, sparse_block_size> zeros{};
+
+    for (qint64 pos = 0; pos < size;)
+    {
+        const auto length = std::min(sparse_block_size, size - pos);
+        if (length == sparse_block_size && std::memcmp(data + pos, zeros.data(), length) == 0)
+        {
+            if (!file.seek(file.pos() + length))
+                return false;
+            pos += length;
+            continue;
+        }
+
+        // Write any data blocks that follow in one go
+        auto end = pos + length;
+        while (end + sparse_block_size <= size && std::memcmp(data + end, zeros.data(), sparse_block_size) != 0)
+            end += sparse_block_size;
+        if (end + sparse_block_size > size)
+            end = size;
+
+        if (file.write(data + pos, end - pos) != end - pos)
+            return false;
+        pos = end;
+    }
+
+    return true;
+}
+
+// Makes up for zeros skipped at the very end of a file, which seeking alone does not extend
+inline bool finish_sparse_write(QFileDevice& file)
+{
+    return file.size() >= file.pos() || file.resize(file.pos());
+}
+} // namespace multipass
+#endif // MULTIPASS_SPARSE_FILE_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SSH_SESSION_POOL_H
+#define MULTIPASS_SSH_SESSION_POOL_H
+
+#include <multipass/ssh/ssh_session.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+class SSHKeyProvider;
+
+// Keeps authenticated sessions to each instance open for a while after use, so that commands run one after another
+// do not each pay for connecting and authenticating. A session is only ever lent to one user at a time, and is
+// checked to still work before it is lent again.
+class SSHSessionPool
+{
+public:
+    // A session lent by the pool, which goes back to it once this is destroyed
+    class Lease
+    {
+    public:
+        Lease(Lease&& other) = default;
+        Lease& operator=(Lease&& other) = delete;
+        ~Lease();
+
+        SSHSession& operator*() const;
+        SSHSession* operator->() const;
+
+        // Keeps the session out of the pool for good, e.g. when the instance is about to go down with it
+        SSHSession take();
+
+    private:
+        friend class SSHSessionPool;
+        Lease(SSHSessionPool* pool, const std::string& instance, const std::string& address, unsigned generation,
+              std::unique_ptr<SSHSession> session);
+
+        SSHSessionPool* pool;
+        std::string instance;
+        std::string address;
+        unsigned generation;
+        std::unique_ptr<SSHSession> session;
+    };
+
+    // The default idle timeout comfortably outlasts the usual gaps between commands, telemetry samples included
+    explicit SSHSessionPool(const SSHKeyProvider& key_provider,
+                            std::chrono::milliseconds idle_timeout = std::chrono::minutes(3));
+
+    Lease acquire(const std::string& instance, const std::string& host, int port, const std::string& username);
+
+    // Closes the idle sessions to an instance and keeps those lent out from coming back, for when it stops, restarts
+    // or goes away
+    void forget(const std::string& instance);
+
+    // Closes the sessions to any instance that have been idle for longer than the idle timeout; to be called
+    // periodically, so that sessions to instances that are no longer used do not stay open
+    void expire_idle_sessions();
+
+private:
+    struct IdleSession
+    {
+        std::string address;
+        std::unique_ptr<SSHSession> session;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    struct InstanceSessions
+    {
+        unsigned generation;
+        std::vector<IdleSession> idle;
+    };
+
+    void give_back(Lease& lease);
+    void move_expired(std::vector<IdleSession>& idle, std::vector<IdleSession>& stale) const;
+
+    const SSHKeyProvider& key_provider;
+    const std::chrono::milliseconds idle_timeout;
+    std::mutex mutex;
+    std::unordered_map<std::string, InstanceSessions> sessions;
+    unsigned next_generation{0}; // pool-wide, so that an instance forgotten and used again starts a new one
+};
+} // namespace multipass
+#endif // MULTIPASS_SSH_SESSION_POOL_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_ATTRIBUTE_CACHE_H
+#define MULTIPASS_ATTRIBUTE_CACHE_H
+
+#include <multipass/optional.h>
+
+#include <libssh/sftp.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace multipass
+{
+// Remembers the attributes the SFTP server replied with, keyed by path and without following symlinks. Every
+// directory involved in a cached entry is watched with inotify, so entries are dropped as soon as anything on the
+// host changes them. Watches go away along with the entries that needed them.
+class AttributeCache
+{
+public:
+    // An empty value records that the path did not exist
+    using Attributes = optional<sftp_attributes_struct>;
+    using Compute = std::function<Attributes()>;
+
+    static constexpr std::size_t max_entries = 64 * 1024;
+
+    AttributeCache();
+    ~AttributeCache();
+
+    // Returns the cached attributes of path, or computes and caches them on a miss
+    Attributes get(const std::string& path, const Compute& compute);
+
+    // Drops path, its parent directory and everything below path
+    void invalidate(const std::string& path);
+    void clear();
+
+    std::size_t size();
+    std::size_t watch_count(); // of directories
+
+private:
+    bool watch(const std::string& dir);
+    void unwatch_locked(const std::string& path);
+    void invalidate_locked(const std::string& path);
+    void clear_locked();
+    void process_events();
+
+    int inotify_fd;
+    int stop_fd;
+    std::mutex mutex;
+    std::map<std::string, Attributes> entries;
+    std::unordered_map<int, std::string> watched_dirs;
+    std::map<std::string, int> watch_descriptors;
+    uint64_t generation{0};
+    bool watching{true};
+    std::thread event_thread;
+};
+} // namespace multipass
+#endif // MULTIPASS_ATTRIBUTE_CACHE_H
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_MOUNT_STATS_H
+#define MULTIPASS_MOUNT_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <QJsonObject>
+
+namespace multipass
+{
+// Counts the requests a mount serves. Recording is lock free, so every worker of the SFTP server can do it on the
+// hot path; readers get a snapshot that may be a few requests behind.
+class MountStats
+{
+public:
+    enum Operation
+    {
+        open,
+        close,
+        read,
+        write,
+        stat,
+        fstat,
+        setstat,
+        opendir,
+        readdir,
+        mkdir,
+        rmdir,
+        remove,
+        rename,
+        readlink,
+        symlink,
+        realpath,
+        extended,
+        other,
+        operation_count
+    };
+
+    // Bucket i counts requests served in under 2^i microseconds; the last one takes everything slower
+    static constexpr std::size_t latency_buckets = 24;
+    using LatencyHistogram = std::array<uint64_t, latency_buckets>;
+
+    struct OperationSnapshot
+    {
+        uint64_t count;
+        uint64_t errors;
+        LatencyHistogram latency_histogram;
+    };
+
+    struct Snapshot
+    {
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        std::array<OperationSnapshot, operation_count> operations;
+    };
+
+    void record(Operation operation, std::chrono::microseconds latency);
+    void record_error(Operation operation);
+    void add_bytes_read(uint64_t bytes);
+    void add_bytes_written(uint64_t bytes);
+
+    Snapshot snapshot() const;
+
+    static const char* name_of(Operation operation);
+
+    // Upper bound, in microseconds, of the bucket holding the given fraction of the requests
+    static uint64_t latency_percentile(const LatencyHistogram& histogram, double fraction);
+
+    // The form stats travel in between sshfs_server and multipassd
+    static QJsonObject to_json(const Snapshot& snapshot);
+    static Snapshot from_json(const QJsonObject& json);
+
+private:
+    struct OperationCounters
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> errors{0};
+        std::array<std::atomic<uint64_t>, latency_buckets> latency_histogram{};
+    };
+
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::array<OperationCounters, operation_count> operations;
+};
+} // namespace multipass
+#endif // MULTIPASS_MOUNT_STATS_H
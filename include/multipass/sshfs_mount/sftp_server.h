@@ -18,12 +18,22 @@
 #ifndef MULTIPASS_SFTP_SERVER_H
 #define MULTIPASS_SFTP_SERVER_H
 
+#include <multipass/id_mappings.h>
 #include <multipass/ssh/ssh_session.h>
+#include <multipass/sshfs_mount/attribute_cache.h>
+#include <multipass/sshfs_mount/mount_stats.h>
+#include <multipass/sshfs_mount/shared_ssh_session.h>
 
 #include <libssh/sftp.h>
 
+#include <dirent.h>
+
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <QFile>
 #include <QFileInfo>
@@ -37,21 +47,50 @@ class SftpServer
 {
 public:
     SftpServer(SSHSession&& ssh_session, const std::string& source, const std::string& target,
-               const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map,
-               int default_uid, int default_gid, const std::string& sshfs_exec_line);
+               const IdMappings& gid_map, const IdMappings& uid_map, int default_uid, int default_gid,
+               const std::string& sshfs_exec_line, int num_workers = 0, std::size_t write_buffer_size = 0,
+               bool cache_attributes = false);
+    // Serves the mount over a new channel of a session other mounts use as well
+    SftpServer(const std::shared_ptr<SharedSSHSession>& shared_session, const std::string& source,
+               const std::string& target, const IdMappings& gid_map, const IdMappings& uid_map, int default_uid,
+               int default_gid, const std::string& sshfs_exec_line, int num_workers = 0,
+               std::size_t write_buffer_size = 0, bool cache_attributes = false);
     SftpServer(SftpServer&& other);
     ~SftpServer();
 
     void run();
     void stop();
 
+    MountStats::Snapshot stats() const;
+
     using SSHSessionUptr = std::unique_ptr<ssh_session_struct, decltype(ssh_free)*>;
     using SftpSessionUptr = std::unique_ptr<sftp_session_struct, decltype(sftp_free)*>;
     using SSHFSProcUptr = std::unique_ptr<SSHProcess>;
+    using MsgUPtr = std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
+    using DirUPtr = std::unique_ptr<DIR, decltype(closedir)*>;
+
+    // Largest amount of data sent back in a single read reply; sshfs is told to request up to this much
+    static constexpr uint32_t max_read_size = 256 * 1024;
 
 private:
+    SftpServer(const std::shared_ptr<SharedSSHSession>& shared_session, bool session_is_shared,
+               const std::string& source, const std::string& target, const IdMappings& gid_map,
+               const IdMappings& uid_map, int default_uid, int default_gid, const std::string& sshfs_exec_line,
+               int num_workers, std::size_t write_buffer_size, bool cache_attributes);
+
+    class MessageQueue;
+    class WriteBuffer;
+
+    sftp_client_message next_client_message();
+    void dispatch(MsgUPtr msg);
+    std::size_t dispatch_key_for_handle(void* id);
+    void start_workers();
+    void stop_workers();
     void process_message(sftp_client_message msg);
     sftp_attributes_struct attr_from(const QFileInfo& file_info);
+    AttributeCache::Attributes attr_for_path(const QString& filename);
+    AttributeCache::Attributes cached_attr_for_path(const QString& filename);
+    void invalidate_cached_attr(const QString& filename);
     int mapped_uid_for(const int uid);
     int mapped_gid_for(const int gid);
 
@@ -72,20 +111,50 @@ private:
     int handle_symlink(sftp_client_message msg);
     int handle_write(sftp_client_message msg);
     int handle_extended(sftp_client_message msg);
+    int handle_fsync(sftp_client_message msg);
+
+    std::shared_ptr<WriteBuffer> write_buffer_for(void* id);
+    bool flush_write_buffer(void* id);
+    bool flush_write_buffers_under(const QString& path);
+
+    void* handle_id(ssh_string handle);
+    int reply_status(sftp_client_message msg, uint32_t status, const char* message);
+    int reply_ok(sftp_client_message msg);
+    int reply_failure(sftp_client_message msg);
+    int reply_perm_denied(sftp_client_message msg);
+    int reply_bad_handle(sftp_client_message msg, const char* type);
+    int reply_unsupported(sftp_client_message msg);
+    int reply_attr(sftp_client_message msg, sftp_attributes attr);
+    int reply_data(sftp_client_message msg, const void* data, int len);
+    int reply_name(sftp_client_message msg, const char* name, sftp_attributes attr);
+    int reply_names(sftp_client_message msg);
+    int reply_handle(sftp_client_message msg, ssh_string handle);
 
-    SSHSession ssh_session;
+    const std::shared_ptr<SharedSSHSession> shared_session;
+    SSHSession& ssh_session;
+    std::mutex& session_mutex; // serializes all traffic on the libssh session
+    const bool session_is_shared;
     SSHFSProcUptr sshfs_process;
     SftpSessionUptr sftp_server_session;
     const std::string source_path;
     const std::string target_path;
-    std::unordered_map<void*, std::unique_ptr<QFileInfoList>> open_dir_handles;
+    std::unordered_map<void*, DirUPtr> open_dir_handles;
     std::unordered_map<void*, std::unique_ptr<QFile>> open_file_handles;
-    const std::unordered_map<int, int> gid_map;
-    const std::unordered_map<int, int> uid_map;
+    std::unordered_map<void*, std::shared_ptr<WriteBuffer>> write_buffers;
+    std::unordered_map<void*, std::size_t> handle_dispatch_keys; // the key of the path each handle was opened with
+    const std::shared_ptr<const IdMappings> gid_mappings; // shared with every mount mapping the same IDs
+    const std::shared_ptr<const IdMappings> uid_mappings;
     const int default_uid;
     const int default_gid;
     const std::string sshfs_exec_line;
-    bool stop_invoked{false};
+    const int num_workers;
+    const std::size_t write_buffer_size;
+    std::unique_ptr<AttributeCache> attribute_cache;
+    MountStats mount_stats;
+    std::vector<std::unique_ptr<MessageQueue>> message_queues;
+    std::vector<std::thread> workers;
+    std::mutex handles_mutex;
+    std::atomic<bool> stop_invoked{false};
 };
 } // namespace multipass
 #endif // MULTIPASS_SFTP_SERVER_H
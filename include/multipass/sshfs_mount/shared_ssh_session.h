@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SHARED_SSH_SESSION_H
+#define MULTIPASS_SHARED_SSH_SESSION_H
+
+#include <multipass/ssh/ssh_session.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace multipass
+{
+// An SSH session serving several mounts of the same instance, each over its own channel. libssh is not thread safe
+// within a session, so every use of it has to hold the mutex.
+class SharedSSHSession
+{
+public:
+    // Holds the mutex while the session is used. libssh may read data meant for any channel off the socket on the
+    // way, so the waiters look at their channels again once the use is over.
+    class Lock
+    {
+    public:
+        explicit Lock(SharedSSHSession& shared_session);
+        ~Lock();
+
+    private:
+        SharedSSHSession& shared_session;
+        std::lock_guard<std::mutex> lock;
+    };
+
+    explicit SharedSSHSession(SSHSession&& session);
+    ~SharedSSHSession();
+
+    // Waits, with the lock released, until there may be new data for any channel of the session. A single thread
+    // blocks on the socket and wakes the others once something arrives, so nobody wakes up while the session is idle.
+    void wait_for_data(std::unique_lock<std::mutex>& lock);
+
+    // Whether data is waiting on the socket, which using the session could read for other channels. Call with the
+    // lock held.
+    bool has_unread_data();
+
+    // Wakes the waiters, including the one blocked on the socket, to look at their channels again. Call with the lock
+    // held.
+    void notify_data();
+
+    // Wakes the waiters so that they notice a mount being stopped
+    void interrupt();
+
+    SSHSession session;
+    std::mutex mutex;
+
+private:
+    std::condition_variable data_arrived;
+    std::uint64_t generation{0};
+    bool polling{false};
+    int wake_pipe[2];
+};
+} // namespace multipass
+#endif // MULTIPASS_SHARED_SSH_SESSION_H
@@ -18,28 +18,43 @@
 #ifndef MULTIPASS_SSHFS_MOUNT
 #define MULTIPASS_SSHFS_MOUNT
 
+#include <multipass/id_mappings.h>
+#include <multipass/sshfs_mount/mount_stats.h>
+
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <string>
 #include <thread>
-#include <unordered_map>
 
 namespace multipass
 {
 class SSHSession;
 class SftpServer;
+class SharedSSHSession;
 class SshfsMount
 {
 public:
     SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-               const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map);
+               const IdMappings& gid_map, const IdMappings& uid_map, int num_workers = 0,
+               std::size_t write_buffer_size = 0, bool cache_attributes = false);
+    // on_disconnected is called, from the mount's own thread, if it ends without being stopped
+    SshfsMount(const std::shared_ptr<SharedSSHSession>& shared_session, const std::string& source,
+               const std::string& target, const IdMappings& gid_map, const IdMappings& uid_map, int num_workers = 0,
+               std::size_t write_buffer_size = 0, bool cache_attributes = false,
+               std::function<void()> on_disconnected = nullptr);
     SshfsMount(SshfsMount&& other);
     ~SshfsMount();
 
     void stop();
 
+    MountStats::Snapshot stats() const;
+
 private:
     // sftp_server Doesn't need to be a pointer, but done for now to avoid bringing sftp.h
     // which has an error with -pedantic.
     std::unique_ptr<SftpServer> sftp_server;
+    std::atomic<bool> stopping{false};
     std::thread sftp_thread;
 };
 } // namespace multipass
@@ -18,13 +18,21 @@
 #ifndef MULTIPASS_SSHFSMOUNTS_H
 #define MULTIPASS_SSHFSMOUNTS_H
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
 
+#include <multipass/id_mappings.h>
 #include <multipass/process/process.h>
 #include <multipass/qt_delete_later_unique_ptr.h>
 #include <multipass/ssh/ssh_key_provider.h>
+#include <multipass/sshfs_mount/mount_stats.h>
+#include <multipass/sshfs_server_config.h>
+
+#include <QByteArray>
+#include <QList>
 
 namespace multipass
 {
@@ -37,17 +45,39 @@ public:
     explicit SSHFSMounts(const SSHKeyProvider& ssh_key_provider);
 
     void start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
-                     const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map);
+                     const IdMappings& gid_map, const IdMappings& uid_map);
 
     bool stop_mount(const std::string& instance, const std::string& path);
     void stop_all_mounts_for_instance(const std::string& instance);
 
     bool has_instance_already_mounted(const std::string& instance, const std::string& path) const;
 
+    // Stats of the instance's running mounts, by target path
+    std::unordered_map<std::string, MountStats::Snapshot> mount_stats(const std::string& instance);
+
 private:
+    // A single sshfs_server serves every mount of an instance
+    struct ServerProcess
+    {
+        qt_delete_later_unique_ptr<Process> process;
+        SSHFSServerConfig config;                                 // the process was started with
+        std::unordered_map<std::string, std::string> source_paths; // by target path
+    };
+
+    void add_mount(const std::string& instance, const std::string& source_path, const std::string& target_path,
+                   const IdMappings& gid_map, const IdMappings& uid_map);
+    void update_policy(const ServerProcess& server);
+    void stop_server(std::unordered_map<std::string, ServerProcess>::iterator server);
+    void watch_output(const std::string& instance, Process* process);
+    QList<QByteArray> request_and_wait(Process* process, const QByteArray& request,
+                                       const std::function<bool(const QList<QByteArray>&)>& is_answer,
+                                       int timeout_ms = -1);
+    void drop_disconnected_mount(const std::string& instance, Process* process, const std::string& target_path);
+
     const std::string key;
-    std::unordered_map<std::string, std::unordered_map<std::string, qt_delete_later_unique_ptr<Process>>>
-        mount_processes;
+    std::unordered_map<std::string, ServerProcess> server_processes;
+    std::unordered_map<Process*, qt_delete_later_unique_ptr<Process>> stopping_processes;
+    std::multimap<Process*, std::function<void(const QList<QByteArray>&)>> answer_waiters; // of requests in flight
 };
 
 } // namespace multipass
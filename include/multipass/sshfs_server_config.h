@@ -18,8 +18,11 @@
 #ifndef MULTIPASS_SSHFS_SERVER_CONFIG_H
 #define MULTIPASS_SSHFS_SERVER_CONFIG_H
 
+#include <multipass/id_mappings.h>
+
+#include <cstddef>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 namespace multipass
 {
@@ -33,8 +36,12 @@ struct SSHFSServerConfig
     std::string private_key;
     std::string source_path;
     std::string target_path;
-    std::unordered_map<int, int> gid_map;
-    std::unordered_map<int, int> uid_map;
+    IdMappings gid_map;
+    IdMappings uid_map;
+    std::vector<std::string> additional_source_paths; // of the other mounts served by the same sshfs_server
+    int workers{0};                                   // threads serving each mount, 0 to serve requests in turn
+    std::size_t write_buffer_size{0};                 // bytes held back per open file, 0 to write through
+    bool cache_attributes{false};
 };
 
 } // namespace multipass
@@ -26,6 +26,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 
 class QUrl;
 class QString;
@@ -34,11 +35,18 @@ namespace multipass
 class URLDownloader
 {
 public:
+    // Takes each piece of data as it arrives; returning false aborts the download
+    using DataSink = std::function<bool(const QByteArray&)>;
+
     URLDownloader(std::chrono::milliseconds timeout);
-    URLDownloader(const Path& cache_dir, std::chrono::milliseconds timeout);
+    // HTTP downloads go over up to max_connections parallel range requests, and resume where they stopped
+    URLDownloader(const Path& cache_dir, std::chrono::milliseconds timeout, int max_connections = 4);
     virtual ~URLDownloader() = default;
     virtual void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
                              const ProgressMonitor& monitor);
+    // Downloads to file_name as download_to does, while also handing the data to sink in order as it arrives
+    virtual void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                           const int download_type, const ProgressMonitor& monitor);
     virtual QByteArray download(const QUrl& url);
     virtual QDateTime last_modified(const QUrl& url);
     virtual void abort_all_downloads();
@@ -49,9 +57,12 @@ protected:
 private:
     URLDownloader(const URLDownloader&) = delete;
     URLDownloader& operator=(const URLDownloader&) = delete;
+    void download_to_file(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                          const int download_type, const ProgressMonitor& monitor);
 
     const Path cache_dir_path;
     std::chrono::milliseconds timeout;
+    const int max_connections;
 };
 }
 #endif // MULTIPASS_URL_DOWNLOADER_H
@@ -25,6 +25,7 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <sstream>
@@ -135,18 +136,24 @@ void multipass::utils::try_action_for(OnTimeoutCallable&& on_timeout, std::chron
     static_assert(std::is_same<decltype(try_action(std::forward<Args>(args)...)), TimeoutAction>::value, "");
     using namespace std::literals::chrono_literals;
 
+    // Whatever is being waited for is often ready within moments, so retry quickly at first and back off to a retry
+    // per second for the slow cases. The last try is made at the deadline.
+    constexpr std::chrono::steady_clock::duration first_retry_delay = 100ms, max_retry_delay = 1s;
+
     auto deadline = std::chrono::steady_clock::now() + timeout;
-    while (std::chrono::steady_clock::now() < deadline)
+    auto retry_delay = first_retry_delay;
+    while (try_action(std::forward<Args>(args)...) != TimeoutAction::done)
     {
-        if (try_action(std::forward<Args>(args)...) == TimeoutAction::done)
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            on_timeout();
             return;
+        }
 
-        if ((std::chrono::steady_clock::now() + 1s) >= deadline)
-            break;
-
-        std::this_thread::sleep_for(1s);
+        std::this_thread::sleep_for(std::min(retry_delay, deadline - now));
+        retry_delay = std::min(2 * retry_delay, max_retry_delay);
     }
-    on_timeout();
 }
 
 template <typename RegisteredQtEnum>
@@ -25,6 +25,7 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 
 namespace multipass
@@ -69,6 +70,16 @@ public:
     virtual void ensure_vm_is_running() = 0;
     virtual void update_state() = 0;
 
+    // Native mounts share a host directory through the hypervisor rather than over SSHFS. The device behind each is
+    // set up as the instance starts, so changes take effect from its next start.
+    virtual void add_native_mount(const std::string& /*source_path*/, const std::string& /*tag*/)
+    {
+        throw std::runtime_error("native mounts are not supported by this driver");
+    }
+    virtual void remove_native_mount(const std::string& /*tag*/)
+    {
+    }
+
     VirtualMachine::State state;
     const std::string vm_name;
     std::condition_variable state_wait;
@@ -18,6 +18,7 @@
 #ifndef MULTIPASS_VM_IMAGE_VAULT_H
 #define MULTIPASS_VM_IMAGE_VAULT_H
 
+#include <multipass/days.h>
 #include <multipass/fetch_type.h>
 #include <multipass/memory_size.h>
 #include <multipass/path.h>
@@ -30,6 +31,8 @@
 #include <memory>
 #include <string>
 
+class QDir;
+
 namespace multipass
 {
 namespace vault
@@ -39,6 +42,11 @@ QString filename_for(const Path& path);
 void delete_file(const Path& path);
 void verify_image_download(const Path& image_path, const QString& image_hash);
 QString extract_image(const Path& image_path, const ProgressMonitor& monitor, const bool delete_file = false);
+void sparse_copy(const Path& source_path, const Path& destination_path);
+bool reflink_copy(const Path& source_path, const Path& destination_path);
+QString backing_file_of(const Path& image_path);
+// Partial downloads are kept for the next attempt to resume, unless nothing was written to them for days_to_expire
+void remove_stale_partial_downloads(const QDir& partials_dir, const days& days_to_expire);
 
 class DeleteOnException
 {
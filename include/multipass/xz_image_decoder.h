@@ -22,13 +22,53 @@
 #include <multipass/progress_monitor.h>
 
 #include <memory>
+#include <vector>
 
+#include <QByteArray>
 #include <QFile>
 
 #include <xz.h>
 
 namespace multipass
 {
+using XzDecoderUPtr = std::unique_ptr<xz_dec, decltype(xz_dec_end)*>;
+
+// Decodes an xz stream handed to it in pieces of any size, as they become available
+class XzStreamDecoder
+{
+public:
+    XzStreamDecoder();
+
+    // Writes whatever the data decodes to into decoded_file, leaving holes for blocks of zeros; returns false once the
+    // end of the stream is reached
+    bool decode(const char* data, std::size_t size, QFileDevice& decoded_file);
+
+private:
+    XzDecoderUPtr xz_decoder;
+    std::vector<unsigned char> decoded_data;
+};
+
+// Where the blocks of an xz file are, as read from its index
+struct XzStreamIndex
+{
+    struct Block
+    {
+        qint64 offset;
+        qint64 unpadded_size;
+        qint64 decoded_offset;
+        qint64 decoded_size;
+    };
+
+    QByteArray stream_header;
+    std::vector<Block> blocks;
+    qint64 compressed_size{0};
+    qint64 decoded_size{0};
+};
+
+// Has no blocks unless the file holds a single stream that can be split up along its index
+XzStreamIndex read_stream_index(QFile& xz_file);
+
+// Decodes the independent blocks of multi-block files (as written by "xz -T") concurrently, and anything else in one go
 class XzImageDecoder
 {
 public:
@@ -36,11 +76,12 @@ public:
 
     void decode_to(const Path& decoded_file_path, const ProgressMonitor& monitor);
 
-    using XzDecoderUPtr = std::unique_ptr<xz_dec, decltype(xz_dec_end)*>;
-
 private:
+    void decode_blocks_in_parallel(const XzStreamIndex& stream_index, QFile& decoded_file, std::size_t thread_count,
+                                   const ProgressMonitor& monitor);
+
     QFile xz_file;
-    XzDecoderUPtr xz_decoder;
+    XzStreamDecoder xz_decoder;
 };
 } // namespace multipass
 #endif // MULTIPASS_XZ_IMAGE_DECODER_H
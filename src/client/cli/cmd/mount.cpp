@@ -47,6 +47,29 @@ auto convert_id_for(const QString& id_string)
 
     return id;
 }
+
+// A "<host>:<instance>" map goes in id_map, a "<first>-<last>:<instance>" one in id_ranges
+template <typename IdMap, typename IdRanges>
+void add_id_map(const QRegExp& map_matcher, IdMap& id_map, IdRanges& id_ranges)
+{
+    auto host_id = convert_id_for(map_matcher.cap(1));
+    auto instance_id = convert_id_for(map_matcher.cap(4));
+
+    if (map_matcher.cap(3).isEmpty())
+    {
+        id_map[host_id] = instance_id;
+        return;
+    }
+
+    auto last_host_id = convert_id_for(map_matcher.cap(3));
+    if (last_host_id < host_id)
+        throw std::runtime_error(fmt::format("{} is an invalid id range", map_matcher.cap(0).section(':', 0, 0)));
+
+    auto range = id_ranges.Add();
+    range->set_host_id(host_id);
+    range->set_instance_id(instance_id);
+    range->set_count(last_host_id - host_id + 1);
+}
 } // namespace
 
 mp::ReturnCode cmd::Mount::run(mp::ArgParser* parser)
@@ -106,13 +129,24 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
 
     QCommandLineOption gid_map({"g", "gid-map"}, "A mapping of group IDs for use in the mount. "
                                                  "File and folder ownership will be mapped from "
-                                                 "<host> to <instance> inside the instance. Can be "
+                                                 "<host> to <instance> inside the instance. A "
+                                                 "<first>-<last> range of host IDs maps to as many "
+                                                 "instance IDs, starting at <instance>. Can be "
                                                  "used multiple times.", "host>:<instance");
     QCommandLineOption uid_map({"u", "uid-map"}, "A mapping of user IDs for use in the mount. "
                                                  "File and folder ownership will be mapped from "
-                                                 "<host> to <instance> inside the instance. Can be "
+                                                 "<host> to <instance> inside the instance. A "
+                                                 "<first>-<last> range of host IDs maps to as many "
+                                                 "instance IDs, starting at <instance>. Can be "
                                                  "used multiple times.", "host>:<instance");
-    parser->addOptions({gid_map, uid_map});
+    QCommandLineOption mount_type({"t", "type"},
+                                  "Specify the type of mount to use. Classic mounts use SSHFS. Native mounts use the "
+                                  "hypervisor's shared filesystem support, are only available with the QEMU driver, "
+                                  "take effect when the instance next starts and do not map IDs. Valid types are: "
+                                  "'classic' (default) and 'native'",
+                                  "type", "classic");
+
+    parser->addOptions({gid_map, uid_map, mount_type});
 
     auto status = parser->commandParse(this);
     if (status != ParseCode::Ok)
@@ -170,7 +204,25 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
         }
     }
 
-    QRegExp map_matcher("^([0-9]+[:][0-9]+)$");
+    const auto type = parser->value(mount_type);
+    if (type == "native")
+    {
+        request.set_mount_type(mp::MountRequest::NATIVE);
+    }
+    else if (type != "classic")
+    {
+        cerr << "Bad mount type '" << type.toStdString() << "' given. Valid types are: 'classic' and 'native'\n";
+        return ParseCode::CommandLineError;
+    }
+
+    const auto native = request.mount_type() == mp::MountRequest::NATIVE;
+    if (native && (parser->isSet(uid_map) || parser->isSet(gid_map)))
+    {
+        cerr << "Native mounts do not map IDs\n";
+        return ParseCode::CommandLineError;
+    }
+
+    QRegExp map_matcher("^([0-9]+)(-([0-9]+))?[:]([0-9]+)$");
 
     if (parser->isSet(uid_map))
     {
@@ -184,14 +236,10 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
                 return ParseCode::CommandLineError;
             }
 
-            auto parsed_map = map.split(":");
-
             try
             {
-                auto host_uid = convert_id_for(parsed_map.at(0));
-                auto instance_uid = convert_id_for(parsed_map.at(1));
-
-                (*request.mutable_mount_maps()->mutable_uid_map())[host_uid] = instance_uid;
+                add_id_map(map_matcher, *request.mutable_mount_maps()->mutable_uid_map(),
+                           *request.mutable_mount_maps()->mutable_uid_ranges());
             }
             catch (const std::exception& e)
             {
@@ -213,14 +261,10 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
                 return ParseCode::CommandLineError;
             }
 
-            auto parsed_map = map.split(":");
-
             try
             {
-                auto host_gid = convert_id_for(parsed_map.at(0));
-                auto instance_gid = convert_id_for(parsed_map.at(1));
-
-                (*request.mutable_mount_maps()->mutable_gid_map())[host_gid] = instance_gid;
+                add_id_map(map_matcher, *request.mutable_mount_maps()->mutable_gid_map(),
+                           *request.mutable_mount_maps()->mutable_gid_ranges());
             }
             catch (const std::exception& e)
             {
@@ -230,7 +274,7 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
         }
     }
 
-    if (!parser->isSet(uid_map) && !parser->isSet(gid_map))
+    if (!native && !parser->isSet(uid_map) && !parser->isSet(gid_map))
     {
         mpl::log(mpl::Level::debug, category,
                  fmt::format("{}:{} {}(): adding default uid/gid mapping", __FILE__, __LINE__, __FUNCTION__));
@@ -15,6 +15,7 @@
  *
  */
 
+#include <multipass/cli/client_platform.h>
 #include <multipass/cli/format_utils.h>
 #include <multipass/cli/formatter.h>
 
@@ -46,6 +47,11 @@ auto make_map()
 const std::map<std::string, std::unique_ptr<mp::Formatter>> formatters{make_map()};
 const std::set<std::string> unwanted_aliases{"ubuntu", "default"};
 
+std::string instance_id_string_for(int instance_id)
+{
+    return instance_id == mp::default_id ? "default" : std::to_string(instance_id);
+}
+
 } // namespace
 
 std::string mp::format::status_string_for(const mp::InstanceStatus& status)
@@ -110,3 +116,20 @@ void mp::format::filter_aliases(google::protobuf::RepeatedPtrField<multipass::Fi
             aliases.DeleteSubrange(i, 1);
     }
 }
+
+std::vector<std::string>
+mp::format::id_mappings_for(const google::protobuf::Map<google::protobuf::int32, google::protobuf::int32>& id_map,
+                            const google::protobuf::RepeatedPtrField<multipass::IdRange>& id_ranges)
+{
+    std::vector<std::string> mappings;
+
+    for (const auto& id : id_map)
+        mappings.push_back(fmt::format("{}:{}", id.first, instance_id_string_for(id.second)));
+
+    for (const auto& range : id_ranges)
+        mappings.push_back(fmt::format("{}-{}:{}", range.host_id(),
+                                       static_cast<long long>(range.host_id()) + range.count() - 1,
+                                       instance_id_string_for(range.instance_id())));
+
+    return mappings;
+}
@@ -50,6 +50,23 @@ std::string mp::JsonFormatter::format(const InfoReply& reply) const
         }
         instance_info.insert("load", load);
 
+        if (info.load_history_size() > 0)
+        {
+            QJsonArray load_history;
+            for (const auto& sample : info.load_history())
+            {
+                QJsonArray sample_load;
+                for (const auto& entry : mp::utils::split(sample.load(), " "))
+                    sample_load.append(std::stod(entry));
+
+                QJsonObject entry;
+                entry.insert("timestamp", static_cast<qint64>(sample.timestamp()));
+                entry.insert("load", sample_load);
+                load_history.append(entry);
+            }
+            instance_info.insert("load_history", load_history);
+        }
+
         QJsonObject disks;
         QJsonObject disk;
         if (!info.disk_usage().empty())
@@ -80,25 +97,43 @@ std::string mp::JsonFormatter::format(const InfoReply& reply) const
             QJsonArray mount_uids;
             QJsonArray mount_gids;
 
-            for (const auto& uid_map : mount.mount_maps().uid_map())
-            {
-                mount_uids.append(
-                    QString("%1:%2")
-                        .arg(QString::number(uid_map.first))
-                        .arg((uid_map.second == mp::default_id) ? "default" : QString::number(uid_map.second)));
-            }
-            for (const auto& gid_map : mount.mount_maps().gid_map())
-            {
-                mount_gids.append(
-                    QString("%1:%2")
-                        .arg(QString::number(gid_map.first))
-                        .arg((gid_map.second == mp::default_id) ? "default" : QString::number(gid_map.second)));
-            }
+            for (const auto& uid_map :
+                 mp::format::id_mappings_for(mount.mount_maps().uid_map(), mount.mount_maps().uid_ranges()))
+                mount_uids.append(QString::fromStdString(uid_map));
+
+            for (const auto& gid_map :
+                 mp::format::id_mappings_for(mount.mount_maps().gid_map(), mount.mount_maps().gid_ranges()))
+                mount_gids.append(QString::fromStdString(gid_map));
 
             entry.insert("uid_mappings", mount_uids);
             entry.insert("gid_mappings", mount_gids);
             entry.insert("source_path", QString::fromStdString(mount.source_path()));
 
+            if (mount.has_io_stats())
+            {
+                QJsonObject operations;
+                for (const auto& op : mount.io_stats().operations())
+                {
+                    QJsonArray histogram;
+                    for (const auto count : op.latency_histogram())
+                        histogram.append(static_cast<qint64>(count));
+
+                    QJsonObject op_stats;
+                    op_stats.insert("count", static_cast<qint64>(op.count()));
+                    op_stats.insert("errors", static_cast<qint64>(op.errors()));
+                    op_stats.insert("median_latency_us", static_cast<qint64>(op.median_latency_us()));
+                    op_stats.insert("p99_latency_us", static_cast<qint64>(op.p99_latency_us()));
+                    op_stats.insert("latency_histogram", histogram);
+                    operations.insert(QString::fromStdString(op.operation()), op_stats);
+                }
+
+                QJsonObject io_stats;
+                io_stats.insert("bytes_read", static_cast<qint64>(mount.io_stats().bytes_read()));
+                io_stats.insert("bytes_written", static_cast<qint64>(mount.io_stats().bytes_written()));
+                io_stats.insert("operations", operations);
+                entry.insert("io_stats", io_stats);
+            }
+
             mounts.insert(QString::fromStdString(mount.target_path()), entry);
         }
         instance_info.insert("mounts", mounts);
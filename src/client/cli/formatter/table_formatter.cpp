@@ -82,25 +82,29 @@ std::string mp::TableFormatter::format(const InfoReply& reply) const
             fmt::format_to(buf, "{:<16}{:{}} => {}\n", (mount == mount_paths.cbegin()) ? "Mounts:" : " ",
                            mount->source_path(), info.mount_info().longest_path_len(), mount->target_path());
 
-            for (auto uid_map = mount->mount_maps().uid_map().cbegin(); uid_map != mount->mount_maps().uid_map().cend();
-                 ++uid_map)
-            {
-                fmt::format_to(
-                    buf, "{:>{}}{}:{}{}{}", (uid_map == mount->mount_maps().uid_map().cbegin()) ? "UID map: " : "",
-                    (uid_map == mount->mount_maps().uid_map().cbegin()) ? 29 : 0, std::to_string(uid_map->first),
-                    (uid_map->second == mp::default_id) ? "default" : std::to_string(uid_map->second),
-                    (std::next(uid_map) != mount->mount_maps().uid_map().cend()) ? ", " : "",
-                    (std::next(uid_map) == mount->mount_maps().uid_map().cend()) ? "\n" : "");
-            }
-            for (auto gid_map = mount->mount_maps().gid_map().cbegin(); gid_map != mount->mount_maps().gid_map().cend();
-                 ++gid_map)
+            const auto uid_mappings =
+                mp::format::id_mappings_for(mount->mount_maps().uid_map(), mount->mount_maps().uid_ranges());
+            if (!uid_mappings.empty())
+                fmt::format_to(buf, "{:>29}{}\n", "UID map: ", fmt::join(uid_mappings, ", "));
+
+            const auto gid_mappings =
+                mp::format::id_mappings_for(mount->mount_maps().gid_map(), mount->mount_maps().gid_ranges());
+            if (!gid_mappings.empty())
+                fmt::format_to(buf, "{:>29}{}\n", "GID map: ", fmt::join(gid_mappings, ", "));
+
+            if (mount->has_io_stats())
             {
-                fmt::format_to(
-                    buf, "{:>{}}{}:{}{}{}", (gid_map == mount->mount_maps().gid_map().cbegin()) ? "GID map: " : "",
-                    (gid_map == mount->mount_maps().gid_map().cbegin()) ? 29 : 0, std::to_string(gid_map->first),
-                    (gid_map->second == mp::default_id) ? "default" : std::to_string(gid_map->second),
-                    (std::next(gid_map) != mount->mount_maps().gid_map().cend()) ? ", " : "",
-                    (std::next(gid_map) == mount->mount_maps().gid_map().cend()) ? "\n" : "");
+                const auto& io_stats = mount->io_stats();
+                uint64_t ops = 0, errors = 0;
+                for (const auto& op : io_stats.operations())
+                {
+                    ops += op.count();
+                    errors += op.errors();
+                }
+
+                fmt::format_to(buf, "{:>29}{} ops, {} errors, {} read, {} written\n", "I/O: ", ops, errors,
+                               human_readable_size(std::to_string(io_stats.bytes_read())),
+                               human_readable_size(std::to_string(io_stats.bytes_written())));
             }
         }
 
@@ -88,20 +88,38 @@ std::string mp::YamlFormatter::format(const InfoReply& reply) const
         {
             YAML::Node mount_node;
 
-            for (const auto& uid_map : mount.mount_maps().uid_map())
-            {
-                mount_node["uid_mappings"].push_back(
-                    fmt::format("{}:{}", std::to_string(uid_map.first),
-                                (uid_map.second == mp::default_id) ? "default" : std::to_string(uid_map.second)));
-            }
-            for (const auto& gid_map : mount.mount_maps().gid_map())
-            {
-                mount_node["gid_mappings"].push_back(
-                    fmt::format("{}:{}", std::to_string(gid_map.first),
-                                (gid_map.second == mp::default_id) ? "default" : std::to_string(gid_map.second)));
-            }
+            for (const auto& uid_map :
+                 mp::format::id_mappings_for(mount.mount_maps().uid_map(), mount.mount_maps().uid_ranges()))
+                mount_node["uid_mappings"].push_back(uid_map);
+
+            for (const auto& gid_map :
+                 mp::format::id_mappings_for(mount.mount_maps().gid_map(), mount.mount_maps().gid_ranges()))
+                mount_node["gid_mappings"].push_back(gid_map);
 
             mount_node["source_path"] = mount.source_path();
+
+            if (mount.has_io_stats())
+            {
+                YAML::Node io_stats;
+                io_stats["bytes_read"] = mount.io_stats().bytes_read();
+                io_stats["bytes_written"] = mount.io_stats().bytes_written();
+                io_stats["operations"] = YAML::Node(YAML::NodeType::Map);
+
+                for (const auto& op : mount.io_stats().operations())
+                {
+                    YAML::Node op_stats;
+                    op_stats["count"] = op.count();
+                    op_stats["errors"] = op.errors();
+                    op_stats["median_latency_us"] = op.median_latency_us();
+                    op_stats["p99_latency_us"] = op.p99_latency_us();
+                    for (const auto count : op.latency_histogram())
+                        op_stats["latency_histogram"].push_back(count);
+
+                    io_stats["operations"][op.operation()] = op_stats;
+                }
+
+                mount_node["io_stats"] = io_stats;
+            }
             mounts[mount.target_path()] = mount_node;
         }
         instance_node["mounts"] = mounts;
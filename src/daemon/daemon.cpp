@@ -31,7 +31,9 @@
 #include <multipass/name_generator.h>
 #include <multipass/platform.h>
 #include <multipass/query.h>
+#include <multipass/settings.h>
 #include <multipass/ssh/ssh_session.h>
+#include <multipass/ssh/ssh_session_pool.h>
 #include <multipass/utils.h>
 #include <multipass/version.h>
 #include <multipass/virtual_machine.h>
@@ -44,6 +46,7 @@
 #include <multipass/format.h>
 #include <yaml-cpp/yaml.h>
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QEventLoop>
 #include <QFutureSynchronizer>
@@ -52,8 +55,12 @@
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QSysInfo>
+#include <QThread>
+#include <QTimeZone>
 #include <QtConcurrent/QtConcurrent>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
 #include <stdexcept>
@@ -77,6 +84,11 @@ constexpr auto metrics_opt_in_file = "multipassd-send-metrics.yaml";
 constexpr auto reboot_cmd = "sudo reboot";
 constexpr auto up_timeout = 2min; // This may be tweaked as appropriate and used in places that wait for ssh to be up
 constexpr auto cloud_init_timeout = 5min;
+constexpr auto max_parallel_probes = 16;
+constexpr auto telemetry_history_size = 120u; // samples kept per instance
+constexpr auto telemetry_history_span = 10min; // of samples reported by info
+constexpr auto idle_ssh_sessions_check = 1min;
+constexpr auto telemetry_settings_check = 1min; // while sampling is turned off
 constexpr auto stop_ssh_cmd = "sudo systemctl stop ssh";
 const std::string sshfs_error_template = "Error enabling mount support in '{}'"
                                          "\n\nPlease install the 'multipass-sshfs' snap manually inside the instance.";
@@ -99,6 +111,66 @@ mp::Query query_from(const mp::LaunchRequest* request, const std::string& name)
     return {name, image, false, request->remote_name(), query_type, true};
 }
 
+// Keeps the I/O of the calling thread at background priority while it is in scope
+class BackgroundIOPriority
+{
+public:
+    BackgroundIOPriority()
+    {
+        mp::platform::set_background_io_priority(true);
+    }
+
+    ~BackgroundIOPriority()
+    {
+        mp::platform::set_background_io_priority(false);
+    }
+};
+
+// The images of the prefetch setting, like "lts,daily:devel", to be kept ready for launches
+std::vector<mp::Query> prefetch_queries()
+{
+    std::vector<mp::Query> queries;
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    for (const auto& image : MP_SETTINGS.get(mp::image_prefetch_key).split(',', Qt::SkipEmptyParts))
+#else
+    for (const auto& image : MP_SETTINGS.get(mp::image_prefetch_key).split(',', QString::SkipEmptyParts))
+#endif
+    {
+        const auto remote_and_alias = image.trimmed().split(':');
+        const auto& alias = remote_and_alias.constLast();
+        const auto remote = remote_and_alias.size() > 1 ? remote_and_alias.constFirst() : QString{};
+
+        queries.push_back({"", alias.toStdString(), false, remote.toStdString(), mp::Query::Type::Alias});
+    }
+
+    return queries;
+}
+
+// The images to keep spare instances of: those to prefetch, or else the default one
+std::vector<std::string> spare_instance_images()
+{
+    std::vector<std::string> images;
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    for (const auto& image : MP_SETTINGS.get(mp::image_prefetch_key).split(',', Qt::SkipEmptyParts))
+#else
+    for (const auto& image : MP_SETTINGS.get(mp::image_prefetch_key).split(',', QString::SkipEmptyParts))
+#endif
+        images.push_back(image.trimmed().toStdString());
+
+    if (images.empty())
+        images.push_back("default");
+
+    return images;
+}
+
+// The image of a launch request, written the way it is in the prefetch setting
+std::string image_key_for(const mp::LaunchRequest* request)
+{
+    const auto image = request->image().empty() ? std::string{"default"} : request->image();
+
+    return request->remote_name().empty() ? image : request->remote_name() + ":" + image;
+}
+
 auto make_cloud_init_vendor_config(const mp::SSHKeyProvider& key_provider, const std::string& time_zone,
                                    const std::string& username, const std::string& backend_version_string)
 {
@@ -195,6 +267,65 @@ auto name_from(const std::string& requested_name, mp::NameGenerator& name_gen, c
     return requested_name;
 }
 
+// Entries without a count, as written before ranges were supported, map a single ID
+mp::IdMappings id_mappings_from_json(const QJsonArray& entries, const QString& kind)
+{
+    mp::IdMappings mappings;
+    for (const auto& entry : entries)
+    {
+        const auto map = entry.toObject();
+        mappings.add(map["host_" + kind].toInt(), map["instance_" + kind].toInt(), map["count"].toInt(1));
+    }
+
+    return mappings;
+}
+
+QJsonArray id_mappings_to_json(const mp::IdMappings& mappings, const QString& kind)
+{
+    QJsonArray entries;
+    for (const auto& range : mappings.ranges())
+    {
+        QJsonObject map_entry;
+        map_entry.insert("host_" + kind, range.host_id);
+        map_entry.insert("instance_" + kind, range.instance_id);
+        if (range.count > 1)
+            map_entry.insert("count", range.count);
+
+        entries.append(map_entry);
+    }
+
+    return entries;
+}
+
+template <typename IdMap, typename IdRanges>
+mp::IdMappings id_mappings_from(const IdMap& id_map, const IdRanges& id_ranges)
+{
+    mp::IdMappings mappings{std::unordered_map<int, int>{id_map.begin(), id_map.end()}};
+    for (const auto& range : id_ranges)
+        mappings.add(range.host_id(), range.instance_id(), range.count());
+
+    return mappings;
+}
+
+void add_id_mappings_to(google::protobuf::Map<google::protobuf::int32, google::protobuf::int32>& id_map,
+                        google::protobuf::RepeatedPtrField<mp::IdRange>& id_ranges, const mp::IdMappings& mappings)
+{
+    for (const auto& range : mappings.ranges())
+    {
+        if (range.count == 1)
+        {
+            id_map[range.host_id] = range.instance_id;
+        }
+        else
+        {
+            auto entry = id_ranges.Add();
+            entry->set_host_id(range.host_id);
+            entry->set_instance_id(range.instance_id);
+            entry->set_count(range.count);
+        }
+    }
+}
+
 std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path, const mp::Path& cache_path)
 {
     QDir data_dir{data_path};
@@ -233,31 +364,32 @@ std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
         auto state = record["state"].toInt();
         auto deleted = record["deleted"].toBool();
         auto metadata = record["metadata"].toObject();
+        auto spare_for = record["spare_for"].toString().toStdString();
 
         if (ssh_username.empty())
             ssh_username = "ubuntu";
 
         std::unordered_map<std::string, mp::VMMount> mounts;
-        std::unordered_map<int, int> uid_map;
-        std::unordered_map<int, int> gid_map;
 
         for (QJsonValueRef entry : record["mounts"].toArray())
         {
             auto target_path = entry.toObject()["target_path"].toString().toStdString();
             auto source_path = entry.toObject()["source_path"].toString().toStdString();
+            auto mount_type = static_cast<mp::MountRequest::MountType>(entry.toObject()["mount_type"].toInt());
 
-            for (QJsonValueRef uid_entry : entry.toObject()["uid_mappings"].toArray())
+            try
             {
-                uid_map[uid_entry.toObject()["host_uid"].toInt()] = uid_entry.toObject()["instance_uid"].toInt();
-            }
+                auto uid_map = id_mappings_from_json(entry.toObject()["uid_mappings"].toArray(), "uid");
+                auto gid_map = id_mappings_from_json(entry.toObject()["gid_mappings"].toArray(), "gid");
 
-            for (QJsonValueRef gid_entry : entry.toObject()["gid_mappings"].toArray())
+                mp::VMMount mount{source_path, gid_map, uid_map, mount_type};
+                mounts[target_path] = mount;
+            }
+            catch (const std::invalid_argument& e)
             {
-                gid_map[gid_entry.toObject()["host_gid"].toInt()] = gid_entry.toObject()["instance_gid"].toInt();
+                mpl::log(mpl::Level::warning, category,
+                         fmt::format("Skipping mount \"{}\" of {}: {}", target_path, key, e.what()));
             }
-
-            mp::VMMount mount{source_path, gid_map, uid_map};
-            mounts[target_path] = mount;
         }
 
         reconstructed_records[key] = {num_cores,
@@ -268,7 +400,8 @@ std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
                                       static_cast<mp::VirtualMachine::State>(state),
                                       mounts,
                                       deleted,
-                                      metadata};
+                                      metadata,
+                                      spare_for};
     }
     return reconstructed_records;
 }
@@ -526,6 +659,50 @@ mp::SSHProcess exec_and_log(mp::SSHSession& session, const std::string& cmd)
     return session.exec(cmd);
 }
 
+// The guest finds a native mount's device by its tag, which virtio-fs limits to 36 characters
+std::string native_mount_tag_for(const std::string& target_path)
+{
+    const auto hash = QCryptographicHash::hash(QByteArray::fromStdString(target_path), QCryptographicHash::Sha256);
+    return "mp" + hash.toHex().left(32).toStdString();
+}
+
+// A native mount that cannot be set up, for instance after a driver change, is left in place for the user to remove
+void add_native_mount_for(mp::VirtualMachine& vm, const std::string& source_path, const std::string& target_path)
+{
+    try
+    {
+        vm.add_native_mount(source_path, native_mount_tag_for(target_path));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot mount \"{}\" in {}: {}", target_path, vm.vm_name, e.what()));
+    }
+}
+
+void set_io_stats(mp::MountIOStats* reply_stats, const mp::MountStats::Snapshot& stats)
+{
+    reply_stats->set_bytes_read(stats.bytes_read);
+    reply_stats->set_bytes_written(stats.bytes_written);
+
+    for (std::size_t i = 0; i < stats.operations.size(); ++i)
+    {
+        const auto& op = stats.operations[i];
+        if (op.count == 0 && op.errors == 0)
+            continue;
+
+        auto entry = reply_stats->add_operations();
+        entry->set_operation(mp::MountStats::name_of(static_cast<mp::MountStats::Operation>(i)));
+        entry->set_count(op.count);
+        entry->set_errors(op.errors);
+        entry->set_median_latency_us(mp::MountStats::latency_percentile(op.latency_histogram, 0.5));
+        entry->set_p99_latency_us(mp::MountStats::latency_percentile(op.latency_histogram, 0.99));
+
+        for (const auto count : op.latency_histogram)
+            entry->add_latency_histogram(count);
+    }
+}
+
 grpc::Status stop_accepting_ssh_connections(mp::SSHSession& session)
 {
     auto proc = exec_and_log(session, stop_ssh_cmd);
@@ -537,11 +714,8 @@ grpc::Status stop_accepting_ssh_connections(mp::SSHSession& session)
                                      proc.read_std_error()};
 }
 
-grpc::Status ssh_reboot(const std::string& hostname, int port, const std::string& username,
-                        const mp::SSHKeyProvider& key_provider)
+grpc::Status ssh_reboot(mp::SSHSession& session)
 {
-    mp::SSHSession session{hostname, port, username, key_provider};
-
     // This allows us to later detect when the machine has finished restarting by waiting for SSH to be back up.
     // Otherwise, there would be a race condition, and we would be unable to distinguish whether it had ever been down.
     stop_accepting_ssh_connections(session);
@@ -602,6 +776,90 @@ mp::InstanceStatus::Status grpc_instance_status_for(const mp::VirtualMachine::St
     }
 }
 
+// What is needed to reach a running instance over SSH, read from it on the daemon's thread, as instances are not
+// thread-safe
+struct SSHTarget
+{
+    std::string name;
+    std::string hostname;
+    int port;
+    std::string username;
+};
+
+// What info needs to ask an instance about itself, taken on the daemon's thread
+struct InstanceProbe
+{
+    SSHTarget target;
+    mp::optional<mp::TelemetrySample> sample; // a recent enough one from the background, if there is any
+};
+
+// Everything sampled from inside an instance, one line each in the output of a single command
+const std::vector<std::string> probe_commands{
+    "cat /proc/loadavg | cut -d ' ' -f1-3",
+    "free -b | sed '1d;3d' | awk '{printf $3}'",
+    "free -b | sed '1d;3d' | awk '{printf $2}'",
+    "df --output=used `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d",
+    "df --output=size `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d",
+    "lsb_release -ds"};
+
+// Failures are logged at the given level, so that background sampling does not fill the log with them
+mp::TelemetrySample sample_instance(const SSHTarget& target, mp::SSHSessionPool& ssh_sessions,
+                                    mpl::Level failure_level)
+{
+    auto session = ssh_sessions.acquire(target.name, target.hostname, target.port, target.username);
+
+    std::string script;
+    for (const auto& cmd : probe_commands)
+        script += fmt::format("printf '%s\\n' \"$({})\"\n", cmd);
+
+    std::vector<std::string> fields;
+    auto proc = session->exec(script);
+    if (proc.exit_code() != 0)
+    {
+        auto error_msg = proc.read_std_error();
+        mpl::log(failure_level, category,
+                 fmt::format("failed to probe instance, error message: '{}'", mp::utils::trim_end(error_msg)));
+    }
+    else
+    {
+        fields = mp::utils::split(proc.read_std_output(), "\n");
+    }
+
+    fields.resize(probe_commands.size());
+    for (auto i = 0u; i < fields.size(); ++i)
+    {
+        if (mp::utils::trim_end(fields[i]).empty())
+            mpl::log(failure_level, category, fmt::format("no output after running '{}'", probe_commands[i]));
+    }
+
+    return {std::chrono::system_clock::now(), fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]};
+}
+
+void probe_instance(mp::InfoReply::Info& info, const InstanceProbe& probe, mp::SSHSessionPool& ssh_sessions)
+{
+    const auto sample = probe.sample ? *probe.sample : sample_instance(probe.target, ssh_sessions, mpl::Level::warning);
+
+    info.set_load(sample.load);
+    info.set_memory_usage(sample.memory_usage);
+    info.set_memory_total(sample.memory_total);
+    info.set_disk_usage(sample.disk_usage);
+    info.set_disk_total(sample.disk_total);
+    info.set_current_release(!sample.current_release.empty() ? sample.current_release : info.image_release());
+}
+
+// An info reply whose instances are being probed in parallel
+struct PendingInfoReply
+{
+    PendingInfoReply(mp::InfoReply response, std::size_t probes) : response{std::move(response)}, remaining{probes}
+    {
+    }
+
+    mp::InfoReply response;
+    std::atomic<std::size_t> remaining;
+    std::mutex mutex;
+    std::string error;
+};
+
 // Computes the final size of an image, but also checks if the value given by the user is bigger than or equal than
 // the size of the image.
 mp::MemorySize compute_final_image_size(const mp::MemorySize image_size,
@@ -638,8 +896,13 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
       metrics_provider{"https://api.jujucharms.com/omnibus/v4/multipass/metrics", get_unique_id(config->data_directory),
                        config->data_directory},
       metrics_opt_in{get_metrics_opt_in(config->data_directory)},
-      instance_mounts{*config->ssh_key_provider}
+      instance_mounts{*config->ssh_key_provider},
+      ssh_sessions{*config->ssh_key_provider},
+      telemetry{telemetry_history_size}
 {
+    // Probing instances mostly waits on them, so more of it can go on at once than there are cores
+    read_only_rpc_pool.setMaxThreadCount(std::max(QThread::idealThreadCount(), max_parallel_probes));
+
     connect_rpc(daemon_rpc, *this);
     std::vector<std::string> invalid_specs;
     bool mac_addr_missing{false};
@@ -680,8 +943,15 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
 
         try
         {
-            auto& instance_record = spec.deleted ? deleted_instances : vm_instances;
+            auto& instance_record =
+                spec.deleted ? deleted_instances : spec.spare_for.empty() ? vm_instances : spare_instances;
             instance_record[name] = config->factory->create_virtual_machine(vm_desc, *this);
+
+            for (const auto& mount : spec.mounts)
+            {
+                if (mount.second.mount_type == MountRequest::NATIVE)
+                    add_native_mount_for(*instance_record[name], mount.second.source_path, mount.first);
+            }
         }
         catch (const std::exception& e)
         {
@@ -699,7 +969,13 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
             spec.state = VirtualMachine::State::stopped;
         }
 
-        if (spec.state == VirtualMachine::State::running && vm_instances[name]->state != VirtualMachine::State::running)
+        if (!spec.spare_for.empty())
+        {
+            if (spec.state == VirtualMachine::State::running && spare_instances.count(name))
+                QTimer::singleShot(0, [this, &name] { spare_instances[name]->start(); });
+        }
+        else if (spec.state == VirtualMachine::State::running &&
+                 vm_instances[name]->state != VirtualMachine::State::running)
         {
             assert(!spec.deleted);
             mpl::log(mpl::Level::info, category, fmt::format("{} needs starting. Starting now...", name));
@@ -730,47 +1006,148 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
     config->vault->prune_expired_images();
 
     // Fire timer every six hours to perform maintenance on source images such as
-    // pruning expired images and updating to newly released images.
+    // pruning expired images, updating to newly released images, prefetching images and topping up spare instances.
     connect(&source_images_maintenance_task, &QTimer::timeout, [this]() {
-        if (image_update_future.isRunning())
-        {
-            mpl::log(mpl::Level::info, category, "Image updater already running. Skipping…");
-        }
-        else
-        {
-            image_update_future = QtConcurrent::run([this] {
-                config->vault->prune_expired_images();
+        maintain_source_images();
+        replenish_spare_instances();
+    });
+    source_images_maintenance_task.start(config->image_refresh_timer);
+
+    // Images to prefetch should not have to wait for the first timeout
+    if (!prefetch_queries().empty())
+        maintain_source_images();
+
+    QTimer::singleShot(0, this, [this] { replenish_spare_instances(); });
+
+    // Instances are first sampled one interval in, when most are done booting
+    connect(&telemetry_task, &QTimer::timeout, [this]() { sample_instance_telemetry(); });
+    telemetry_task.setSingleShot(true);
+    const auto telemetry_interval = std::chrono::seconds{MP_SETTINGS.get_as<int>(mp::telemetry_interval_key)};
+    telemetry_task.start(telemetry_interval.count() > 0 ? telemetry_interval : telemetry_settings_check);
+
+    // Sessions of instances nobody talks to any more are closed rather than left to the next lease
+    connect(&idle_ssh_sessions_task, &QTimer::timeout, [this]() { ssh_sessions.expire_idle_sessions(); });
+    idle_ssh_sessions_task.start(idle_ssh_sessions_check);
+}
+
+mp::Daemon::~Daemon()
+{
+    // Downloads can run for long, so the image updater is stopped rather than waited out
+    stopping_image_updates = true;
+    config->url_downloader->abort_all_downloads();
+    image_update_future.waitForFinished();
+}
+
+void mp::Daemon::maintain_source_images()
+{
+    if (image_update_future.isRunning())
+    {
+        mpl::log(mpl::Level::info, category, "Image updater already running. Skipping…");
+    }
+    else
+    {
+        image_update_future = QtConcurrent::run([this] {
+            // Stay out of the way of instances and of launches
+            BackgroundIOPriority background_io_priority;
+            config->vault->prune_expired_images();
+            if (stopping_image_updates)
+                return;
+
+            auto prepare_action = [this](const VMImage& source_image) -> VMImage {
+                return config->factory->prepare_source_image(source_image);
+            };
 
-                auto prepare_action = [this](const VMImage& source_image) -> VMImage {
-                    return config->factory->prepare_source_image(source_image);
-                };
+            auto download_monitor = [this](int download_type, int percentage) {
+                if (stopping_image_updates)
+                    return false;
 
-                auto download_monitor = [](int download_type, int percentage) {
-                    static int last_percentage_logged = -1;
-                    if (percentage % 10 == 0)
+                static int last_percentage_logged = -1;
+                if (percentage % 10 == 0)
+                {
+                    // Note: The progress callback may be called repeatedly with the same percentage,
+                    // so this logic is to only log it once
+                    if (last_percentage_logged != percentage)
                     {
-                        // Note: The progress callback may be called repeatedly with the same percentage,
-                        // so this logic is to only log it once
-                        if (last_percentage_logged != percentage)
-                        {
-                            mpl::log(mpl::Level::info, category, fmt::format("  {}%", percentage));
-                            last_percentage_logged = percentage;
-                        }
+                        mpl::log(mpl::Level::info, category, fmt::format("  {}%", percentage));
+                        last_percentage_logged = percentage;
                     }
-                    return true;
-                };
+                }
+                return true;
+            };
+            try
+            {
+                config->vault->update_images(config->factory->fetch_type(), prepare_action, download_monitor);
+            }
+            catch (const std::exception& e)
+            {
+                mpl::log(mpl::Level::error, category, fmt::format("Error updating images: {}", e.what()));
+            }
+
+            // Fetching records the images as accessed, which keeps them from expiring while they are prefetched
+            for (const auto& query : prefetch_queries())
+            {
+                if (stopping_image_updates)
+                    return;
+
+                mpl::log(mpl::Level::info, category, fmt::format("Prefetching image {}", query.release));
                 try
                 {
-                    config->vault->update_images(config->factory->fetch_type(), prepare_action, download_monitor);
+                    config->vault->fetch_image(config->factory->fetch_type(), query, prepare_action, download_monitor);
                 }
                 catch (const std::exception& e)
                 {
-                    mpl::log(mpl::Level::error, category, fmt::format("Error updating images: {}", e.what()));
+                    mpl::log(mpl::Level::error, category,
+                             fmt::format("Error prefetching image {}: {}", query.release, e.what()));
                 }
-            });
+            }
+        });
+    }
+}
+
+void mp::Daemon::sample_instance_telemetry()
+{
+    const auto interval = std::chrono::seconds{MP_SETTINGS.get_as<int>(mp::telemetry_interval_key)};
+
+    if (interval.count() > 0)
+    {
+        if (pending_telemetry_samples > 0)
+        {
+            mpl::log(mpl::Level::debug, category, "Instances are still being sampled. Skipping…");
         }
-    });
-    source_images_maintenance_task.start(config->image_refresh_timer);
+        else
+        {
+            // Instances are not thread-safe, so how to reach them is read here, on the daemon's thread. Those whose
+            // address is not known yet are left for a later sample, rather than waited for.
+            std::vector<SSHTarget> targets;
+            for (const auto& instance : vm_instances)
+            {
+                auto& vm = *instance.second;
+                if (mp::utils::is_running(vm.current_state()) && vm.ip)
+                    targets.push_back({instance.first, vm.ssh_hostname(), vm.ssh_port(),
+                                       vm_instance_specs[instance.first].ssh_username});
+            }
+
+            pending_telemetry_samples = targets.size();
+            for (const auto& target : targets)
+            {
+                QtConcurrent::run(&read_only_rpc_pool, [this, target] {
+                    try
+                    {
+                        telemetry.record(target.name, sample_instance(target, ssh_sessions, mpl::Level::debug));
+                    }
+                    catch (const std::exception& e)
+                    {
+                        mpl::log(mpl::Level::debug, category,
+                                 fmt::format("Cannot sample instance \"{}\": {}", target.name, e.what()));
+                    }
+
+                    --pending_telemetry_samples;
+                });
+            }
+        }
+    }
+
+    telemetry_task.start(interval.count() > 0 ? interval : telemetry_settings_check);
 }
 
 void mp::Daemon::create(const CreateRequest* request, grpc::ServerWriter<CreateReply>* server,
@@ -1022,7 +1399,8 @@ void mp::Daemon::info(const InfoRequest* request, grpc::ServerWriter<InfoReply>*
                       std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
 {
-    mpl::ClientLogger<InfoReply> logger{mpl::level_from(request->verbosity_level()), *config->logger, server};
+    auto logger = std::make_shared<mpl::ClientLogger<InfoReply>>(mpl::level_from(request->verbosity_level()),
+                                                                  *config->logger, server);
     InfoReply response;
 
     fmt::memory_buffer errors;
@@ -1039,6 +1417,9 @@ try // clang-format on
             instances_for_info.push_back(name);
     }
 
+    const auto telemetry_interval = std::chrono::seconds{MP_SETTINGS.get_as<int>(mp::telemetry_interval_key)};
+    std::vector<InstanceProbe> probes;
+    std::vector<int> probe_indices; // of the info each probe fills in
     for (const auto& name : instances_for_info)
     {
         auto it = vm_instances.find(name);
@@ -1055,17 +1436,7 @@ try // clang-format on
         }
 
         auto info = response.add_info();
-        auto& vm = it->second;
-        auto present_state = vm->current_state();
         info->set_name(name);
-        if (deleted)
-        {
-            info->mutable_instance_status()->set_status(mp::InstanceStatus::DELETED);
-        }
-        else
-        {
-            info->mutable_instance_status()->set_status(grpc_instance_status_for(present_state));
-        }
 
         auto vm_image = fetch_image_for(name, config->factory->fetch_type(), *config->vault);
         auto original_release = vm_image.original_release;
@@ -1092,6 +1463,8 @@ try // clang-format on
 
         mount_info->set_longest_path_len(0);
 
+        const auto mount_stats = instance_mounts.mount_stats(name);
+
         for (const auto& mount : vm_specs.mounts)
         {
             if (mount.second.source_path.size() > mount_info->longest_path_len())
@@ -1103,61 +1476,86 @@ try // clang-format on
             entry->set_source_path(mount.second.source_path);
             entry->set_target_path(mount.first);
 
-            for (const auto& uid_map : mount.second.uid_map)
-            {
-                (*entry->mutable_mount_maps()->mutable_uid_map())[uid_map.first] = uid_map.second;
-            }
-            for (const auto& gid_map : mount.second.gid_map)
-            {
-                (*entry->mutable_mount_maps()->mutable_gid_map())[gid_map.first] = gid_map.second;
-            }
+            auto mount_maps = entry->mutable_mount_maps();
+            add_id_mappings_to(*mount_maps->mutable_uid_map(), *mount_maps->mutable_uid_ranges(),
+                               mount.second.uid_map);
+            add_id_mappings_to(*mount_maps->mutable_gid_map(), *mount_maps->mutable_gid_ranges(),
+                               mount.second.gid_map);
+
+            auto stats = mount_stats.find(mount.first);
+            if (stats != mount_stats.end())
+                set_io_stats(entry->mutable_io_stats(), stats->second);
         }
 
-        if (mp::utils::is_running(present_state))
+        const auto now = std::chrono::system_clock::now();
+        for (const auto& sample : telemetry.history(name, now - telemetry_history_span))
         {
-            mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                   *config->ssh_key_provider};
+            if (sample.load.empty())
+                continue;
 
-            auto run_in_vm = [&session](const std::string& cmd) {
-                auto proc = session.exec(cmd);
-                if (proc.exit_code() != 0)
-                {
-                    auto error_msg = proc.read_std_error();
-                    mpl::log(
-                        mpl::Level::warning, category,
-                        fmt::format("failed to run '{}', error message: '{}'", cmd, mp::utils::trim_end(error_msg)));
-                    return std::string{};
-                }
+            auto load_sample = info->add_load_history();
+            load_sample->set_timestamp(
+                std::chrono::duration_cast<std::chrono::seconds>(sample.time.time_since_epoch()).count());
+            load_sample->set_load(sample.load);
+        }
 
-                auto output = proc.read_std_output();
-                if (output.empty())
-                {
-                    mpl::log(mpl::Level::warning, category, fmt::format("no output after running '{}'", cmd));
-                    return std::string{};
-                }
+        // Samples are taken every interval, so one that is older than two of them was not refreshed and is not used
+        auto sample = telemetry.latest(name);
+        if (sample && (telemetry_interval.count() == 0 || sample->time + 2 * telemetry_interval < now))
+            sample = nullopt;
 
-                return mp::utils::trim_end(output);
-            };
+        // Instances are not thread-safe, so all that is asked of them is asked here, on the daemon's thread
+        auto& vm = *it->second;
+        const auto present_state = vm.current_state();
+        info->mutable_instance_status()->set_status(deleted ? mp::InstanceStatus::DELETED
+                                                            : grpc_instance_status_for(present_state));
 
-            info->set_load(run_in_vm("cat /proc/loadavg | cut -d ' ' -f1-3"));
-            info->set_memory_usage(run_in_vm("free -b | sed '1d;3d' | awk '{printf $3}'"));
-            info->set_memory_total(run_in_vm("free -b | sed '1d;3d' | awk '{printf $2}'"));
-            info->set_disk_usage(
-                run_in_vm("df --output=used `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d"));
-            info->set_disk_total(
-                run_in_vm("df --output=size `awk '$2 == \"/\" { print $1 }' /proc/mounts` -B1 | sed 1d"));
-            info->set_ipv4(vm->ipv4());
-
-            auto current_release = run_in_vm("lsb_release -ds");
-            info->set_current_release(!current_release.empty() ? current_release : original_release);
+        if (mp::utils::is_running(present_state))
+        {
+            info->set_ipv4(vm.ipv4());
+            probe_indices.push_back(response.info_size() - 1);
+            probes.push_back({{name, vm.ssh_hostname(), vm.ssh_port(), vm_specs.ssh_username}, sample});
         }
     }
 
     auto status = grpc_status_for(errors);
-    if (status.ok())
+    if (!status.ok())
+        return status_promise->set_value(status);
+
+    if (probes.empty())
+    {
         server->Write(response);
+        return status_promise->set_value(status);
+    }
 
-    status_promise->set_value(status);
+    // Probing the instances over SSH can take a while, so it is done away from the daemon's thread, on the snapshot
+    // taken above. Instances are probed in parallel, and the last probe to finish answers the client.
+    auto reply = std::make_shared<PendingInfoReply>(std::move(response), probes.size());
+    for (auto i = 0u; i < probes.size(); ++i)
+    {
+        QtConcurrent::run(&read_only_rpc_pool, [this, logger, server, status_promise, reply, probe = probes[i],
+                                                index = probe_indices[i]] {
+            try
+            {
+                probe_instance(*reply->response.mutable_info(index), probe, ssh_sessions);
+            }
+            catch (const std::exception& e)
+            {
+                std::lock_guard<std::mutex> lock{reply->mutex};
+                reply->error = e.what();
+            }
+
+            if (--reply->remaining == 0)
+            {
+                if (!reply->error.empty())
+                    return status_promise->set_value(
+                        grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, reply->error, ""));
+
+                server->Write(reply->response);
+                status_promise->set_value(grpc::Status::OK);
+            }
+        });
+    }
 }
 catch (const std::exception& e)
 {
@@ -1172,6 +1570,7 @@ try // clang-format on
     ListReply response;
     config->update_prompt->populate_if_time_to_show(response.mutable_update_info());
 
+    // Instances are not thread-safe, and list needs nothing slow of them, so all of it is answered from here
     for (const auto& instance : vm_instances)
     {
         const auto& name = instance.first;
@@ -1248,10 +1647,17 @@ try // clang-format on
                          fmt::format("source \"{}\" is not readable", request->source_path()), ""));
     }
 
-    std::unordered_map<int, int> uid_map{request->mount_maps().uid_map().begin(),
-                                         request->mount_maps().uid_map().end()};
-    std::unordered_map<int, int> gid_map{request->mount_maps().gid_map().begin(),
-                                         request->mount_maps().gid_map().end()};
+    mp::IdMappings uid_map, gid_map;
+    try
+    {
+        uid_map = id_mappings_from(request->mount_maps().uid_map(), request->mount_maps().uid_ranges());
+        gid_map = id_mappings_from(request->mount_maps().gid_map(), request->mount_maps().gid_ranges());
+    }
+    catch (const std::invalid_argument& e)
+    {
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, fmt::format("invalid ID mappings: {}", e.what()), ""));
+    }
 
     fmt::memory_buffer errors;
     for (const auto& path_entry : request->target_paths())
@@ -1280,6 +1686,45 @@ try // clang-format on
         auto& vm = it->second;
         auto& vm_specs = vm_instance_specs[name];
 
+        if (request->mount_type() == MountRequest::NATIVE)
+        {
+            // virtiofsd does not translate IDs, so maps would be silently ignored
+            if (!uid_map.empty() || !gid_map.empty())
+            {
+                fmt::format_to(errors, "Native mounts do not map IDs, so \"{}:{}\" cannot be mounted with ID maps\n",
+                               name, target_path);
+                continue;
+            }
+
+            if (vm_specs.mounts.find(target_path) != vm_specs.mounts.end())
+            {
+                fmt::format_to(errors, "There is already a mount defined for \"{}:{}\"\n", name, target_path);
+                continue;
+            }
+
+            try
+            {
+                vm->add_native_mount(request->source_path(), native_mount_tag_for(target_path));
+            }
+            catch (const std::exception& e)
+            {
+                fmt::format_to(errors, "error mounting \"{}\": {}\n", target_path, e.what());
+                continue;
+            }
+
+            if (mp::utils::is_running(vm->current_state()))
+            {
+                MountReply mount_reply;
+                mount_reply.set_log_line(fmt::format("\"{}:{}\" will be mounted once the instance is stopped and "
+                                                     "started again",
+                                                     name, target_path));
+                server->Write(mount_reply);
+            }
+
+            vm_specs.mounts[target_path] = {request->source_path(), gid_map, uid_map, MountRequest::NATIVE};
+            continue;
+        }
+
         if (vm->current_state() == mp::VirtualMachine::State::running)
         {
             try
@@ -1298,9 +1743,9 @@ try // clang-format on
                     mount_reply.set_mount_message("Enabling support for mounting");
                     server->Write(mount_reply);
 
-                    mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                           *config->ssh_key_provider};
-                    mp::utils::install_sshfs_for(name, session);
+                    auto session =
+                        ssh_sessions.acquire(name, vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username);
+                    mp::utils::install_sshfs_for(name, *session);
                     instance_mounts.start_mount(vm.get(), request->source_path(), target_path, gid_map, uid_map);
                 }
                 catch (const mp::SSHFSMissingError&)
@@ -1321,7 +1766,7 @@ try // clang-format on
             continue;
         }
 
-        VMMount mount{request->source_path(), gid_map, uid_map};
+        VMMount mount{request->source_path(), gid_map, uid_map, MountRequest::CLASSIC};
         vm_specs.mounts[target_path] = mount;
     }
 
@@ -1677,7 +2122,34 @@ try // clang-format on
         if (target_path.empty())
         {
             instance_mounts.stop_all_mounts_for_instance(name);
-            mounts.clear();
+
+            for (auto mount = mounts.begin(); mount != mounts.end();)
+            {
+                try
+                {
+                    if (mount->second.mount_type == MountRequest::NATIVE)
+                        stop_native_mount(*vm, mount->first);
+
+                    mount = mounts.erase(mount);
+                }
+                catch (const std::exception& e)
+                {
+                    fmt::format_to(errors, "error unmounting \"{}\": {}\n", mount->first, e.what());
+                    ++mount;
+                }
+            }
+        }
+        else if (mounts.find(target_path) != mounts.end() && mounts[target_path].mount_type == MountRequest::NATIVE)
+        {
+            try
+            {
+                stop_native_mount(*vm, target_path);
+                mounts.erase(target_path);
+            }
+            catch (const std::exception& e)
+            {
+                fmt::format_to(errors, "error unmounting \"{}\": {}\n", target_path, e.what());
+            }
         }
         else
         {
@@ -1736,6 +2208,10 @@ void mp::Daemon::on_suspend()
 
 void mp::Daemon::on_restart(const std::string& name)
 {
+    // Spares have no mounts to start and nobody waiting for them
+    if (spare_instances.find(name) != spare_instances.end())
+        return;
+
     auto future_watcher = create_future_watcher();
     future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<StartReply>, nullptr,
                                                 std::vector<std::string>{name}, nullptr));
@@ -1743,6 +2219,10 @@ void mp::Daemon::on_restart(const std::string& name)
 
 void mp::Daemon::persist_state_for(const std::string& name, const VirtualMachine::State& state)
 {
+    // Sessions do not survive the instance going down, and it may come back with another address
+    if (!mp::utils::is_running(state))
+        ssh_sessions.forget(name);
+
     vm_instance_specs[name].state = state;
     persist_instances();
 }
@@ -1771,6 +2251,7 @@ void mp::Daemon::persist_instances()
         json.insert("state", static_cast<int>(specs.state));
         json.insert("deleted", specs.deleted);
         json.insert("metadata", specs.metadata);
+        json.insert("spare_for", QString::fromStdString(specs.spare_for));
 
         QJsonArray mounts;
         for (const auto& mount : specs.mounts)
@@ -1778,30 +2259,10 @@ void mp::Daemon::persist_instances()
             QJsonObject entry;
             entry.insert("source_path", QString::fromStdString(mount.second.source_path));
             entry.insert("target_path", QString::fromStdString(mount.first));
+            entry.insert("mount_type", mount.second.mount_type);
 
-            QJsonArray uid_map;
-            for (const auto& map : mount.second.uid_map)
-            {
-                QJsonObject map_entry;
-                map_entry.insert("host_uid", map.first);
-                map_entry.insert("instance_uid", map.second);
-
-                uid_map.append(map_entry);
-            }
-
-            entry.insert("uid_mappings", uid_map);
-
-            QJsonArray gid_map;
-            for (const auto& map : mount.second.gid_map)
-            {
-                QJsonObject map_entry;
-                map_entry.insert("host_gid", map.first);
-                map_entry.insert("instance_gid", map.second);
-
-                gid_map.append(map_entry);
-            }
-
-            entry.insert("gid_mappings", gid_map);
+            entry.insert("uid_mappings", id_mappings_to_json(mount.second.uid_map, "uid"));
+            entry.insert("gid_mappings", id_mappings_to_json(mount.second.gid_map, "gid"));
             mounts.append(entry);
         }
 
@@ -1819,11 +2280,19 @@ void mp::Daemon::persist_instances()
     mp::write_json(instance_records_json, data_dir.filePath(instance_db_name));
 }
 
+void mp::Daemon::release_mac_address(const std::string& mac_addr)
+{
+    std::lock_guard<std::mutex> lock{mac_addrs_mutex};
+    allocated_mac_addrs.erase(mac_addr);
+}
+
 void mp::Daemon::release_resources(const std::string& instance)
 {
     config->factory->remove_resources_for(instance);
     config->vault->remove(instance);
     vm_instance_specs.erase(instance);
+    telemetry.forget(instance);
+    ssh_sessions.forget(instance);
 }
 
 std::string mp::Daemon::check_instance_operational(const std::string& instance_name) const
@@ -1859,9 +2328,17 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriter<Crea
                                                       checked_args.option_errors.SerializeAsString()));
     }
 
+    if (start)
+    {
+        const auto spare_name = claim_spare_instance(request, checked_args.mem_size, checked_args.disk_space);
+        if (!spare_name.empty())
+            return start_launched_vm(spare_name, server, status_promise);
+    }
+
     auto name = name_from(checked_args.instance_name, *config->name_generator, vm_instances);
 
-    if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end())
+    if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end() ||
+        spare_instances.find(name) != spare_instances.end())
     {
         CreateError create_error;
         create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
@@ -1904,7 +2381,8 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriter<Crea
                                            VirtualMachine::State::off,
                                            {},
                                            false,
-                                           QJsonObject()};
+                                           QJsonObject(),
+                                           {}};
                 preparing_instances.erase(name);
 
                 persist_instances();
@@ -1915,18 +2393,8 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriter<Crea
                     reply.set_create_message("Starting " + name);
                     server->Write(reply);
 
-                    auto& vm = vm_instances[name];
-                    vm->start();
-
-                    auto future_watcher = create_future_watcher([this, server, name] {
-                        LaunchReply reply;
-                        reply.set_vm_instance_name(name);
-                        config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
-                        server->Write(reply);
-                    });
-                    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<LaunchReply>,
-                                                                server, std::vector<std::string>{name},
-                                                                status_promise));
+                    vm_instances[name]->start();
+                    start_launched_vm(name, server, status_promise);
                 }
                 else
                 {
@@ -1949,68 +2417,263 @@ void mp::Daemon::create_vm(const CreateRequest* request, grpc::ServerWriter<Crea
         QtConcurrent::run([this, server, request, name, checked_args]() -> VirtualMachineDescription {
             try
             {
-                auto query = query_from(request, name);
-
-                auto progress_monitor = [server](int progress_type, int percentage) {
-                    CreateReply create_reply;
-                    create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
-                    create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
-                    return server->Write(create_reply);
-                };
-
-                auto prepare_action = [this, server, &name](const VMImage& source_image) -> VMImage {
-                    CreateReply reply;
-                    reply.set_create_message("Preparing image for " + name);
-                    server->Write(reply);
+                return prepare_instance(request, name, checked_args.mem_size, checked_args.disk_space, server);
+            }
+            catch (const std::exception& e)
+            {
+                throw CreateImageException(e.what());
+            }
+        }));
+}
 
-                    return config->factory->prepare_source_image(source_image);
-                };
+// Fetches the image of a new instance and gets its disk and cloud-init configuration ready. Progress is reported to
+// the client, if there is one.
+mp::VirtualMachineDescription mp::Daemon::prepare_instance(const CreateRequest* request, const std::string& name,
+                                                           const MemorySize& mem_size,
+                                                           const optional<MemorySize>& requested_disk_space,
+                                                           grpc::ServerWriter<CreateReply>* server)
+{
+    auto report = [server](const std::string& message) {
+        if (server)
+        {
+            CreateReply reply;
+            reply.set_create_message(message);
+            server->Write(reply);
+        }
+    };
 
-                auto fetch_type = config->factory->fetch_type();
+    auto query = query_from(request, name);
 
-                CreateReply reply;
-                reply.set_create_message("Creating " + name);
-                server->Write(reply);
-                auto vm_image = config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
+    auto progress_monitor = [server](int progress_type, int percentage) {
+        if (!server)
+            return true;
 
-                const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
-                const auto disk_space = compute_final_image_size(image_size, checked_args.disk_space);
+        CreateReply create_reply;
+        create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
+        create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
+        return server->Write(create_reply);
+    };
 
-                reply.set_create_message("Configuring " + name);
-                server->Write(reply);
-                auto vendor_data_cloud_init_config =
-                    make_cloud_init_vendor_config(*config->ssh_key_provider, request->time_zone(), config->ssh_username,
-                                                  config->factory->get_backend_version_string().toStdString());
-                auto meta_data_cloud_init_config = make_cloud_init_meta_config(name);
-                auto user_data_cloud_init_config = YAML::Load(request->cloud_init_user_data());
-                prepare_user_data(user_data_cloud_init_config, vendor_data_cloud_init_config);
-
-                std::string mac_addr;
-                while (true)
-                {
-                    mac_addr = mp::utils::generate_mac_address();
+    auto prepare_action = [this, &report, &name](const VMImage& source_image) -> VMImage {
+        report("Preparing image for " + name);
 
-                    auto it = allocated_mac_addrs.find(mac_addr);
-                    if (it == allocated_mac_addrs.end())
-                    {
-                        allocated_mac_addrs.insert(mac_addr);
-                        break;
-                    }
-                }
+        return config->factory->prepare_source_image(source_image);
+    };
+
+    auto fetch_type = config->factory->fetch_type();
+
+    report("Creating " + name);
+    auto vm_image = config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
 
-                auto vm_desc = to_machine_desc(request, name, checked_args.mem_size, disk_space, mac_addr,
-                                               config->ssh_username, vm_image, meta_data_cloud_init_config,
-                                               user_data_cloud_init_config, vendor_data_cloud_init_config);
+    const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
+    const auto disk_space = compute_final_image_size(image_size, requested_disk_space);
 
-                config->factory->prepare_instance_image(vm_image, vm_desc);
+    report("Configuring " + name);
+    auto vendor_data_cloud_init_config =
+        make_cloud_init_vendor_config(*config->ssh_key_provider, request->time_zone(), config->ssh_username,
+                                      config->factory->get_backend_version_string().toStdString());
+    auto meta_data_cloud_init_config = make_cloud_init_meta_config(name);
+    auto user_data_cloud_init_config = YAML::Load(request->cloud_init_user_data());
+    prepare_user_data(user_data_cloud_init_config, vendor_data_cloud_init_config);
 
-                return vm_desc;
+    std::string mac_addr;
+    {
+        std::lock_guard<std::mutex> lock{mac_addrs_mutex};
+        while (true)
+        {
+            mac_addr = mp::utils::generate_mac_address();
+
+            auto it = allocated_mac_addrs.find(mac_addr);
+            if (it == allocated_mac_addrs.end())
+            {
+                allocated_mac_addrs.insert(mac_addr);
+                break;
             }
-            catch (const std::exception& e)
+        }
+    }
+
+    auto vm_desc = to_machine_desc(request, name, mem_size, disk_space, mac_addr, config->ssh_username, vm_image,
+                                   meta_data_cloud_init_config, user_data_cloud_init_config,
+                                   vendor_data_cloud_init_config);
+
+    try
+    {
+        config->factory->prepare_instance_image(vm_image, vm_desc);
+    }
+    catch (...)
+    {
+        release_mac_address(mac_addr);
+        throw;
+    }
+
+    return vm_desc;
+}
+
+void mp::Daemon::start_launched_vm(const std::string& name, grpc::ServerWriter<CreateReply>* server,
+                                   std::promise<grpc::Status>* status_promise)
+{
+    auto future_watcher = create_future_watcher([this, server, name] {
+        LaunchReply reply;
+        reply.set_vm_instance_name(name);
+        config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
+        server->Write(reply);
+    });
+    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<LaunchReply>, server,
+                                                std::vector<std::string>{name}, status_promise));
+}
+
+// Hands a spare instance over to a launch that asks for nothing it was not created with: its image, a generated name,
+// default resources, the time zone of the daemon and no cloud-init customization. Returns the name of the instance, or
+// an empty string if there is no such spare.
+std::string mp::Daemon::claim_spare_instance(const CreateRequest* request, const MemorySize& mem_size,
+                                             const optional<MemorySize>& disk_space)
+{
+    if (!request->instance_name().empty() || !request->cloud_init_user_data().empty())
+        return {};
+
+    // Spares are set up in the time zone of the daemon, see replenish_spare_instances()
+    if (!request->time_zone().empty() && request->time_zone() != QTimeZone::systemTimeZoneId().toStdString())
+        return {};
+
+    const auto image = image_key_for(request);
+    const auto num_cores = request->num_cores() < std::stoi(mp::min_cpu_cores) ? std::stoi(mp::default_cpu_cores)
+                                                                                : request->num_cores();
+    for (auto it = spare_instances.begin(); it != spare_instances.end(); ++it)
+    {
+        const auto& name = it->first;
+        auto& specs = vm_instance_specs[name];
+        if (specs.spare_for != image || specs.num_cores != num_cores || specs.mem_size != mem_size ||
+            (disk_space && *disk_space != specs.disk_space))
+            continue;
+
+        mpl::log(mpl::Level::info, category, fmt::format("Launching spare instance {}", name));
+
+        vm_instances[name] = std::move(it->second);
+        spare_instances.erase(it);
+        specs.spare_for.clear();
+        persist_instances();
+
+        // Spares are normally running already
+        const auto state = vm_instances[name]->current_state();
+        if (state == VirtualMachine::State::off || state == VirtualMachine::State::stopped ||
+            state == VirtualMachine::State::suspended)
+            vm_instances[name]->start();
+
+        // Get a new spare ready in the background for the next launch
+        QTimer::singleShot(0, this, [this] { replenish_spare_instances(); });
+
+        return name;
+    }
+
+    return {};
+}
+
+// Keeps the number of instances set by the instance pool setting waiting for each of the images to prefetch. They are
+// started right away, so that claiming one only takes waiting for it to be reachable.
+void mp::Daemon::replenish_spare_instances()
+{
+    const auto pool_size = MP_SETTINGS.get(mp::instance_pool_key).toUInt();
+    const auto images = spare_instance_images();
+
+    // Get rid of the spares that are no longer wanted, after the settings changed
+    std::unordered_map<std::string, unsigned> spare_counts;
+    for (auto it = spare_instances.begin(); it != spare_instances.end();)
+    {
+        const auto name = it->first;
+        const auto image = vm_instance_specs[name].spare_for;
+        if (std::find(images.cbegin(), images.cend(), image) != images.cend() &&
+            preparing_spares.count(image) + ++spare_counts[image] <= pool_size)
+        {
+            ++it;
+            continue;
+        }
+
+        mpl::log(mpl::Level::info, category, fmt::format("Removing spare instance {}", name));
+        it->second->shutdown();
+        release_mac_address(vm_instance_specs[name].mac_addr);
+        release_resources(name);
+        it = spare_instances.erase(it);
+        persist_instances();
+    }
+
+    for (const auto& image : images)
+    {
+        for (auto spares = preparing_spares.count(image) + spare_counts[image]; spares < pool_size; ++spares)
+        {
+            auto name_taken = [this](const std::string& name) {
+                return vm_instances.count(name) || deleted_instances.count(name) || spare_instances.count(name) ||
+                       preparing_instances.count(name);
+            };
+
+            auto name = config->name_generator->make_name();
+            for (int retries = 100; retries > 0 && name_taken(name); --retries)
+                name = config->name_generator->make_name();
+
+            if (name_taken(name))
             {
-                throw CreateImageException(e.what());
+                mpl::log(mpl::Level::error, category, "Unable to generate a unique name for a spare instance");
+                return;
             }
-        }));
+
+            auto request = std::make_shared<CreateRequest>();
+            const auto remote_and_alias = QString::fromStdString(image).split(':');
+            request->set_image(remote_and_alias.constLast().toStdString());
+            if (remote_and_alias.size() > 1)
+                request->set_remote_name(remote_and_alias.constFirst().toStdString());
+            request->set_time_zone(QTimeZone::systemTimeZoneId().toStdString());
+
+            preparing_instances.insert(name);
+            preparing_spares.insert(image);
+            mpl::log(mpl::Level::info, category, fmt::format("Creating spare instance {} of {}", name, image));
+
+            auto prepare_future_watcher = new QFutureWatcher<VirtualMachineDescription>();
+            QObject::connect(
+                prepare_future_watcher, &QFutureWatcher<VirtualMachineDescription>::finished,
+                [this, name, image, prepare_future_watcher] {
+                    preparing_instances.erase(name);
+                    preparing_spares.erase(preparing_spares.find(image));
+
+                    std::string mac_addr; // known once the instance is prepared
+                    try
+                    {
+                        auto vm_desc = prepare_future_watcher->future().result();
+                        mac_addr = vm_desc.mac_addr;
+
+                        spare_instances[name] = config->factory->create_virtual_machine(vm_desc, *this);
+                        vm_instance_specs[name] = {vm_desc.num_cores,
+                                                   vm_desc.mem_size,
+                                                   vm_desc.disk_space,
+                                                   vm_desc.mac_addr,
+                                                   config->ssh_username,
+                                                   VirtualMachine::State::off,
+                                                   {},
+                                                   false,
+                                                   QJsonObject(),
+                                                   image};
+                        persist_instances();
+
+                        spare_instances[name]->start();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        // Not retried before the next round of image maintenance, to avoid spinning on a bad image
+                        mpl::log(mpl::Level::error, category,
+                                 fmt::format("Error creating spare instance {}: {}", name, e.what()));
+                        if (!mac_addr.empty())
+                            release_mac_address(mac_addr);
+                        release_resources(name);
+                        spare_instances.erase(name);
+                        persist_instances();
+                    }
+
+                    delete prepare_future_watcher;
+                });
+
+            prepare_future_watcher->setFuture(QtConcurrent::run([this, request, name]() -> VirtualMachineDescription {
+                return prepare_instance(request.get(), name, MemorySize{mp::default_memory_size}, nullopt, nullptr);
+            }));
+        }
+    }
 }
 
 grpc::Status mp::Daemon::reboot_vm(VirtualMachine& vm)
@@ -2023,7 +2686,9 @@ grpc::Status mp::Daemon::reboot_vm(VirtualMachine& vm)
                             fmt::format("instance \"{}\" is not running", vm.vm_name), ""};
 
     mpl::log(mpl::Level::debug, category, fmt::format("Rebooting {}", vm.vm_name));
-    return ssh_reboot(vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), *config->ssh_key_provider);
+    // The connection goes down with the instance, so it is not given back to the pool
+    auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username()).take();
+    return ssh_reboot(session);
 }
 
 grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::milliseconds delay)
@@ -2041,7 +2706,7 @@ grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::mill
         mp::optional<mp::SSHSession> session;
         try
         {
-            session = mp::SSHSession{vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), *config->ssh_key_provider};
+            session = ssh_sessions.acquire(name, vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username()).take();
         }
         catch (const std::exception& e)
         {
@@ -2090,6 +2755,35 @@ grpc::Status mp::Daemon::cmd_vms(const std::vector<std::string>& tgts, std::func
     return grpc::Status::OK;
 }
 
+void mp::Daemon::start_native_mount(VirtualMachine& vm, const std::string& target_path)
+{
+    auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(),
+                                        vm_instance_specs[vm.vm_name].ssh_username);
+
+    const auto target = mp::utils::escape_char(target_path, '"');
+    auto proc = exec_and_log(*session, fmt::format("mountpoint -q \"{0}\" || "
+                                                  "(sudo mkdir -p \"{0}\" && sudo mount -t virtiofs {1} \"{0}\")",
+                                                  target, native_mount_tag_for(target_path)));
+    if (proc.exit_code() != 0)
+        throw std::runtime_error(proc.read_std_error());
+}
+
+void mp::Daemon::stop_native_mount(VirtualMachine& vm, const std::string& target_path)
+{
+    if (vm.current_state() == VirtualMachine::State::running)
+    {
+        auto session = ssh_sessions.acquire(vm.vm_name, vm.ssh_hostname(), vm.ssh_port(),
+                                            vm_instance_specs[vm.vm_name].ssh_username);
+
+        const auto target = mp::utils::escape_char(target_path, '"');
+        auto proc = exec_and_log(*session, fmt::format("! mountpoint -q \"{0}\" || sudo umount \"{0}\"", target));
+        if (proc.exit_code() != 0)
+            throw std::runtime_error(proc.read_std_error());
+    }
+
+    vm.remove_native_mount(native_mount_tag_for(target_path));
+}
+
 QFutureWatcher<mp::Daemon::AsyncOperationStatus>*
 mp::Daemon::create_future_watcher(std::function<void()> const& finished_op)
 {
@@ -2113,6 +2807,9 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::stri
     try
     {
         auto it = vm_instances.find(name);
+        if (it == vm_instances.end())
+            throw std::runtime_error(fmt::format("instance \"{}\" does not exist", name));
+
         auto vm = it->second;
         vm->wait_until_ssh_up(up_timeout);
 
@@ -2138,6 +2835,20 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::stri
             auto& uid_map = mount_entry.second.uid_map;
             auto& gid_map = mount_entry.second.gid_map;
 
+            if (mount_entry.second.mount_type == MountRequest::NATIVE)
+            {
+                // A failure here most likely means the mount was added after the instance started, so it is kept
+                try
+                {
+                    start_native_mount(*vm, target_path);
+                }
+                catch (const std::exception& e)
+                {
+                    fmt::format_to(errors, "Cannot mount \"{}\" yet: {}\n", target_path, e.what());
+                }
+                continue;
+            }
+
             try
             {
                 instance_mounts.start_mount(vm.get(), source_path, target_path, gid_map, uid_map);
@@ -2153,9 +2864,9 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::stri
                         server->Write(reply);
                     }
 
-                    mp::SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username,
-                                           *config->ssh_key_provider};
-                    mp::utils::install_sshfs_for(name, session);
+                    auto session =
+                        ssh_sessions.acquire(name, vm->ssh_hostname(), vm->ssh_port(), vm_specs.ssh_username);
+                    mp::utils::install_sshfs_for(name, *session);
                     instance_mounts.start_mount(vm.get(), source_path, target_path, gid_map, uid_map);
                 }
                 catch (const mp::SSHFSMissingError&)
@@ -20,14 +20,20 @@
 
 #include "daemon_config.h"
 #include "daemon_rpc.h"
+#include "instance_telemetry.h"
 
 #include <multipass/delayed_shutdown_timer.h>
+#include <multipass/id_mappings.h>
 #include <multipass/memory_size.h>
 #include <multipass/metrics_provider.h>
+#include <multipass/optional.h>
+#include <multipass/ssh/ssh_session_pool.h>
 #include <multipass/sshfs_mount/sshfs_mounts.h>
 #include <multipass/virtual_machine.h>
+#include <multipass/virtual_machine_description.h>
 #include <multipass/vm_status_monitor.h>
 
+#include <atomic>
 #include <future>
 #include <memory>
 #include <mutex>
@@ -36,14 +42,16 @@
 #include <vector>
 
 #include <QFutureWatcher>
+#include <QThreadPool>
 
 namespace multipass
 {
 struct VMMount
 {
     std::string source_path;
-    std::unordered_map<int, int> gid_map;
-    std::unordered_map<int, int> uid_map;
+    IdMappings gid_map;
+    IdMappings uid_map;
+    MountRequest::MountType mount_type;
 };
 
 struct VMSpecs
@@ -57,6 +65,7 @@ struct VMSpecs
     std::unordered_map<std::string, VMMount> mounts;
     bool deleted;
     QJsonObject metadata;
+    std::string spare_for; // the image a spare instance waits to be launched from; empty for regular instances
 };
 
 struct MetricsOptInData
@@ -72,6 +81,7 @@ class Daemon : public QObject, public multipass::VMStatusMonitor
 public:
     explicit Daemon(std::unique_ptr<const DaemonConfig> config);
     Daemon(const Daemon&) = delete;
+    ~Daemon();
     Daemon& operator=(const Daemon&) = delete;
 
 protected:
@@ -136,15 +146,28 @@ public slots:
 private:
     void persist_instances();
     void release_resources(const std::string& instance);
+    void release_mac_address(const std::string& mac_addr);
     std::string check_instance_operational(const std::string& instance_name) const;
     std::string check_instance_exists(const std::string& instance_name) const;
     void create_vm(const CreateRequest* request, grpc::ServerWriter<CreateReply>* server,
                    std::promise<grpc::Status>* status_promise, bool start);
+    VirtualMachineDescription prepare_instance(const CreateRequest* request, const std::string& name,
+                                               const MemorySize& mem_size, const optional<MemorySize>& disk_space,
+                                               grpc::ServerWriter<CreateReply>* server);
+    void start_launched_vm(const std::string& name, grpc::ServerWriter<CreateReply>* server,
+                           std::promise<grpc::Status>* status_promise);
+    std::string claim_spare_instance(const CreateRequest* request, const MemorySize& mem_size,
+                                     const optional<MemorySize>& disk_space);
+    void replenish_spare_instances();
     grpc::Status reboot_vm(VirtualMachine& vm);
     grpc::Status shutdown_vm(VirtualMachine& vm, const std::chrono::milliseconds delay);
     grpc::Status cancel_vm_shutdown(const VirtualMachine& vm);
     grpc::Status cmd_vms(const std::vector<std::string>& tgts, std::function<grpc::Status(VirtualMachine&)> cmd);
     void install_sshfs(VirtualMachine* vm, const std::string& name);
+    void start_native_mount(VirtualMachine& vm, const std::string& target_path);
+    void stop_native_mount(VirtualMachine& vm, const std::string& target_path);
+    void maintain_source_images();
+    void sample_instance_telemetry();
 
     struct AsyncOperationStatus
     {
@@ -165,19 +188,29 @@ private:
     std::unordered_map<std::string, VMSpecs> vm_instance_specs;
     std::unordered_map<std::string, VirtualMachine::ShPtr> vm_instances;
     std::unordered_map<std::string, VirtualMachine::ShPtr> deleted_instances;
+    std::unordered_map<std::string, VirtualMachine::ShPtr> spare_instances;
     std::unordered_map<std::string, std::unique_ptr<DelayedShutdownTimer>> delayed_shutdown_instances;
     std::unordered_set<std::string> allocated_mac_addrs;
+    std::mutex mac_addrs_mutex; // instances are prepared off the daemon's thread, spares several at a time
     std::unordered_map<std::string, VMImageHost*> remote_image_host_map;
     DaemonRpc daemon_rpc;
     QTimer source_images_maintenance_task;
     MetricsProvider metrics_provider;
     MetricsOptInData metrics_opt_in;
     SSHFSMounts instance_mounts;
+    SSHSessionPool ssh_sessions;
     std::vector<std::unique_ptr<QFutureWatcher<AsyncOperationStatus>>> async_future_watchers;
     std::unordered_map<std::string, QFuture<std::string>> async_running_futures;
     std::mutex start_mutex;
     std::unordered_set<std::string> preparing_instances;
+    std::unordered_multiset<std::string> preparing_spares; // by image
     QFuture<void> image_update_future;
+    std::atomic<bool> stopping_image_updates{false};
+    QTimer telemetry_task;
+    QTimer idle_ssh_sessions_task;
+    InstanceTelemetry telemetry;
+    std::atomic<std::size_t> pending_telemetry_samples{0};
+    QThreadPool read_only_rpc_pool; // for the SSH probes of info and telemetry, off the daemon's thread
 };
 } // namespace multipass
 #endif // MULTIPASS_DAEMON_H
@@ -16,16 +16,19 @@
  */
 
 #include "default_vm_image_vault.h"
-#include "json_writer.h"
 
+#include <multipass/constants.h>
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/create_image_exception.h>
 #include <multipass/exceptions/unsupported_image_exception.h>
+#include <multipass/image_download_pipeline.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
+#include <multipass/qcow2_image.h>
 #include <multipass/query.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/settings.h>
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 #include <multipass/vm_image.h>
@@ -34,12 +37,12 @@
 #include <multipass/format.h>
 
 #include <QJsonArray>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QUrl>
 #include <QtConcurrent/QtConcurrent>
 
 #include <exception>
+#include <functional>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -92,19 +95,8 @@ auto record_to_json(const mp::VaultRecord& record)
     return json;
 }
 
-std::unordered_map<std::string, mp::VaultRecord> load_db(const QString& db_name)
+std::unordered_map<std::string, mp::VaultRecord> load_db(const QJsonObject& records)
 {
-    QFile db_file{db_name};
-    auto opened = db_file.open(QIODevice::ReadOnly);
-    if (!opened)
-        return {};
-
-    QJsonParseError parse_error;
-    auto doc = QJsonDocument::fromJson(db_file.readAll(), &parse_error);
-    if (doc.isNull())
-        return {};
-
-    auto records = doc.object();
     if (records.isEmpty())
         return {};
 
@@ -169,7 +161,24 @@ std::unordered_map<std::string, mp::VaultRecord> load_db(const QString& db_name)
     return reconstructed_records;
 }
 
-QString copy(const QString& file_name, const QDir& output_dir)
+void make_overlay(const QString& backing_path, const QString& overlay_path)
+{
+    QStringList qemuimg_parameters{{"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_path, overlay_path}};
+    auto qemuimg_process = mp::platform::make_process(
+        std::make_unique<mp::QemuImgProcessSpec>(qemuimg_parameters, backing_path, overlay_path));
+    auto process_state = qemuimg_process->execute();
+
+    if (!process_state.completed_successfully())
+    {
+        throw std::runtime_error(fmt::format("Cannot create image overlay: qemu-img failed ({}) with output:\n{}",
+                                             process_state.failure_message(),
+                                             qemuimg_process->read_all_standard_error()));
+    }
+}
+
+// Prefers sharing the data with the original over copying it: through a reflink where the file system supports
+// them, or else through a qcow2 overlay backed by the original, if allowed
+QString copy(const QString& file_name, const QDir& output_dir, bool overlay_allowed = false)
 {
     if (file_name.isEmpty())
         return {};
@@ -180,7 +189,23 @@ QString copy(const QString& file_name, const QDir& output_dir)
     QFileInfo info{file_name};
     const auto source_name = info.fileName();
     auto new_path = output_dir.filePath(source_name);
-    QFile::copy(file_name, new_path);
+    if (mp::vault::reflink_copy(file_name, new_path))
+        return new_path;
+
+    if (overlay_allowed)
+    {
+        try
+        {
+            make_overlay(file_name, new_path);
+            return new_path;
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Copying {} instead: {}", file_name, e.what()));
+        }
+    }
+
+    mp::vault::sparse_copy(file_name, new_path);
     return new_path;
 }
 
@@ -209,6 +234,9 @@ void delete_image_dir(const mp::Path& image_path)
 
 mp::MemorySize get_image_size(const mp::Path& image_path)
 {
+    if (const auto image_info = mp::vault::read_image_info(image_path))
+        return mp::MemorySize{std::to_string(image_info->virtual_size)};
+
     QStringList qemuimg_parameters{{"info", image_path}};
     auto qemuimg_process =
         mp::platform::make_process(std::make_unique<mp::QemuImgProcessSpec>(qemuimg_parameters, image_path));
@@ -250,9 +278,13 @@ mp::DefaultVMImageVault::DefaultVMImageVault(std::vector<VMImageHost*> image_hos
       data_dir{QDir(data_dir_path).filePath("vault")},
       instances_dir(data_dir.filePath("instances")),
       images_dir(cache_dir.filePath("images")),
+      partials_dir(cache_dir.filePath("partial")),
       days_to_expire{days_to_expire},
-      prepared_image_records{load_db(cache_dir.filePath(image_db_name))},
-      instance_image_records{load_db(data_dir.filePath(instance_db_name))}
+      blob_store{QDir(cache_dir_path).filePath("blobs")},
+      image_db{cache_dir.filePath(image_db_name)},
+      instance_db{data_dir.filePath(instance_db_name)},
+      prepared_image_records{load_db(image_db.records())},
+      instance_image_records{load_db(instance_db.records())}
 {
     for (const auto& image_host : image_hosts)
     {
@@ -301,7 +333,8 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
         }
         else
         {
-            source_image = image_instance_from(query.name, source_image);
+            // Custom images are yet to be prepared, so they cannot back overlays
+            source_image = image_instance_from(query.name, source_image, false);
         }
 
         if (fetch_type == FetchType::ImageKernelAndInitrd)
@@ -318,7 +351,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
         {
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
-            persist_instance_records();
+            persist_instance_record(query.name);
         }
 
         return vm_image;
@@ -483,7 +516,7 @@ void mp::DefaultVMImageVault::remove(const std::string& name)
         instance_dir.removeRecursively();
 
     instance_image_records.erase(name);
-    persist_instance_records();
+    persist_instance_record(name);
 }
 
 bool mp::DefaultVMImageVault::has_record_for(const std::string& name)
@@ -506,17 +539,23 @@ void mp::DefaultVMImageVault::prune_expired_images()
                 mpl::Level::info, category,
                 fmt::format("Source image {} is expired. Removing it from the cache.", record.second.query.release));
             expired_keys.push_back(record.first);
-            delete_image_dir(record.second.image.image_path);
+            if (!backs_instance_images(QFileInfo{record.second.image.image_path}.absolutePath()))
+                delete_image_dir(record.second.image.image_path);
         }
     }
 
+    // Downloads in progress keep writing to their partial files, so those are only looked at while there are none
+    if (in_progress_image_fetches.empty())
+        mp::vault::remove_stale_partial_downloads(partials_dir, days_to_expire);
+
     // Remove any image directories that have no corresponding database entry
     for (const auto& entry : images_dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
     {
         if (std::find_if(prepared_image_records.cbegin(), prepared_image_records.cend(),
                          [&entry](const std::pair<std::string, VaultRecord>& record) {
                              return record.second.image.image_path.contains(entry.absoluteFilePath());
-                         }) == prepared_image_records.cend())
+                         }) == prepared_image_records.cend() &&
+            !backs_instance_images(entry.absoluteFilePath()))
         {
             mpl::log(mpl::Level::info, category,
                      fmt::format("Source image {} is no longer valid. Removing it from the cache.",
@@ -526,9 +565,12 @@ void mp::DefaultVMImageVault::prune_expired_images()
     }
 
     for (const auto& key : expired_keys)
+    {
         prepared_image_records.erase(key);
+        persist_image_record(key);
+    }
 
-    persist_image_records();
+    blob_store.prune(days_to_expire);
 }
 
 void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type, const PrepareAction& prepare,
@@ -565,11 +607,12 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type, const P
         {
             fetch_image(fetch_type, record.query, prepare, monitor);
 
-            // Remove old image
+            // Remove old image, unless instance images are overlays on top of it; pruning takes care of it then
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
-            delete_image_dir(record.image.image_path);
+            if (!backs_instance_images(QFileInfo{record.image.image_path}.absolutePath()))
+                delete_image_dir(record.image.image_path);
             prepared_image_records.erase(key);
-            persist_image_records();
+            persist_image_record(key);
         }
         catch (const CreateImageException& e)
         {
@@ -616,17 +659,59 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
         }
     }
 
+    // The download is kept aside until it is complete, so that an interrupted one is resumed by the next attempt
+    const auto partial_image_path = partial_download_path(image_dir, source_image.image_path);
+    const auto xz_compressed = source_image.image_path.endsWith(".xz");
+    if (xz_compressed)
+        source_image.image_path.chop(3);
+
     mp::vault::DeleteOnException image_file{source_image.image_path};
 
     try
     {
-        url_downloader->download_to(info.image_location, source_image.image_path, info.size, LaunchProgress::IMAGE,
-                                    monitor);
-
-        if (info.verify)
+        // Only verified images are known by the hash of their contents, so only those can be shared
+        if (!info.verify || !blob_store.fetch(id, source_image.image_path))
         {
-            monitor(LaunchProgress::VERIFY, -1);
-            mp::vault::verify_image_download(source_image.image_path, id);
+            // The image is hashed and decoded as it downloads, starting over from what an earlier attempt left in the
+            // partial file, so the decoded image is the only one kept
+            mp::vault::ImageDownloadPipeline pipeline{source_image.image_path, info.verify ? id : QString{},
+                                                      xz_compressed};
+
+            // A download that cannot be processed is no use to the next attempt, which starts over
+            auto discard_download_on_failure = [&partial_image_path](const std::function<void()>& step) {
+                try
+                {
+                    step();
+                }
+                catch (const std::exception&)
+                {
+                    QFile::remove(partial_image_path);
+                    throw;
+                }
+            };
+
+            try
+            {
+                url_downloader->stream_to(
+                    info.image_location, partial_image_path,
+                    [&pipeline](const QByteArray& data) { return pipeline.push(data); }, info.size,
+                    LaunchProgress::IMAGE, monitor);
+            }
+            catch (const std::exception&)
+            {
+                // A download stopped by the pipeline failed because of it
+                discard_download_on_failure([&pipeline] { pipeline.throw_if_failed(); });
+                throw;
+            }
+
+            if (info.verify)
+                monitor(LaunchProgress::VERIFY, -1);
+
+            discard_download_on_failure([&pipeline] { pipeline.finish(); });
+            QFile::remove(partial_image_path);
+
+            if (info.verify)
+                blob_store.add(id, source_image.image_path);
         }
 
         if (fetch_type == FetchType::ImageKernelAndInitrd)
@@ -634,11 +719,6 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
             source_image = fetch_kernel_and_initrd(info, source_image, image_dir, monitor);
         }
 
-        if (source_image.image_path.endsWith(".xz"))
-        {
-            source_image.image_path = mp::vault::extract_image(source_image.image_path, monitor, true);
-        }
-
         auto prepared_image = prepare(source_image);
         remove_source_images(source_image, prepared_image);
 
@@ -667,12 +747,12 @@ QString mp::DefaultVMImageVault::extract_image_from(const std::string& instance_
 }
 
 mp::VMImage mp::DefaultVMImageVault::image_instance_from(const std::string& instance_name,
-                                                         const VMImage& prepared_image)
+                                                         const VMImage& prepared_image, bool overlay_allowed)
 {
     auto name = QString::fromStdString(instance_name);
     auto output_dir = mp::utils::make_dir(instances_dir, name);
 
-    return {copy(prepared_image.image_path, output_dir),
+    return {copy(prepared_image.image_path, output_dir, overlay_allowed),
             copy(prepared_image.kernel_path, output_dir),
             copy(prepared_image.initrd_path, output_dir),
             prepared_image.id,
@@ -691,12 +771,31 @@ mp::VMImage mp::DefaultVMImageVault::fetch_kernel_and_initrd(const VMImageInfo&
     image.initrd_path = image_dir.filePath(mp::vault::filename_for(info.initrd_location));
     mp::vault::DeleteOnException kernel_file{image.kernel_path};
     mp::vault::DeleteOnException initrd_file{image.initrd_path};
-    url_downloader->download_to(info.kernel_location, image.kernel_path, -1, LaunchProgress::KERNEL, monitor);
-    url_downloader->download_to(info.initrd_location, image.initrd_path, -1, LaunchProgress::INITRD, monitor);
+
+    // The manifest does not give their sizes, so the downloader asks the server for them
+    auto download = [this, &image_dir, &monitor](const QString& location, const QString& file_path, int type) {
+        const auto partial_path = partial_download_path(image_dir, file_path);
+        url_downloader->download_to(location, partial_path, -1, type, monitor);
+
+        QFile::remove(file_path);
+        if (!QFile::rename(partial_path, file_path))
+            throw std::runtime_error(fmt::format("Cannot move {} to {}", partial_path, file_path));
+    };
+
+    download(info.kernel_location, image.kernel_path, LaunchProgress::KERNEL);
+    download(info.initrd_location, image.initrd_path, LaunchProgress::INITRD);
 
     return image;
 }
 
+QString mp::DefaultVMImageVault::partial_download_path(const QDir& image_dir, const QString& file_path)
+{
+    // Image directories are named after the release and version, so together with the file name they tell downloads
+    // apart
+    const QDir dir{mp::utils::make_dir(partials_dir, "")};
+    return dir.filePath(QString("%1-%2").arg(image_dir.dirName()).arg(QFileInfo{file_path}.fileName()));
+}
+
 mp::optional<QFuture<mp::VMImage>> mp::DefaultVMImageVault::get_image_future(const std::string& id)
 {
     auto it = in_progress_image_fetches.find(id);
@@ -715,7 +814,7 @@ mp::VMImage mp::DefaultVMImageVault::finalize_image_records(const Query& query,
 
     if (!query.name.empty())
     {
-        vm_image = image_instance_from(query.name, prepared_image);
+        vm_image = image_instance_from(query.name, prepared_image, MP_SETTINGS.get_as<bool>(mp::image_overlays_key));
         instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
     }
 
@@ -724,12 +823,23 @@ mp::VMImage mp::DefaultVMImageVault::finalize_image_records(const Query& query,
     prepared_query.name = "";
     prepared_image_records[id] = {prepared_image, prepared_query, std::chrono::system_clock::now()};
 
-    persist_instance_records();
-    persist_image_records();
+    if (!query.name.empty())
+        persist_instance_record(query.name);
+    persist_image_record(id);
 
     return vm_image;
 }
 
+bool mp::DefaultVMImageVault::backs_instance_images(const QString& image_dir_path)
+{
+    const auto image_dir = QDir{image_dir_path}.absolutePath();
+    return std::any_of(instance_image_records.cbegin(), instance_image_records.cend(),
+                       [&image_dir](const std::pair<std::string, VaultRecord>& record) {
+                           const auto backing_file = mp::vault::backing_file_of(record.second.image.image_path);
+                           return !backing_file.isEmpty() && QFileInfo{backing_file}.absolutePath() == image_dir;
+                       });
+}
+
 mp::VMImageInfo mp::DefaultVMImageVault::info_for(const mp::Query& query)
 {
     if (!query.remote_name.empty())
@@ -767,25 +877,24 @@ mp::VMImageInfo mp::DefaultVMImageVault::get_kernel_query_info(const std::string
 
 namespace
 {
+// Journals the record as it is now, or its removal if it is gone
 template <typename T>
-void persist_records(const T& records, const QString& path)
+void persist_record(const T& records, const std::string& key, mp::JsonJournal& db)
 {
-    QJsonObject json_records;
-    for (const auto& record : records)
-    {
-        auto key = QString::fromStdString(record.first);
-        json_records.insert(key, record_to_json(record.second));
-    }
-    mp::write_json(json_records, path);
+    auto it = records.find(key);
+    if (it == records.end())
+        db.remove(QString::fromStdString(key));
+    else
+        db.insert(QString::fromStdString(key), record_to_json(it->second));
 }
 } // namespace
 
-void mp::DefaultVMImageVault::persist_instance_records()
+void mp::DefaultVMImageVault::persist_instance_record(const std::string& name)
 {
-    persist_records(instance_image_records, data_dir.filePath(instance_db_name));
+    persist_record(instance_image_records, name, instance_db);
 }
 
-void mp::DefaultVMImageVault::persist_image_records()
+void mp::DefaultVMImageVault::persist_image_record(const std::string& key)
 {
-    persist_records(prepared_image_records, cache_dir.filePath(image_db_name));
+    persist_record(prepared_image_records, key, image_db);
 }
@@ -18,7 +18,10 @@
 #ifndef MULTIPASS_DEFAULT_VM_IMAGE_VAULT_H
 #define MULTIPASS_DEFAULT_VM_IMAGE_VAULT_H
 
+#include "json_journal.h"
+
 #include <multipass/days.h>
+#include <multipass/image_blob_store.h>
 #include <multipass/optional.h>
 #include <multipass/query.h>
 #include <multipass/vm_image.h>
@@ -59,7 +62,7 @@ public:
     MemorySize minimum_image_size_for(const std::string& id) override;
 
 private:
-    VMImage image_instance_from(const std::string& name, const VMImage& prepared_image);
+    VMImage image_instance_from(const std::string& name, const VMImage& prepared_image, bool overlay_allowed);
     VMImage download_and_prepare_source_image(const VMImageInfo& info, optional<VMImage>& existing_source_image,
                                               const QDir& image_dir, const FetchType& fetch_type,
                                               const PrepareAction& prepare, const ProgressMonitor& monitor);
@@ -69,10 +72,12 @@ private:
                                     const ProgressMonitor& monitor);
     optional<QFuture<VMImage>> get_image_future(const std::string& id);
     VMImage finalize_image_records(const Query& query, const VMImage& prepared_image, const std::string& id);
+    bool backs_instance_images(const QString& image_dir_path);
+    QString partial_download_path(const QDir& image_dir, const QString& file_path);
     VMImageInfo info_for(const Query& query);
     VMImageInfo get_kernel_query_info(const std::string& name);
-    void persist_image_records();
-    void persist_instance_records();
+    void persist_image_record(const std::string& key);
+    void persist_instance_record(const std::string& name);
 
     std::vector<VMImageHost*> image_hosts;
     URLDownloader* const url_downloader;
@@ -80,9 +85,13 @@ private:
     const QDir data_dir;
     const QDir instances_dir;
     const QDir images_dir;
+    const QDir partials_dir;
     const days days_to_expire;
+    vault::ImageBlobStore blob_store;
     std::mutex fetch_mutex;
 
+    JsonJournal image_db;
+    JsonJournal instance_db;
     std::unordered_map<std::string, VaultRecord> prepared_image_records;
     std::unordered_map<std::string, VaultRecord> instance_image_records;
     std::unordered_map<std::string, VMImageHost*> remote_image_host_map;
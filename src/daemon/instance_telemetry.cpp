@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_telemetry.h"
+
+#include <cassert>
+
+namespace mp = multipass;
+
+mp::InstanceTelemetry::InstanceTelemetry(std::size_t history_size) : history_size{history_size}
+{
+    assert(history_size > 0);
+}
+
+void mp::InstanceTelemetry::record(const std::string& name, const TelemetrySample& sample)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& ring = rings[name];
+
+    if (ring.samples.size() < history_size)
+    {
+        ring.samples.push_back(sample);
+    }
+    else
+    {
+        ring.samples[ring.next] = sample;
+        ring.next = (ring.next + 1) % history_size;
+    }
+}
+
+auto mp::InstanceTelemetry::latest(const std::string& name) const -> optional<TelemetrySample>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = rings.find(name);
+    if (it == rings.end() || it->second.samples.empty())
+        return nullopt;
+
+    const auto& ring = it->second;
+    return ring.samples[(ring.next + ring.samples.size() - 1) % ring.samples.size()];
+}
+
+auto mp::InstanceTelemetry::history(const std::string& name, std::chrono::system_clock::time_point since) const
+    -> std::vector<TelemetrySample>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = rings.find(name);
+    if (it == rings.end())
+        return {};
+
+    std::vector<TelemetrySample> samples;
+    const auto& ring = it->second;
+    for (auto i = 0u; i < ring.samples.size(); ++i)
+    {
+        const auto& sample = ring.samples[(ring.next + i) % ring.samples.size()];
+        if (sample.time >= since)
+            samples.push_back(sample);
+    }
+
+    return samples;
+}
+
+void mp::InstanceTelemetry::forget(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    rings.erase(name);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_TELEMETRY_H
+#define MULTIPASS_INSTANCE_TELEMETRY_H
+
+#include <multipass/optional.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+struct TelemetrySample
+{
+    std::chrono::system_clock::time_point time;
+    std::string load;
+    std::string memory_usage;
+    std::string memory_total;
+    std::string disk_usage;
+    std::string disk_total;
+    std::string current_release;
+};
+
+// Holds the latest samples taken from each instance, up to a fixed number per instance, so that info can answer
+// from memory and tell how an instance fared lately. Samples are recorded from the threads that take them.
+class InstanceTelemetry
+{
+public:
+    explicit InstanceTelemetry(std::size_t history_size);
+
+    void record(const std::string& name, const TelemetrySample& sample);
+    optional<TelemetrySample> latest(const std::string& name) const;
+    // Oldest first
+    std::vector<TelemetrySample> history(const std::string& name, std::chrono::system_clock::time_point since) const;
+    void forget(const std::string& name);
+
+private:
+    struct Ring
+    {
+        std::vector<TelemetrySample> samples;
+        std::size_t next{0}; // where the next sample goes, once the ring is full
+    };
+
+    const std::size_t history_size;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Ring> rings;
+};
+} // namespace multipass
+#endif // MULTIPASS_INSTANCE_TELEMETRY_H
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "json_journal.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "json journal";
+constexpr auto min_entries_to_compact = 64;
+
+QJsonObject read_snapshot(const QString& file_name)
+{
+    QFile file{file_name};
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+} // namespace
+
+mp::JsonJournal::JsonJournal(const QString& file_name)
+    : file_name{file_name}, journal{file_name + ".journal"}, snapshot{read_snapshot(file_name)}
+{
+    if (journal.open(QIODevice::ReadOnly))
+    {
+        while (!journal.atEnd())
+        {
+            // A line that does not parse was torn by a crash while it was appended, and nothing can follow it
+            auto entry = QJsonDocument::fromJson(journal.readLine()).object();
+            if (entry.isEmpty())
+                break;
+
+            auto key = entry["key"].toString();
+            if (entry["removed"].toBool())
+                snapshot.remove(key);
+            else
+                snapshot.insert(key, entry["record"]);
+
+            ++journal_entries;
+        }
+        journal.close();
+    }
+
+    // Starts from an empty journal, which also drops whatever was torn at its end
+    if (journal.exists())
+        compact();
+}
+
+const QJsonObject& mp::JsonJournal::records() const
+{
+    return snapshot;
+}
+
+void mp::JsonJournal::insert(const QString& key, const QJsonObject& record)
+{
+    snapshot.insert(key, record);
+    append({{"key", key}, {"record", record}});
+}
+
+void mp::JsonJournal::remove(const QString& key)
+{
+    snapshot.remove(key);
+    append({{"key", key}, {"removed", true}});
+}
+
+void mp::JsonJournal::append(const QJsonObject& entry)
+{
+    if (!journal.isOpen() && !journal.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("Cannot open {}: {}", journal.fileName(), journal.errorString()));
+        return;
+    }
+
+    journal.write(QJsonDocument{entry}.toJson(QJsonDocument::Compact) + '\n');
+    journal.flush();
+
+    if (++journal_entries > std::max(snapshot.size(), min_entries_to_compact))
+        compact();
+}
+
+void mp::JsonJournal::compact()
+{
+    QSaveFile file{file_name};
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument{snapshot}.toJson()) < 0 || !file.commit())
+    {
+        // The journal still holds what the file is missing, so it keeps growing until compacting works again
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot write {}: {}", file_name, file.errorString()));
+        return;
+    }
+
+    journal.close();
+    journal.remove();
+    journal_entries = 0;
+}
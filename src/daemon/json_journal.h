@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_JSON_JOURNAL_H
+#define MULTIPASS_JSON_JOURNAL_H
+
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+
+namespace multipass
+{
+// Keeps a JSON object of records on disk without rewriting all of it on every change. Changes are appended to a
+// journal next to the file, one line each, and folded back into the file once the journal has grown about as large
+// as the records themselves. The file is only ever replaced through an atomic rename, and replaying the journal is
+// idempotent, so a crash at any point leaves either the old or the new state behind.
+class JsonJournal
+{
+public:
+    explicit JsonJournal(const QString& file_name);
+
+    const QJsonObject& records() const;
+    void insert(const QString& key, const QJsonObject& record);
+    void remove(const QString& key);
+
+private:
+    void append(const QJsonObject& entry);
+    void compact();
+
+    const QString file_name;
+    QFile journal;
+    QJsonObject snapshot;
+    int journal_entries{0};
+};
+} // namespace multipass
+#endif // MULTIPASS_JSON_JOURNAL_H
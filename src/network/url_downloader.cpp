@@ -25,13 +25,20 @@
 #include <QDir>
 #include <QEventLoop>
 #include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QNetworkDiskCache>
 #include <QNetworkReply>
 #include <QTimer>
 #include <QUrl>
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <vector>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -39,6 +46,17 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "url downloader";
+constexpr qint64 min_segment_size = 16 * 1024 * 1024;
+constexpr qint64 segments_save_interval = 4 * 1024 * 1024;
+constexpr qint64 stream_chunk_size = 1024 * 1024;
+
+// A range of the file that is downloaded over its own connection; done counts the bytes written from its start
+struct Segment
+{
+    qint64 start;
+    qint64 end;
+    qint64 done;
+};
 
 auto make_network_manager(const mp::Path& cache_dir_path)
 {
@@ -108,25 +126,12 @@ QByteArray download(QNetworkAccessManager* manager, const Time& timeout, QUrl co
     }
     return reply->readAll();
 }
-} // namespace
-
-mp::URLDownloader::URLDownloader(std::chrono::milliseconds timeout) : URLDownloader{Path(), timeout}
-{
-}
 
-mp::URLDownloader::URLDownloader(const mp::Path& cache_dir, std::chrono::milliseconds timeout)
-    : cache_dir_path{QDir(cache_dir).filePath("network-cache")}, timeout{timeout}
+template <typename Sink, typename ErrorAction, typename Time>
+void download_to_sink(QNetworkAccessManager* manager, const Time& timeout, const QUrl& url, int64_t size,
+                      const int download_type, const mp::ProgressMonitor& monitor, Sink&& sink, ErrorAction&& on_error,
+                      const std::atomic_bool& abort_download)
 {
-}
-
-void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
-                                    const mp::ProgressMonitor& monitor)
-{
-    auto manager{make_network_manager(cache_dir_path)};
-
-    QFile file{file_name};
-    file.open(QIODevice::ReadWrite | QIODevice::Truncate);
-
     auto progress_monitor = [&monitor, download_type, size](QNetworkReply* reply, qint64 bytes_received,
                                                             qint64 bytes_total) {
         if (bytes_received == 0)
@@ -142,7 +147,7 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         }
     };
 
-    auto on_download = [this, &file](QNetworkReply* reply, QTimer& download_timeout) {
+    auto on_download = [&sink, &abort_download](QNetworkReply* reply, QTimer& download_timeout) {
         if (abort_download)
         {
             reply->abort();
@@ -154,17 +159,362 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         else
             return;
 
-        if (file.write(reply->readAll()) < 0)
+        if (!sink(reply->readAll()))
         {
-            mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
             reply->abort();
+            return;
         }
         download_timeout.start();
     };
 
+    download(manager, timeout, url, progress_monitor, on_download, on_error, abort_download);
+}
+
+// The progress of a segmented download is kept next to the file, so that the download can resume after a restart
+QString segments_path_for(const QString& file_name)
+{
+    return file_name + ".segments";
+}
+
+qint64 downloaded_size(const std::vector<Segment>& segments)
+{
+    return std::accumulate(segments.cbegin(), segments.cend(), qint64{0},
+                           [](qint64 sum, const Segment& segment) { return sum + segment.done; });
+}
+
+// How much of the file is downloaded without gaps from its start
+qint64 contiguous_size(const std::vector<Segment>& segments)
+{
+    for (const auto& segment : segments)
+    {
+        if (segment.start + segment.done < segment.end)
+            return segment.start + segment.done;
+    }
+
+    return segments.empty() ? 0 : segments.back().end;
+}
+
+std::vector<Segment> make_segments(qint64 size, int max_connections)
+{
+    const auto count = std::max(qint64{1}, std::min(qint64{max_connections}, size / min_segment_size));
+    const auto length = size / count;
+
+    std::vector<Segment> segments;
+    for (qint64 i = 0; i < count; ++i)
+        segments.push_back({i * length, i == count - 1 ? size : (i + 1) * length, 0});
+
+    return segments;
+}
+
+// Returns nothing unless the saved progress is for a partial file of the expected size
+std::vector<Segment> load_segments(const QString& file_name, qint64 size)
+{
+    QFile segments_file{segments_path_for(file_name)};
+    if (QFileInfo{file_name}.size() != size || !segments_file.open(QIODevice::ReadOnly))
+        return {};
+
+    const auto json = QJsonDocument::fromJson(segments_file.readAll()).object();
+    if (static_cast<qint64>(json["size"].toDouble()) != size)
+        return {};
+
+    std::vector<Segment> segments;
+    qint64 expected_start{0};
+    for (const auto& entry : json["segments"].toArray())
+    {
+        const auto object = entry.toObject();
+        const Segment segment{static_cast<qint64>(object["start"].toDouble()),
+                              static_cast<qint64>(object["end"].toDouble()),
+                              static_cast<qint64>(object["done"].toDouble())};
+        if (segment.start != expected_start || segment.end <= segment.start || segment.done < 0 ||
+            segment.done > segment.end - segment.start)
+            return {};
+
+        segments.push_back(segment);
+        expected_start = segment.end;
+    }
+
+    if (expected_start != size)
+        return {};
+
+    return segments;
+}
+
+void save_segments(const QString& file_name, qint64 size, const std::vector<Segment>& segments)
+{
+    QJsonArray segments_array;
+    for (const auto& segment : segments)
+        segments_array.append(QJsonObject{{"start", segment.start}, {"end", segment.end}, {"done", segment.done}});
+
+    QFile segments_file{segments_path_for(file_name)};
+    if (!segments_file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        segments_file.write(QJsonDocument{QJsonObject{{"size", size}, {"segments", segments_array}}}.toJson()) < 0)
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("cannot save download progress of {}: {}", file_name, segments_file.errorString()));
+}
+
+// Asks the server for the size of the file behind url, returning -1 if it does not say
+template <typename Time>
+qint64 content_length_of(QNetworkAccessManager* manager, const Time& timeout, const QUrl& url)
+{
+    QEventLoop event_loop;
+    QTimer head_timeout;
+    head_timeout.setInterval(timeout);
+    head_timeout.setSingleShot(true);
+
+    QNetworkRequest request{url};
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+
+    auto reply = manager->head(request);
+    QObject::connect(reply, &QNetworkReply::finished, &event_loop, &QEventLoop::quit);
+    QObject::connect(&head_timeout, &QTimer::timeout, reply, &QNetworkReply::abort);
+
+    head_timeout.start();
+    event_loop.exec();
+
+    bool ok{false};
+    const auto length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+    return reply->error() == QNetworkReply::NoError && ok && length > 0 ? length : -1;
+}
+
+// Downloads the missing parts of each segment over parallel range requests. Returns false if the server does not
+// honour range requests, in which case the download has to start over as a whole. If there is a sink, the file is
+// handed to it in order, as far as it is downloaded without gaps, and streamed_size counts what it was handed.
+template <typename Time>
+bool download_segments(QNetworkAccessManager* manager, const Time& timeout, const QUrl& url, const QString& file_name,
+                       qint64 size, int max_connections, const int download_type, const mp::ProgressMonitor& monitor,
+                       const mp::URLDownloader::DataSink& sink, qint64& streamed_size,
+                       const std::atomic_bool& abort_download)
+{
+    auto segments = load_segments(file_name, size);
+    const auto resuming = !segments.empty();
+
+    QFile file{file_name};
+    if (resuming)
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("resuming download of {} from {} bytes", url.toString(), downloaded_size(segments)));
+        file.open(QIODevice::ReadWrite);
+    }
+    else
+    {
+        segments = make_segments(size, max_connections);
+        file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+        file.resize(size);
+    }
+
+    QEventLoop event_loop;
+    std::vector<QNetworkReply*> replies;
+    std::vector<std::unique_ptr<QTimer>> timers;
+    auto pending = 0;
+    auto saved_size = downloaded_size(segments);
+    bool ranges_ignored{false}, timed_out{false}, sink_refused{false};
+    QString write_error;
+
+    auto abort_all = [&replies] {
+        for (auto reply : replies)
+            if (reply->isRunning())
+                reply->abort();
+    };
+
+    auto stream_downloaded = [&] {
+        const auto end = sink ? contiguous_size(segments) : 0;
+        while (streamed_size < end)
+        {
+            QByteArray data;
+            if (file.seek(streamed_size))
+                data = file.read(std::min(end - streamed_size, stream_chunk_size));
+            if (data.isEmpty())
+            {
+                write_error = file.errorString();
+                return false;
+            }
+
+            if (!sink(data))
+            {
+                sink_refused = true;
+                return false;
+            }
+            streamed_size += data.size();
+        }
+
+        return true;
+    };
+
+    // What an earlier attempt downloaded is handed over first, and nothing more is asked for if that fails
+    const auto streamed_earlier = stream_downloaded();
+
+    for (std::size_t index = 0; streamed_earlier && index < segments.size(); ++index)
+    {
+        const auto& segment = segments[index];
+        if (segment.start + segment.done == segment.end)
+            continue;
+
+        QNetworkRequest request{url};
+        request.setRawHeader("Range", QStringLiteral("bytes=%1-%2")
+                                          .arg(segment.start + segment.done)
+                                          .arg(segment.end - 1)
+                                          .toLatin1());
+        request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+
+        auto reply = manager->get(request);
+        auto timer = std::make_unique<QTimer>();
+        timer->setInterval(timeout);
+        timer->setSingleShot(true);
+
+        QObject::connect(timer.get(), &QTimer::timeout, [&timed_out, reply] {
+            timed_out = true;
+            reply->abort();
+        });
+        QObject::connect(reply, &QNetworkReply::readyRead, [&, index, reply, timer = timer.get()] {
+            if (abort_download)
+                return abort_all();
+
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+            {
+                ranges_ignored = true;
+                return abort_all();
+            }
+
+            auto& segment = segments[index];
+            const auto data = reply->read(segment.end - segment.start - segment.done);
+            if (!file.seek(segment.start + segment.done) || file.write(data) != data.size())
+            {
+                write_error = file.errorString();
+                return abort_all();
+            }
+            segment.done += data.size();
+            timer->start();
+
+            if (!stream_downloaded())
+                return abort_all();
+
+            const auto downloaded = downloaded_size(segments);
+            if (!monitor(download_type, (100 * downloaded + size / 2) / size))
+                return abort_all();
+
+            if (downloaded - saved_size >= segments_save_interval && file.flush())
+            {
+                save_segments(file_name, size, segments);
+                saved_size = downloaded;
+            }
+        });
+        QObject::connect(reply, &QNetworkReply::finished, [&event_loop, &pending, timer = timer.get()] {
+            timer->stop();
+            if (--pending == 0)
+                event_loop.quit();
+        });
+
+        replies.push_back(reply);
+        timer->start();
+        timers.push_back(std::move(timer));
+        ++pending;
+    }
+
+    if (pending > 0)
+        event_loop.exec();
+
+    if (ranges_ignored)
+        return false;
+
+    file.flush();
+    save_segments(file_name, size, segments);
+
+    if (!write_error.isEmpty())
+    {
+        mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", write_error));
+        throw mp::DownloadException{url.toString().toStdString(), write_error.toStdString()};
+    }
+
+    if (sink_refused)
+        throw mp::DownloadException{url.toString().toStdString(), "the downloaded data was not taken"};
+
+    const auto failed_reply = std::find_if(replies.cbegin(), replies.cend(), [](QNetworkReply* reply) {
+        return reply->error() != QNetworkReply::NoError;
+    });
+    if (failed_reply != replies.cend())
+    {
+        const auto msg = (*failed_reply)->errorString().toStdString();
+        if (abort_download)
+            throw mp::AbortedDownloadException{msg};
+        else
+            throw mp::DownloadException{url.toString().toStdString(), timed_out ? "Network timeout" : msg};
+    }
+
+    if (downloaded_size(segments) != size)
+        throw mp::DownloadException{url.toString().toStdString(),
+                                    fmt::format("downloaded size does not match the expected {} bytes", size)};
+
+    QFile::remove(segments_path_for(file_name));
+    return true;
+}
+} // namespace
+
+mp::URLDownloader::URLDownloader(std::chrono::milliseconds timeout) : URLDownloader{Path(), timeout}
+{
+}
+
+mp::URLDownloader::URLDownloader(const mp::Path& cache_dir, std::chrono::milliseconds timeout, int max_connections)
+    : cache_dir_path{QDir(cache_dir).filePath("network-cache")},
+      timeout{timeout},
+      max_connections{std::max(max_connections, 1)}
+{
+}
+
+void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                                    const mp::ProgressMonitor& monitor)
+{
+    download_to_file(url, file_name, nullptr, size, download_type, monitor);
+}
+
+void mp::URLDownloader::stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                                  const int download_type, const mp::ProgressMonitor& monitor)
+{
+    download_to_file(url, file_name, sink, size, download_type, monitor);
+}
+
+void mp::URLDownloader::download_to_file(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                                         const int download_type, const mp::ProgressMonitor& monitor)
+{
+    auto manager{make_network_manager(cache_dir_path)};
+
+    // Only HTTP servers can be asked for ranges, and those only help if the size is known up front, so it is asked for
+    // when the caller does not know it
+    const auto http = url.scheme().startsWith("http");
+    if (size <= 0 && http)
+        size = content_length_of(manager.get(), timeout, url);
+
+    qint64 streamed_size{0};
+    if (size > 0 && http &&
+        download_segments(manager.get(), timeout, url, file_name, size, max_connections, download_type, monitor, sink,
+                          streamed_size, abort_download))
+        return;
+
+    QFile::remove(segments_path_for(file_name));
+
+    QFile file{file_name};
+    file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+
+    // Starting over, the sink is only handed what it was not handed already
+    qint64 received_size{0};
+    auto write_to_file = [&file, &sink, &received_size, streamed_size](const QByteArray& data) {
+        if (file.write(data) < 0)
+        {
+            mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
+            return false;
+        }
+
+        const auto skipped = std::min<qint64>(std::max<qint64>(streamed_size - received_size, 0), data.size());
+        received_size += data.size();
+        return !sink || skipped == data.size() || sink(data.mid(skipped));
+    };
+
     auto on_error = [&file]() { file.remove(); };
 
-    ::download(manager.get(), timeout, url, progress_monitor, on_download, on_error, abort_download);
+    download_to_sink(manager.get(), timeout, url, size, download_type, monitor, write_to_file, on_error,
+                     abort_download);
 }
 
 QByteArray mp::URLDownloader::download(const QUrl& url)
@@ -24,6 +24,8 @@
 #include <multipass/logging/log.h>
 #include <multipass/utils.h>
 
+#include <QDir>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
 
@@ -138,6 +140,7 @@ mp::VMImageVault::UPtr mp::LXDVirtualMachineFactory::create_image_vault(std::vec
                                                                         const mp::Path& data_dir_path,
                                                                         const mp::days& days_to_expire)
 {
+    // The blob store is shared with the other backends, at the top of the daemon's cache
     return std::make_unique<mp::LXDVMImageVault>(image_hosts, downloader, manager.get(), base_url, cache_dir_path,
-                                                 days_to_expire);
+                                                 days_to_expire, QFileInfo{cache_dir_path}.dir().filePath("blobs"));
 }
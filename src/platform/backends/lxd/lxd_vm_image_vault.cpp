@@ -134,13 +134,15 @@ QString create_metadata_tarball(const mp::VMImageInfo& info, const QTemporaryDir
 
 mp::LXDVMImageVault::LXDVMImageVault(std::vector<VMImageHost*> image_hosts, URLDownloader* downloader,
                                      NetworkAccessManager* manager, const QUrl& base_url, const QString& cache_dir_path,
-                                     const days& days_to_expire)
+                                     const days& days_to_expire, const QString& blob_store_path)
     : image_hosts{image_hosts},
       url_downloader{downloader},
       manager{manager},
       base_url{base_url},
       template_path{QString("%1/%2-").arg(cache_dir_path).arg(QCoreApplication::applicationName())},
-      days_to_expire{days_to_expire}
+      partials_dir{QDir{cache_dir_path}.filePath("partial")},
+      days_to_expire{days_to_expire},
+      blob_store{blob_store_path.isEmpty() ? QDir{cache_dir_path}.filePath("blobs") : blob_store_path}
 {
     for (const auto& image_host : image_hosts)
     {
@@ -258,9 +260,20 @@ mp::VMImage mp::LXDVMImageVault::fetch_image(const FetchType& fetch_type, const
 
             auto image_path = lxd_import_dir.filePath(mp::vault::filename_for(info.image_location));
 
-            url_download_image(info, image_path, monitor);
+            // Blobs are decoded images, the way the other vaults keep them
+            const auto decoded_image_path = QString{image_path}.remove(".xz");
+            if (!info.verify || !blob_store.fetch(info.id, decoded_image_path))
+            {
+                url_download_image(info, image_path, monitor);
+
+                if (image_path.endsWith(".xz"))
+                    mp::vault::extract_image(image_path, monitor, true);
+
+                if (info.verify)
+                    blob_store.add(info.id, decoded_image_path);
+            }
 
-            image_path = post_process_downloaded_image(image_path, monitor);
+            image_path = post_process_downloaded_image(decoded_image_path, monitor);
 
             monitor(LaunchProgress::WAITING, -1);
 
@@ -339,6 +352,9 @@ void mp::LXDVMImageVault::prune_expired_images()
             }
         }
     }
+
+    blob_store.prune(days_to_expire);
+    mp::vault::remove_stale_partial_downloads(partials_dir, days_to_expire);
 }
 
 void mp::LXDVMImageVault::update_images(const FetchType& fetch_type, const PrepareAction& prepare,
@@ -465,15 +481,24 @@ void mp::LXDVMImageVault::lxd_download_image(const QString& id, const QString& s
 void mp::LXDVMImageVault::url_download_image(const VMImageInfo& info, const QString& image_path,
                                              const ProgressMonitor& monitor)
 {
-    mp::vault::DeleteOnException image_file{image_path};
+    // The import directory is new on every attempt, so the download is kept aside until it is complete for an
+    // interrupted one to be resumed by the next attempt
+    const QDir dir{mp::utils::make_dir(partials_dir, "")};
+    const auto partial_path = dir.filePath(QString("%1-%2").arg(info.id).arg(QFileInfo{image_path}.fileName()));
 
-    url_downloader->download_to(info.image_location, image_path, info.size, LaunchProgress::IMAGE, monitor);
+    url_downloader->download_to(info.image_location, partial_path, info.size, LaunchProgress::IMAGE, monitor);
 
     if (info.verify)
     {
         monitor(LaunchProgress::VERIFY, -1);
-        mp::vault::verify_image_download(image_path, info.id);
+
+        // A complete download that does not match has to start over
+        mp::vault::DeleteOnException partial_file{partial_path};
+        mp::vault::verify_image_download(partial_path, info.id);
     }
+
+    if (!QFile::rename(partial_path, image_path))
+        throw std::runtime_error(fmt::format("Cannot move {} to {}", partial_path, image_path));
 }
 
 void mp::LXDVMImageVault::poll_download_operation(const QJsonObject& json_reply, const ProgressMonitor& monitor,
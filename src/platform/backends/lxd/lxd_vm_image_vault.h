@@ -19,10 +19,12 @@
 #define MULTIPASS_LXD_VM_IMAGE_VAULT_H
 
 #include <multipass/days.h>
+#include <multipass/image_blob_store.h>
 #include <multipass/query.h>
 #include <multipass/vm_image_host.h>
 #include <multipass/vm_image_vault.h>
 
+#include <QDir>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QUrl>
@@ -39,8 +41,10 @@ class LXDVMImageVault final : public VMImageVault
 public:
     using TaskCompleteAction = std::function<void(const QJsonObject&)>;
 
+    // Images are shared through the blob store at blob_store_path, or in cache_dir_path if that is empty
     LXDVMImageVault(std::vector<VMImageHost*> image_host, URLDownloader* downloader, NetworkAccessManager* manager,
-                    const QUrl& base_url, const QString& cache_dir_path, const multipass::days& days_to_expire);
+                    const QUrl& base_url, const QString& cache_dir_path, const multipass::days& days_to_expire,
+                    const QString& blob_store_path = {});
 
     VMImage fetch_image(const FetchType& fetch_type, const Query& query, const PrepareAction& prepare,
                         const ProgressMonitor& monitor) override;
@@ -67,7 +71,9 @@ private:
     NetworkAccessManager* manager;
     const QUrl base_url;
     const QString template_path;
+    const QDir partials_dir;
     const days days_to_expire;
+    vault::ImageBlobStore blob_store;
     std::unordered_map<std::string, VMImageHost*> remote_image_host_map;
 };
 } // namespace multipass
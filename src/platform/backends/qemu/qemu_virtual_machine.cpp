@@ -20,6 +20,7 @@
 #include "dnsmasq_server.h"
 #include "qemu_vm_process_spec.h"
 #include "qemu_vmstate_process_spec.h"
+#include "virtiofsd_process_spec.h"
 #include <shared/linux/backend_utils.h>
 #include <shared/linux/process_factory.h>
 #include <shared/shared_backend_utils.h>
@@ -33,6 +34,8 @@
 #include <multipass/format.h>
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
 #include <QHash>
 #include <QJsonArray>
@@ -85,7 +88,8 @@ QStringList get_arguments(const QJsonObject& metadata)
 }
 
 auto make_qemu_process(const mp::VirtualMachineDescription& desc, const mp::optional<QJsonObject>& resume_metadata,
-                       const std::string& tap_device_name)
+                       const std::string& tap_device_name,
+                       const std::vector<mp::QemuVMProcessSpec::NativeMount>& native_mounts)
 {
     if (!QFile::exists(desc.image.image_path) || !QFile::exists(desc.cloud_init_iso))
     {
@@ -100,8 +104,8 @@ auto make_qemu_process(const mp::VirtualMachineDescription& desc, const mp::opti
                                                         get_arguments(data)};
     }
 
-    auto process_spec =
-        std::make_unique<mp::QemuVMProcessSpec>(desc, QString::fromStdString(tap_device_name), resume_data);
+    auto process_spec = std::make_unique<mp::QemuVMProcessSpec>(desc, QString::fromStdString(tap_device_name),
+                                                                resume_data, native_mounts);
     auto process = MP_PROCFACTORY.create_process(std::move(process_spec));
 
     mpl::log(mpl::Level::debug, desc.vm_name, fmt::format("process working dir '{}'", process->working_directory()));
@@ -195,14 +199,16 @@ auto generate_metadata(const QStringList& args)
 } // namespace
 
 mp::QemuVirtualMachine::QemuVirtualMachine(const VirtualMachineDescription& desc, const std::string& tap_device_name,
-                                           DNSMasqServer& dnsmasq_server, VMStatusMonitor& monitor)
+                                           DNSMasqServer& dnsmasq_server, VMStatusMonitor& monitor,
+                                           const Path& virtiofs_dir)
     : VirtualMachine{instance_image_has_snapshot(desc.image.image_path) ? State::suspended : State::off, desc.vm_name},
       tap_device_name{tap_device_name},
       desc{desc},
       mac_addr{desc.mac_addr},
       username{desc.ssh_username},
       dnsmasq_server{&dnsmasq_server},
-      monitor{&monitor}
+      monitor{&monitor},
+      virtiofs_dir{virtiofs_dir}
 {
     QObject::connect(this, &QemuVirtualMachine::on_delete_memory_snapshot, this,
                      [this] {
@@ -219,18 +225,22 @@ mp::QemuVirtualMachine::~QemuVirtualMachine()
     {
         update_shutdown_status = false;
 
-        if (state == State::running)
+        if (state == State::running && virtiofsd_processes.empty())
         {
             suspend();
         }
         else
         {
+            if (state == State::running)
+                mpl::log(mpl::Level::info, vm_name, "Shutting down rather than suspending, due to native mounts");
+
             shutdown();
         }
 
         vm_process->wait_for_finished();
     }
 
+    stop_native_mount_servers();
     remove_tap_device(QString::fromStdString(tap_device_name));
 }
 
@@ -242,6 +252,9 @@ void mp::QemuVirtualMachine::start()
     if (state == State::suspending)
         throw std::runtime_error("cannot start the instance while suspending");
 
+    // An instance resumes with the devices it was suspended with, which never include native mounts
+    if (state != State::suspended)
+        start_native_mount_servers();
     initialize_vm_process();
 
     if (state == State::suspended)
@@ -312,6 +325,11 @@ void mp::QemuVirtualMachine::suspend()
 {
     if ((state == State::running || state == State::delayed_shutdown) && vm_process->running())
     {
+        // QEMU cannot save vhost-user-fs devices, it would fail to suspend and never get back to us
+        if (!virtiofsd_processes.empty())
+            throw std::runtime_error(
+                fmt::format("cannot suspend {} while it has native mounts, stop it instead", vm_name));
+
         vm_process->write(hmc_to_qmp_json("savevm " + QString::fromStdString(suspend_tag)));
 
         if (update_shutdown_status)
@@ -376,6 +394,7 @@ void mp::QemuVirtualMachine::on_shutdown()
     ip = nullopt;
     update_state();
     vm_process.reset(nullptr);
+    stop_native_mount_servers();
     lock.unlock();
     monitor->on_shutdown();
 }
@@ -383,6 +402,7 @@ void mp::QemuVirtualMachine::on_shutdown()
 void mp::QemuVirtualMachine::on_suspend()
 {
     state = State::suspended;
+    stop_native_mount_servers();
     monitor->on_suspend();
 }
 
@@ -444,11 +464,96 @@ void mp::QemuVirtualMachine::wait_until_ssh_up(std::chrono::milliseconds timeout
     }
 }
 
+void mp::QemuVirtualMachine::add_native_mount(const std::string& source_path, const std::string& tag)
+{
+    native_mounts[tag] = source_path;
+}
+
+void mp::QemuVirtualMachine::remove_native_mount(const std::string& tag)
+{
+    native_mounts.erase(tag);
+}
+
+void mp::QemuVirtualMachine::start_native_mount_servers()
+{
+    stop_native_mount_servers();
+
+    std::vector<QString> socket_paths;
+    for (const auto& native_mount : native_mounts)
+    {
+        const auto source_path = QString::fromStdString(native_mount.second);
+        const auto socket_path = native_mount_socket_path(native_mount.first);
+        QFile::remove(socket_path);
+
+        auto process =
+            MP_PROCFACTORY.create_process(std::make_unique<mp::VirtiofsdProcessSpec>(source_path, socket_path));
+        mpl::log(mpl::Level::debug, vm_name, fmt::format("serving native mount of '{}'", source_path));
+
+        QObject::connect(process.get(), &Process::ready_read_standard_error, [this, virtiofsd = process.get()]() {
+            mpl::log(mpl::Level::debug, vm_name, virtiofsd->read_all_standard_error().toStdString());
+        });
+
+        process->start();
+        if (!process->wait_for_started())
+        {
+            throw std::runtime_error(fmt::format("failed to serve native mount of '{}': {}", source_path,
+                                                 process->process_state().failure_message()));
+        }
+
+        virtiofsd_processes.push_back(std::move(process));
+        socket_paths.push_back(socket_path);
+    }
+
+    // QEMU connects to every socket as it starts, so they all need to be listening first
+    for (const auto& socket_path : socket_paths)
+    {
+        auto on_timeout = [&socket_path] {
+            throw std::runtime_error(fmt::format("timed out waiting for virtiofsd to listen on '{}'", socket_path));
+        };
+
+        mp::utils::try_action_for(on_timeout, std::chrono::seconds(5), [&socket_path] {
+            return QFile::exists(socket_path) ? mp::utils::TimeoutAction::done : mp::utils::TimeoutAction::retry;
+        });
+    }
+}
+
+void mp::QemuVirtualMachine::stop_native_mount_servers()
+{
+    for (auto& process : virtiofsd_processes)
+    {
+        if (process->running())
+        {
+            process->terminate();
+            if (!process->wait_for_finished(5000))
+                process->kill();
+        }
+    }
+
+    virtiofsd_processes.clear();
+}
+
+QString mp::QemuVirtualMachine::native_mount_socket_path(const std::string& tag) const
+{
+    // Stable across runs, as QEMU finds it again on restart, and kept short, as socket paths are limited to 108
+    // characters
+    const auto name_hash =
+        QCryptographicHash::hash(QByteArray::fromStdString(vm_name + ":" + tag), QCryptographicHash::Sha256);
+    return QDir(virtiofs_dir).filePath(QString::fromLatin1(name_hash.toHex().left(16)) + ".sock");
+}
+
 void mp::QemuVirtualMachine::initialize_vm_process()
 {
+    std::vector<QemuVMProcessSpec::NativeMount> vm_native_mounts;
+    if (state != State::suspended)
+    {
+        for (const auto& native_mount : native_mounts)
+            vm_native_mounts.push_back({QString::fromStdString(native_mount.first),
+                                        native_mount_socket_path(native_mount.first)});
+    }
+
     vm_process = make_qemu_process(
         desc, ((state == State::suspended) ? mp::make_optional(monitor->retrieve_metadata_for(vm_name)) : mp::nullopt),
-        tap_device_name);
+        tap_device_name, vm_native_mounts);
 
     QObject::connect(vm_process.get(), &Process::started, [this]() {
         mpl::log(mpl::Level::info, vm_name, "process started");
@@ -18,6 +18,7 @@
 #ifndef MULTIPASS_QEMU_VIRTUAL_MACHINE_H
 #define MULTIPASS_QEMU_VIRTUAL_MACHINE_H
 
+#include <multipass/path.h>
 #include <multipass/process/process.h>
 #include <multipass/virtual_machine.h>
 #include <multipass/virtual_machine_description.h>
@@ -25,6 +26,9 @@
 #include <QObject>
 #include <QStringList>
 
+#include <map>
+#include <vector>
+
 namespace multipass
 {
 class DNSMasqServer;
@@ -35,7 +39,7 @@ class QemuVirtualMachine final : public QObject, public VirtualMachine
     Q_OBJECT
 public:
     QemuVirtualMachine(const VirtualMachineDescription& desc, const std::string& tap_device_name,
-                       DNSMasqServer& dnsmasq_server, VMStatusMonitor& monitor);
+                       DNSMasqServer& dnsmasq_server, VMStatusMonitor& monitor, const Path& virtiofs_dir);
     ~QemuVirtualMachine();
 
     void start() override;
@@ -51,6 +55,8 @@ public:
     void ensure_vm_is_running() override;
     void wait_until_ssh_up(std::chrono::milliseconds timeout) override;
     void update_state() override;
+    void add_native_mount(const std::string& source_path, const std::string& tag) override;
+    void remove_native_mount(const std::string& tag) override;
 
 signals:
     void on_delete_memory_snapshot();
@@ -62,6 +68,9 @@ private:
     void on_suspend();
     void on_restart();
     void initialize_vm_process();
+    void start_native_mount_servers();
+    void stop_native_mount_servers();
+    QString native_mount_socket_path(const std::string& tag) const;
 
     const std::string tap_device_name;
     const VirtualMachineDescription desc;
@@ -73,6 +82,9 @@ private:
     std::string saved_error_msg;
     bool update_shutdown_status{true};
     bool delete_memory_snapshot{false};
+    const Path virtiofs_dir;
+    std::map<std::string, std::string> native_mounts; // source paths by tag
+    std::vector<std::unique_ptr<Process>> virtiofsd_processes;
 };
 } // namespace multipass
 
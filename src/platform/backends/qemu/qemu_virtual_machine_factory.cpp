@@ -122,7 +122,8 @@ mp::QemuVirtualMachineFactory::QemuVirtualMachineFactory(const mp::Path& data_di
       network_dir{mp::utils::make_dir(QDir(data_dir), "network")},
       subnet{mp::backend::get_subnet(network_dir, bridge_name)},
       dnsmasq_server{create_dnsmasq_server(network_dir, bridge_name, subnet)},
-      iptables_config{bridge_name, subnet}
+      iptables_config{bridge_name, subnet},
+      virtiofs_dir{mp::utils::make_dir(QDir(data_dir), "virtiofs")}
 {
 }
 
@@ -137,7 +138,7 @@ mp::VirtualMachine::UPtr mp::QemuVirtualMachineFactory::create_virtual_machine(c
     auto tap_device_name = generate_tap_device_name(desc.vm_name);
     create_tap_device(QString::fromStdString(tap_device_name), bridge_name);
 
-    auto vm = std::make_unique<mp::QemuVirtualMachine>(desc, tap_device_name, dnsmasq_server, monitor);
+    auto vm = std::make_unique<mp::QemuVirtualMachine>(desc, tap_device_name, dnsmasq_server, monitor, virtiofs_dir);
 
     name_to_mac_map.emplace(desc.vm_name, desc.mac_addr);
     return vm;
@@ -50,6 +50,7 @@ private:
     const std::string subnet;
     DNSMasqServer dnsmasq_server;
     IPTablesConfig iptables_config;
+    const Path virtiofs_dir;
     std::unordered_map<std::string, std::string> name_to_mac_map;
 };
 } // namespace multipass
@@ -21,6 +21,7 @@
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/snap_utils.h>
+#include <multipass/vm_image_vault.h>
 #include <shared/linux/backend_utils.h>
 
 namespace mp = multipass;
@@ -73,8 +74,9 @@ QStringList initial_qemu_arguments(const mp::VirtualMachineDescription& desc, co
 } // namespace
 
 mp::QemuVMProcessSpec::QemuVMProcessSpec(const mp::VirtualMachineDescription& desc, const QString& tap_device_name,
-                                         const multipass::optional<ResumeData>& resume_data)
-    : desc(desc), tap_device_name(tap_device_name), resume_data{resume_data}
+                                         const multipass::optional<ResumeData>& resume_data,
+                                         const std::vector<NativeMount>& native_mounts)
+    : desc(desc), tap_device_name(tap_device_name), resume_data{resume_data}, native_mounts{native_mounts}
 {
 }
 
@@ -147,6 +149,20 @@ QStringList mp::QemuVMProcessSpec::arguments() const
              << "-nographic";
         // Cloud-init disk
         args << "-cdrom" << desc.cloud_init_iso;
+
+        if (!native_mounts.empty())
+        {
+            // virtiofsd serves the guest straight out of its memory, so that needs to be shareable
+            args << "-object" << QString("memory-backend-memfd,id=mem,size=%1,share=on").arg(mem_size) << "-numa"
+                 << "node,memdev=mem";
+
+            for (auto i = 0u; i < native_mounts.size(); ++i)
+            {
+                args << "-chardev" << QString("socket,id=virtiofs%1,path=%2").arg(i).arg(native_mounts[i].socket_path)
+                     << "-device"
+                     << QString("vhost-user-fs-pci,chardev=virtiofs%1,tag=%2").arg(i).arg(native_mounts[i].tag);
+            }
+        }
     }
 
     return args;
@@ -223,7 +239,9 @@ profile %1 flags=(attach_disconnected) {
   # Disk images
   %6 rwk,  # QCow2 filesystem image
   %7 rk,   # cloud-init ISO
-}
+%9
+  # virtiofsd sockets of native mounts
+%8}
     )END");
 
     /* Customisations depending on if running inside snap or not */
@@ -243,8 +261,17 @@ profile %1 flags=(attach_disconnected) {
         firmware = "/usr/share/seabios/*";
     }
 
+    QString native_mount_sockets;
+    for (const auto& native_mount : native_mounts)
+        native_mount_sockets += QString("  %1 rw,\n").arg(native_mount.socket_path);
+
+    QString backing_image; // if the image is an overlay
+    const auto backing_file = mp::vault::backing_file_of(desc.image.image_path);
+    if (!backing_file.isEmpty())
+        backing_image = QString("  %1 rk,   # QCow2 backing image\n").arg(backing_file);
+
     return profile_template.arg(apparmor_profile_name(), signal_peer, firmware, root_dir, program(),
-                                desc.image.image_path, desc.cloud_init_iso);
+                                desc.image.image_path, desc.cloud_init_iso, native_mount_sockets, backing_image);
 }
 
 QString mp::QemuVMProcessSpec::identifier() const
@@ -23,6 +23,8 @@
 #include <multipass/optional.h>
 #include <multipass/virtual_machine_description.h>
 
+#include <vector>
+
 namespace multipass
 {
 
@@ -37,10 +39,17 @@ public:
         QStringList arguments;
     };
 
+    struct NativeMount
+    {
+        QString tag;         // the guest mounts the directory by
+        QString socket_path; // of the virtiofsd serving the directory
+    };
+
     static QString default_machine_type();
 
     explicit QemuVMProcessSpec(const VirtualMachineDescription& desc, const QString& tap_device_name,
-                               const multipass::optional<ResumeData>& resume_data);
+                               const multipass::optional<ResumeData>& resume_data,
+                               const std::vector<NativeMount>& native_mounts = {});
 
     QStringList arguments() const override;
 
@@ -51,6 +60,7 @@ private:
     const VirtualMachineDescription desc;
     const QString tap_device_name;
     const multipass::optional<ResumeData> resume_data;
+    const std::vector<NativeMount> native_mounts;
 };
 
 } // namespace multipass
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "virtiofsd_process_spec.h"
+
+#include <multipass/exceptions/snap_environment_exception.h>
+#include <multipass/snap_utils.h>
+
+#include <QFile>
+#include <QFileInfo>
+
+namespace mp = multipass;
+namespace mu = multipass::utils;
+
+namespace
+{
+QString root_dir()
+{
+    try
+    {
+        return mu::snap_dir();
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        return {};
+    }
+}
+} // namespace
+
+mp::VirtiofsdProcessSpec::VirtiofsdProcessSpec(const QString& source_path, const QString& socket_path)
+    : source_path{source_path}, socket_path{socket_path}
+{
+}
+
+QString mp::VirtiofsdProcessSpec::program() const
+{
+    // virtiofsd is a QEMU helper, so distributions keep it out of $PATH
+    for (const auto& candidate : {"/usr/libexec/virtiofsd", "/usr/lib/qemu/virtiofsd"})
+    {
+        const auto path = root_dir() + candidate;
+        if (QFile::exists(path))
+            return path;
+    }
+
+    return "virtiofsd";
+}
+
+QStringList mp::VirtiofsdProcessSpec::arguments() const
+{
+    // virtiofsd splits options on commas, taking a doubled one as a literal comma. IDs are not translated, so it
+    // keeps no capability that would let the guest hand out privileges on the host.
+    return QStringList() << QString("--socket-path=%1").arg(socket_path) << "-o"
+                         << QString("source=%1").arg(QString{source_path}.replace(",", ",,")) << "-o"
+                         << "cache=auto"
+                         << "-o"
+                         << "modcaps=-fsetid:-setfcap";
+}
+
+QString mp::VirtiofsdProcessSpec::apparmor_profile() const
+{
+    QString profile_template(R"END(
+#include <tunables/global>
+profile %1 flags=(attach_disconnected) {
+  #include <abstractions/base>
+
+  # virtiofsd sandboxes itself in new namespaces
+  capability sys_admin,
+  capability sys_chroot,
+  capability sys_resource,
+  mount,
+  umount,
+  pivot_root,
+
+  # to create files with the ownership and modes the guest asks for
+  capability chown,
+  capability dac_override,
+  capability dac_read_search,
+  capability fowner,
+  capability mknod,
+  capability setgid,
+  capability setuid,
+
+  # Allow multipassd send virtiofsd signals
+  signal (receive) peer=%2,
+
+  @{PROC}/ r,
+  @{PROC}/@{pid}/** rw,
+  @{PROC}/sys/fs/file-max r,
+
+  # binary and its libs
+  %3/{usr/,}{lib/qemu,libexec}/virtiofsd ixr,
+  %3/{,usr/}lib/{,@{multiarch}/}{,**/}*.so* rm,
+
+  # CLASSIC ONLY: need to specify required libs from core snap
+  /{,var/lib/snapd/}snap/core18/*/{,usr/}lib/@{multiarch}/{,**/}*.so* rm,
+
+  /{,var/}run/virtiofsd/ rw,
+  /{,var/}run/virtiofsd/** rwk, # pid files
+
+  %4 rw,        # vhost-user socket
+  %5/ rw,
+  %5/** rwlk,   # shared directory
+}
+    )END");
+
+    QString signal_peer; // who can send kill signal to virtiofsd
+
+    try
+    {
+        mu::snap_dir();
+        signal_peer = "snap.multipass.multipassd"; // only multipassd can send virtiofsd signals
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        signal_peer = "unconfined";
+    }
+
+    return profile_template.arg(apparmor_profile_name(), signal_peer, root_dir(), socket_path, source_path);
+}
+
+QString mp::VirtiofsdProcessSpec::identifier() const
+{
+    return QFileInfo(socket_path).completeBaseName();
+}
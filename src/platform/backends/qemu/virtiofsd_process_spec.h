@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
+#define MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
+
+#include <multipass/process/process_spec.h>
+
+namespace multipass
+{
+
+// The host side of a native mount: serves source_path to QEMU's vhost-user-fs device over socket_path
+class VirtiofsdProcessSpec : public ProcessSpec
+{
+public:
+    explicit VirtiofsdProcessSpec(const QString& source_path, const QString& socket_path);
+
+    QString program() const override;
+    QStringList arguments() const override;
+
+    QString apparmor_profile() const override;
+    QString identifier() const override;
+
+private:
+    const QString source_path;
+    const QString socket_path;
+};
+
+} // namespace multipass
+
+#endif // MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
@@ -22,6 +22,7 @@
 #include <multipass/platform.h>
 #include <multipass/process/process.h>
 #include <multipass/process/qemuimg_process_spec.h>
+#include <multipass/qcow2_image.h>
 #include <multipass/utils.h>
 
 #include <multipass/format.h>
@@ -131,6 +132,10 @@ std::string mp::backend::get_subnet(const mp::Path& network_dir, const QString&
 
 void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::Path& image_path)
 {
+    // Raw and most qcow2 images only need their file or their header changed for that
+    if (mp::vault::grow_image(image_path, disk_space.in_bytes()))
+        return;
+
     auto disk_size = QString::number(disk_space.in_bytes()); // format documented in `man qemu-img` (look for "size")
     QStringList qemuimg_parameters{{"resize", image_path, disk_size}};
     auto qemuimg_process =
@@ -151,6 +156,16 @@ mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
     // TODO: we could support converting from other the image formats that qemu-img can deal with
     const auto qcow2_path{image_path + ".qcow2"};
 
+    // Images in formats that are not recognized here, or that cannot be read, are left for qemu-img to look into
+    if (const auto image_info = mp::vault::read_image_info(image_path))
+    {
+        if (image_info->format != "raw")
+            return image_path;
+
+        mp::vault::convert_raw_to_qcow2(image_path, qcow2_path);
+        return qcow2_path;
+    }
+
     auto qemuimg_info_spec =
         std::make_unique<mp::QemuImgProcessSpec>(QStringList{"info", "--output=json", image_path}, image_path);
     auto qemuimg_info_process = MP_PROCFACTORY.create_process(std::move(qemuimg_info_spec));
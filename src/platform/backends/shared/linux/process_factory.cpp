@@ -119,6 +119,21 @@ std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(std::unique_ptr<
     }
 }
 
+void mp::ProcessFactory::update_policy(const mp::ProcessSpec& process_spec) const
+{
+    if (!apparmor || process_spec.apparmor_profile().isNull())
+        return;
+
+    try
+    {
+        apparmor->load_policy(process_spec.apparmor_profile().toLatin1());
+    }
+    catch (const mp::AppArmorException& e)
+    {
+        mpl::log(mpl::Level::warning, "apparmor", e.what());
+    }
+}
+
 std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(const QString& command,
                                                                 const QStringList& arguments) const
 {
@@ -39,6 +39,9 @@ public:
     virtual std::unique_ptr<Process> create_process(std::unique_ptr<ProcessSpec>&& process_spec) const;
     std::unique_ptr<Process> create_process(const QString& command, const QStringList& args = QStringList()) const;
 
+    // Replaces the security policy processes created from an earlier version of the spec are running under
+    virtual void update_policy(const ProcessSpec& process_spec) const;
+
 private:
     const multipass::optional<AppArmor> apparmor;
 };
@@ -17,8 +17,10 @@
 
 #include "sshfs_server_process_spec.h"
 
+#include <multipass/constants.h>
 #include <multipass/exceptions/snap_environment_exception.h>
 #include <multipass/snap_utils.h>
+#include <multipass/utils.h>
 
 #include <QCoreApplication>
 #include <QCryptographicHash>
@@ -29,16 +31,6 @@ namespace mu = multipass::utils;
 
 namespace
 {
-QString serialise_id_map(const std::unordered_map<int, int>& id_map)
-{
-    QString out;
-    for (auto ids : id_map)
-    {
-        out += QString("%1:%2,").arg(ids.first).arg(ids.second);
-    }
-    return out;
-}
-
 QByteArray gen_hash(const std::string& path)
 {
     // need to return unique name for each mount.  The target directory string will be unique,
@@ -61,14 +53,17 @@ QStringList mp::SSHFSServerProcessSpec::arguments() const
 {
     return QStringList() << QString::fromStdString(config.host) << QString::number(config.port)
                          << QString::fromStdString(config.username) << QString::fromStdString(config.source_path)
-                         << QString::fromStdString(config.target_path) << serialise_id_map(config.uid_map)
-                         << serialise_id_map(config.gid_map);
+                         << QString::fromStdString(config.target_path) << config.uid_map.to_string()
+                         << config.gid_map.to_string();
 }
 
 QProcessEnvironment mp::SSHFSServerProcessSpec::environment() const
 {
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("KEY", QString::fromStdString(config.private_key));
+    env.insert(mp::sftp_workers_env_var, QString::number(config.workers));
+    env.insert(mp::sftp_write_buffer_env_var, QString::number(config.write_buffer_size));
+    env.insert(mp::sftp_attribute_cache_env_var, config.cache_attributes ? "1" : "0");
     return env;
 }
 
@@ -113,10 +108,8 @@ profile %1 flags=(attach_disconnected) {
     # CLASSIC ONLY: need to specify required libs from core snap
     /{,var/lib/snapd/}snap/core18/*/{,usr/}lib/@{multiarch}/{,**/}*.so* rm,
 
-    # allow full access just to this user-specified source directory on the host
-    %4/ rw,
-    %4/** rwlk,
-}
+    # allow full access just to the user-specified source directories on the host
+%4}
     )END");
 
     /* Customisations depending on if running inside snap or not */
@@ -137,8 +130,13 @@ profile %1 flags=(attach_disconnected) {
         signal_peer = "unconfined";
     }
 
-    return profile_template.arg(apparmor_profile_name(), signal_peer, root_dir,
-                                QString::fromStdString(config.source_path));
+    QString source_rules;
+    auto source_paths = config.additional_source_paths;
+    source_paths.insert(source_paths.begin(), config.source_path);
+    for (const auto& source_path : source_paths)
+        source_rules += QString("    %1/ rw,\n    %1/** rwlk,\n").arg(QString::fromStdString(source_path));
+
+    return profile_template.arg(apparmor_profile_name(), signal_peer, root_dir, source_rules);
 }
 
 QString mp::SSHFSServerProcessSpec::identifier() const
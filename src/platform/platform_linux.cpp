@@ -132,6 +132,11 @@ std::unique_ptr<mp::Process> mp::platform::make_sshfs_server_process(const mp::S
     return MP_PROCFACTORY.create_process(std::make_unique<mp::SSHFSServerProcessSpec>(config));
 }
 
+void mp::platform::update_sshfs_server_policy(const mp::SSHFSServerConfig& config)
+{
+    MP_PROCFACTORY.update_policy(mp::SSHFSServerProcessSpec{config});
+}
+
 std::unique_ptr<mp::Process> mp::platform::make_process(std::unique_ptr<mp::ProcessSpec>&& process_spec)
 {
     return MP_PROCFACTORY.create_process(std::move(process_spec));
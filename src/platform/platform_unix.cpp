@@ -17,7 +17,10 @@
 #include <multipass/platform.h>
 #include <multipass/platform_unix.h>
 
+#include <cerrno>
+
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -83,6 +86,44 @@ int mp::platform::symlink_attr_from(const char* path, sftp_attributes_struct* at
     return 0;
 }
 
+long long mp::platform::pread(int fd, void* buf, std::size_t count, long long offset)
+{
+    ssize_t ret;
+    do
+    {
+        ret = ::pread(fd, buf, count, offset);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+long long mp::platform::pwrite(int fd, const void* buf, std::size_t count, long long offset)
+{
+    ssize_t ret;
+    do
+    {
+        ret = ::pwrite(fd, buf, count, offset);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+int mp::platform::fsync(int fd)
+{
+    return ::fsync(fd);
+}
+
+void mp::platform::set_background_io_priority(bool background)
+{
+#ifdef SYS_ioprio_set
+    // From linux/ioprio.h, which is not installed everywhere; a priority of 0 goes back to following the CPU niceness
+    constexpr int ioprio_who_process = 1, ioprio_class_shift = 13, ioprio_class_idle = 3;
+    ::syscall(SYS_ioprio_set, ioprio_who_process, 0, background ? ioprio_class_idle << ioprio_class_shift : 0);
+#else
+    (void)background;
+#endif
+}
+
 sigset_t mp::platform::make_sigset(const std::vector<int>& sigs)
 {
     sigset_t sigset;
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/ssh/ssh_session_pool.h>
+
+#include <libssh/libssh.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto max_idle_sessions = 4u; // per instance
+
+// Opening a channel takes a single round trip, against the several that connecting and authenticating again take
+bool is_healthy(mp::SSHSession& session)
+{
+    if (!ssh_is_connected(session))
+        return false;
+
+    std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)> channel{ssh_channel_new(session), ssh_channel_free};
+    return channel && ssh_channel_open_session(channel.get()) == SSH_OK;
+}
+} // namespace
+
+mp::SSHSessionPool::Lease::Lease(SSHSessionPool* pool, const std::string& instance, const std::string& address,
+                                 unsigned generation, std::unique_ptr<SSHSession> session)
+    : pool{pool}, instance{instance}, address{address}, generation{generation}, session{std::move(session)}
+{
+}
+
+mp::SSHSessionPool::Lease::~Lease()
+{
+    if (session)
+        pool->give_back(*this);
+}
+
+mp::SSHSession& mp::SSHSessionPool::Lease::operator*() const
+{
+    return *session;
+}
+
+mp::SSHSession* mp::SSHSessionPool::Lease::operator->() const
+{
+    return session.get();
+}
+
+mp::SSHSession mp::SSHSessionPool::Lease::take()
+{
+    auto taken = std::move(*session);
+    session.reset();
+
+    return taken;
+}
+
+mp::SSHSessionPool::SSHSessionPool(const SSHKeyProvider& key_provider, std::chrono::milliseconds idle_timeout)
+    : key_provider{key_provider}, idle_timeout{idle_timeout}
+{
+}
+
+auto mp::SSHSessionPool::acquire(const std::string& instance, const std::string& host, int port,
+                                 const std::string& username) -> Lease
+{
+    const auto address = fmt::format("{}@{}:{}", username, host, port);
+    std::vector<IdleSession> stale; // closed once the lock is released
+    std::unique_ptr<SSHSession> session;
+    unsigned generation;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto entry = sessions.find(instance);
+        if (entry == sessions.end())
+            entry = sessions.emplace(instance, InstanceSessions{next_generation++, {}}).first;
+
+        auto& idle = entry->second.idle;
+        generation = entry->second.generation;
+        move_expired(idle, stale);
+
+        // The session given back last is the likeliest to still be up
+        auto it = std::find_if(idle.rbegin(), idle.rend(),
+                               [&address](const IdleSession& idle_session) { return idle_session.address == address; });
+        if (it != idle.rend())
+        {
+            session = std::move(it->session);
+            idle.erase(std::next(it).base());
+        }
+    }
+
+    if (session && !is_healthy(*session))
+        stale.push_back({address, std::move(session), {}});
+
+    if (!session)
+        session = std::make_unique<SSHSession>(host, port, username, key_provider);
+
+    return {this, instance, address, generation, std::move(session)};
+}
+
+void mp::SSHSessionPool::forget(const std::string& instance)
+{
+    std::vector<IdleSession> closing;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = sessions.find(instance);
+    if (it == sessions.end())
+        return;
+
+    // Leases still out carry the generation of the erased entry, which no later one shares
+    closing.swap(it->second.idle);
+    sessions.erase(it);
+}
+
+void mp::SSHSessionPool::expire_idle_sessions()
+{
+    std::vector<IdleSession> stale; // closed once the lock is released
+
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto& instance_sessions : sessions)
+        move_expired(instance_sessions.second.idle, stale);
+}
+
+void mp::SSHSessionPool::move_expired(std::vector<IdleSession>& idle, std::vector<IdleSession>& stale) const
+{
+    const auto now = std::chrono::steady_clock::now();
+    auto expired = std::stable_partition(idle.begin(), idle.end(), [this, &now](const IdleSession& idle_session) {
+        return now - idle_session.idle_since < idle_timeout;
+    });
+    std::move(expired, idle.end(), std::back_inserter(stale));
+    idle.erase(expired, idle.end());
+}
+
+void mp::SSHSessionPool::give_back(Lease& lease)
+{
+    std::unique_ptr<SSHSession> overflow;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = sessions.find(lease.instance);
+    if (it == sessions.end() || it->second.generation != lease.generation)
+        return;
+
+    auto& idle = it->second.idle;
+    idle.push_back({lease.address, std::move(lease.session), std::chrono::steady_clock::now()});
+    if (idle.size() > max_idle_sessions)
+    {
+        overflow = std::move(idle.front().session);
+        idle.erase(idle.begin());
+    }
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sshfs_mount/attribute_cache.h>
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "sftp attribute cache";
+constexpr auto watch_mask = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                            IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+std::string parent_of(const std::string& path)
+{
+    const auto pos = path.rfind('/');
+    if (pos == std::string::npos)
+        return {};
+
+    return pos == 0 ? "/" : path.substr(0, pos);
+}
+
+bool ends_with(const std::string& path, const std::string& suffix)
+{
+    return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Invalidation works on exact paths, so only absolute paths spelled the one way the host reports them are cached
+bool is_normalized(const std::string& path)
+{
+    if (path.empty() || path[0] != '/')
+        return false;
+
+    if (path.size() > 1 && path.back() == '/')
+        return false;
+
+    return path.find("//") == std::string::npos && path.find("/./") == std::string::npos &&
+           path.find("/../") == std::string::npos && !ends_with(path, "/.") && !ends_with(path, "/..");
+}
+
+bool is_under(const std::string& path, const std::string& dir)
+{
+    return path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 &&
+           (dir == "/" || path[dir.size()] == '/');
+}
+} // namespace
+
+mp::AttributeCache::AttributeCache()
+    : inotify_fd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}, stop_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}
+{
+    if (inotify_fd < 0 || stop_fd < 0)
+    {
+        const auto error = std::strerror(errno);
+        if (inotify_fd >= 0)
+            close(inotify_fd);
+        if (stop_fd >= 0)
+            close(stop_fd);
+
+        throw std::runtime_error(fmt::format("cannot watch for file changes: {}", error));
+    }
+
+    event_thread = std::thread{[this] { process_events(); }};
+}
+
+mp::AttributeCache::~AttributeCache()
+{
+    const uint64_t stop{1};
+    if (write(stop_fd, &stop, sizeof(stop)) < 0)
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("cannot stop watching for changes: {}", std::strerror(errno)));
+
+    event_thread.join();
+    close(inotify_fd);
+    close(stop_fd);
+}
+
+mp::AttributeCache::Attributes mp::AttributeCache::get(const std::string& path, const Compute& compute)
+{
+    if (!is_normalized(path))
+        return compute();
+
+    std::unique_lock<std::mutex> lock{mutex};
+    if (!watching)
+    {
+        lock.unlock();
+        return compute();
+    }
+
+    auto entry = entries.find(path);
+    if (entry != entries.end())
+        return entry->second;
+
+    // The watches go in before computing, otherwise a change landing in between would never be noticed. The path
+    // itself is watched as well in case it is a directory, whose times change with its contents.
+    if (!watch(parent_of(path)) || (!watch(path) && errno != ENOTDIR && errno != ENOENT))
+    {
+        lock.unlock();
+        return compute();
+    }
+
+    const auto computed_at = generation;
+    lock.unlock();
+
+    auto attr = compute();
+
+    lock.lock();
+    if (watching && generation == computed_at)
+    {
+        // Starting over drops the watches this entry needs too, so it waits for the next miss
+        if (entries.size() >= max_entries)
+            clear_locked();
+        else
+            entries.emplace(path, attr);
+    }
+
+    return attr;
+}
+
+void mp::AttributeCache::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    invalidate_locked(path);
+}
+
+void mp::AttributeCache::clear()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    clear_locked();
+}
+
+std::size_t mp::AttributeCache::size()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return entries.size();
+}
+
+std::size_t mp::AttributeCache::watch_count()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return watch_descriptors.size();
+}
+
+bool mp::AttributeCache::watch(const std::string& dir)
+{
+    if (dir.empty())
+        return false;
+
+    if (watch_descriptors.find(dir) != watch_descriptors.end())
+        return true;
+
+    const auto wd = inotify_add_watch(inotify_fd, dir.c_str(), watch_mask);
+    if (wd < 0)
+    {
+        if (errno == ENOSPC)
+            mpl::log(mpl::Level::debug, category, fmt::format("out of inotify watches, not caching under {}", dir));
+        return false;
+    }
+
+    // The same directory is known by another path if it was moved, so whatever was cached through that is stale.
+    // The watch is the one just added, so it is handed over to the new path rather than removed.
+    auto previous = watched_dirs.find(wd);
+    if (previous != watched_dirs.end())
+    {
+        const auto previous_path = previous->second;
+        watch_descriptors.erase(previous_path);
+        watched_dirs.erase(previous);
+        invalidate_locked(previous_path);
+    }
+
+    watched_dirs[wd] = dir;
+    watch_descriptors[dir] = wd;
+    return true;
+}
+
+// Removes the watches of path and of the directories below it
+void mp::AttributeCache::unwatch_locked(const std::string& path)
+{
+    auto remove = [this](std::map<std::string, int>::iterator watch) {
+        inotify_rm_watch(inotify_fd, watch->second); // fails harmlessly if the kernel dropped the watch already
+        watched_dirs.erase(watch->second);
+        return watch_descriptors.erase(watch);
+    };
+
+    auto watch = watch_descriptors.find(path);
+    if (watch != watch_descriptors.end())
+        remove(watch);
+
+    watch = watch_descriptors.lower_bound(path == "/" ? path : path + "/");
+    while (watch != watch_descriptors.end() && is_under(watch->first, path))
+        watch = remove(watch);
+}
+
+// The parent's entry is dropped as its times change with its contents, but its watch stays for the siblings of path
+void mp::AttributeCache::invalidate_locked(const std::string& path)
+{
+    ++generation;
+
+    entries.erase(path);
+    entries.erase(parent_of(path));
+
+    // Everything below path sorts together right after its "path/" prefix
+    auto entry = entries.lower_bound(path == "/" ? path : path + "/");
+    while (entry != entries.end() && is_under(entry->first, path))
+        entry = entries.erase(entry);
+
+    unwatch_locked(path);
+}
+
+void mp::AttributeCache::clear_locked()
+{
+    ++generation;
+    entries.clear();
+
+    for (const auto& watch : watch_descriptors)
+        inotify_rm_watch(inotify_fd, watch.second);
+
+    watched_dirs.clear();
+    watch_descriptors.clear();
+}
+
+void mp::AttributeCache::process_events()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd fds[]{{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            mpl::log(mpl::Level::error, category,
+                     fmt::format("cannot wait for file changes: {}", std::strerror(errno)));
+
+            std::lock_guard<std::mutex> lock{mutex};
+            watching = false;
+            clear_locked();
+            return;
+        }
+
+        if (fds[1].revents)
+            return;
+
+        const auto len = read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto ptr = buffer; ptr < buffer + len;)
+        {
+            const auto event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                clear_locked();
+                continue;
+            }
+
+            // Watches removed here still report being ignored, after they are forgotten
+            auto dir = watched_dirs.find(event->wd);
+            if (dir == watched_dirs.end())
+                continue;
+
+            // Invalidating a path also removes its watch and those below it, so a directory that changed itself,
+            // moved or went away is watched afresh at whatever path it is looked up by next
+            if (event->len > 0)
+                invalidate_locked(dir->second == "/" ? "/" + std::string(event->name)
+                                                     : dir->second + "/" + event->name);
+            else
+                invalidate_locked(std::string{dir->second});
+        }
+    }
+}
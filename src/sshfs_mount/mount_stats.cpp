@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sshfs_mount/mount_stats.h>
+
+#include <QJsonArray>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mp = multipass;
+
+namespace
+{
+std::size_t bucket_for(std::chrono::microseconds latency)
+{
+    auto us = static_cast<uint64_t>(std::max(latency.count(), decltype(latency.count()){0}));
+
+    std::size_t bucket = 0;
+    while (us > 0 && bucket < mp::MountStats::latency_buckets - 1)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+// Counters travel as strings, since JSON numbers lose precision above 2^53
+QString to_json_value(uint64_t value)
+{
+    return QString::number(value);
+}
+
+uint64_t from_json_value(const QJsonValue& value)
+{
+    return value.toString().toULongLong();
+}
+} // namespace
+
+void mp::MountStats::record(Operation operation, std::chrono::microseconds latency)
+{
+    auto& counters = operations[operation];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.latency_histogram[bucket_for(latency)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void mp::MountStats::record_error(Operation operation)
+{
+    operations[operation].errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void mp::MountStats::add_bytes_read(uint64_t bytes)
+{
+    bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void mp::MountStats::add_bytes_written(uint64_t bytes)
+{
+    bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+mp::MountStats::Snapshot mp::MountStats::snapshot() const
+{
+    Snapshot snapshot{bytes_read.load(std::memory_order_relaxed), bytes_written.load(std::memory_order_relaxed), {}};
+
+    for (std::size_t i = 0; i < operation_count; ++i)
+    {
+        auto& op = snapshot.operations[i];
+        op.count = operations[i].count.load(std::memory_order_relaxed);
+        op.errors = operations[i].errors.load(std::memory_order_relaxed);
+
+        for (std::size_t bucket = 0; bucket < latency_buckets; ++bucket)
+            op.latency_histogram[bucket] = operations[i].latency_histogram[bucket].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+const char* mp::MountStats::name_of(Operation operation)
+{
+    switch (operation)
+    {
+    case open:
+        return "open";
+    case close:
+        return "close";
+    case read:
+        return "read";
+    case write:
+        return "write";
+    case stat:
+        return "stat";
+    case fstat:
+        return "fstat";
+    case setstat:
+        return "setstat";
+    case opendir:
+        return "opendir";
+    case readdir:
+        return "readdir";
+    case mkdir:
+        return "mkdir";
+    case rmdir:
+        return "rmdir";
+    case remove:
+        return "remove";
+    case rename:
+        return "rename";
+    case readlink:
+        return "readlink";
+    case symlink:
+        return "symlink";
+    case realpath:
+        return "realpath";
+    case extended:
+        return "extended";
+    default:
+        return "other";
+    }
+}
+
+uint64_t mp::MountStats::latency_percentile(const LatencyHistogram& histogram, double fraction)
+{
+    uint64_t total = 0;
+    for (const auto count : histogram)
+        total += count;
+
+    if (total == 0)
+        return 0;
+
+    const auto wanted = static_cast<uint64_t>(std::ceil(total * fraction));
+    uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < latency_buckets; ++bucket)
+    {
+        seen += histogram[bucket];
+        if (seen >= wanted)
+            return uint64_t{1} << bucket;
+    }
+
+    return uint64_t{1} << (latency_buckets - 1);
+}
+
+QJsonObject mp::MountStats::to_json(const Snapshot& snapshot)
+{
+    QJsonObject operations;
+    for (std::size_t i = 0; i < operation_count; ++i)
+    {
+        const auto& op = snapshot.operations[i];
+        if (op.count == 0 && op.errors == 0)
+            continue;
+
+        QJsonArray histogram;
+        for (const auto count : op.latency_histogram)
+            histogram.append(to_json_value(count));
+
+        QJsonObject entry;
+        entry.insert("count", to_json_value(op.count));
+        entry.insert("errors", to_json_value(op.errors));
+        entry.insert("latency_histogram", histogram);
+        operations.insert(name_of(static_cast<Operation>(i)), entry);
+    }
+
+    QJsonObject json;
+    json.insert("bytes_read", to_json_value(snapshot.bytes_read));
+    json.insert("bytes_written", to_json_value(snapshot.bytes_written));
+    json.insert("operations", operations);
+
+    return json;
+}
+
+mp::MountStats::Snapshot mp::MountStats::from_json(const QJsonObject& json)
+{
+    Snapshot snapshot{from_json_value(json["bytes_read"]), from_json_value(json["bytes_written"]), {}};
+
+    const auto operations = json["operations"].toObject();
+    for (std::size_t i = 0; i < operation_count; ++i)
+    {
+        const auto entry = operations[name_of(static_cast<Operation>(i))].toObject();
+        auto& op = snapshot.operations[i];
+        op.count = from_json_value(entry["count"]);
+        op.errors = from_json_value(entry["errors"]);
+
+        const auto histogram = entry["latency_histogram"].toArray();
+        for (std::size_t bucket = 0; bucket < latency_buckets && bucket < static_cast<std::size_t>(histogram.size());
+             ++bucket)
+            op.latency_histogram[bucket] = from_json_value(histogram[static_cast<int>(bucket)]);
+    }
+
+    return snapshot;
+}
@@ -30,6 +30,20 @@
 #include <QDir>
 #include <QFile>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -39,6 +53,11 @@ constexpr auto category = "sftp server";
 using SftpHandleUPtr = std::unique_ptr<ssh_string_struct, void (*)(ssh_string)>;
 using namespace std::literals::chrono_literals;
 
+constexpr auto sshfs_start_wait = 250ms; // for sshfs to fail on start, if it is going to
+constexpr auto sshfs_start_wait_slice = 10ms;
+constexpr auto max_queued_messages_per_worker = 64u;
+constexpr auto max_readdir_reply_size = 64u * 1024;
+
 enum Permissions
 {
     read_user = 0400,
@@ -52,108 +71,123 @@ enum Permissions
     exec_other = 01
 };
 
-auto make_sftp_session(ssh_session session, ssh_channel channel)
-{
-    mp::SftpServer::SftpSessionUptr sftp_server_session{sftp_server_new(session, channel), sftp_free};
-    mp::SSH::throw_on_error(sftp_server_session, session, "[sftp] server init failed", sftp_server_init);
-    return sftp_server_session;
-}
-
-int reply_ok(sftp_client_message msg)
+uint32_t read_uint32(const unsigned char* data)
 {
-    return sftp_reply_status(msg, SSH_FX_OK, nullptr);
+    return (uint32_t{data[0]} << 24) | (uint32_t{data[1]} << 16) | (uint32_t{data[2]} << 8) | uint32_t{data[3]};
 }
 
-int reply_failure(sftp_client_message msg)
+void append_uint32(std::string& data, uint32_t value)
 {
-    return sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+    for (auto shift : {24, 16, 8, 0})
+        data += static_cast<char>((value >> shift) & 0xff);
 }
 
-int reply_perm_denied(sftp_client_message msg)
+void append_string(std::string& data, const std::string& value)
 {
-    return sftp_reply_status(msg, SSH_FX_PERMISSION_DENIED, "permission denied");
+    append_uint32(data, value.size());
+    data += value;
 }
 
-int reply_bad_handle(sftp_client_message msg, const char* type)
+bool read_exactly(ssh_channel channel, unsigned char* data, uint32_t size)
 {
-    return sftp_reply_status(msg, SSH_FX_BAD_MESSAGE, fmt::format("{}: invalid handle", type).c_str());
+    for (uint32_t done = 0; done < size;)
+    {
+        const auto read = ssh_channel_read(channel, data + done, size - done, 0);
+        if (read <= 0)
+            return false;
+        done += read;
+    }
+    return true;
 }
 
-int reply_unsupported(sftp_client_message msg)
+// libssh answers SSH_FXP_INIT with a bare version, and sshfs only sends fsync@openssh.com to servers that
+// advertise it, so the version exchange is done here: uint32 length, byte type, uint32 version, extension pairs
+int sftp_server_init_with_extensions(sftp_session sftp)
 {
-    return sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, "Unsupported message");
+    unsigned char length[4];
+    if (!read_exactly(sftp->channel, length, sizeof(length)))
+        return SSH_ERROR;
+
+    const auto packet_len = read_uint32(length);
+    if (packet_len < 5 || packet_len > 256 * 1024)
+        return SSH_ERROR;
+
+    std::vector<unsigned char> packet(packet_len);
+    if (!read_exactly(sftp->channel, packet.data(), packet_len) || packet[0] != SSH_FXP_INIT)
+        return SSH_ERROR;
+
+    const auto client_version = read_uint32(packet.data() + 1);
+
+    std::string payload{static_cast<char>(SSH_FXP_VERSION)};
+    append_uint32(payload, LIBSFTP_VERSION);
+    append_string(payload, "fsync@openssh.com");
+    append_string(payload, "1");
+
+    std::string reply;
+    append_uint32(reply, payload.size());
+    reply += payload;
+    if (ssh_channel_write(sftp->channel, reply.data(), reply.size()) != static_cast<int>(reply.size()))
+        return SSH_ERROR;
+
+    sftp->client_version = static_cast<int>(client_version);
+    sftp->version = static_cast<int>(std::min<uint32_t>(client_version, LIBSFTP_VERSION));
+    return SSH_OK;
 }
 
-fmt::memory_buffer& operator<<(fmt::memory_buffer& buf, const char* v)
+auto make_sftp_session(mp::SharedSSHSession& shared_session, ssh_channel channel)
 {
-    fmt::format_to(buf, v);
-    return buf;
+    mp::SharedSSHSession::Lock lock{shared_session};
+    ssh_session session = shared_session.session;
+    mp::SftpServer::SftpSessionUptr sftp_server_session{sftp_server_new(session, channel), sftp_free};
+    mp::SSH::throw_on_error(sftp_server_session, session, "[sftp] server init failed",
+                            sftp_server_init_with_extensions);
+    return sftp_server_session;
 }
 
-auto longname_from(const QFileInfo& file_info, const std::string& filename)
+sftp_attributes_struct stat_to_attr(const struct stat& st)
 {
-    fmt::memory_buffer out;
-    auto mode = file_info.permissions();
-
-    if (file_info.isSymLink())
-        out << "l";
-    else if (file_info.isDir())
-        out << "d";
-    else
-        out << "-";
-
-    /* user */
-    if (mode & QFileDevice::ReadOwner)
-        out << "r";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::WriteOwner)
-        out << "w";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::ExeOwner)
-        out << "x";
-    else
-        out << "-";
-
-    /*group*/
-    if (mode & QFileDevice::ReadGroup)
-        out << "r";
-    else
-        out << "-";
+    sftp_attributes_struct attr{};
 
-    if (mode & QFileDevice::WriteGroup)
-        out << "w";
-    else
-        out << "-";
+    attr.size = st.st_size;
+    attr.uid = st.st_uid;
+    attr.gid = st.st_gid;
+    attr.permissions = st.st_mode;
+    attr.atime = st.st_atime;
+    attr.mtime = st.st_mtime;
+    attr.flags =
+        SSH_FILEXFER_ATTR_SIZE | SSH_FILEXFER_ATTR_UIDGID | SSH_FILEXFER_ATTR_PERMISSIONS | SSH_FILEXFER_ATTR_ACMODTIME;
 
-    if (mode & QFileDevice::ExeGroup)
-        out << "x";
-    else
-        out << "-";
+    return attr;
+}
 
-    /* other */
-    if (mode & QFileDevice::ReadOther)
-        out << "r";
-    else
-        out << "-";
+// Same layout as "ls -l", with the mapped owner IDs the attributes carry; sshfs does not rely on it, so keep it cheap
+// to produce
+auto longname_from(const struct stat& st, const sftp_attributes_struct& attr, const char* filename)
+{
+    static constexpr const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                             "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    static constexpr const char rwx[] = "rwxrwxrwx";
 
-    if (mode & QFileDevice::WriteOther)
-        out << "w";
-    else
-        out << "-";
+    char mode[] = "----------";
+    if (S_ISLNK(st.st_mode))
+        mode[0] = 'l';
+    else if (S_ISDIR(st.st_mode))
+        mode[0] = 'd';
 
-    if (mode & QFileDevice::ExeOther)
-        out << "x";
-    else
-        out << "-";
+    for (auto i = 0; i < 9; ++i)
+    {
+        if (st.st_mode & (0400 >> i))
+            mode[i + 1] = rwx[i];
+    }
 
-    fmt::format_to(out, " 1 {} {} {}", file_info.ownerId(), file_info.groupId(), file_info.size());
+    tm mtime{};
+    localtime_r(&st.st_mtime, &mtime);
 
-    const auto timestamp = file_info.lastModified().toString("MMM d hh:mm:ss yyyy").toStdString();
-    fmt::format_to(out, " {} {}", timestamp, filename);
+    fmt::memory_buffer out;
+    fmt::format_to(out, "{} 1 {} {} {} {} {} {:02}:{:02}:{:02} {} {}", mode, attr.uid, attr.gid, st.st_size,
+                   months[mtime.tm_mon], mtime.tm_mday, mtime.tm_hour, mtime.tm_min, mtime.tm_sec,
+                   mtime.tm_year + 1900, filename);
+    out.push_back('\0');
 
     return out;
 }
@@ -210,6 +244,40 @@ auto to_unix_permissions(QFile::Permissions perms)
     return out;
 }
 
+bool apply_attr(const QString& filename, sftp_attributes attr)
+{
+    if (attr->flags & SSH_FILEXFER_ATTR_SIZE)
+    {
+        if (!QFile::resize(filename, attr->size))
+            return false;
+    }
+
+    if (attr->flags & SSH_FILEXFER_ATTR_PERMISSIONS)
+    {
+        if (!QFile::setPermissions(filename, to_qt_permissions(attr->permissions)))
+            return false;
+    }
+
+    if (attr->flags & SSH_FILEXFER_ATTR_ACMODTIME)
+    {
+        if (mp::platform::utime(filename.toStdString().c_str(), attr->atime, attr->mtime) < 0)
+            return false;
+    }
+
+    if (attr->flags & SSH_FILEXFER_ATTR_UIDGID)
+    {
+        if (mp::platform::chown(filename.toStdString().c_str(), attr->uid, attr->gid) < 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool is_symlink(const sftp_attributes_struct& attr)
+{
+    return (attr.permissions & SSH_S_IFMT) == SSH_S_IFLNK;
+}
+
 auto validate_path(const std::string& source_path, const std::string& current_path)
 {
     if (source_path.empty())
@@ -218,9 +286,11 @@ auto validate_path(const std::string& source_path, const std::string& current_pa
     return current_path.compare(0, source_path.length(), source_path) == 0;
 }
 
-template <typename T>
-auto handle_from(sftp_client_message msg, const std::unordered_map<void*, std::unique_ptr<T>>& handles) -> T*
+template <typename T, typename Deleter>
+auto handle_from(sftp_client_message msg, const std::unordered_map<void*, std::unique_ptr<T, Deleter>>& handles,
+                 std::mutex& handles_mutex) -> T*
 {
+    std::lock_guard<std::mutex> lock{handles_mutex};
     const auto id = sftp_handle(msg->sftp, msg->handle);
     auto entry = handles.find(id);
     if (entry != handles.end())
@@ -228,50 +298,324 @@ auto handle_from(sftp_client_message msg, const std::unordered_map<void*, std::u
     return nullptr;
 }
 
-void check_sshfs_status(mp::SSHSession& session, mp::SSHProcess& sshfs_process)
+// Gives sshfs a moment to fail on start. Other mounts may be using the session meanwhile, so it is only locked for a
+// slice of the wait at a time.
+void check_sshfs_status(mp::SharedSSHSession& shared_session, mp::SSHProcess& sshfs_process)
 {
-    try
+    for (auto waited = 0ms; waited < sshfs_start_wait; waited += sshfs_start_wait_slice)
     {
-        if (sshfs_process.exit_code(250ms) != 0)
-            throw std::runtime_error(sshfs_process.read_std_error());
+        mp::SharedSSHSession::Lock lock{shared_session};
+        try
+        {
+            if (sshfs_process.exit_code(sshfs_start_wait_slice) != 0)
+                throw std::runtime_error(sshfs_process.read_std_error());
+            return;
+        }
+        catch (const mp::ExitlessSSHProcessException&)
+        {
+            // Timeout getting exit status; assume sshfs is running in the instance once the wait is over
+        }
     }
-    catch (const mp::ExitlessSSHProcessException&)
+}
+
+auto create_sshfs_process(mp::SharedSSHSession& shared_session, const std::string& sshfs_exec_line,
+                          const std::string& source, const std::string& target)
+{
+    auto sshfs_process = [&shared_session, &sshfs_exec_line, &source, &target] {
+        mp::SharedSSHSession::Lock lock{shared_session};
+        return shared_session.session.exec(fmt::format("sudo {} :\"{}\" \"{}\"", sshfs_exec_line, source, target));
+    }();
+
+    check_sshfs_status(shared_session, sshfs_process);
+
+    return std::make_unique<mp::SSHProcess>(std::move(sshfs_process));
+}
+
+bool write_all(int fd, const char* data, std::size_t len, uint64_t offset)
+{
+    while (len > 0)
     {
-        // Timeout getting exit status; assume sshfs is running in the instance
+        auto r = mp::platform::pwrite(fd, data, len, offset);
+        if (r < 0)
+            return false;
+
+        data += r;
+        len -= r;
+        offset += r;
     }
+
+    return true;
 }
 
-auto create_sshfs_process(mp::SSHSession& session, const std::string& sshfs_exec_line, const std::string& source,
-                          const std::string& target)
+// libssh only unpacks the arguments of the extensions it knows about, so the handle of an
+// fsync@openssh.com request is read from the raw payload: uint32 id, string name, string handle
+SftpHandleUPtr fsync_handle_from(sftp_client_message msg)
 {
-    auto sshfs_process = session.exec(fmt::format("sudo {} :\"{}\" \"{}\"", sshfs_exec_line, source, target));
+    SftpHandleUPtr handle{nullptr, ssh_string_free};
+    if (msg->complete_message == nullptr)
+        return handle;
 
-    check_sshfs_status(session, sshfs_process);
+    auto payload = static_cast<const unsigned char*>(ssh_buffer_get(msg->complete_message));
+    const uint64_t payload_len = ssh_buffer_get_len(msg->complete_message);
 
-    return std::make_unique<mp::SSHProcess>(std::move(sshfs_process));
+    uint64_t pos = 4; // skip the request id
+    if (pos + 4 > payload_len)
+        return handle;
+    pos += 4 + read_uint32(payload + pos);
+
+    if (pos + 4 > payload_len)
+        return handle;
+    const auto handle_len = read_uint32(payload + pos);
+    pos += 4;
+
+    if (handle_len == 0 || pos + handle_len > payload_len)
+        return handle;
+
+    handle.reset(ssh_string_new(handle_len));
+    ssh_string_fill(handle.get(), payload + pos, handle_len);
+    return handle;
+}
+
+bool is_fsync_message(sftp_client_message msg)
+{
+    const auto submessage = sftp_client_message_get_submessage(msg);
+    return submessage != nullptr && std::string(submessage) == "fsync@openssh.com";
+}
+
+bool is_handle_message(uint8_t type)
+{
+    switch (type)
+    {
+    case SFTP_CLOSE:
+    case SFTP_READ:
+    case SFTP_WRITE:
+    case SFTP_FSTAT:
+    case SFTP_FSETSTAT:
+    case SFTP_READDIR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::size_t dispatch_key_for(const std::string& path)
+{
+    return std::hash<std::string>{}(path);
+}
+
+mp::MountStats::Operation operation_for(uint8_t type)
+{
+    switch (type)
+    {
+    case SFTP_OPEN:
+        return mp::MountStats::open;
+    case SFTP_CLOSE:
+        return mp::MountStats::close;
+    case SFTP_READ:
+        return mp::MountStats::read;
+    case SFTP_WRITE:
+        return mp::MountStats::write;
+    case SFTP_LSTAT:
+    case SFTP_STAT:
+        return mp::MountStats::stat;
+    case SFTP_FSTAT:
+        return mp::MountStats::fstat;
+    case SFTP_SETSTAT:
+    case SFTP_FSETSTAT:
+        return mp::MountStats::setstat;
+    case SFTP_OPENDIR:
+        return mp::MountStats::opendir;
+    case SFTP_READDIR:
+        return mp::MountStats::readdir;
+    case SFTP_MKDIR:
+        return mp::MountStats::mkdir;
+    case SFTP_RMDIR:
+        return mp::MountStats::rmdir;
+    case SFTP_REMOVE:
+        return mp::MountStats::remove;
+    case SFTP_RENAME:
+        return mp::MountStats::rename;
+    case SFTP_READLINK:
+        return mp::MountStats::readlink;
+    case SFTP_SYMLINK:
+        return mp::MountStats::symlink;
+    case SFTP_REALPATH:
+        return mp::MountStats::realpath;
+    case SFTP_EXTENDED:
+        return mp::MountStats::extended;
+    default:
+        return mp::MountStats::other;
+    }
 }
 } // namespace
 
+class mp::SftpServer::MessageQueue
+{
+public:
+    void push(MsgUPtr msg)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        not_full.wait(lock, [this] { return closed || queue.size() < max_queued_messages_per_worker; });
+        queue.push_back(std::move(msg));
+        lock.unlock();
+        not_empty.notify_one();
+    }
+
+    // Blocks until a message is available, returns null once the queue is closed and drained
+    MsgUPtr pop()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        not_empty.wait(lock, [this] { return closed || !queue.empty(); });
+        if (queue.empty())
+            return {nullptr, sftp_client_message_free};
+
+        auto msg = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return msg;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<MsgUPtr> queue;
+    bool closed{false};
+};
+
+// Holds back contiguous writes to an open file so they reach the disk in large chunks
+class mp::SftpServer::WriteBuffer
+{
+public:
+    WriteBuffer(int fd, const QString& path, std::size_t capacity) : path{path}, fd{fd}, capacity{capacity}
+    {
+    }
+
+    bool write(uint64_t offset, const char* data, std::size_t len)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!pending.empty() && offset != pending_offset + pending.size())
+        {
+            if (!write_out())
+                return false;
+        }
+
+        if (pending.empty() && len >= capacity)
+            return write_all(fd, data, len, offset);
+
+        if (pending.empty())
+            pending_offset = offset;
+
+        pending.insert(pending.end(), data, data + len);
+
+        return pending.size() < capacity || write_out();
+    }
+
+    bool flush()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return write_out();
+    }
+
+    const QString path;
+
+private:
+    bool write_out()
+    {
+        if (pending.empty())
+            return true;
+
+        auto success = write_all(fd, pending.data(), pending.size(), pending_offset);
+        if (!success)
+            mpl::log(mpl::Level::error, category,
+                     fmt::format("failed to write {} buffered bytes to '{}': {}", pending.size(), path,
+                                 std::strerror(errno)));
+
+        // The capacity is kept around for the next batch of writes
+        pending.clear();
+        return success;
+    }
+
+    const int fd;
+    const std::size_t capacity;
+    std::mutex mutex;
+    uint64_t pending_offset{0};
+    std::vector<char> pending;
+};
+
 mp::SftpServer::SftpServer(SSHSession&& session, const std::string& source, const std::string& target,
-                           const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map,
-                           int default_uid, int default_gid, const std::string& sshfs_exec_line)
-    : ssh_session{std::move(session)},
-      sshfs_process{create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source, '"'),
+                           const IdMappings& gid_map, const IdMappings& uid_map, int default_uid, int default_gid,
+                           const std::string& sshfs_exec_line, int num_workers, std::size_t write_buffer_size,
+                           bool cache_attributes)
+    : SftpServer{std::make_shared<SharedSSHSession>(std::move(session)), false, source, target, gid_map, uid_map,
+                 default_uid, default_gid, sshfs_exec_line, num_workers, write_buffer_size, cache_attributes}
+{
+}
+
+mp::SftpServer::SftpServer(const std::shared_ptr<SharedSSHSession>& shared_session, const std::string& source,
+                           const std::string& target, const IdMappings& gid_map, const IdMappings& uid_map,
+                           int default_uid, int default_gid, const std::string& sshfs_exec_line, int num_workers,
+                           std::size_t write_buffer_size, bool cache_attributes)
+    : SftpServer{shared_session, true, source, target, gid_map, uid_map, default_uid, default_gid, sshfs_exec_line,
+                 num_workers, write_buffer_size, cache_attributes}
+{
+}
+
+mp::SftpServer::SftpServer(const std::shared_ptr<SharedSSHSession>& shared_session, bool session_is_shared,
+                           const std::string& source, const std::string& target, const IdMappings& gid_map,
+                           const IdMappings& uid_map, int default_uid, int default_gid,
+                           const std::string& sshfs_exec_line, int num_workers, std::size_t write_buffer_size,
+                           bool cache_attributes)
+    : shared_session{shared_session},
+      ssh_session{shared_session->session},
+      session_mutex{shared_session->mutex},
+      session_is_shared{session_is_shared},
+      sshfs_process{create_sshfs_process(*shared_session, sshfs_exec_line, mp::utils::escape_char(source, '"'),
                                          mp::utils::escape_char(target, '"'))},
-      sftp_server_session{make_sftp_session(ssh_session, sshfs_process->release_channel())},
+      sftp_server_session{make_sftp_session(*shared_session, sshfs_process->release_channel())},
       source_path{source},
       target_path{target},
-      gid_map{gid_map},
-      uid_map{uid_map},
+      gid_mappings{IdMappings::intern(gid_map)},
+      uid_mappings{IdMappings::intern(uid_map)},
       default_uid{default_uid},
       default_gid{default_gid},
-      sshfs_exec_line{sshfs_exec_line}
+      sshfs_exec_line{sshfs_exec_line},
+      num_workers{std::max(num_workers, 0)},
+      write_buffer_size{write_buffer_size}
 {
+    if (cache_attributes)
+    {
+        try
+        {
+            attribute_cache = std::make_unique<AttributeCache>();
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("not caching file attributes: {}", e.what()));
+        }
+    }
 }
 
 mp::SftpServer::~SftpServer()
 {
     stop_invoked = true;
+    stop_workers();
+
+    // Closing the channel goes through the session, which other mounts may still be using
+    SharedSSHSession::Lock lock{*shared_session};
+    sftp_server_session.reset();
+    sshfs_process.reset();
 }
 
 sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
@@ -299,21 +643,49 @@ sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
     return attr;
 }
 
+// Attributes of the path itself, without following a final symlink
+mp::AttributeCache::Attributes mp::SftpServer::attr_for_path(const QString& filename)
+{
+    QFileInfo file_info(filename);
+    if (!file_info.isSymLink() && !file_info.exists())
+        return nullopt;
+
+    if (!file_info.isSymLink())
+        return attr_from(file_info);
+
+    sftp_attributes_struct attr{};
+    mp::platform::symlink_attr_from(filename.toStdString().c_str(), &attr);
+    attr.uid = mapped_uid_for(attr.uid);
+    attr.gid = mapped_gid_for(attr.gid);
+
+    return attr;
+}
+
+mp::AttributeCache::Attributes mp::SftpServer::cached_attr_for_path(const QString& filename)
+{
+    if (attribute_cache == nullptr)
+        return attr_for_path(filename);
+
+    return attribute_cache->get(filename.toStdString(), [this, &filename] { return attr_for_path(filename); });
+}
+
+// Changes made through the server are dropped right away rather than when inotify gets around to reporting them
+void mp::SftpServer::invalidate_cached_attr(const QString& filename)
+{
+    if (attribute_cache)
+        attribute_cache->invalidate(filename.toStdString());
+}
+
 int mp::SftpServer::mapped_uid_for(const int uid)
 {
     if (uid == mp::no_id_info_available)
         return default_uid;
 
-    auto map = uid_map.find(uid);
-    if (map != uid_map.end())
-    {
-        if (map->second == mp::default_id)
-            return default_uid;
-        else
-            return map->second;
-    }
+    const auto mapped = uid_mappings->instance_id_for(uid);
+    if (!mapped)
+        return uid;
 
-    return uid;
+    return *mapped == mp::default_id ? default_uid : *mapped;
 }
 
 int mp::SftpServer::mapped_gid_for(const int gid)
@@ -321,22 +693,18 @@ int mp::SftpServer::mapped_gid_for(const int gid)
     if (gid == mp::no_id_info_available)
         return default_gid;
 
-    auto map = gid_map.find(gid);
-    if (map != gid_map.end())
-    {
-        if (map->second == mp::default_id)
-            return default_gid;
-        else
-            return map->second;
-    }
+    const auto mapped = gid_mappings->instance_id_for(gid);
+    if (!mapped)
+        return gid;
 
-    return gid;
+    return *mapped == mp::default_id ? default_gid : *mapped;
 }
 
 void mp::SftpServer::process_message(sftp_client_message msg)
 {
     int ret = 0;
     const auto type = sftp_client_message_get_type(msg);
+    const auto start = std::chrono::steady_clock::now();
     switch (type)
     {
     case SFTP_REALPATH:
@@ -396,23 +764,120 @@ void mp::SftpServer::process_message(sftp_client_message msg)
         mpl::log(mpl::Level::warning, category, fmt::format("Unknown message: {}", static_cast<int>(type)));
         ret = reply_unsupported(msg);
     }
+
+    mount_stats.record(operation_for(type), std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - start));
+
     if (ret != 0)
         mpl::log(mpl::Level::error, category, fmt::format("error occurred when replying to client: {}", ret));
 }
 
+sftp_client_message mp::SftpServer::next_client_message()
+{
+    if (message_queues.empty() && !session_is_shared)
+        return sftp_get_client_message(sftp_server_session.get());
+
+    // Workers and other mounts use the same session, so only hold the session lock while a request is pending
+    std::unique_lock<std::mutex> lock{session_mutex};
+    while (!stop_invoked)
+    {
+        // Looking at this channel reads whatever came in on the socket, for other channels too
+        const auto unread_data = shared_session->has_unread_data();
+        const auto available = ssh_channel_poll_timeout(sftp_server_session->channel, 0, 0);
+        if (unread_data)
+            shared_session->notify_data();
+
+        if (available > 0)
+        {
+            auto msg = sftp_get_client_message(sftp_server_session.get());
+            shared_session->notify_data();
+            return msg;
+        }
+
+        if (available == SSH_ERROR || available == SSH_EOF)
+            return nullptr;
+
+        shared_session->wait_for_data(lock);
+    }
+
+    return nullptr;
+}
+
+void mp::SftpServer::dispatch(MsgUPtr msg)
+{
+    const auto type = sftp_client_message_get_type(msg.get());
+
+    // Requests on a file go to the same worker whether they name it by path or by an open handle, to preserve
+    // per-file ordering
+    std::size_t key;
+    if (is_handle_message(type))
+    {
+        key = dispatch_key_for_handle(handle_id(msg->handle));
+    }
+    else if (type == SFTP_EXTENDED && is_fsync_message(msg.get()))
+    {
+        key = dispatch_key_for_handle(handle_id(fsync_handle_from(msg.get()).get()));
+    }
+    else
+    {
+        const auto filename = sftp_client_message_get_filename(msg.get());
+        key = dispatch_key_for(filename ? filename : "");
+    }
+
+    message_queues[key % message_queues.size()]->push(std::move(msg));
+}
+
+std::size_t mp::SftpServer::dispatch_key_for_handle(void* id)
+{
+    std::lock_guard<std::mutex> lock{handles_mutex};
+    auto entry = handle_dispatch_keys.find(id);
+    return entry != handle_dispatch_keys.end() ? entry->second : std::hash<void*>{}(id);
+}
+
+void mp::SftpServer::start_workers()
+{
+    for (auto i = 0; i < num_workers; ++i)
+    {
+        auto& message_queue = message_queues.emplace_back(std::make_unique<MessageQueue>());
+        workers.emplace_back([this, &queue = *message_queue] {
+            while (auto msg = queue.pop())
+                process_message(msg.get());
+        });
+    }
+}
+
+void mp::SftpServer::stop_workers()
+{
+    for (auto& queue : message_queues)
+        queue->close();
+
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    workers.clear();
+    message_queues.clear();
+}
+
 void mp::SftpServer::run()
 {
-    using MsgUPtr = std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
+    start_workers();
 
     while (true)
     {
-        MsgUPtr client_msg{sftp_get_client_message(sftp_server_session.get()), sftp_client_message_free};
+        MsgUPtr client_msg{next_client_message(), sftp_client_message_free};
         auto msg = client_msg.get();
         if (msg == nullptr)
         {
+            // Let outstanding requests finish before touching the session from this thread alone
+            stop_workers();
+
             if (stop_invoked)
                 break;
 
+            std::unique_lock<std::mutex> lock{session_mutex};
             int status{0};
             try
             {
@@ -434,11 +899,17 @@ void mp::SftpServer::run()
                     ssh_session.exec(fmt::format("sudo umount {}", mount_path));
                 }
 
+                sftp_server_session.reset();
+                sshfs_process.reset();
+                shared_session->notify_data();
+                lock.unlock();
+
                 sshfs_process =
-                    create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
+                    create_sshfs_process(*shared_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
                                          mp::utils::escape_char(target_path, '"'));
-                sftp_server_session = make_sftp_session(ssh_session, sshfs_process->release_channel());
+                sftp_server_session = make_sftp_session(*shared_session, sshfs_process->release_channel());
 
+                start_workers();
                 continue;
             }
             else
@@ -447,42 +918,182 @@ void mp::SftpServer::run()
             }
         }
 
-        process_message(msg);
+        if (message_queues.empty())
+            process_message(msg);
+        else
+            dispatch(std::move(client_msg));
     }
 }
 
 void mp::SftpServer::stop()
 {
     stop_invoked = true;
-    ssh_session.force_shutdown();
+
+    // Other mounts keep using a shared session, this one notices stop_invoked when woken from waiting for requests
+    if (session_is_shared)
+        shared_session->interrupt();
+    else
+        ssh_session.force_shutdown();
+}
+
+void* mp::SftpServer::handle_id(ssh_string handle)
+{
+    if (handle == nullptr)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock{handles_mutex};
+    return sftp_handle(sftp_server_session.get(), handle);
+}
+
+std::shared_ptr<mp::SftpServer::WriteBuffer> mp::SftpServer::write_buffer_for(void* id)
+{
+    std::lock_guard<std::mutex> lock{handles_mutex};
+    auto entry = write_buffers.find(id);
+    return entry != write_buffers.end() ? entry->second : nullptr;
+}
+
+bool mp::SftpServer::flush_write_buffer(void* id)
+{
+    auto write_buffer = write_buffer_for(id);
+    return write_buffer == nullptr || write_buffer->flush();
+}
+
+bool mp::SftpServer::flush_write_buffers_under(const QString& path)
+{
+    if (write_buffer_size == 0)
+        return true;
+
+    std::vector<std::shared_ptr<WriteBuffer>> matching_buffers;
+    {
+        std::lock_guard<std::mutex> lock{handles_mutex};
+        for (const auto& entry : write_buffers)
+        {
+            const auto& buffer_path = entry.second->path;
+            if (buffer_path == path || (buffer_path.startsWith(path) && buffer_path[path.size()] == '/'))
+                matching_buffers.push_back(entry.second);
+        }
+    }
+
+    auto success = true;
+    for (const auto& write_buffer : matching_buffers)
+        success = write_buffer->flush() && success;
+
+    return success;
+}
+
+mp::MountStats::Snapshot mp::SftpServer::stats() const
+{
+    return mount_stats.snapshot();
+}
+
+int mp::SftpServer::reply_status(sftp_client_message msg, uint32_t status, const char* message)
+{
+    if (status != SSH_FX_OK && status != SSH_FX_EOF)
+        mount_stats.record_error(operation_for(sftp_client_message_get_type(msg)));
+
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_status(msg, status, message);
+}
+
+int mp::SftpServer::reply_ok(sftp_client_message msg)
+{
+    return reply_status(msg, SSH_FX_OK, nullptr);
+}
+
+int mp::SftpServer::reply_failure(sftp_client_message msg)
+{
+    return reply_status(msg, SSH_FX_FAILURE, nullptr);
+}
+
+int mp::SftpServer::reply_perm_denied(sftp_client_message msg)
+{
+    return reply_status(msg, SSH_FX_PERMISSION_DENIED, "permission denied");
+}
+
+int mp::SftpServer::reply_bad_handle(sftp_client_message msg, const char* type)
+{
+    return reply_status(msg, SSH_FX_BAD_MESSAGE, fmt::format("{}: invalid handle", type).c_str());
+}
+
+int mp::SftpServer::reply_unsupported(sftp_client_message msg)
+{
+    return reply_status(msg, SSH_FX_OP_UNSUPPORTED, "Unsupported message");
+}
+
+int mp::SftpServer::reply_attr(sftp_client_message msg, sftp_attributes attr)
+{
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_attr(msg, attr);
+}
+
+int mp::SftpServer::reply_data(sftp_client_message msg, const void* data, int len)
+{
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_data(msg, data, len);
+}
+
+int mp::SftpServer::reply_name(sftp_client_message msg, const char* name, sftp_attributes attr)
+{
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_name(msg, name, attr);
+}
+
+int mp::SftpServer::reply_names(sftp_client_message msg)
+{
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_names(msg);
+}
+
+int mp::SftpServer::reply_handle(sftp_client_message msg, ssh_string handle)
+{
+    SharedSSHSession::Lock lock{*shared_session};
+    return sftp_reply_handle(msg, handle);
 }
 
 int mp::SftpServer::handle_close(sftp_client_message msg)
 {
-    const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
+    const auto id = handle_id(msg->handle);
+    const auto flushed = flush_write_buffer(id);
 
-    auto erased = open_file_handles.erase(id);
-    erased += open_dir_handles.erase(id);
-    if (erased == 0)
-        return reply_bad_handle(msg, "close");
+    {
+        std::lock_guard<std::mutex> lock{handles_mutex};
+        auto erased = open_file_handles.erase(id);
+        erased += open_dir_handles.erase(id);
+        if (erased == 0)
+            return reply_bad_handle(msg, "close");
+
+        write_buffers.erase(id);
+        handle_dispatch_keys.erase(id);
+        sftp_handle_remove(sftp_server_session.get(), id);
+    }
+
+    // Writes that were held back can only fail now, so let the client know on close
+    if (!flushed)
+        return reply_failure(msg);
 
-    sftp_handle_remove(sftp_server_session.get(), id);
     return reply_ok(msg);
 }
 
 int mp::SftpServer::handle_fstat(sftp_client_message msg)
 {
-    auto file = handle_from(msg, open_file_handles);
+    auto file = handle_from(msg, open_file_handles, handles_mutex);
     if (file == nullptr)
         return reply_bad_handle(msg, "fstat");
 
+    if (!flush_write_buffer(file))
+        return reply_failure(msg);
+
+    auto cached_attr = cached_attr_for_path(file->fileName());
+    if (cached_attr && !is_symlink(*cached_attr))
+        return reply_attr(msg, &*cached_attr);
+
     QFileInfo file_info(*file);
 
     if (file_info.isSymLink())
         file_info = QFileInfo(file_info.symLinkTarget());
 
     auto attr = attr_from(file_info);
-    return sftp_reply_attr(msg, &attr);
+    return reply_attr(msg, &attr);
 }
 
 int mp::SftpServer::handle_mkdir(sftp_client_message msg)
@@ -492,7 +1103,9 @@ int mp::SftpServer::handle_mkdir(sftp_client_message msg)
         return reply_perm_denied(msg);
 
     QDir dir(filename);
-    if (!dir.mkdir(filename))
+    const auto created = dir.mkdir(filename);
+    invalidate_cached_attr(filename);
+    if (!created)
         return reply_failure(msg);
 
     if (!QFile::setPermissions(filename, to_qt_permissions(msg->attr->permissions)))
@@ -518,7 +1131,9 @@ int mp::SftpServer::handle_rmdir(sftp_client_message msg)
         return reply_perm_denied(msg);
 
     QDir dir(filename);
-    if (!dir.rmdir(filename))
+    const auto removed = dir.rmdir(filename);
+    invalidate_cached_attr(filename);
+    if (!removed)
         return reply_failure(msg);
 
     return reply_ok(msg);
@@ -559,7 +1174,11 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
 
     auto exists = QFileInfo(filename).isSymLink() || file->exists();
 
-    if (!file->open(mode))
+    const auto opened = file->open(mode);
+    if (!exists || (mode & QIODevice::Truncate))
+        invalidate_cached_attr(filename);
+
+    if (!opened)
         return reply_failure(msg);
 
     if (!exists)
@@ -579,10 +1198,15 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
         }
     }
 
+    std::unique_lock<std::mutex> lock{handles_mutex};
     SftpHandleUPtr sftp_handle{sftp_handle_alloc(sftp_server_session.get(), file.get()), ssh_string_free};
+    if (write_buffer_size > 0 && (mode & QIODevice::WriteOnly))
+        write_buffers.emplace(file.get(), std::make_shared<WriteBuffer>(file->handle(), filename, write_buffer_size));
+    handle_dispatch_keys.emplace(file.get(), dispatch_key_for(filename));
     open_file_handles.emplace(file.get(), std::move(file));
+    lock.unlock();
 
-    return sftp_reply_handle(msg, sftp_handle.get());
+    return reply_handle(msg, sftp_handle.get());
 }
 
 int mp::SftpServer::handle_opendir(sftp_client_message msg)
@@ -591,76 +1215,89 @@ int mp::SftpServer::handle_opendir(sftp_client_message msg)
     if (!validate_path(source_path, filename))
         return reply_perm_denied(msg);
 
-    QDir dir(filename);
-    if (!dir.exists())
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such directory");
+    // Entry sizes are read as the listing goes, so they must include writes still held back
+    if (!flush_write_buffers_under(filename))
+        return reply_failure(msg);
 
-    if (!dir.isReadable())
-        return reply_perm_denied(msg);
+    DirUPtr dir{::opendir(filename), closedir};
+    if (dir == nullptr)
+    {
+        if (errno == EACCES)
+            return reply_perm_denied(msg);
 
-    auto entry_list =
-        std::make_unique<QFileInfoList>(dir.entryInfoList(QDir::AllEntries | QDir::System | QDir::Hidden));
+        return reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such directory");
+    }
 
-    SftpHandleUPtr sftp_handle{sftp_handle_alloc(sftp_server_session.get(), entry_list.get()), ssh_string_free};
-    open_dir_handles.emplace(entry_list.get(), std::move(entry_list));
+    std::unique_lock<std::mutex> lock{handles_mutex};
+    SftpHandleUPtr sftp_handle{sftp_handle_alloc(sftp_server_session.get(), dir.get()), ssh_string_free};
+    handle_dispatch_keys.emplace(dir.get(), dispatch_key_for(filename));
+    open_dir_handles.emplace(dir.get(), std::move(dir));
+    lock.unlock();
 
-    return sftp_reply_handle(msg, sftp_handle.get());
+    return reply_handle(msg, sftp_handle.get());
 }
 
 int mp::SftpServer::handle_read(sftp_client_message msg)
 {
-    auto file = handle_from(msg, open_file_handles);
+    auto file = handle_from(msg, open_file_handles, handles_mutex);
     if (file == nullptr)
         return reply_bad_handle(msg, "read");
 
-    const auto max_packet_size = 65536u;
-    const auto len = std::min(msg->len, max_packet_size);
+    if (!flush_write_buffer(file))
+        return reply_failure(msg);
+
+    const auto len = std::min(msg->len, max_read_size);
 
-    std::vector<char> data;
-    data.reserve(len);
+    // Reused by every read served on this thread, so sequential reads don't allocate per request
+    thread_local std::vector<char> data;
+    if (data.size() < len)
+        data.resize(len);
 
-    file->seek(msg->offset);
-    auto r = file->read(data.data(), len);
+    // Read at the requested offset straight from the descriptor, bypassing QFile's own buffering
+    auto r = mp::platform::pread(file->handle(), data.data(), len, msg->offset);
     if (r < 0)
-        return sftp_reply_status(msg, SSH_FX_FAILURE, file->errorString().toStdString().c_str());
+        return reply_status(msg, SSH_FX_FAILURE, std::strerror(errno));
     else if (r == 0)
-        return sftp_reply_status(msg, SSH_FX_EOF, "End of file");
+        return reply_status(msg, SSH_FX_EOF, "End of file");
 
-    return sftp_reply_data(msg, data.data(), r);
+    mount_stats.add_bytes_read(r);
+    return reply_data(msg, data.data(), r);
 }
 
 int mp::SftpServer::handle_readdir(sftp_client_message msg)
 {
-    auto dir_entries = handle_from(msg, open_dir_handles);
-    if (dir_entries == nullptr)
+    auto dir = handle_from(msg, open_dir_handles, handles_mutex);
+    if (dir == nullptr)
         return reply_bad_handle(msg, "readdir");
 
-    if (dir_entries->empty())
-        return sftp_reply_status(msg, SSH_FX_EOF, nullptr);
+    // Fill the reply up to a size budget rather than a fixed count, names and longnames dominate it
+    std::size_t reply_size{0};
+    auto num_entries{0};
+    while (reply_size < max_readdir_reply_size)
+    {
+        const auto entry = ::readdir(dir);
+        if (entry == nullptr)
+            break;
 
-    const auto max_num_entries_per_packet = 50;
-    const auto num_entries = std::min(dir_entries->size(), max_num_entries_per_packet);
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+            continue; // removed since the listing started
 
-    for (int i = 0; i < num_entries; i++)
-    {
-        const QFileInfo entry = dir_entries->takeFirst();
-        const auto filename = entry.fileName().toStdString();
-        sftp_attributes_struct attr{};
-        if (entry.isSymLink())
-        {
-            mp::platform::symlink_attr_from(entry.absoluteFilePath().toStdString().c_str(), &attr);
-            attr.uid = mapped_uid_for(attr.uid);
-            attr.gid = mapped_gid_for(attr.gid);
-        }
-        else
-        {
-            attr = attr_from(entry);
-        }
-        const auto longname = longname_from(entry, filename);
-        sftp_reply_names_add(msg, filename.c_str(), longname.data(), &attr);
+        auto attr = stat_to_attr(st);
+        attr.uid = mapped_uid_for(attr.uid);
+        attr.gid = mapped_gid_for(attr.gid);
+
+        const auto longname = longname_from(st, attr, entry->d_name);
+        sftp_reply_names_add(msg, entry->d_name, longname.data(), &attr);
+
+        reply_size += std::strlen(entry->d_name) + longname.size() + sizeof(attr);
+        ++num_entries;
     }
 
-    return sftp_reply_names(msg);
+    if (num_entries == 0)
+        return reply_status(msg, SSH_FX_EOF, nullptr);
+
+    return reply_names(msg);
 }
 
 int mp::SftpServer::handle_readlink(sftp_client_message msg)
@@ -671,11 +1308,11 @@ int mp::SftpServer::handle_readlink(sftp_client_message msg)
 
     auto link = QFile::symLinkTarget(filename);
     if (link.isEmpty())
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "invalid link");
+        return reply_status(msg, SSH_FX_NO_SUCH_FILE, "invalid link");
 
     sftp_attributes_struct attr{};
     sftp_reply_names_add(msg, link.toStdString().c_str(), link.toStdString().c_str(), &attr);
-    return sftp_reply_names(msg);
+    return reply_names(msg);
 }
 
 int mp::SftpServer::handle_realpath(sftp_client_message msg)
@@ -685,7 +1322,7 @@ int mp::SftpServer::handle_realpath(sftp_client_message msg)
         return reply_perm_denied(msg);
 
     auto realpath = QFileInfo(filename).absoluteFilePath();
-    return sftp_reply_name(msg, realpath.toStdString().c_str(), nullptr);
+    return reply_name(msg, realpath.toStdString().c_str(), nullptr);
 }
 
 int mp::SftpServer::handle_remove(sftp_client_message msg)
@@ -694,7 +1331,12 @@ int mp::SftpServer::handle_remove(sftp_client_message msg)
     if (!validate_path(source_path, filename))
         return reply_perm_denied(msg);
 
-    if (!QFile::remove(filename))
+    if (!flush_write_buffers_under(filename))
+        return reply_failure(msg);
+
+    const auto removed = QFile::remove(filename);
+    invalidate_cached_attr(filename);
+    if (!removed)
         return reply_failure(msg);
     return reply_ok(msg);
 }
@@ -706,19 +1348,26 @@ int mp::SftpServer::handle_rename(sftp_client_message msg)
         return reply_perm_denied(msg);
 
     if (!QFileInfo(source).isSymLink() && !QFile::exists(source))
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
+        return reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
 
     const auto target = sftp_client_message_get_data(msg);
     if (!validate_path(source_path, target))
         return reply_perm_denied(msg);
 
+    if (!flush_write_buffers_under(source) || !flush_write_buffers_under(target))
+        return reply_failure(msg);
+
+    invalidate_cached_attr(target);
     if (QFile::exists(target))
     {
         if (!QFile::remove(target))
             return reply_failure(msg);
     }
 
-    if (!QFile::rename(source, target))
+    const auto renamed = QFile::rename(source, target);
+    invalidate_cached_attr(source);
+    invalidate_cached_attr(target);
+    if (!renamed)
         return reply_failure(msg);
 
     return reply_ok(msg);
@@ -730,9 +1379,13 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
 
     if (sftp_client_message_get_type(msg) == SFTP_FSETSTAT)
     {
-        auto handle = handle_from(msg, open_file_handles);
+        auto handle = handle_from(msg, open_file_handles, handles_mutex);
         if (handle == nullptr)
             return reply_bad_handle(msg, "setstat");
+
+        if (!flush_write_buffer(handle))
+            return reply_failure(msg);
+
         filename = handle->fileName();
     }
     else
@@ -742,32 +1395,16 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
             return reply_perm_denied(msg);
 
         if (!QFileInfo(filename).isSymLink() && !QFile::exists(filename))
-            return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
-    }
-
-    if (msg->attr->flags & SSH_FILEXFER_ATTR_SIZE)
-    {
-        if (!QFile::resize(filename, msg->attr->size))
-            return reply_failure(msg);
-    }
+            return reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
 
-    if (msg->attr->flags & SSH_FILEXFER_ATTR_PERMISSIONS)
-    {
-        if (!QFile::setPermissions(filename, to_qt_permissions(msg->attr->permissions)))
-            return reply_failure(msg);
-    }
-
-    if (msg->attr->flags & SSH_FILEXFER_ATTR_ACMODTIME)
-    {
-        if (mp::platform::utime(filename.toStdString().c_str(), msg->attr->atime, msg->attr->mtime) < 0)
+        if (!flush_write_buffers_under(filename))
             return reply_failure(msg);
     }
 
-    if (msg->attr->flags & SSH_FILEXFER_ATTR_UIDGID)
-    {
-        if (mp::platform::chown(filename.toStdString().c_str(), msg->attr->uid, msg->attr->gid) < 0)
-            return reply_failure(msg);
-    }
+    const auto applied = apply_attr(filename, msg->attr);
+    invalidate_cached_attr(filename);
+    if (!applied)
+        return reply_failure(msg);
 
     return reply_ok(msg);
 }
@@ -778,27 +1415,18 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
     if (!validate_path(source_path, filename))
         return reply_perm_denied(msg);
 
-    QFileInfo file_info(filename);
-    if (!file_info.isSymLink() && !file_info.exists())
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
-
-    sftp_attributes_struct attr{};
+    if (!flush_write_buffers_under(filename))
+        return reply_failure(msg);
 
-    if (!follow && file_info.isSymLink())
-    {
-        mp::platform::symlink_attr_from(filename, &attr);
-        attr.uid = mapped_uid_for(attr.uid);
-        attr.gid = mapped_gid_for(attr.gid);
-    }
-    else
-    {
-        if (file_info.isSymLink())
-            file_info = QFileInfo(file_info.symLinkTarget());
+    auto attr = cached_attr_for_path(filename);
+    if (!attr)
+        return reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
 
-        attr = attr_from(file_info);
-    }
+    // Only the link itself is cached, what it points to may live anywhere
+    if (follow && is_symlink(*attr))
+        attr = attr_from(QFileInfo(QFile::symLinkTarget(filename)));
 
-    return sftp_reply_attr(msg, &attr);
+    return reply_attr(msg, &*attr);
 }
 
 int mp::SftpServer::handle_symlink(sftp_client_message msg)
@@ -809,7 +1437,9 @@ int mp::SftpServer::handle_symlink(sftp_client_message msg)
     if (!validate_path(source_path, new_name))
         return reply_perm_denied(msg);
 
-    if (!mp::platform::symlink(old_name, new_name, QFileInfo(old_name).isDir()))
+    const auto linked = mp::platform::symlink(old_name, new_name, QFileInfo(old_name).isDir());
+    invalidate_cached_attr(new_name);
+    if (!linked)
         return reply_failure(msg);
 
     QFileInfo current_file(new_name);
@@ -828,26 +1458,41 @@ int mp::SftpServer::handle_symlink(sftp_client_message msg)
 
 int mp::SftpServer::handle_write(sftp_client_message msg)
 {
-    auto file = handle_from(msg, open_file_handles);
+    auto file = handle_from(msg, open_file_handles, handles_mutex);
     if (file == nullptr)
         return reply_bad_handle(msg, "write");
 
     auto len = ssh_string_len(msg->data);
     auto data_ptr = ssh_string_get_char(msg->data);
-    if (!file->seek(msg->offset))
+
+    auto write_buffer = write_buffer_for(file);
+    auto written = write_buffer ? write_buffer->write(msg->offset, data_ptr, len)
+                                : write_all(file->handle(), data_ptr, len, msg->offset);
+    invalidate_cached_attr(file->fileName());
+    if (!written)
         return reply_failure(msg);
 
-    do
+    mount_stats.add_bytes_written(len);
+    return reply_ok(msg);
+}
+
+int mp::SftpServer::handle_fsync(sftp_client_message msg)
+{
+    auto id = handle_id(fsync_handle_from(msg).get());
+
+    QFile* file{nullptr};
     {
-        auto r = file->write(data_ptr, len);
-        if (r < 0)
-            return reply_failure(msg);
+        std::lock_guard<std::mutex> lock{handles_mutex};
+        auto entry = open_file_handles.find(id);
+        if (entry != open_file_handles.end())
+            file = entry->second.get();
+    }
 
-        file->flush();
+    if (file == nullptr)
+        return reply_bad_handle(msg, "fsync");
 
-        data_ptr += r;
-        len -= r;
-    } while (len > 0);
+    if (!flush_write_buffer(file) || mp::platform::fsync(file->handle()) < 0)
+        return reply_failure(msg);
 
     return reply_ok(msg);
 }
@@ -867,13 +1512,19 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
         if (!validate_path(source_path, new_name))
             return reply_perm_denied(msg);
 
-        if (!mp::platform::link(old_name, new_name))
+        const auto linked = mp::platform::link(old_name, new_name);
+        invalidate_cached_attr(new_name);
+        if (!linked)
             return reply_failure(msg);
     }
     else if (method == "posix-rename@openssh.com")
     {
         return handle_rename(msg);
     }
+    else if (method == "fsync@openssh.com")
+    {
+        return handle_fsync(msg);
+    }
     else
     {
         return reply_unsupported(msg);
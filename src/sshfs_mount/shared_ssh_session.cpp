@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sshfs_mount/shared_ssh_session.h>
+
+#include <multipass/format.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+
+mp::SharedSSHSession::Lock::Lock(SharedSSHSession& shared_session)
+    : shared_session{shared_session}, lock{shared_session.mutex}
+{
+}
+
+mp::SharedSSHSession::Lock::~Lock()
+{
+    shared_session.notify_data();
+}
+
+mp::SharedSSHSession::SharedSSHSession(SSHSession&& session) : session{std::move(session)}
+{
+    if (pipe(wake_pipe) < 0)
+        throw std::runtime_error(fmt::format("failed to create a pipe: {}", std::strerror(errno)));
+
+    for (auto fd : wake_pipe)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+mp::SharedSSHSession::~SharedSSHSession()
+{
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+void mp::SharedSSHSession::wait_for_data(std::unique_lock<std::mutex>& lock)
+{
+    const auto seen_generation = generation;
+    if (polling)
+    {
+        data_arrived.wait(lock, [this, seen_generation] { return generation != seen_generation; });
+        return;
+    }
+
+    polling = true;
+    lock.unlock();
+
+    std::array<pollfd, 2> fds{{{ssh_get_fd(session), POLLIN, 0}, {wake_pipe[0], POLLIN, 0}}};
+    while (poll(fds.data(), fds.size(), -1) < 0 && errno == EINTR)
+        ;
+
+    std::array<char, 64> wake_bytes;
+    while (read(wake_pipe[0], wake_bytes.data(), wake_bytes.size()) > 0)
+        ;
+
+    lock.lock();
+    polling = false;
+    notify_data();
+}
+
+bool mp::SharedSSHSession::has_unread_data()
+{
+    pollfd socket_fd{ssh_get_fd(session), POLLIN, 0};
+    return poll(&socket_fd, 1, 0) > 0;
+}
+
+void mp::SharedSSHSession::notify_data()
+{
+    ++generation;
+    data_arrived.notify_all();
+
+    // The thread blocked on the socket has a channel to look at as well. A full pipe wakes it just the same.
+    if (polling)
+    {
+        const char wake_byte{0};
+        [[maybe_unused]] auto written = write(wake_pipe[1], &wake_byte, 1);
+    }
+}
+
+void mp::SharedSSHSession::interrupt()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    notify_data();
+}
@@ -18,6 +18,7 @@
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/optional.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/sshfs_mount/sftp_server.h>
 #include <multipass/sshfs_mount/sshfs_mount.h>
@@ -27,7 +28,6 @@
 
 #include <QDir>
 #include <QString>
-#include <iostream>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -39,18 +39,30 @@ const std::string fuse_version_string{"FUSE library version"};
 const std::string ld_library_path_key{"LD_LIBRARY_PATH="};
 const std::string snap_path_key{"SNAP="};
 
+// The session the commands preparing a mount run over. When other mounts use it as well, it is only locked for each
+// command rather than for the whole preparation, so that their I/O keeps flowing in between.
+struct InstanceSession
+{
+    mp::SSHSession& session;
+    mp::SharedSSHSession* shared_session;
+};
+
 // TODO: Need to unify all the various SSHSession::exec type of functions into
 //       one place and account for reading both stdout and stderr
-auto run_cmd(mp::SSHSession& session, std::string&& cmd)
+std::string run_cmd(const InstanceSession& instance, std::string&& cmd)
 {
-    auto ssh_process = session.exec(cmd);
+    mp::optional<mp::SharedSSHSession::Lock> lock;
+    if (instance.shared_session)
+        lock.emplace(*instance.shared_session);
+
+    auto ssh_process = instance.session.exec(cmd);
     if (ssh_process.exit_code() != 0)
         throw std::runtime_error(ssh_process.read_std_error());
 
     return ssh_process.read_std_output() + ssh_process.read_std_error();
 }
 
-auto get_sshfs_exec_and_options(mp::SSHSession& session)
+auto get_sshfs_exec_and_options(const InstanceSession& session)
 {
     std::string sshfs_exec;
 
@@ -87,7 +99,8 @@ auto get_sshfs_exec_and_options(mp::SSHSession& session)
 
     auto version_info{run_cmd(session, fmt::format("sudo {} -V", sshfs_exec))};
 
-    sshfs_exec += " -o slave -o transform_symlinks -o allow_other -o Compression=no";
+    sshfs_exec += fmt::format(" -o slave -o transform_symlinks -o allow_other -o Compression=no -o max_read={}",
+                              mp::SftpServer::max_read_size);
 
     auto fuse_version_line = mp::utils::match_line_for(version_info, fuse_version_string);
     if (!fuse_version_line.empty())
@@ -123,7 +136,7 @@ auto get_sshfs_exec_and_options(mp::SSHSession& session)
 }
 
 // Split a path into existing and to-be-created parts.
-std::pair<std::string, std::string> get_path_split(mp::SSHSession& session, const std::string& target)
+std::pair<std::string, std::string> get_path_split(const InstanceSession& session, const std::string& target)
 {
     std::string absolute;
 
@@ -153,22 +166,29 @@ std::pair<std::string, std::string> get_path_split(mp::SSHSession& session, cons
 }
 
 // Create a directory on a given root folder.
-void make_target_dir(mp::SSHSession& session, const std::string& root, const std::string& relative_target)
+void make_target_dir(const InstanceSession& session, const std::string& root, const std::string& relative_target)
 {
     run_cmd(session, fmt::format("sudo /bin/bash -c 'cd \"{}\" && mkdir -p \"{}\"'", root, relative_target));
 }
 
 // Set ownership of all directories on a path starting on a given root.
 // Assume it is already created.
-void set_owner_for(mp::SSHSession& session, const std::string& root, const std::string& relative_target, int vm_user,
-                   int vm_group)
+void set_owner_for(const InstanceSession& session, const std::string& root, const std::string& relative_target,
+                   int vm_user, int vm_group)
 {
     run_cmd(session, fmt::format("sudo /bin/bash -c 'cd \"{}\" && chown -R {}:{} \"{}\"'", root, vm_user, vm_group,
                                  relative_target.substr(0, relative_target.find_first_of('/'))));
 }
 
-auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const std::string& target,
-                      const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map)
+struct PreparedMount
+{
+    std::string sshfs_exec_line;
+    std::string target;
+    int default_uid;
+    int default_gid;
+};
+
+PreparedMount prepare_mount(const InstanceSession& session, const std::string& source, const std::string& target)
 {
     mpl::log(mpl::Level::debug, category,
              fmt::format("{}:{} {}(source = {}, target = {}, …): ", __FILE__, __LINE__, __FUNCTION__, source, target));
@@ -196,18 +216,52 @@ auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const
         set_owner_for(session, leading, missing, default_uid, default_gid);
     }
 
-    return std::make_unique<mp::SftpServer>(std::move(session), source, leading + missing, gid_map, uid_map,
-                                            default_uid, default_gid, sshfs_exec_line);
+    return {sshfs_exec_line, leading + missing, default_uid, default_gid};
+}
+
+auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const std::string& target,
+                      const mp::IdMappings& gid_map, const mp::IdMappings& uid_map, int num_workers,
+                      std::size_t write_buffer_size, bool cache_attributes)
+{
+    const auto mount = prepare_mount({session, nullptr}, source, target);
+
+    return std::make_unique<mp::SftpServer>(std::move(session), source, mount.target, gid_map, uid_map,
+                                            mount.default_uid, mount.default_gid, mount.sshfs_exec_line, num_workers,
+                                            write_buffer_size, cache_attributes);
+}
+
+auto make_sftp_server(const std::shared_ptr<mp::SharedSSHSession>& shared_session, const std::string& source,
+                      const std::string& target, const mp::IdMappings& gid_map, const mp::IdMappings& uid_map,
+                      int num_workers, std::size_t write_buffer_size, bool cache_attributes)
+{
+    const auto mount = prepare_mount({shared_session->session, shared_session.get()}, source, target);
+
+    return std::make_unique<mp::SftpServer>(shared_session, source, mount.target, gid_map, uid_map,
+                                            mount.default_uid, mount.default_gid, mount.sshfs_exec_line, num_workers,
+                                            write_buffer_size, cache_attributes);
 }
 
 } // namespace
 
 mp::SshfsMount::SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-                           const std::unordered_map<int, int>& gid_map, const std::unordered_map<int, int>& uid_map)
-    : sftp_server{make_sftp_server(std::move(session), source, target, gid_map, uid_map)}, sftp_thread{[this] {
-          std::cout << "Connected" << std::endl;
+                           const IdMappings& gid_map, const IdMappings& uid_map, int num_workers,
+                           std::size_t write_buffer_size, bool cache_attributes)
+    : sftp_server{make_sftp_server(std::move(session), source, target, gid_map, uid_map, num_workers,
+                                   write_buffer_size, cache_attributes)},
+      sftp_thread{[this] { sftp_server->run(); }}
+{
+}
+
+mp::SshfsMount::SshfsMount(const std::shared_ptr<SharedSSHSession>& shared_session, const std::string& source,
+                           const std::string& target, const IdMappings& gid_map, const IdMappings& uid_map,
+                           int num_workers, std::size_t write_buffer_size, bool cache_attributes,
+                           std::function<void()> on_disconnected)
+    : sftp_server{make_sftp_server(shared_session, source, target, gid_map, uid_map, num_workers, write_buffer_size,
+                                   cache_attributes)},
+      sftp_thread{[this, on_disconnected] {
           sftp_server->run();
-          std::cout << "Stopped" << std::endl;
+          if (on_disconnected && !stopping)
+              on_disconnected();
       }}
 {
 }
@@ -219,7 +273,13 @@ mp::SshfsMount::~SshfsMount()
 
 void mp::SshfsMount::stop()
 {
+    stopping = true;
     sftp_server->stop();
     if (sftp_thread.joinable())
         sftp_thread.join();
 }
+
+mp::MountStats::Snapshot mp::SshfsMount::stats() const
+{
+    return sftp_server->stats();
+}
@@ -15,10 +15,12 @@
  *
  */
 
+#include <multipass/constants.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform.h>
+#include <multipass/settings.h>
 #include <multipass/ssh/ssh_key_provider.h>
 #include <multipass/sshfs_mount/sshfs_mounts.h>
 #include <multipass/sshfs_server_config.h>
@@ -26,6 +28,10 @@
 #include <multipass/virtual_machine.h>
 
 #include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTimer>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -33,6 +39,7 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "sshfs-mounts";
+constexpr auto stats_timeout_ms = 1000;
 
 template <typename Signal>
 void start_and_block_until(mp::Process* process, Signal signal, std::function<bool(mp::Process* process)> ready_decider)
@@ -56,6 +63,17 @@ void start_and_block_until(mp::Process* process, Signal signal, std::function<bo
     QObject::disconnect(stop_conn);
     QObject::disconnect(running_conn);
 }
+
+// Fields of the lines exchanged with sshfs_server are percent-encoded, so they can hold spaces and newlines
+QByteArray encode(const std::string& field)
+{
+    return QByteArray::fromStdString(field).toPercentEncoding();
+}
+
+std::string decode(const QByteArray& field)
+{
+    return QByteArray::fromPercentEncoding(field).toStdString();
+}
 } // namespace
 
 mp::SSHFSMounts::SSHFSMounts(const SSHKeyProvider& key_provider) : key(key_provider.private_key_as_base64())
@@ -63,9 +81,11 @@ mp::SSHFSMounts::SSHFSMounts(const SSHKeyProvider& key_provider) : key(key_provi
 }
 
 void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_path, const std::string& target_path,
-                                  const std::unordered_map<int, int>& gid_map,
-                                  const std::unordered_map<int, int>& uid_map)
+                                  const IdMappings& gid_map, const IdMappings& uid_map)
 {
+    if (server_processes.find(vm->vm_name) != server_processes.end())
+        return add_mount(vm->vm_name, source_path, target_path, gid_map, uid_map);
+
     mp::SSHFSServerConfig config;
     config.host = vm->ssh_hostname();
     config.port = vm->ssh_port();
@@ -76,6 +96,9 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
     config.uid_map = uid_map;
     config.gid_map = gid_map;
     config.private_key = key;
+    config.workers = MP_SETTINGS.get_as<int>(mp::mount_workers_key);
+    config.write_buffer_size = MP_SETTINGS.get(mp::mount_write_buffer_key).toULongLong();
+    config.cache_attributes = MP_SETTINGS.get_as<bool>(mp::mount_attribute_cache_key);
 
     auto sshfs_server_process_t = mp::platform::make_sshfs_server_process(config);
     // FIXME: ProcessFactory really should return qt_delete_later_unique_ptr<Process> as Process emits signals
@@ -85,32 +108,35 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
 
     QObject::connect(
         sshfs_server_process.get(), &mp::Process::finished, this,
-        [this, instance = vm->vm_name, target_path](mp::ProcessState exit_state) {
+        [this, instance = vm->vm_name, process = sshfs_server_process.get()](mp::ProcessState exit_state) {
             if (exit_state.completed_successfully())
             {
                 mpl::log(mpl::Level::info, category,
-                         fmt::format("Mount '{}' in instance \"{}\" has stopped", target_path, instance));
+                         fmt::format("Mounts in instance \"{}\" have stopped", instance));
             }
             else
             {
                 mpl::log(mpl::Level::warning, // not error as it failing can indicate we need to install sshfs in the VM
                          category,
-                         fmt::format("Mount '{}' in instance \"{}\" has stopped unexpectedly: {}", target_path,
-                                     instance, exit_state.failure_message()));
+                         fmt::format("Mounts in instance \"{}\" have stopped unexpectedly: {}", instance,
+                                     exit_state.failure_message()));
             }
 
-            mount_processes[instance].erase(target_path);
-        });
+            stopping_processes.erase(process);
 
-    QObject::connect(
-        sshfs_server_process.get(), &mp::Process::error_occurred, this,
-        [instance = vm->vm_name, target_path, process = sshfs_server_process.get()](QProcess::ProcessError error,
-                                                                                    QString error_string) {
-            mpl::log(mpl::Level::error, category,
-                     fmt::format("There was an error with sshfs_server for instance \"{}\" with path '{}': {} - {}",
-                                 instance, target_path, mp::utils::qenum_to_string(error), error_string));
+            // A new server may have taken over the instance meanwhile
+            auto server = server_processes.find(instance);
+            if (server != server_processes.end() && server->second.process.get() == process)
+                server_processes.erase(server);
         });
 
+    QObject::connect(sshfs_server_process.get(), &mp::Process::error_occurred, this,
+                     [instance = vm->vm_name](QProcess::ProcessError error, QString error_string) {
+                         mpl::log(mpl::Level::error, category,
+                                  fmt::format("There was an error with sshfs_server for instance \"{}\": {} - {}",
+                                              instance, mp::utils::qenum_to_string(error), error_string));
+                     });
+
     mpl::log(mpl::Level::info, category, fmt::format("mounting {} => {} in {}", source_path, target_path, vm->vm_name));
     mpl::log(mpl::Level::info, category,
              fmt::format("process program '{}'", sshfs_server_process->program().toStdString()));
@@ -134,53 +160,238 @@ void mp::SSHFSMounts::start_mount(VirtualMachine* vm, const std::string& source_
             fmt::format("{}: {}", process_state.failure_message(), sshfs_server_process->read_all_standard_error()));
     }
 
-    mount_processes[vm->vm_name][target_path] = std::move(sshfs_server_process);
+    watch_output(vm->vm_name, sshfs_server_process.get());
+    server_processes[vm->vm_name] = {std::move(sshfs_server_process), config, {{target_path, source_path}}};
+}
+
+// Asks the instance's running sshfs_server to serve one more mount over its existing SSH session
+void mp::SSHFSMounts::add_mount(const std::string& instance, const std::string& source_path,
+                                const std::string& target_path, const IdMappings& gid_map,
+                                const IdMappings& uid_map)
+{
+    auto& server = server_processes.at(instance);
+    server.source_paths[target_path] = source_path;
+    update_policy(server);
+
+    mpl::log(mpl::Level::info, category, fmt::format("mounting {} => {} in {}", source_path, target_path, instance));
+
+    const auto request = "mount " + encode(source_path) + " " + encode(target_path) + " " +
+                         encode(uid_map.to_string().toStdString()) + " " + encode(gid_map.to_string().toStdString()) +
+                         "\n";
+    const auto reply = request_and_wait(server.process.get(), request, [&target_path](const QList<QByteArray>& fields) {
+        return fields.size() >= 2 && (fields[0] == "Connected" || fields[0] == "Failed") &&
+               decode(fields[1]) == target_path;
+    });
+
+    if (reply.isEmpty() || reply[0] != "Connected")
+    {
+        auto server = server_processes.find(instance);
+        if (server != server_processes.end())
+        {
+            server->second.source_paths.erase(target_path);
+            update_policy(server->second);
+        }
+
+        if (reply.isEmpty())
+            throw std::runtime_error(fmt::format("sshfs_server for instance \"{}\" stopped before mounting '{}'",
+                                                 instance, target_path));
+
+        if (reply.value(2) == "9") // Magic number answered by sshfs_server
+            throw mp::SSHFSMissingError();
+
+        throw std::runtime_error(decode(reply.value(3)));
+    }
+}
+
+// Lets the process reach the source paths of the mounts it serves, and none of those it stopped serving
+void mp::SSHFSMounts::update_policy(const ServerProcess& server)
+{
+    auto config = server.config;
+    config.additional_source_paths.clear();
+
+    auto mount = server.source_paths.begin();
+    if (mount == server.source_paths.end())
+        return;
+
+    config.source_path = mount->second;
+    while (++mount != server.source_paths.end())
+        config.additional_source_paths.push_back(mount->second);
+
+    mp::platform::update_sshfs_server_policy(config);
+}
+
+// Splits what sshfs_server prints into lines. Mounts that went away by themselves are dropped, and the rest is passed
+// on to whoever waits for an answer.
+void mp::SSHFSMounts::watch_output(const std::string& instance, Process* process)
+{
+    auto output = std::make_shared<QByteArray>();
+    QObject::connect(process, &mp::Process::ready_read_standard_output, this, [this, instance, process, output] {
+        *output += process->read_all_standard_output();
+
+        int end_of_line;
+        while ((end_of_line = output->indexOf('\n')) >= 0)
+        {
+            const auto fields = output->left(end_of_line).split(' ');
+            output->remove(0, end_of_line + 1);
+
+            if (fields.size() == 2 && fields[0] == "Disconnected")
+            {
+                drop_disconnected_mount(instance, process, decode(fields[1]));
+                continue;
+            }
+
+            auto waiters = answer_waiters.equal_range(process);
+            for (auto waiter = waiters.first; waiter != waiters.second; ++waiter)
+                waiter->second(fields);
+        }
+    });
+}
+
+// Sends sshfs_server a request and waits for the answer that is_answer picks out of its output, skipping answers to
+// earlier requests. No answer comes back if the process finishes, or the timeout expires, first.
+QList<QByteArray> mp::SSHFSMounts::request_and_wait(Process* server_process, const QByteArray& request,
+                                                    const std::function<bool(const QList<QByteArray>&)>& is_answer,
+                                                    int timeout_ms)
+{
+    // The process may finish, and be deleted, while waiting for its answer
+    QPointer<mp::Process> process{server_process};
+    QList<QByteArray> reply;
+
+    QEventLoop event_loop;
+    auto stop_conn =
+        QObject::connect(process, &mp::Process::finished, [&event_loop](mp::ProcessState) { event_loop.quit(); });
+    auto waiter = answer_waiters.emplace(server_process, [&](const QList<QByteArray>& fields) {
+        if (reply.isEmpty() && is_answer(fields))
+        {
+            reply = fields;
+            event_loop.quit();
+        }
+    });
+
+    if (timeout_ms >= 0)
+        QTimer::singleShot(timeout_ms, &event_loop, &QEventLoop::quit);
+
+    if (process->write(request) >= 0)
+        event_loop.exec();
+
+    answer_waiters.erase(waiter);
+    if (process)
+        QObject::disconnect(stop_conn);
+
+    return reply;
+}
+
+void mp::SSHFSMounts::drop_disconnected_mount(const std::string& instance, Process* process,
+                                              const std::string& target_path)
+{
+    auto server = server_processes.find(instance);
+    if (server == server_processes.end() || server->second.process.get() != process ||
+        server->second.source_paths.erase(target_path) == 0)
+        return;
+
+    mpl::log(mpl::Level::warning, category,
+             fmt::format("Mount '{}' in instance \"{}\" has stopped unexpectedly", target_path, instance));
+    if (server->second.source_paths.empty())
+    {
+        stop_server(server);
+    }
+    else
+    {
+        process->write("unmount " + encode(target_path) + "\n"); // for sshfs_server to let go of it too
+        update_policy(server->second);
+    }
+}
+
+void mp::SSHFSMounts::stop_server(std::unordered_map<std::string, ServerProcess>::iterator server)
+{
+    auto& process = server->second.process;
+    process->terminate(); // TODO - if non-responsive, then kill()
+
+    // Kept around until it finishes
+    auto process_ptr = process.get();
+    stopping_processes[process_ptr] = std::move(process);
+    server_processes.erase(server);
 }
 
 bool mp::SSHFSMounts::stop_mount(const std::string& instance, const std::string& path)
 {
-    auto sshfs_mount_it = mount_processes.find(instance);
-    if (sshfs_mount_it == mount_processes.end())
+    auto server = server_processes.find(instance);
+    if (server == server_processes.end())
     {
         return false;
     }
 
-    auto& sshfs_mount_map = sshfs_mount_it->second;
-    auto map_entry = sshfs_mount_map.find(path);
-    if (map_entry != sshfs_mount_map.end())
+    auto& source_paths = server->second.source_paths;
+    if (source_paths.erase(path) == 0)
     {
-        auto& sshfs_mount = map_entry->second;
-        mpl::log(mpl::Level::info, category,
-                 fmt::format("stopping sshfs_server for \"{}\" serving '{}'", instance, path));
-        sshfs_mount->terminate(); // TODO - if non-responsive, then kill()
-        return true;
+        return false;
     }
-    return false;
+
+    mpl::log(mpl::Level::info, category, fmt::format("stopping sshfs_server for \"{}\" serving '{}'", instance, path));
+    if (source_paths.empty())
+    {
+        stop_server(server);
+    }
+    else
+    {
+        server->second.process->write("unmount " + encode(path) + "\n");
+        update_policy(server->second);
+    }
+
+    return true;
 }
 
 void mp::SSHFSMounts::stop_all_mounts_for_instance(const std::string& instance)
 {
-    auto mounts_it = mount_processes.find(instance);
-    if (mounts_it == mount_processes.end() || mounts_it->second.empty())
+    auto server = server_processes.find(instance);
+    if (server == server_processes.end() || server->second.source_paths.empty())
     {
         mpl::log(mpl::Level::debug, category, fmt::format("No mounts to stop for instance \"{}\"", instance));
     }
     else
     {
-        for (auto& sshfs_mount : mounts_it->second)
+        for (const auto& mount : server->second.source_paths)
         {
             mpl::log(mpl::Level::debug, category,
-                     fmt::format("Stopping mount '{}' in instance \"{}\"", sshfs_mount.first, instance));
-            sshfs_mount.second->terminate();
+                     fmt::format("Stopping mount '{}' in instance \"{}\"", mount.first, instance));
         }
     }
-    mount_processes[instance].clear();
+
+    if (server != server_processes.end())
+    {
+        stop_server(server);
+    }
+}
+
+std::unordered_map<std::string, mp::MountStats::Snapshot> mp::SSHFSMounts::mount_stats(const std::string& instance)
+{
+    std::unordered_map<std::string, MountStats::Snapshot> stats;
+
+    auto server = server_processes.find(instance);
+    if (server == server_processes.end())
+        return stats;
+
+    const auto reply = request_and_wait(
+        server->second.process.get(), "stats\n",
+        [](const QList<QByteArray>& fields) { return fields.size() == 2 && fields[0] == "Stats"; },
+        stats_timeout_ms);
+    if (reply.isEmpty())
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot get the stats of mounts in \"{}\"", instance));
+        return stats;
+    }
+
+    const auto json = QJsonDocument::fromJson(QByteArray::fromPercentEncoding(reply[1])).object();
+    for (auto mount = json.constBegin(); mount != json.constEnd(); ++mount)
+        stats[mount.key().toStdString()] = MountStats::from_json(mount.value().toObject());
+
+    return stats;
 }
 
 bool mp::SSHFSMounts::has_instance_already_mounted(const std::string& instance, const std::string& path) const
 {
-    auto entry = mount_processes.find(instance);
-    if (entry != mount_processes.end() && entry->second.find(path) != entry->second.end())
+    auto entry = server_processes.find(instance);
+    if (entry != server_processes.end() && entry->second.source_paths.find(path) != entry->second.source_paths.end())
     {
         return true;
     }
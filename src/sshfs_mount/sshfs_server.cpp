@@ -15,18 +15,26 @@
  *
  */
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStringList>
 
 #include "../ssh/ssh_client_key_provider.h" // FIXME
+#include <multipass/constants.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
+#include <multipass/id_mappings.h>
 #include <multipass/logging/log.h>
 #include <multipass/logging/standard_logger.h>
 #include <multipass/platform.h>
 #include <multipass/ssh/ssh_session.h>
+#include <multipass/sshfs_mount/shared_ssh_session.h>
 #include <multipass/sshfs_mount/sshfs_mount.h>
 
 namespace mp = multipass;
@@ -36,34 +44,139 @@ using namespace std;
 
 namespace
 {
-unordered_map<int, int> deserialise_id_map(const char* in)
+int int_from_env(const char* name)
 {
-    unordered_map<int, int> id_map;
-    QString input(in);
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-    auto maps = input.split(',', Qt::SkipEmptyParts);
-#else
-    auto maps = input.split(',', QString::SkipEmptyParts);
-#endif
-    for (auto map : maps)
+    bool ok{false};
+    const auto value = qEnvironmentVariableIntValue(name, &ok);
+    return ok ? std::max(value, 0) : 0;
+}
+
+// Fields of the lines exchanged with multipassd are percent-encoded, so they can hold spaces and newlines
+string encode(const string& field)
+{
+    return QByteArray::fromStdString(field).toPercentEncoding().toStdString();
+}
+
+string decode(const QByteArray& field)
+{
+    return QByteArray::fromPercentEncoding(field).toStdString();
+}
+
+// Mounts report going away from their own threads, so lines are written whole, one at a time
+void answer(const string& line)
+{
+    static mutex output_mutex;
+    lock_guard<mutex> lock{output_mutex};
+    cout << line << endl;
+}
+
+// All the mounts of one instance, each served over its own channel of the same SSH session
+class Mounts
+{
+public:
+    explicit Mounts(mp::SSHSession&& session) : shared_session{make_shared<mp::SharedSSHSession>(move(session))}
+    {
+    }
+
+    void add(const string& source_path, const string& target_path, const mp::IdMappings& uid_map,
+             const mp::IdMappings& gid_map)
+    {
+        auto mount = make_unique<mp::SshfsMount>(
+            shared_session, source_path, target_path, gid_map, uid_map, int_from_env(mp::sftp_workers_env_var),
+            int_from_env(mp::sftp_write_buffer_env_var), int_from_env(mp::sftp_attribute_cache_env_var) > 0,
+            [target_path] { answer("Disconnected " + encode(target_path)); });
+
+        lock_guard<mutex> lock{mounts_mutex};
+        mounts[target_path] = move(mount);
+    }
+
+    void remove(const string& target_path)
+    {
+        unique_ptr<mp::SshfsMount> mount;
+        {
+            lock_guard<mutex> lock{mounts_mutex};
+            auto entry = mounts.find(target_path);
+            if (entry == mounts.end())
+                return;
+
+            mount = move(entry->second);
+            mounts.erase(entry);
+        }
+
+        mount->stop();
+    }
+
+    QJsonObject stats()
     {
-        auto ids = map.split(":");
-        if (ids.count() != 2)
+        QJsonObject stats;
+
+        lock_guard<mutex> lock{mounts_mutex};
+        for (const auto& mount : mounts)
+            stats.insert(QString::fromStdString(mount.first), mp::MountStats::to_json(mount.second->stats()));
+
+        return stats;
+    }
+
+    void stop_all()
+    {
+        lock_guard<mutex> lock{mounts_mutex};
+        for (auto& mount : mounts)
+            mount.second->stop();
+    }
+
+private:
+    const shared_ptr<mp::SharedSSHSession> shared_session;
+    mutex mounts_mutex;
+    unordered_map<string, unique_ptr<mp::SshfsMount>> mounts;
+};
+
+// multipassd asks for more mounts of the same instance on stdin, one request per line:
+//   mount <source> <target> <uid map> <gid map>, answered with Connected <target> or Failed <target> <code> <error>
+//   unmount <target>, answered with Stopped <target>
+//   stats, answered with Stats <JSON object of the stats of every mount, keyed by target>
+// Any mount that ends by itself, such as when sshfs is unmounted in the instance, is reported with
+// Disconnected <target>
+void serve_requests(Mounts& mounts)
+{
+    string line;
+    while (getline(cin, line))
+    {
+        const auto fields = QByteArray::fromStdString(line).split(' ');
+        if (fields.size() == 5 && fields[0] == "mount")
+        {
+            const auto target_path = decode(fields[2]);
+            try
+            {
+                mounts.add(decode(fields[1]), target_path,
+                           mp::IdMappings::from_string(QString::fromStdString(decode(fields[3]))),
+                           mp::IdMappings::from_string(QString::fromStdString(decode(fields[4]))));
+                answer("Connected " + encode(target_path));
+            }
+            catch (const mp::SSHFSMissingError&)
+            {
+                answer("Failed " + encode(target_path) + " 9 " + encode("SSHFS was not found"));
+            }
+            catch (const exception& e)
+            {
+                answer("Failed " + encode(target_path) + " 1 " + encode(e.what()));
+            }
+        }
+        else if (fields.size() == 2 && fields[0] == "unmount")
+        {
+            const auto target_path = decode(fields[1]);
+            mounts.remove(target_path);
+            answer("Stopped " + encode(target_path));
+        }
+        else if (fields.size() == 1 && fields[0] == "stats")
         {
-            cerr << "Incorrect ID mapping syntax";
-            continue;
+            const auto stats = QJsonDocument{mounts.stats()}.toJson(QJsonDocument::Compact).toStdString();
+            answer("Stats " + encode(stats));
         }
-        bool ok1, ok2;
-        int from = ids.first().toInt(&ok1);
-        int to = ids.last().toInt(&ok2);
-        if (!ok1 || !ok2)
+        else
         {
-            cerr << "Incorrect ID mapping ids found, ignored" << endl;
-            continue;
+            cerr << "Unknown request: " << line << endl;
         }
-        id_map.insert({from, to});
     }
-    return id_map;
 }
 } // namespace
 
@@ -87,8 +200,6 @@ int main(int argc, char* argv[])
     const auto username = string(argv[3]);
     const auto source_path = string(argv[4]);
     const auto target_path = string(argv[5]);
-    const unordered_map<int, int> uid_map = deserialise_id_map(argv[6]);
-    const unordered_map<int, int> gid_map = deserialise_id_map(argv[7]);
 
     auto logger = std::make_shared<mpl::StandardLogger>(mpl::Level::error); // QUESTION - how to pass verbosity level?
     mpl::set_logger(logger);
@@ -97,14 +208,21 @@ int main(int argc, char* argv[])
     {
         auto watchdog = mpp::make_quit_watchdog(); // called while there is only one thread
 
-        mp::SSHSession session{host, port, username, mp::SSHClientKeyProvider{priv_key_blob}};
-        mp::SshfsMount sshfs_mount(move(session), source_path, target_path, gid_map, uid_map);
+        const auto uid_map = mp::IdMappings::from_string(argv[6]);
+        const auto gid_map = mp::IdMappings::from_string(argv[7]);
+
+        Mounts mounts{mp::SSHSession{host, port, username, mp::SSHClientKeyProvider{priv_key_blob}}};
+        mounts.add(source_path, target_path, uid_map, gid_map);
+        answer("Connected " + encode(target_path));
+
+        // Blocks on stdin until multipassd goes away, so it is never joined
+        thread{[&mounts] { serve_requests(mounts); }}.detach();
 
-        // ssh lives on its own thread, use this thread to listen for quit signal
+        // ssh lives on its own threads, use this thread to listen for quit signal
         if (int sig = watchdog())
-            cout << "Received signal " << sig << ". Stopping" << endl;
+            answer("Received signal " + to_string(sig) + ". Stopping");
 
-        sshfs_mount.stop();
+        mounts.stop_all();
         exit(0);
     }
     catch (const mp::SSHFSMissingError&)
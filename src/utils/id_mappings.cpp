@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/cli/client_platform.h>
+#include <multipass/format.h>
+#include <multipass/id_mappings.h>
+
+#include <QStringList>
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+long long end_of(long long first, int count)
+{
+    return first + count;
+}
+
+// Whether b picks up right where a leaves off, so that both can be one range
+bool continues(const mp::IdMappings::Range& a, const mp::IdMappings::Range& b)
+{
+    if (end_of(a.host_id, a.count) != b.host_id)
+        return false;
+
+    if (a.instance_id == mp::default_id || b.instance_id == mp::default_id)
+        return a.instance_id == b.instance_id;
+
+    return end_of(a.instance_id, a.count) == b.instance_id;
+}
+
+bool comes_before(int host_id, const mp::IdMappings::Range& range)
+{
+    return host_id < range.host_id;
+}
+
+int to_id(const QString& in, const QString& entry)
+{
+    bool ok{false};
+    const auto id = in.toInt(&ok);
+    if (!ok)
+        throw std::invalid_argument(fmt::format("invalid ID mapping '{}'", entry.toStdString()));
+
+    return id;
+}
+} // namespace
+
+mp::IdMappings::IdMappings(std::initializer_list<std::pair<int, int>> id_map)
+    : IdMappings{std::unordered_map<int, int>{id_map.begin(), id_map.end()}}
+{
+}
+
+mp::IdMappings::IdMappings(const std::unordered_map<int, int>& id_map)
+{
+    // Adding in order only ever appends or extends the last range
+    std::vector<std::pair<int, int>> entries{id_map.begin(), id_map.end()};
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto& entry : entries)
+        add(entry.first, entry.second);
+}
+
+void mp::IdMappings::add(int host_id, int instance_id, int count)
+{
+    constexpr long long max_id = std::numeric_limits<int>::max();
+    if (count < 1 || host_id < 0 || end_of(host_id, count) - 1 > max_id ||
+        (instance_id != default_id && (instance_id < 0 || end_of(instance_id, count) - 1 > max_id)))
+        throw std::invalid_argument(
+            fmt::format("invalid mapping of {} IDs from host ID {} to instance ID {}", count, host_id, instance_id));
+
+    auto next = std::upper_bound(sorted_ranges.begin(), sorted_ranges.end(), host_id, comes_before);
+    if ((next != sorted_ranges.begin() && end_of(std::prev(next)->host_id, std::prev(next)->count) > host_id) ||
+        (next != sorted_ranges.end() && end_of(host_id, count) > next->host_id))
+        throw std::invalid_argument(fmt::format("ID mappings overlap at host ID {}", host_id));
+
+    auto range = sorted_ranges.insert(next, {host_id, instance_id, count});
+
+    if (std::next(range) != sorted_ranges.end() && continues(*range, *std::next(range)))
+    {
+        range->count += std::next(range)->count;
+        sorted_ranges.erase(std::next(range));
+    }
+
+    if (range != sorted_ranges.begin() && continues(*std::prev(range), *range))
+    {
+        std::prev(range)->count += range->count;
+        sorted_ranges.erase(range);
+    }
+}
+
+mp::optional<int> mp::IdMappings::instance_id_for(int host_id) const
+{
+    auto next = std::upper_bound(sorted_ranges.begin(), sorted_ranges.end(), host_id, comes_before);
+    if (next == sorted_ranges.begin())
+        return nullopt;
+
+    const auto& range = *std::prev(next);
+    if (host_id >= end_of(range.host_id, range.count))
+        return nullopt;
+
+    if (range.instance_id == default_id)
+        return default_id;
+
+    return range.instance_id + (host_id - range.host_id);
+}
+
+const std::vector<mp::IdMappings::Range>& mp::IdMappings::ranges() const
+{
+    return sorted_ranges;
+}
+
+bool mp::IdMappings::empty() const
+{
+    return sorted_ranges.empty();
+}
+
+QString mp::IdMappings::to_string() const
+{
+    QStringList entries;
+    for (const auto& range : sorted_ranges)
+    {
+        if (range.count == 1)
+            entries << QString("%1:%2").arg(range.host_id).arg(range.instance_id);
+        else
+            entries << QString("%1-%2:%3")
+                           .arg(range.host_id)
+                           .arg(range.host_id + range.count - 1)
+                           .arg(range.instance_id);
+    }
+
+    return entries.join(',');
+}
+
+mp::IdMappings mp::IdMappings::from_string(const QString& in)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    const auto entries = in.split(',', Qt::SkipEmptyParts);
+#else
+    const auto entries = in.split(',', QString::SkipEmptyParts);
+#endif
+
+    IdMappings mappings;
+    for (const auto& entry : entries)
+    {
+        const auto ids = entry.split(':');
+        if (ids.size() != 2)
+            throw std::invalid_argument(fmt::format("invalid ID mapping '{}'", entry.toStdString()));
+
+        const auto host_ids = ids[0].split('-');
+        if (host_ids.size() > 2)
+            throw std::invalid_argument(fmt::format("invalid ID mapping '{}'", entry.toStdString()));
+
+        const auto first = to_id(host_ids.first(), entry);
+        const auto last = to_id(host_ids.last(), entry);
+        const auto count = end_of(last, 1) - first;
+        if (count < 1 || count > std::numeric_limits<int>::max())
+            throw std::invalid_argument(fmt::format("invalid ID mapping '{}'", entry.toStdString()));
+
+        mappings.add(first, to_id(ids[1], entry), static_cast<int>(count));
+    }
+
+    return mappings;
+}
+
+std::shared_ptr<const mp::IdMappings> mp::IdMappings::intern(const IdMappings& mappings)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<const IdMappings>> tables;
+
+    const auto key = mappings.to_string().toStdString();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto table = tables.find(key);
+    if (table != tables.end())
+    {
+        if (auto shared = table->second.lock())
+            return shared;
+    }
+
+    for (auto entry = tables.begin(); entry != tables.end();)
+        entry = entry->second.expired() ? tables.erase(entry) : std::next(entry);
+
+    auto shared = std::make_shared<const IdMappings>(mappings);
+    tables[key] = shared;
+
+    return shared;
+}
+
+bool mp::operator==(const IdMappings& a, const IdMappings& b)
+{
+    return std::equal(a.sorted_ranges.begin(), a.sorted_ranges.end(), b.sorted_ranges.begin(), b.sorted_ranges.end(),
+                      [](const IdMappings::Range& x, const IdMappings::Range& y) {
+                          return x.host_id == y.host_id && x.instance_id == y.instance_id && x.count == y.count;
+                      });
+}
+
+bool mp::operator!=(const IdMappings& a, const IdMappings& b)
+{
+    return !(a == b);
+}
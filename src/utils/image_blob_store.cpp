@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/image_blob_store.h>
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/vm_image_vault.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "image blob store";
+
+bool is_sha256(const QString& hash)
+{
+    static const QRegularExpression sha256_regex{"^[0-9a-f]{64}$"};
+    return sha256_regex.match(hash).hasMatch();
+}
+
+bool hard_link(const QString& source_path, const QString& link_path)
+{
+#ifdef Q_OS_UNIX
+    return ::link(QFile::encodeName(source_path).constData(), QFile::encodeName(link_path).constData()) == 0;
+#else
+    Q_UNUSED(source_path);
+    Q_UNUSED(link_path);
+    return false;
+#endif
+}
+
+int link_count(const QString& path)
+{
+#ifdef Q_OS_UNIX
+    struct stat file_status;
+    if (::stat(QFile::encodeName(path).constData(), &file_status) != 0)
+        return 0;
+
+    return static_cast<int>(file_status.st_nlink);
+#else
+    return QFileInfo::exists(path) ? 1 : 0;
+#endif
+}
+
+// Falls back to copying, preferably sharing the data, where hard links cannot be made, e.g. across file systems
+void link_or_copy(const QString& source_path, const QString& destination_path)
+{
+    if (!hard_link(source_path, destination_path) && !mp::vault::reflink_copy(source_path, destination_path))
+        mp::vault::sparse_copy(source_path, destination_path);
+}
+
+// Marks the blob as in use, for pruning to go by
+void touch(const QString& path)
+{
+    QFile file{path};
+    if (file.open(QIODevice::ReadOnly))
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+}
+} // namespace
+
+mp::vault::ImageBlobStore::ImageBlobStore(const mp::Path& store_path) : store_dir{store_path}
+{
+}
+
+bool mp::vault::ImageBlobStore::fetch(const QString& hash, const mp::Path& image_path) const
+{
+    const auto blob_path = blob_path_for(hash);
+    if (!is_sha256(hash) || !QFile::exists(blob_path))
+        return false;
+
+    try
+    {
+        QFile::remove(image_path);
+        link_or_copy(blob_path, image_path);
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot use cached image {}: {}", hash, e.what()));
+        QFile::remove(image_path);
+        return false;
+    }
+
+    touch(blob_path);
+    mpl::log(mpl::Level::debug, category, fmt::format("Using cached image {}", hash));
+
+    return true;
+}
+
+void mp::vault::ImageBlobStore::add(const QString& hash, const mp::Path& image_path)
+{
+    const auto blob_path = blob_path_for(hash);
+    if (!is_sha256(hash) || QFile::exists(blob_path))
+        return;
+
+    // Put the blob in place in one go, so that a half-copied image never passes for one
+    const auto partial_blob_path = blob_path + ".partial";
+    try
+    {
+        if (!store_dir.mkpath("."))
+            throw std::runtime_error(fmt::format("failed to create {}", store_dir.path()));
+
+        QFile::remove(partial_blob_path);
+        link_or_copy(image_path, partial_blob_path);
+        if (!QFile::rename(partial_blob_path, blob_path))
+            throw std::runtime_error(fmt::format("failed to rename {}", partial_blob_path));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot cache image {}: {}", hash, e.what()));
+        QFile::remove(partial_blob_path);
+    }
+}
+
+int mp::vault::ImageBlobStore::reference_count(const QString& hash) const
+{
+    return std::max(link_count(blob_path_for(hash)) - 1, 0);
+}
+
+void mp::vault::ImageBlobStore::prune(const mp::days& days_to_expire)
+{
+    const auto expiry_date = QDateTime::currentDateTime().addDays(-days_to_expire.count());
+
+    for (const auto& entry : store_dir.entryInfoList(QDir::Files))
+    {
+        if (!is_sha256(entry.fileName()) || reference_count(entry.fileName()) > 0 ||
+            entry.lastModified() > expiry_date)
+            continue;
+
+        mpl::log(mpl::Level::info, category, fmt::format("Removing unused cached image {}", entry.fileName()));
+        QFile::remove(entry.absoluteFilePath());
+    }
+}
+
+QString mp::vault::ImageBlobStore::blob_path_for(const QString& hash) const
+{
+    return store_dir.filePath(hash);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/image_download_pipeline.h>
+
+#include <multipass/format.h>
+#include <multipass/sparse_file.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+namespace
+{
+// Chunks are however much the network hands over at a time, usually some tens of KiB
+constexpr auto max_queued_chunks = 256u;
+} // namespace
+
+bool mp::vault::ImageDownloadPipeline::ChunkQueue::push(const QByteArray& chunk)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    cv.wait(lock, [this] { return closed || chunks.size() < max_queued_chunks; });
+    if (closed)
+        return false;
+
+    chunks.push_back(chunk);
+    cv.notify_all();
+
+    return true;
+}
+
+bool mp::vault::ImageDownloadPipeline::ChunkQueue::pop(QByteArray& chunk)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    cv.wait(lock, [this] { return closed || !chunks.empty(); });
+    if (chunks.empty())
+        return false;
+
+    chunk = chunks.front();
+    chunks.pop_front();
+    cv.notify_all();
+
+    return true;
+}
+
+void mp::vault::ImageDownloadPipeline::ChunkQueue::close()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    closed = true;
+    cv.notify_all();
+}
+
+mp::vault::ImageDownloadPipeline::ImageDownloadPipeline(const Path& image_path, const QString& image_hash,
+                                                        bool xz_compressed)
+    : image_file{image_path},
+      image_hash{image_hash},
+      xz_decoder{xz_compressed ? std::make_unique<XzStreamDecoder>() : nullptr}
+{
+    if (!image_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", image_path));
+
+    if (!image_hash.isEmpty())
+        hash_thread = std::make_unique<AutoJoinThread>([this] { hash_data(); });
+    write_thread = std::make_unique<AutoJoinThread>([this] { write_data(); });
+}
+
+mp::vault::ImageDownloadPipeline::~ImageDownloadPipeline()
+{
+    stop();
+}
+
+bool mp::vault::ImageDownloadPipeline::push(const QByteArray& data)
+{
+    // QByteArray is implicitly shared, so both queues hold the same copy of the data
+    if (hash_thread && !hash_queue.push(data))
+        return false;
+
+    return write_queue.push(data) && !failed;
+}
+
+void mp::vault::ImageDownloadPipeline::throw_if_failed()
+{
+    if (failed)
+        std::rethrow_exception(error);
+}
+
+void mp::vault::ImageDownloadPipeline::finish()
+{
+    stop();
+    throw_if_failed();
+
+    if (xz_decoder && !stream_ended)
+        throw std::runtime_error("xz file is corrupt");
+
+    if (!finish_sparse_write(image_file) || !image_file.flush())
+        throw std::runtime_error(fmt::format("failed to write {}: {}", image_file.fileName(), image_file.errorString()));
+    image_file.close();
+
+    if (!image_hash.isEmpty() && hash.result().toHex() != image_hash)
+        throw std::runtime_error("Downloaded image hash does not match");
+}
+
+void mp::vault::ImageDownloadPipeline::hash_data()
+{
+    QByteArray chunk;
+    while (hash_queue.pop(chunk))
+        hash.addData(chunk);
+}
+
+void mp::vault::ImageDownloadPipeline::write_data()
+{
+    try
+    {
+        QByteArray chunk;
+        while (write_queue.pop(chunk))
+        {
+            if (!xz_decoder)
+            {
+                if (!write_sparse(image_file, chunk.constData(), chunk.size()))
+                    throw std::runtime_error(
+                        fmt::format("failed to write {}: {}", image_file.fileName(), image_file.errorString()));
+            }
+            else if (!stream_ended)
+            {
+                stream_ended = !xz_decoder->decode(chunk.constData(), chunk.size(), image_file);
+            }
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+        failed = true;
+
+        hash_queue.close();
+        write_queue.close();
+    }
+}
+
+void mp::vault::ImageDownloadPipeline::stop()
+{
+    hash_queue.close();
+    write_queue.close();
+
+    hash_thread.reset();
+    write_thread.reset();
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/qcow2_image.h>
+
+#include <multipass/format.h>
+#include <multipass/vm_image_vault.h>
+
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+
+namespace
+{
+// See docs/interop/qcow2.txt in the QEMU sources for the format
+constexpr auto qcow2_magic = "QFI\xfb";
+constexpr auto qcow2_v2_header_length = 72;
+constexpr auto qcow2_v3_header_length = 104;
+constexpr auto qcow2_cluster_bits = 16;
+constexpr qint64 qcow2_cluster_size = Q_INT64_C(1) << qcow2_cluster_bits;
+constexpr auto qcow2_refcount_order = 4; // 16 bit refcounts, like qemu-img makes
+constexpr quint64 qcow2_copied_flag = Q_UINT64_C(1) << 63;
+
+struct Qcow2Header
+{
+    quint32 version;
+    quint32 cluster_bits;
+    quint64 size;
+    quint32 crypt_method;
+    quint32 l1_size;
+    quint64 l1_table_offset;
+    quint32 nb_snapshots;
+    quint64 incompatible_features;
+};
+
+mp::optional<Qcow2Header> parse_qcow2_header(const QByteArray& data)
+{
+    if (data.size() < qcow2_v2_header_length || !data.startsWith(qcow2_magic))
+        return mp::nullopt;
+
+    const auto version = qFromBigEndian<quint32>(data.constData() + 4);
+    if (version != 2 && version != 3)
+        return mp::nullopt;
+
+    return Qcow2Header{version,
+                       qFromBigEndian<quint32>(data.constData() + 20),
+                       qFromBigEndian<quint64>(data.constData() + 24),
+                       qFromBigEndian<quint32>(data.constData() + 32),
+                       qFromBigEndian<quint32>(data.constData() + 36),
+                       qFromBigEndian<quint64>(data.constData() + 40),
+                       qFromBigEndian<quint32>(data.constData() + 60),
+                       version == 3 && data.size() >= 80 ? qFromBigEndian<quint64>(data.constData() + 72) : 0};
+}
+
+// The formats besides qcow2 that qemu-img would recognize at the start of an image; anything else is raw to it
+bool has_other_format_magic(const QByteArray& start)
+{
+    static const std::vector<QByteArray> magics{QByteArray{"QED\0", 4},
+                                                "KDMV",
+                                                "COWD",
+                                                "# Disk DescriptorFile",
+                                                "vhdxfile",
+                                                "conectix",
+                                                QByteArray{"LUKS\xba\xbe", 6},
+                                                "WithoutFreeSpace",
+                                                "WithouFreSpacExt",
+                                                "Bochs Virtual HD Image",
+                                                "#!/bin/sh\n#V2.0 Format\n"};
+    static const QByteArray vdi_magic{"\x7f\x10\xda\xbe", 4}; // at offset 64
+
+    const auto at_start = [&start](const auto& magic) { return start.startsWith(magic); };
+
+    return std::any_of(magics.cbegin(), magics.cend(), at_start) || start.mid(64, vdi_magic.size()) == vdi_magic;
+}
+
+template <typename T>
+void write_big_endian(QFile& file, qint64 offset, T value)
+{
+    char data[sizeof(T)];
+    qToBigEndian<T>(value, data);
+
+    if (!file.seek(offset) || file.write(data, sizeof(T)) != sizeof(T))
+        throw std::runtime_error(fmt::format("failed to write {}: {}", file.fileName(), file.errorString()));
+}
+
+void write_at(QFile& file, qint64 offset, const QByteArray& data)
+{
+    if (!file.seek(offset) || file.write(data) != data.size())
+        throw std::runtime_error(fmt::format("failed to write {}: {}", file.fileName(), file.errorString()));
+}
+
+qint64 clusters_for(qint64 bytes)
+{
+    return (bytes + qcow2_cluster_size - 1) / qcow2_cluster_size;
+}
+} // namespace
+
+mp::optional<mp::vault::ImageInfo> mp::vault::read_image_info(const mp::Path& image_path)
+{
+    QFile image_file{image_path};
+    if (!image_file.open(QIODevice::ReadOnly))
+        return mp::nullopt;
+
+    const auto start = image_file.read(512);
+    if (start.startsWith(qcow2_magic))
+    {
+        const auto header = parse_qcow2_header(start);
+        if (!header)
+            return mp::nullopt;
+
+        return ImageInfo{"qcow2", static_cast<qint64>(header->size), backing_file_of(image_path)};
+    }
+
+    if (has_other_format_magic(start))
+        return mp::nullopt;
+
+    return ImageInfo{"raw", image_file.size(), {}};
+}
+
+bool mp::vault::grow_image(const mp::Path& image_path, qint64 size)
+{
+    const auto info = read_image_info(image_path);
+    if (!info || size < info->virtual_size)
+        return false; // shrinking is left to qemu-img too, which refuses it
+
+    if (size == info->virtual_size)
+        return true;
+
+    QFile image_file{image_path};
+    if (!image_file.open(QIODevice::ReadWrite))
+        throw std::runtime_error(fmt::format("failed to open {}: {}", image_path, image_file.errorString()));
+
+    if (info->format == "raw")
+    {
+        if (!image_file.resize(size))
+            throw std::runtime_error(fmt::format("failed to resize {}: {}", image_path, image_file.errorString()));
+        return true;
+    }
+
+    // Images with snapshots, encryption or features we do not know about are better dealt with by qemu-img
+    const auto header = parse_qcow2_header(image_file.read(qcow2_v3_header_length));
+    if (!header || header->crypt_method || header->nb_snapshots || header->incompatible_features ||
+        header->cluster_bits < 9 || header->cluster_bits > 21)
+        return false;
+
+    const auto cluster_size = Q_INT64_C(1) << header->cluster_bits;
+    const auto l2_table_coverage = cluster_size * (cluster_size / 8);
+    const auto l1_size = (size + l2_table_coverage - 1) / l2_table_coverage;
+    if (l1_size > header->l1_size)
+    {
+        // The L1 table can grow into the rest of the last cluster it takes, as long as nothing else is there
+        const auto l1_bytes = static_cast<qint64>(header->l1_size) * 8;
+        const auto l1_room = (l1_bytes + cluster_size - 1) / cluster_size * cluster_size;
+        if (l1_size * 8 > l1_room || !image_file.seek(header->l1_table_offset + l1_bytes))
+            return false;
+
+        const auto rest = image_file.read(l1_size * 8 - l1_bytes);
+        if (rest.size() != l1_size * 8 - l1_bytes || rest.count('\0') != rest.size())
+            return false;
+
+        write_big_endian<quint32>(image_file, 36, l1_size);
+    }
+
+    write_big_endian<quint64>(image_file, 24, size);
+    if (!image_file.flush())
+        throw std::runtime_error(fmt::format("failed to write {}: {}", image_path, image_file.errorString()));
+
+    return true;
+}
+
+void mp::vault::convert_raw_to_qcow2(const mp::Path& raw_path, const mp::Path& qcow2_path)
+{
+    QFile raw_file{raw_path};
+    if (!raw_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        throw std::runtime_error(fmt::format("failed to open {} for reading", raw_path));
+
+    QFile qcow2_file{qcow2_path};
+    if (!qcow2_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", qcow2_path));
+
+    const auto size = raw_file.size();
+    const auto l2_entries = qcow2_cluster_size / 8;
+    const auto guest_clusters = clusters_for(size);
+    const auto l1_size = (guest_clusters + l2_entries - 1) / l2_entries;
+    const auto l1_clusters = std::max(Q_INT64_C(1), clusters_for(l1_size * 8));
+
+    // Room is made up front for the refcounts of every cluster the image could end up with, so that data and L2 tables
+    // can go straight after the metadata, in the order they come
+    const auto refcounts_per_block = qcow2_cluster_size * 8 / (1 << qcow2_refcount_order);
+    qint64 refcount_blocks{0}, refcount_table_clusters{0};
+    while (true)
+    {
+        const auto max_clusters =
+            1 + refcount_table_clusters + refcount_blocks + l1_clusters + l1_size + guest_clusters;
+        const auto blocks = (max_clusters + refcounts_per_block - 1) / refcounts_per_block;
+        const auto table_clusters = clusters_for(blocks * 8);
+        if (blocks == refcount_blocks && table_clusters == refcount_table_clusters)
+            break;
+
+        refcount_blocks = blocks;
+        refcount_table_clusters = table_clusters;
+    }
+
+    const auto refcount_table_offset = qcow2_cluster_size;
+    const auto refcount_blocks_offset = refcount_table_offset + refcount_table_clusters * qcow2_cluster_size;
+    const auto l1_table_offset = refcount_blocks_offset + refcount_blocks * qcow2_cluster_size;
+    auto next_offset = l1_table_offset + l1_clusters * qcow2_cluster_size;
+
+    QByteArray l1_table(l1_clusters * qcow2_cluster_size, '\0');
+    std::vector<QByteArray> l2_tables(l1_size);
+    std::vector<qint64> l2_table_offsets(l1_size);
+
+    auto convert_clusters = [&](qint64 first_cluster, qint64 end_cluster) {
+        if (!raw_file.seek(first_cluster * qcow2_cluster_size))
+            throw std::runtime_error(fmt::format("failed to seek in {}", raw_path));
+
+        for (auto cluster = first_cluster; cluster < end_cluster; ++cluster)
+        {
+            auto data = raw_file.read(qcow2_cluster_size);
+            if (data.isEmpty() && raw_file.error() != QFileDevice::NoError)
+                throw std::runtime_error(fmt::format("failed to read {}: {}", raw_path, raw_file.errorString()));
+
+            if (data.count('\0') == data.size())
+                continue;
+
+            data.append(QByteArray(qcow2_cluster_size - data.size(), '\0')); // the last one may be partial
+
+            const auto l1_index = cluster / l2_entries;
+            auto& l2_table = l2_tables[l1_index];
+            if (l2_table.isEmpty())
+            {
+                l2_table = QByteArray(qcow2_cluster_size, '\0');
+                l2_table_offsets[l1_index] = next_offset;
+                qToBigEndian<quint64>(next_offset | qcow2_copied_flag, l1_table.data() + l1_index * 8);
+                next_offset += qcow2_cluster_size;
+            }
+
+            qToBigEndian<quint64>(next_offset | qcow2_copied_flag, l2_table.data() + (cluster % l2_entries) * 8);
+            write_at(qcow2_file, next_offset, data);
+            next_offset += qcow2_cluster_size;
+        }
+    };
+
+    bool converted{false};
+#if defined(Q_OS_UNIX) && defined(SEEK_DATA)
+    // Only visit the extents that hold data, where the file system can tell them apart from holes
+    const auto fd = raw_file.handle();
+    auto data_start = ::lseek(fd, 0, SEEK_DATA);
+    if (data_start >= 0 || errno == ENXIO)
+    {
+        while (data_start >= 0 && data_start < size)
+        {
+            auto data_end = ::lseek(fd, data_start, SEEK_HOLE);
+            if (data_end < 0)
+                data_end = size;
+
+            convert_clusters(data_start / qcow2_cluster_size, clusters_for(data_end));
+            data_start = ::lseek(fd, clusters_for(data_end) * qcow2_cluster_size, SEEK_DATA);
+        }
+        converted = true;
+    }
+#endif
+
+    if (!converted)
+        convert_clusters(0, guest_clusters);
+
+    for (qint64 i = 0; i < l1_size; ++i)
+        if (!l2_tables[i].isEmpty())
+            write_at(qcow2_file, l2_table_offsets[i], l2_tables[i]);
+
+    write_at(qcow2_file, l1_table_offset, l1_table);
+
+    // Every cluster up to the end of the file is in use once, including the reserved refcount blocks
+    const auto used_clusters = next_offset / qcow2_cluster_size;
+    QByteArray refcount_table(refcount_table_clusters * qcow2_cluster_size, '\0');
+    QByteArray refcounts(refcount_blocks * qcow2_cluster_size, '\0');
+    for (qint64 block = 0; block < refcount_blocks; ++block)
+    {
+        const auto offset = static_cast<quint64>(refcount_blocks_offset + block * qcow2_cluster_size);
+        qToBigEndian<quint64>(offset, refcount_table.data() + block * 8);
+    }
+    for (qint64 cluster = 0; cluster < used_clusters; ++cluster)
+        qToBigEndian<quint16>(1, refcounts.data() + cluster * 2);
+
+    write_at(qcow2_file, refcount_table_offset, refcount_table);
+    write_at(qcow2_file, refcount_blocks_offset, refcounts);
+
+    QByteArray header(qcow2_v3_header_length + 8, '\0'); // followed by the end of header extensions
+    header.replace(0, 4, qcow2_magic);
+    qToBigEndian<quint32>(3, header.data() + 4);
+    qToBigEndian<quint32>(qcow2_cluster_bits, header.data() + 20);
+    qToBigEndian<quint64>(size, header.data() + 24);
+    qToBigEndian<quint32>(l1_size, header.data() + 36);
+    qToBigEndian<quint64>(l1_table_offset, header.data() + 40);
+    qToBigEndian<quint64>(refcount_table_offset, header.data() + 48);
+    qToBigEndian<quint32>(refcount_table_clusters, header.data() + 56);
+    qToBigEndian<quint32>(qcow2_refcount_order, header.data() + 96);
+    qToBigEndian<quint32>(qcow2_v3_header_length, header.data() + 100);
+    write_at(qcow2_file, 0, header);
+
+    if (!qcow2_file.resize(next_offset) || !qcow2_file.flush())
+        throw std::runtime_error(fmt::format("failed to write {}: {}", qcow2_path, qcow2_file.errorString()));
+}
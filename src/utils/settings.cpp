@@ -42,6 +42,13 @@ const auto daemon_root = QStringLiteral("local");
 const auto client_root = QStringLiteral("client");
 const auto petenv_name = QStringLiteral("primary");
 const auto autostart_default = QStringLiteral("true");
+const auto image_overlays_default = QStringLiteral("false");
+const auto image_prefetch_default = QStringLiteral("");
+const auto instance_pool_default = QStringLiteral("0");
+const auto telemetry_interval_default = QStringLiteral("0");      // seconds; off unless asked for
+const auto mount_workers_default = QStringLiteral("4");           // threads serving each mount; 0 to serve in turn
+const auto mount_write_buffer_default = QStringLiteral("1048576"); // bytes held back per open file; 0 to write through
+const auto mount_attribute_cache_default = QStringLiteral("true");
 
 QString default_hotkey()
 {
@@ -53,6 +60,13 @@ std::map<QString, QString> make_defaults()
     auto ret = std::map<QString, QString>{{mp::petenv_key, petenv_name},
                                           {mp::driver_key, mp::platform::default_driver()},
                                           {mp::autostart_key, autostart_default},
+                                          {mp::image_overlays_key, image_overlays_default},
+                                          {mp::image_prefetch_key, image_prefetch_default},
+                                          {mp::instance_pool_key, instance_pool_default},
+                                          {mp::telemetry_interval_key, telemetry_interval_default},
+                                          {mp::mount_workers_key, mount_workers_default},
+                                          {mp::mount_write_buffer_key, mount_write_buffer_default},
+                                          {mp::mount_attribute_cache_key, mount_attribute_cache_default},
                                           {mp::hotkey_key, default_hotkey()}};
 
     for(const auto& [k, v] : mp::platform::extra_settings_defaults())
@@ -132,6 +146,32 @@ void checked_set(QSettings& settings, const QString& key, const QString& val, st
     check_status(settings, QStringLiteral("read/write"));
 }
 
+// Comma separated images, optionally with their remote, like "lts,daily:devel"
+bool valid_image_list(const QString& val)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    for (const auto& image : val.split(',', Qt::SkipEmptyParts))
+#else
+    for (const auto& image : val.split(',', QString::SkipEmptyParts))
+#endif
+    {
+        const auto remote_and_alias = image.trimmed().split(':');
+        if (remote_and_alias.size() > 2 ||
+            std::any_of(remote_and_alias.cbegin(), remote_and_alias.cend(), [](const auto& s) { return s.isEmpty(); }))
+            return false;
+    }
+
+    return true;
+}
+
+bool valid_count(const QString& val)
+{
+    bool ok;
+    val.toUInt(&ok);
+
+    return ok;
+}
+
 QString interpret_bool(QString val)
 { // constrain accepted values to avoid QVariant::toBool interpreting non-empty strings (such as "nope") as true
     static constexpr auto convert_to_true = {"on", "yes", "1"};
@@ -205,8 +245,19 @@ void multipass::Settings::set_aux(const QString& key, QString val) // work with
         throw InvalidSettingsException{key, val, "Invalid hostname"};
     else if (key == driver_key && !mp::platform::is_backend_supported(val))
         throw InvalidSettingsException(key, val, "Invalid driver");
-    else if (key == autostart_key && (val = interpret_bool(val)) != "true" && val != "false")
+    else if ((key == autostart_key || key == image_overlays_key || key == mount_attribute_cache_key) &&
+             (val = interpret_bool(val)) != "true" && val != "false")
         throw InvalidSettingsException(key, val, "Invalid flag, try \"true\" or \"false\"");
+    else if (key == image_prefetch_key && !valid_image_list(val))
+        throw InvalidSettingsException(key, val, "Invalid image list, try e.g. \"lts,daily:devel\"");
+    else if (key == instance_pool_key && !valid_count(val))
+        throw InvalidSettingsException(key, val, "Invalid number of instances");
+    else if (key == telemetry_interval_key && !valid_count(val))
+        throw InvalidSettingsException(key, val, "Invalid number of seconds, use 0 to stop sampling");
+    else if (key == mount_workers_key && !valid_count(val))
+        throw InvalidSettingsException(key, val, "Invalid number of threads, use 0 to serve requests in turn");
+    else if (key == mount_write_buffer_key && !valid_count(val))
+        throw InvalidSettingsException(key, val, "Invalid number of bytes, use 0 to write through");
     else if (key == winterm_key || key == hotkey_key)
         val = mp::platform::interpret_setting(key, val);
 
@@ -15,16 +15,59 @@
  *
  */
 
+#include <multipass/format.h>
+#include <multipass/sparse_file.h>
 #include <multipass/vm_image_vault.h>
 #include <multipass/xz_image_decoder.h>
 
 #include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
 #include <QFileInfo>
+#include <QtEndian>
 
+#include <algorithm>
+#include <cerrno>
 #include <stdexcept>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 
 namespace mp = multipass;
 
+namespace
+{
+constexpr qint64 copy_chunk_size = 1024 * 1024;
+constexpr auto qcow2_magic = "QFI\xfb";
+constexpr auto qcow2_backing_file_max_size = 1023;
+
+void copy_range(QFile& source, QFile& destination, qint64 start, qint64 end)
+{
+    if (!source.seek(start) || !destination.seek(start))
+        throw std::runtime_error(fmt::format("failed to seek in {}", source.fileName()));
+
+    std::vector<char> buffer(copy_chunk_size);
+    for (auto pos = start; pos < end;)
+    {
+        const auto read = source.read(buffer.data(), std::min(copy_chunk_size, end - pos));
+        if (read <= 0)
+            throw std::runtime_error(fmt::format("failed to read {}: {}", source.fileName(), source.errorString()));
+
+        if (!mp::write_sparse(destination, buffer.data(), read))
+            throw std::runtime_error(
+                fmt::format("failed to write {}: {}", destination.fileName(), destination.errorString()));
+        pos += read;
+    }
+}
+} // namespace
+
 QString mp::vault::filename_for(const mp::Path& path)
 {
     QFileInfo file_info(path);
@@ -70,3 +113,96 @@ QString mp::vault::extract_image(const mp::Path& image_path, const mp::ProgressM
 
     return new_image_path;
 }
+
+void mp::vault::sparse_copy(const mp::Path& source_path, const mp::Path& destination_path)
+{
+    QFile source{source_path};
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        throw std::runtime_error(fmt::format("failed to open {} for reading", source_path));
+
+    QFile destination{destination_path};
+    if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", destination_path));
+
+    const auto size = source.size();
+    bool copied{false};
+
+#if defined(Q_OS_UNIX) && defined(SEEK_DATA)
+    // Only visit the extents that hold data, where the file system can tell them apart from holes
+    const auto fd = source.handle();
+    auto data_start = ::lseek(fd, 0, SEEK_DATA);
+    if (data_start >= 0 || errno == ENXIO)
+    {
+        while (data_start >= 0 && data_start < size)
+        {
+            auto data_end = ::lseek(fd, data_start, SEEK_HOLE);
+            if (data_end < 0)
+                data_end = size;
+
+            copy_range(source, destination, data_start, data_end);
+            data_start = ::lseek(fd, data_end, SEEK_DATA);
+        }
+        copied = true;
+    }
+#endif
+
+    // Otherwise go through all of it, still leaving holes where there are zeros
+    if (!copied)
+        copy_range(source, destination, 0, size);
+
+    if (destination.size() < size && !destination.resize(size))
+        throw std::runtime_error(fmt::format("failed to write {}: {}", destination_path, destination.errorString()));
+}
+
+bool mp::vault::reflink_copy(const mp::Path& source_path, const mp::Path& destination_path)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    QFile source{source_path};
+    if (!source.open(QIODevice::ReadOnly))
+        return false;
+
+    QFile destination{destination_path};
+    if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    // Shares the source's extents on file systems that can, like btrfs and XFS, instead of copying any data
+    if (::ioctl(destination.handle(), FICLONE, source.handle()) == 0)
+        return true;
+
+    destination.remove();
+#else
+    Q_UNUSED(source_path);
+    Q_UNUSED(destination_path);
+#endif
+    return false;
+}
+
+QString mp::vault::backing_file_of(const mp::Path& image_path)
+{
+    QFile image_file{image_path};
+    if (!image_file.open(QIODevice::ReadOnly))
+        return {};
+
+    // The qcow2 header starts with the magic, the version, then the offset and the size of the backing file name
+    const auto header = image_file.read(20);
+    if (header.size() != 20 || !header.startsWith(qcow2_magic))
+        return {};
+
+    const auto offset = qFromBigEndian<quint64>(header.constData() + 8);
+    const auto size = qFromBigEndian<quint32>(header.constData() + 16);
+    if (offset == 0 || size == 0 || size > qcow2_backing_file_max_size || !image_file.seek(offset))
+        return {};
+
+    const auto backing_file = QString::fromUtf8(image_file.read(size));
+    return QFileInfo{image_path}.dir().absoluteFilePath(backing_file);
+}
+
+void mp::vault::remove_stale_partial_downloads(const QDir& partials_dir, const mp::days& days_to_expire)
+{
+    const auto expiry = QDateTime::currentDateTime().addDays(-days_to_expire.count());
+    for (const auto& entry : partials_dir.entryInfoList(QDir::Files))
+    {
+        if (entry.lastModified() <= expiry)
+            QFile::remove(entry.absoluteFilePath());
+    }
+}
@@ -19,14 +19,25 @@
 
 #include <multipass/rpc/multipass.grpc.pb.h>
 
+#include <multipass/auto_join_thread.h>
 #include <multipass/format.h>
+#include <multipass/sparse_file.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace mp = multipass;
 
 namespace
 {
+constexpr auto max_size = 65536u;
+
 bool verify_decode(const xz_ret& ret)
 {
     switch (ret)
@@ -52,13 +63,225 @@ bool verify_decode(const xz_ret& ret)
 
     return true;
 }
+
+// The CRC tables are global, so they are filled once rather than by each of the decoders running in parallel
+void init_crc_tables()
+{
+    static std::once_flag crc_tables_initialized;
+    std::call_once(crc_tables_initialized, [] {
+        xz_crc32_init();
+        xz_crc64_init();
+    });
+}
+
+uint32_t crc32_of(const QByteArray& data)
+{
+    init_crc_tables();
+    return xz_crc32(reinterpret_cast<const uint8_t*>(data.constData()), data.size(), 0);
+}
+
+uint32_t read_le32(const QByteArray& data, int pos)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i)
+        value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+
+    return value;
+}
+
+void append_le32(QByteArray& data, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        data.append(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+bool read_varint(const QByteArray& data, int& pos, quint64& value)
+{
+    value = 0;
+    for (int i = 0; i < 9 && pos < data.size(); ++i)
+    {
+        const auto byte = static_cast<unsigned char>(data[pos++]);
+        value |= quint64{byte & 0x7fu} << (7 * i);
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+void append_varint(QByteArray& data, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(static_cast<char>(value));
+}
+
+qint64 padded(quint64 size)
+{
+    return static_cast<qint64>((size + 3) & ~quint64{3});
+}
+
+// The index and footer of a stream holding nothing but the given block
+QByteArray single_block_stream_end(const QByteArray& stream_flags, const mp::XzStreamIndex::Block& block)
+{
+    QByteArray index;
+    index.append('\0');
+    append_varint(index, 1);
+    append_varint(index, block.unpadded_size);
+    append_varint(index, block.decoded_size);
+    while (index.size() % 4)
+        index.append('\0');
+    append_le32(index, crc32_of(index));
+
+    QByteArray footer_fields;
+    append_le32(footer_fields, index.size() / 4 - 1);
+    footer_fields.append(stream_flags);
+
+    auto stream_end = index;
+    append_le32(stream_end, crc32_of(footer_fields));
+    stream_end.append(footer_fields);
+    stream_end.append("YZ");
+
+    return stream_end;
+}
+
+void decode_block(const mp::XzStreamIndex& stream_index, const mp::XzStreamIndex::Block& block, QFile& in, QFile& out,
+                  std::atomic<qint64>& bytes_decoded)
+{
+    if (!in.seek(block.offset) || !out.seek(block.decoded_offset))
+        throw std::runtime_error("xz file is corrupt");
+
+    mp::XzStreamDecoder decoder;
+    decoder.decode(stream_index.stream_header.constData(), stream_index.stream_header.size(), out);
+
+    std::vector<char> read_data(max_size);
+    for (auto remaining = padded(block.unpadded_size); remaining > 0;)
+    {
+        const auto bytes_read = in.read(read_data.data(), std::min<qint64>(remaining, max_size));
+        if (bytes_read <= 0)
+            throw std::runtime_error("xz file is corrupt");
+
+        decoder.decode(read_data.data(), bytes_read, out);
+        remaining -= bytes_read;
+        bytes_decoded += bytes_read;
+    }
+
+    const auto stream_end = single_block_stream_end(stream_index.stream_header.mid(6, 2), block);
+    if (decoder.decode(stream_end.constData(), stream_end.size(), out))
+        throw std::runtime_error("xz file is corrupt");
+}
 } // namespace
 
-mp::XzImageDecoder::XzImageDecoder(const Path& xz_file_path)
-    : xz_file{xz_file_path}, xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end}
+mp::XzStreamIndex mp::read_stream_index(QFile& xz_file)
+{
+    // Anything but a lone stream, with its blocks right where its index says, is left to the sequential decoder
+    constexpr auto header_size = 12;
+    constexpr auto footer_size = 12;
+
+    XzStreamIndex stream_index;
+    const auto file_size = xz_file.size();
+    if (file_size < header_size + footer_size || !xz_file.seek(0))
+        return {};
+
+    const auto header = xz_file.read(header_size);
+    if (header.size() != header_size || !header.startsWith(QByteArray("\xfd" "7zXZ\0", 6)))
+        return {};
+
+    if (!xz_file.seek(file_size - footer_size))
+        return {};
+
+    const auto footer = xz_file.read(footer_size);
+    if (footer.size() != footer_size || !footer.endsWith("YZ") || footer.mid(8, 2) != header.mid(6, 2) ||
+        read_le32(footer, 0) != crc32_of(footer.mid(4, 6)))
+        return {};
+
+    const auto index_size = (qint64{read_le32(footer, 4)} + 1) * 4;
+    const auto index_offset = file_size - footer_size - index_size;
+    if (index_offset < header_size || !xz_file.seek(index_offset))
+        return {};
+
+    const auto index = xz_file.read(index_size);
+    if (index.size() != index_size || index[0] != '\0' ||
+        read_le32(index, index.size() - 4) != crc32_of(index.left(index.size() - 4)))
+        return {};
+
+    int pos = 1;
+    quint64 record_count;
+    if (!read_varint(index, pos, record_count) || record_count > static_cast<quint64>(index_size))
+        return {};
+
+    qint64 offset = header_size, decoded_offset = 0;
+    for (quint64 i = 0; i < record_count; ++i)
+    {
+        quint64 unpadded_size, decoded_size;
+        if (!read_varint(index, pos, unpadded_size) || !read_varint(index, pos, decoded_size) ||
+            unpadded_size > static_cast<quint64>(file_size) || decoded_size > (quint64{1} << 62))
+            return {};
+
+        stream_index.blocks.push_back({offset, static_cast<qint64>(unpadded_size), decoded_offset,
+                                       static_cast<qint64>(decoded_size)});
+        offset += padded(unpadded_size);
+        decoded_offset += static_cast<qint64>(decoded_size);
+    }
+
+    if (offset != index_offset)
+        return {};
+
+    stream_index.stream_header = header;
+    stream_index.compressed_size = offset - header_size;
+    stream_index.decoded_size = decoded_offset;
+
+    return stream_index;
+}
+
+mp::XzStreamDecoder::XzStreamDecoder()
+    : xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end}, decoded_data(max_size)
+{
+    init_crc_tables();
+}
+
+bool mp::XzStreamDecoder::decode(const char* data, std::size_t size, QFileDevice& decoded_file)
+{
+    struct xz_buf decode_buf
+    {
+    };
+
+    decode_buf.in = reinterpret_cast<const unsigned char*>(data);
+    decode_buf.in_pos = 0;
+    decode_buf.in_size = size;
+    decode_buf.out = decoded_data.data();
+    decode_buf.out_pos = 0;
+    decode_buf.out_size = decoded_data.size();
+
+    while (true)
+    {
+        const auto more = verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf));
+
+        // A full output buffer may be hiding more output, even once all the input is in
+        const auto out_full = decode_buf.out_pos == decode_buf.out_size;
+        const auto input_used_up = decode_buf.in_pos == decode_buf.in_size && !out_full;
+
+        // Whatever was decoded is written before returning, as the buffer starts over with the next call
+        if ((out_full || input_used_up || !more) && decode_buf.out_pos > 0)
+        {
+            if (!write_sparse(decoded_file, reinterpret_cast<const char*>(decoded_data.data()), decode_buf.out_pos))
+                throw std::runtime_error(fmt::format("failed to write decoded image: {}", decoded_file.errorString()));
+            decode_buf.out_pos = 0;
+        }
+
+        if (!more && !finish_sparse_write(decoded_file))
+            throw std::runtime_error(fmt::format("failed to write decoded image: {}", decoded_file.errorString()));
+
+        if (!more || input_used_up)
+            return more;
+    }
+}
+
+mp::XzImageDecoder::XzImageDecoder(const Path& xz_file_path) : xz_file{xz_file_path}
 {
-    xz_crc32_init();
-    xz_crc64_init();
 }
 
 void mp::XzImageDecoder::decode_to(const Path& decoded_image_path, const ProgressMonitor& monitor)
@@ -70,46 +293,94 @@ void mp::XzImageDecoder::decode_to(const Path& decoded_image_path, const Progres
     if (!decoded_file.open(QIODevice::WriteOnly))
         throw std::runtime_error(fmt::format("failed to open {} for writing", decoded_file.fileName()));
 
-    struct xz_buf decode_buf
+    const auto stream_index = read_stream_index(xz_file);
+    const auto thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                                    stream_index.blocks.size());
+    if (thread_count > 1)
     {
-    };
-    const auto max_size = 65536u;
-
-    std::vector<char> read_data, write_data;
-    read_data.reserve(max_size);
-    write_data.reserve(max_size);
+        decode_blocks_in_parallel(stream_index, decoded_file, thread_count, monitor);
+        return;
+    }
 
-    decode_buf.in = reinterpret_cast<unsigned char*>(read_data.data());
-    decode_buf.in_pos = 0;
-    decode_buf.in_size = 0;
-    decode_buf.out = reinterpret_cast<unsigned char*>(write_data.data());
-    decode_buf.out_pos = 0;
-    decode_buf.out_size = max_size;
+    std::vector<char> read_data(max_size);
 
     const auto file_size = xz_file.size();
     qint64 total_bytes_extracted{0};
 
+    xz_file.seek(0);
     while (true)
     {
-        if (decode_buf.in_pos == decode_buf.in_size)
+        const auto bytes_read = xz_file.read(read_data.data(), max_size);
+        if (bytes_read <= 0)
+            throw std::runtime_error("xz file is corrupt");
+
+        total_bytes_extracted += bytes_read;
+        auto progress = (total_bytes_extracted / (float)file_size) * 100;
+        monitor(LaunchProgress::EXTRACT, progress);
+
+        if (!xz_decoder.decode(read_data.data(), bytes_read, decoded_file))
+            return;
+    }
+}
+
+void mp::XzImageDecoder::decode_blocks_in_parallel(const XzStreamIndex& stream_index, QFile& decoded_file,
+                                                   std::size_t thread_count, const ProgressMonitor& monitor)
+{
+    // Every block is decoded by itself, as a stream of its own, straight to where it belongs in the decoded image
+    if (!decoded_file.resize(stream_index.decoded_size))
+        throw std::runtime_error(fmt::format("failed to resize {}: {}", decoded_file.fileName(),
+                                             decoded_file.errorString()));
+
+    std::atomic<std::size_t> next_block{0};
+    std::atomic<qint64> bytes_decoded{0};
+    std::atomic_bool failed{false};
+    std::exception_ptr error;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    auto running = thread_count;
+
+    auto decode_blocks = [&] {
+        try
         {
-            decode_buf.in_size = xz_file.read(read_data.data(), max_size);
-            decode_buf.in_pos = 0;
-            total_bytes_extracted += decode_buf.in_size;
-            auto progress = (total_bytes_extracted / (float)file_size) * 100;
-            monitor(LaunchProgress::EXTRACT, progress);
-        }
+            QFile in{xz_file.fileName()};
+            QFile out{decoded_file.fileName()};
+            if (!in.open(QIODevice::ReadOnly) || !out.open(QIODevice::ReadWrite))
+                throw std::runtime_error(fmt::format("failed to open {} for decoding", in.fileName()));
 
-        if (!verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf)))
+            for (auto i = next_block++; i < stream_index.blocks.size() && !failed; i = next_block++)
+                decode_block(stream_index, stream_index.blocks[i], in, out, bytes_decoded);
+        }
+        catch (...)
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
-            return;
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!failed)
+                error = std::current_exception();
+            failed = true;
         }
 
-        if (decode_buf.out_pos == max_size)
+        std::lock_guard<std::mutex> lock{mutex};
+        --running;
+        cv.notify_all();
+    };
+
+    {
+        std::vector<std::unique_ptr<AutoJoinThread>> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+            threads.push_back(std::make_unique<AutoJoinThread>(decode_blocks));
+
+        const auto compressed_size = std::max(stream_index.compressed_size, qint64{1});
+        std::unique_lock<std::mutex> lock{mutex};
+        while (!cv.wait_for(lock, std::chrono::milliseconds(100), [&running] { return running == 0; }))
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
-            decode_buf.out_pos = 0;
+            lock.unlock();
+            monitor(LaunchProgress::EXTRACT, (bytes_decoded / (float)compressed_size) * 100);
+            lock.lock();
         }
     }
+
+    if (failed)
+        std::rethrow_exception(error);
+
+    monitor(LaunchProgress::EXTRACT, 100);
 }
@@ -0,0 +1,548 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Measures how fast SftpServer serves a mount. Instead of a VM, the "guest" is an SSH server on the loopback
+// interface that accepts the sshfs exec request and then speaks SFTP to SftpServer itself, so only the host side of
+// the mount path is timed.
+
+#include <multipass/format.h>
+#include <multipass/ssh/openssh_key_provider.h>
+#include <multipass/ssh/ssh_session.h>
+#include <multipass/sshfs_mount/sftp_server.h>
+
+#include <libssh/libssh.h>
+#include <libssh/server.h>
+#include <libssh/sftp.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+
+using namespace std::chrono;
+
+namespace
+{
+constexpr auto all_workloads = {"seq-write", "seq-read", "create", "readdir", "stat"};
+
+struct Options
+{
+    std::vector<std::string> workloads;
+    uint64_t file_size;
+    std::size_t block_size;
+    int files;
+    int depth;
+    int iterations;
+    int workers;
+    std::size_t write_buffer_size;
+    bool cache_attributes;
+    bool csv;
+};
+
+struct Result
+{
+    explicit Result(const std::string& workload) : workload{workload}
+    {
+    }
+
+    std::string workload;
+    std::vector<nanoseconds> latencies;
+    uint64_t bytes{0};
+    nanoseconds elapsed{0};
+};
+
+// Times a single operation and records its latency
+template <typename Operation>
+auto timed(Result& result, Operation&& operation)
+{
+    const auto start = steady_clock::now();
+    auto ret = operation();
+    const auto latency = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+    result.latencies.push_back(latency);
+    result.elapsed += latency;
+    return ret;
+}
+
+using SSHBindUPtr = std::unique_ptr<ssh_bind_struct, decltype(ssh_bind_free)*>;
+using SSHSessionUPtr = std::unique_ptr<ssh_session_struct, decltype(ssh_free)*>;
+using SftpSessionUPtr = std::unique_ptr<sftp_session_struct, decltype(sftp_free)*>;
+
+// The guest end of the loopback pair: it accepts the connection SftpServer makes and plays the part of sshfs
+class LoopbackGuest
+{
+public:
+    explicit LoopbackGuest(const QString& key_dir) : bind{ssh_bind_new(), ssh_bind_free}, session{nullptr, ssh_free}
+    {
+        const auto host_key_path = QDir{key_dir}.filePath("host_key").toStdString();
+        ssh_key host_key{nullptr};
+        if (ssh_pki_generate(SSH_KEYTYPE_ED25519, 0, &host_key) != SSH_OK ||
+            ssh_pki_export_privkey_file(host_key, nullptr, nullptr, nullptr, host_key_path.c_str()) != SSH_OK)
+        {
+            ssh_key_free(host_key);
+            throw std::runtime_error("cannot generate the loopback host key");
+        }
+        ssh_key_free(host_key);
+
+        const auto address = "127.0.0.1";
+        const int any_port{0};
+        ssh_bind_options_set(bind.get(), SSH_BIND_OPTIONS_BINDADDR, address);
+        ssh_bind_options_set(bind.get(), SSH_BIND_OPTIONS_BINDPORT, &any_port);
+        ssh_bind_options_set(bind.get(), SSH_BIND_OPTIONS_HOSTKEY, host_key_path.c_str());
+
+        if (ssh_bind_listen(bind.get()) != SSH_OK)
+            throw std::runtime_error(fmt::format("cannot listen on {}: {}", address, ssh_get_error(bind.get())));
+
+        sockaddr_in bound{};
+        socklen_t len = sizeof(bound);
+        if (getsockname(ssh_bind_get_fd(bind.get()), reinterpret_cast<sockaddr*>(&bound), &len) < 0)
+            throw std::runtime_error("cannot find the loopback port");
+
+        listening_port = ntohs(bound.sin_port);
+    }
+
+    int port() const
+    {
+        return listening_port;
+    }
+
+    // Takes the connection up to the point where sshfs would start talking SFTP on the exec channel
+    void accept_sshfs()
+    {
+        session.reset(ssh_new());
+        if (ssh_bind_accept(bind.get(), session.get()) != SSH_OK || ssh_handle_key_exchange(session.get()) != SSH_OK)
+            throw std::runtime_error(fmt::format("loopback connection failed: {}", ssh_get_error(session.get())));
+
+        ssh_set_auth_methods(session.get(), SSH_AUTH_METHOD_PUBLICKEY);
+
+        ssh_channel channel{nullptr};
+        auto exec_requested = false;
+        while (!exec_requested)
+        {
+            auto msg = ssh_message_get(session.get());
+            if (msg == nullptr)
+                throw std::runtime_error(fmt::format("loopback connection closed: {}", ssh_get_error(session.get())));
+
+            const auto type = ssh_message_type(msg);
+            const auto subtype = ssh_message_subtype(msg);
+            if (type == SSH_REQUEST_AUTH)
+            {
+                ssh_message_auth_reply_success(msg, 0);
+            }
+            else if (type == SSH_REQUEST_CHANNEL_OPEN && subtype == SSH_CHANNEL_SESSION && channel == nullptr)
+            {
+                channel = ssh_message_channel_request_open_reply_accept(msg);
+            }
+            else if (type == SSH_REQUEST_CHANNEL && subtype == SSH_CHANNEL_REQUEST_EXEC && channel != nullptr)
+            {
+                ssh_message_channel_request_reply_success(msg);
+                exec_requested = true;
+            }
+            else
+            {
+                ssh_message_reply_default(msg);
+            }
+
+            ssh_message_free(msg);
+        }
+
+        // The SFTP session owns the channel from here on
+        sftp = SftpSessionUPtr{sftp_new_channel(session.get(), channel), sftp_free};
+        if (sftp == nullptr)
+        {
+            ssh_channel_free(channel);
+            throw std::runtime_error("cannot allocate the SFTP client");
+        }
+
+        if (sftp_init(sftp.get()) != SSH_OK)
+            throw std::runtime_error(fmt::format("cannot start the SFTP client: {}", ssh_get_error(session.get())));
+    }
+
+    sftp_session client() const
+    {
+        return sftp.get();
+    }
+
+    // Unblocks accept_sshfs() when the host end never connects
+    void abort()
+    {
+        shutdown(ssh_bind_get_fd(bind.get()), SHUT_RDWR);
+    }
+
+private:
+    SSHBindUPtr bind;
+    SSHSessionUPtr session;
+    SftpSessionUPtr sftp{nullptr, sftp_free};
+    int listening_port{0};
+};
+
+void check(bool ok, sftp_session sftp, const std::string& what)
+{
+    if (!ok)
+        throw std::runtime_error(fmt::format("{} failed: SFTP error {}", what, sftp_get_error(sftp)));
+}
+
+// Fixtures for the read-only workloads are laid down straight on the host, outside the measurements
+void write_host_file(const QString& path, uint64_t size)
+{
+    QFile file{path};
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error(fmt::format("cannot create {}", path));
+
+    const QByteArray block(64 * 1024, 'x');
+    for (uint64_t written = 0; written < size; written += block.size())
+        file.write(block.constData(), std::min<uint64_t>(block.size(), size - written));
+}
+
+QString tree_dir(const QString& root, int level)
+{
+    auto path = root;
+    for (auto i = 0; i < level; ++i)
+        path += QString{"/level%1"}.arg(i);
+
+    return path;
+}
+
+Result seq_write(sftp_session sftp, const QString& root, const Options& options)
+{
+    Result result{"seq-write"};
+    const std::vector<char> block(options.block_size, 'x');
+    const auto path = QDir{root}.filePath("seq.bin").toStdString();
+
+    auto file = sftp_open(sftp, path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    check(file != nullptr, sftp, "open");
+
+    while (result.bytes < options.file_size)
+    {
+        const auto len = std::min<uint64_t>(block.size(), options.file_size - result.bytes);
+        const auto written = timed(result, [&] { return sftp_write(file, block.data(), len); });
+        check(written > 0, sftp, "write");
+        result.bytes += written;
+    }
+
+    check(timed(result, [&] { return sftp_close(file); }) == SSH_OK, sftp, "close");
+    return result;
+}
+
+Result seq_read(sftp_session sftp, const QString& root, const Options& options)
+{
+    Result result{"seq-read"};
+    const auto path = QDir{root}.filePath("seq.bin");
+    if (!QFile::exists(path) || static_cast<uint64_t>(QFile{path}.size()) != options.file_size)
+        write_host_file(path, options.file_size);
+
+    std::vector<char> block(options.block_size);
+    auto file = sftp_open(sftp, path.toStdString().c_str(), O_RDONLY, 0);
+    check(file != nullptr, sftp, "open");
+
+    while (true)
+    {
+        const auto read = timed(result, [&] { return sftp_read(file, block.data(), block.size()); });
+        check(read >= 0, sftp, "read");
+        if (read == 0)
+            break;
+
+        result.bytes += read;
+    }
+
+    sftp_close(file);
+    return result;
+}
+
+// Many small files in one directory, each opened, written and closed the way a build or an unpack would
+Result create_storm(sftp_session sftp, const QString& root, const Options& options)
+{
+    Result result{"create"};
+    const auto dir = QDir{root}.filePath("create");
+    QDir{dir}.removeRecursively();
+    check(sftp_mkdir(sftp, dir.toStdString().c_str(), 0755) == SSH_OK, sftp, "mkdir");
+
+    const std::vector<char> contents(std::min<std::size_t>(options.block_size, 4096), 'x');
+    for (auto i = 0; i < options.files; ++i)
+    {
+        const auto path = QString{"%1/file%2"}.arg(dir).arg(i).toStdString();
+        const auto ok = timed(result, [&] {
+            auto file = sftp_open(sftp, path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (file == nullptr)
+                return false;
+
+            const auto written = sftp_write(file, contents.data(), contents.size());
+            return sftp_close(file) == SSH_OK && written == static_cast<ssize_t>(contents.size());
+        });
+        check(ok, sftp, "create");
+        result.bytes += contents.size();
+    }
+
+    return result;
+}
+
+// Lists a chain of nested directories, each holding the next level and a batch of files
+Result deep_readdir(sftp_session sftp, const QString& root, const Options& options)
+{
+    Result result{"readdir"};
+    const auto tree = QDir{root}.filePath("tree");
+    if (!QDir{tree_dir(tree, options.depth)}.exists())
+    {
+        QDir{tree}.removeRecursively();
+        for (auto level = 0; level <= options.depth; ++level)
+        {
+            const auto dir = tree_dir(tree, level);
+            QDir{}.mkpath(dir);
+            for (auto i = 0; i < options.files; ++i)
+                write_host_file(QString{"%1/file%2"}.arg(dir).arg(i), 0);
+        }
+    }
+
+    for (auto iteration = 0; iteration < options.iterations; ++iteration)
+    {
+        for (auto level = 0; level <= options.depth; ++level)
+        {
+            const auto path = tree_dir(tree, level).toStdString();
+            const auto entries = timed(result, [&] {
+                auto dir = sftp_opendir(sftp, path.c_str());
+                if (dir == nullptr)
+                    return -1;
+
+                auto count = 0;
+                while (auto attr = sftp_readdir(sftp, dir))
+                {
+                    ++count;
+                    sftp_attributes_free(attr);
+                }
+
+                const auto eof = sftp_dir_eof(dir);
+                sftp_closedir(dir);
+                return eof ? count : -1;
+            });
+            check(entries >= 0, sftp, "readdir");
+        }
+    }
+
+    return result;
+}
+
+// Stats the same files over and over, as shells and build systems checking timestamps do
+Result stat_scan(sftp_session sftp, const QString& root, const Options& options)
+{
+    Result result{"stat"};
+    const auto dir = QDir{root}.filePath("stat");
+    if (!QDir{dir}.exists())
+    {
+        QDir{}.mkpath(dir);
+        for (auto i = 0; i < options.files; ++i)
+            write_host_file(QString{"%1/file%2"}.arg(dir).arg(i), 0);
+    }
+
+    for (auto iteration = 0; iteration < options.iterations; ++iteration)
+    {
+        for (auto i = 0; i < options.files; ++i)
+        {
+            const auto path = QString{"%1/file%2"}.arg(dir).arg(i).toStdString();
+            auto attr = timed(result, [&] { return sftp_stat(sftp, path.c_str()); });
+            check(attr != nullptr, sftp, "stat");
+            sftp_attributes_free(attr);
+        }
+    }
+
+    return result;
+}
+
+Result run_workload(const std::string& workload, sftp_session sftp, const QString& root, const Options& options)
+{
+    if (workload == "seq-write")
+        return seq_write(sftp, root, options);
+    if (workload == "seq-read")
+        return seq_read(sftp, root, options);
+    if (workload == "create")
+        return create_storm(sftp, root, options);
+    if (workload == "readdir")
+        return deep_readdir(sftp, root, options);
+
+    return stat_scan(sftp, root, options);
+}
+
+double percentile_us(std::vector<nanoseconds> latencies, double percentile)
+{
+    if (latencies.empty())
+        return 0;
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto rank = static_cast<std::size_t>(std::ceil(percentile * latencies.size()));
+    return duration<double, std::micro>(latencies[std::max<std::size_t>(rank, 1) - 1]).count();
+}
+
+void report(const Result& result, bool csv)
+{
+    const auto seconds = std::max(duration<double>(result.elapsed).count(), 1e-9);
+    const auto ops = result.latencies.size();
+    const auto ops_per_sec = ops / seconds;
+    const auto mb_per_sec = result.bytes / seconds / (1024 * 1024);
+    const auto p50 = percentile_us(result.latencies, 0.50);
+    const auto p99 = percentile_us(result.latencies, 0.99);
+
+    if (csv)
+        fmt::print("{},{},{:.0f},{:.2f},{:.1f},{:.1f}\n", result.workload, ops, ops_per_sec, mb_per_sec, p50, p99);
+    else
+        fmt::print("{:<10} {:>9} {:>12.0f} {:>10.2f} {:>10.1f} {:>10.1f}\n", result.workload, ops, ops_per_sec,
+                   mb_per_sec, p50, p99);
+}
+
+Options parse(const QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures how fast SftpServer serves mounts over a loopback SSH connection.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("workloads", fmt::format("Workloads to run, out of: {} (default: all)",
+                                                          fmt::join(all_workloads, ", "))
+                                                  .c_str());
+
+    QCommandLineOption file_size{"file-size", "Size of the sequential file in MiB (default: 256)", "MiB", "256"};
+    QCommandLineOption block_size{"block-size", "Bytes per read or write request (default: 65536)", "bytes", "65536"};
+    QCommandLineOption files{"files", "Files per directory for create, readdir and stat (default: 1000)", "count",
+                             "1000"};
+    QCommandLineOption depth{"depth", "Directory levels for readdir (default: 16)", "levels", "16"};
+    QCommandLineOption iterations{"iterations", "Passes over the tree for readdir and stat (default: 10)", "count",
+                                  "10"};
+    QCommandLineOption workers{"workers", "SFTP worker threads, 0 to serve inline (default: 0)", "count", "0"};
+    QCommandLineOption write_buffer{"write-buffer", "Write coalescing buffer in bytes, 0 to disable (default: 0)",
+                                    "bytes", "0"};
+    QCommandLineOption cache{"cache-attributes", "Cache file attributes on the host"};
+    QCommandLineOption csv{"csv", "Print workload,ops,ops/s,MB/s,p50 us,p99 us lines without a header"};
+    parser.addOptions({file_size, block_size, files, depth, iterations, workers, write_buffer, cache, csv});
+    parser.process(app);
+
+    Options options{};
+    for (const auto& workload : parser.positionalArguments())
+    {
+        const auto name = workload.toStdString();
+        if (std::find(all_workloads.begin(), all_workloads.end(), name) == all_workloads.end())
+            throw std::runtime_error(fmt::format("unknown workload: {}", name));
+
+        options.workloads.push_back(name);
+    }
+    if (options.workloads.empty())
+        options.workloads.assign(all_workloads.begin(), all_workloads.end());
+
+    options.file_size = parser.value(file_size).toULongLong() * 1024 * 1024;
+    options.block_size = std::max(parser.value(block_size).toULongLong(), 1ull);
+    options.files = parser.value(files).toInt();
+    options.depth = parser.value(depth).toInt();
+    options.iterations = parser.value(iterations).toInt();
+    options.workers = parser.value(workers).toInt();
+    options.write_buffer_size = parser.value(write_buffer).toULongLong();
+    options.cache_attributes = parser.isSet(cache);
+    options.csv = parser.isSet(csv);
+
+    return options;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    try
+    {
+        const auto options = parse(app);
+
+        QTemporaryDir key_dir, source_dir;
+        if (!key_dir.isValid() || !source_dir.isValid())
+            throw std::runtime_error("cannot create temporary directories");
+
+        const auto source = QDir{source_dir.path()}.canonicalPath();
+        mp::OpenSSHKeyProvider key_provider{key_dir.path()};
+        LoopbackGuest guest{key_dir.path()};
+
+        std::exception_ptr guest_error;
+        std::thread guest_thread{[&guest, &guest_error] {
+            try
+            {
+                guest.accept_sshfs();
+            }
+            catch (...)
+            {
+                guest_error = std::current_exception();
+            }
+        }};
+
+        std::unique_ptr<mp::SftpServer> sftp_server;
+        try
+        {
+            mp::SSHSession session{"127.0.0.1", guest.port(), "ubuntu", key_provider};
+            sftp_server = std::make_unique<mp::SftpServer>(
+                std::move(session), source.toStdString(), "/mnt/benchmark", std::unordered_map<int, int>{},
+                std::unordered_map<int, int>{}, getuid(), getgid(), "sshfs", options.workers, options.write_buffer_size,
+                options.cache_attributes);
+        }
+        catch (...)
+        {
+            guest.abort();
+            guest_thread.join();
+            throw;
+        }
+
+        guest_thread.join();
+        if (guest_error)
+            std::rethrow_exception(guest_error);
+
+        std::thread server_thread{[&sftp_server] { sftp_server->run(); }};
+
+        if (!options.csv)
+            fmt::print("{:<10} {:>9} {:>12} {:>10} {:>10} {:>10}\n", "workload", "ops", "ops/s", "MB/s", "p50 us",
+                       "p99 us");
+
+        try
+        {
+            for (const auto& workload : options.workloads)
+                report(run_workload(workload, guest.client(), source, options), options.csv);
+        }
+        catch (...)
+        {
+            sftp_server->stop();
+            server_thread.join();
+            throw;
+        }
+
+        sftp_server->stop();
+        server_thread.join();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "sftp_server_benchmark: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
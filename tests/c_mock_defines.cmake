@@ -29,6 +29,7 @@ endfunction()
 # See premock.hpp to see how to define and implement a mocked c function
 add_c_mocks(
   ssh_new
+  ssh_free
   ssh_connect
   ssh_is_connected
   ssh_options_set
@@ -40,13 +41,15 @@ add_c_mocks(
   ssh_channel_request_shell
   ssh_channel_request_pty
   ssh_channel_change_pty_size
+  ssh_channel_read
   ssh_channel_read_timeout
+  ssh_channel_write
+  ssh_channel_poll_timeout
   ssh_channel_get_exit_status
   ssh_event_dopoll
   ssh_add_channel_callbacks
   sftp_server_new
   sftp_free
-  sftp_server_init
   sftp_reply_status
   sftp_reply_attr
   sftp_reply_data
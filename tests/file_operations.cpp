@@ -21,6 +21,7 @@
 #include "path.h"
 
 #include <QFile>
+#include <QtEndian>
 
 namespace mpt = multipass::test;
 
@@ -58,3 +59,18 @@ qint64 mpt::make_file_with_content(const QString& file_name, const std::string&
     file.write(content.data(), content.size());
     return file.size();
 }
+
+qint64 mpt::make_qcow2_overlay_header(const QString& file_name, const QString& backing_file)
+{
+    // Just the start of a qcow2 v3 header, with the backing file name right after it
+    constexpr quint64 backing_file_offset = 32;
+    const auto backing_file_name = backing_file.toUtf8();
+
+    std::string header(backing_file_offset, '\0');
+    header.replace(0, 4, "QFI\xfb");
+    qToBigEndian<quint32>(3, &header[4]);
+    qToBigEndian<quint64>(backing_file_offset, &header[8]);
+    qToBigEndian<quint32>(backing_file_name.size(), &header[16]);
+
+    return make_file_with_content(file_name, header + backing_file_name.toStdString());
+}
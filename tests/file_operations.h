@@ -32,6 +32,7 @@ QByteArray load(QString path);
 QByteArray load_test_file(const char* file_name);
 qint64 make_file_with_content(const QString& file_name);
 qint64 make_file_with_content(const QString& file_name, const std::string& content);
+qint64 make_qcow2_overlay_header(const QString& file_name, const QString& backing_file);
 }
 }
 #endif // MULTIPASS_FILE_READER_H
@@ -30,6 +30,13 @@ void mpt::MischievousURLDownloader::download_to(const QUrl& url, const QString&
     URLDownloader::download_to(choose_url(url), file_name, size, download_type, monitor);
 }
 
+void mpt::MischievousURLDownloader::stream_to(const QUrl& url, const QString& file_name, const DataSink& sink,
+                                              int64_t size, const int download_type,
+                                              const mp::ProgressMonitor& monitor)
+{
+    URLDownloader::stream_to(choose_url(url), file_name, sink, size, download_type, monitor);
+}
+
 QByteArray mpt::MischievousURLDownloader::download(const QUrl& url)
 {
     return URLDownloader::download(choose_url(url));
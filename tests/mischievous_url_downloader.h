@@ -33,6 +33,8 @@ public:
 
     void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
                      const ProgressMonitor& monitor) override;
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const ProgressMonitor& monitor) override;
     QByteArray download(const QUrl& url) override;
     QDateTime last_modified(const QUrl& url) override;
 
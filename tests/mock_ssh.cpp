@@ -19,6 +19,7 @@
 extern "C"
 {
     IMPL_MOCK_DEFAULT(0, ssh_new);
+    IMPL_MOCK_DEFAULT(1, ssh_free);
     IMPL_MOCK_DEFAULT(1, ssh_connect);
     IMPL_MOCK_DEFAULT(1, ssh_is_connected);
     IMPL_MOCK_DEFAULT(3, ssh_options_set);
@@ -27,7 +28,10 @@ extern "C"
     IMPL_MOCK_DEFAULT(1, ssh_channel_new);
     IMPL_MOCK_DEFAULT(1, ssh_channel_open_session);
     IMPL_MOCK_DEFAULT(2, ssh_channel_request_exec);
+    IMPL_MOCK_DEFAULT(4, ssh_channel_read);
     IMPL_MOCK_DEFAULT(5, ssh_channel_read_timeout);
+    IMPL_MOCK_DEFAULT(3, ssh_channel_write);
+    IMPL_MOCK_DEFAULT(3, ssh_channel_poll_timeout);
     IMPL_MOCK_DEFAULT(1, ssh_channel_get_exit_status);
     IMPL_MOCK_DEFAULT(2, ssh_event_dopoll);
     IMPL_MOCK_DEFAULT(2, ssh_add_channel_callbacks);
@@ -24,6 +24,7 @@
 #include <libssh/libssh.h>
 
 DECL_MOCK(ssh_new);
+DECL_MOCK(ssh_free);
 DECL_MOCK(ssh_connect);
 DECL_MOCK(ssh_is_connected);
 DECL_MOCK(ssh_options_set);
@@ -32,7 +33,10 @@ DECL_MOCK(ssh_channel_is_closed);
 DECL_MOCK(ssh_channel_new);
 DECL_MOCK(ssh_channel_open_session);
 DECL_MOCK(ssh_channel_request_exec);
+DECL_MOCK(ssh_channel_read);
 DECL_MOCK(ssh_channel_read_timeout);
+DECL_MOCK(ssh_channel_write);
+DECL_MOCK(ssh_channel_poll_timeout);
 DECL_MOCK(ssh_channel_get_exit_status);
 DECL_MOCK(ssh_event_dopoll);
 DECL_MOCK(ssh_add_channel_callbacks);
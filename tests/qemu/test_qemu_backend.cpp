@@ -20,6 +20,7 @@
 
 #include "mock_dnsmasq_server.h"
 #include "tests/extra_assertions.h"
+#include "tests/file_operations.h"
 #include "tests/mock_environment_helpers.h"
 #include "tests/mock_process_factory.h"
 #include "tests/mock_status_monitor.h"
@@ -145,6 +146,29 @@ TEST_F(QemuBackend, machine_start_suspend_sends_monitoring_event)
     machine->suspend();
 }
 
+TEST_F(QemuBackend, refuses_to_suspend_with_native_mounts)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback([](mpt::MockProcess* process) {
+        // Have virtiofsd listen right away
+        if (process->program().endsWith("virtiofsd"))
+            mpt::make_file_with_content(process->arguments().first().section('=', 1));
+    });
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    mpt::TempDir source_dir;
+
+    auto machine = backend.create_virtual_machine(default_description, mock_monitor);
+    machine->add_native_mount(source_dir.path().toStdString(), "src");
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    EXPECT_CALL(mock_monitor, on_suspend()).Times(0);
+    EXPECT_THROW(machine->suspend(), std::runtime_error);
+    EXPECT_THAT(machine->current_state(), Eq(mp::VirtualMachine::State::running));
+}
+
 TEST_F(QemuBackend, throws_when_starting_while_suspending)
 {
     NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
@@ -334,6 +358,34 @@ TEST_F(QemuBackend, verify_qemu_arguments_when_resuming_suspend_image)
     EXPECT_TRUE(qemu->arguments.contains(suspend_tag));
 }
 
+TEST_F(QemuBackend, resumes_suspend_image_without_native_mounts)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(handle_external_process_calls);
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+
+    auto machine = backend.create_virtual_machine(default_description, mock_monitor);
+    machine->add_native_mount("/home/ubuntu/src", "src");
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    auto processes = factory->process_list();
+    auto qemu = std::find_if(processes.cbegin(), processes.cend(),
+                             [](const mpt::MockProcessFactory::ProcessInfo& process_info) {
+                                 return process_info.command.startsWith("qemu-system-");
+                             });
+
+    ASSERT_TRUE(qemu != processes.cend());
+    EXPECT_TRUE(qemu->arguments.contains("-loadvm"));
+    EXPECT_FALSE(qemu->arguments.join(" ").contains("vhost-user-fs-pci"));
+    EXPECT_TRUE(std::none_of(processes.cbegin(), processes.cend(),
+                             [](const mpt::MockProcessFactory::ProcessInfo& process_info) {
+                                 return process_info.command.endsWith("virtiofsd");
+                             }));
+}
+
 TEST_F(QemuBackend, verify_qemu_arguments_when_resuming_suspend_image_uses_metadata)
 {
     constexpr auto machine_type = "k0mPuT0R";
@@ -17,9 +17,11 @@
 
 #include <src/platform/backends/qemu/qemu_vm_process_spec.h>
 
+#include "tests/file_operations.h"
 #include "tests/mock_environment_helpers.h"
 #include <gmock/gmock.h>
 
+#include <QDir>
 #include <QTemporaryDir>
 
 namespace mp = multipass;
@@ -161,6 +163,26 @@ TEST_F(TestQemuVMProcessSpec, resume_with_missing_machine_type_guesses_correctly
     EXPECT_EQ(spec.arguments(), QStringList({"-args", "-loadvm", "suspend_tag"}));
 }
 
+TEST_F(TestQemuVMProcessSpec, native_mounts_add_shared_memory_and_vhost_user_devices)
+{
+    mp::QemuVMProcessSpec spec(desc, tap_device_name, mp::nullopt,
+                               {{"tag0", "/run/share0.sock"}, {"tag1", "/run/share1.sock"}});
+
+    EXPECT_THAT(spec.arguments().mid(26),
+                ElementsAre("-object", "memory-backend-memfd,id=mem,size=3072M,share=on", "-numa", "node,memdev=mem",
+                            "-chardev", "socket,id=virtiofs0,path=/run/share0.sock", "-device",
+                            "vhost-user-fs-pci,chardev=virtiofs0,tag=tag0", "-chardev",
+                            "socket,id=virtiofs1,path=/run/share1.sock", "-device",
+                            "vhost-user-fs-pci,chardev=virtiofs1,tag=tag1"));
+}
+
+TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_native_mount_sockets)
+{
+    mp::QemuVMProcessSpec spec(desc, tap_device_name, mp::nullopt, {{"tag0", "/run/share0.sock"}});
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/run/share0.sock rw,"));
+}
+
 TEST_F(TestQemuVMProcessSpec, apparmor_profile_has_correct_name)
 {
     mp::QemuVMProcessSpec spec(desc, tap_device_name, mp::nullopt);
@@ -176,6 +198,18 @@ TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_disk_images)
     EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/cloud_init.iso rk,"));
 }
 
+TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_backing_image)
+{
+    QTemporaryDir temp_dir;
+    auto overlay_desc = desc;
+    overlay_desc.image.image_path = QDir{temp_dir.path()}.filePath("overlay.img");
+    mpt::make_qcow2_overlay_header(overlay_desc.image.image_path, "/path/to/backing.img");
+
+    mp::QemuVMProcessSpec spec(overlay_desc, tap_device_name, mp::nullopt);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/backing.img rk,"));
+}
+
 TEST_F(TestQemuVMProcessSpec, apparmor_profile_identifier)
 {
     mp::QemuVMProcessSpec spec(desc, tap_device_name, mp::nullopt);
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <src/platform/backends/qemu/virtiofsd_process_spec.h>
+
+#include "tests/mock_environment_helpers.h"
+#include <gmock/gmock.h>
+
+#include <QTemporaryDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+struct TestVirtiofsdProcessSpec : public Test
+{
+    const QString source_path{"/home/ubuntu/src"};
+    const QString socket_path{"/data/virtiofs/0123abcd.sock"};
+};
+
+TEST_F(TestVirtiofsdProcessSpec, default_arguments_correct)
+{
+    mp::VirtiofsdProcessSpec spec(source_path, socket_path);
+
+    EXPECT_EQ(spec.arguments(), QStringList({"--socket-path=/data/virtiofs/0123abcd.sock", "-o",
+                                             "source=/home/ubuntu/src", "-o", "cache=auto", "-o",
+                                             "modcaps=-fsetid:-setfcap"}));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, source_path_commas_are_escaped)
+{
+    mp::VirtiofsdProcessSpec spec("/home/ubuntu/a,b", socket_path);
+
+    EXPECT_TRUE(spec.arguments().contains("source=/home/ubuntu/a,,b"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmor_profile_identifier)
+{
+    mp::VirtiofsdProcessSpec spec(source_path, socket_path);
+
+    EXPECT_EQ(spec.identifier(), "0123abcd");
+    EXPECT_TRUE(spec.apparmor_profile().contains("profile multipass.0123abcd.virtiofsd"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmor_profile_permits_socket_and_source)
+{
+    mp::VirtiofsdProcessSpec spec(source_path, socket_path);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/data/virtiofs/0123abcd.sock rw,"));
+    EXPECT_TRUE(spec.apparmor_profile().contains("/home/ubuntu/src/** rwlk,"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmor_profile_denies_handing_out_privileges)
+{
+    mp::VirtiofsdProcessSpec spec(source_path, socket_path);
+
+    EXPECT_FALSE(spec.apparmor_profile().contains("capability fsetid,"));
+    EXPECT_FALSE(spec.apparmor_profile().contains("capability setfcap,"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmor_profile_running_as_snap_correct)
+{
+    const QByteArray snap_name{"multipass"};
+    QTemporaryDir snap_dir;
+
+    mpt::SetEnvScope e("SNAP", snap_dir.path().toUtf8());
+    mpt::SetEnvScope e2("SNAP_NAME", snap_name);
+    mp::VirtiofsdProcessSpec spec(source_path, socket_path);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("signal (receive) peer=snap.multipass.multipassd"));
+    EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1/{usr/,}{lib/qemu,libexec}/virtiofsd ixr,")
+                                                     .arg(snap_dir.path())));
+}
@@ -24,6 +24,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace multipass
 {
 namespace test
@@ -70,16 +73,27 @@ private:
 struct SftpServerTest : public testing::Test
 {
     SftpServerTest()
-        : free_sftp{mock_sftp_free, [](sftp_session sftp) {
+        : free_sftp{mock_sftp_free,
+                    [](sftp_session sftp) {
                         std::free(sftp->handles);
                         std::free(sftp);
-                    }}
+                    }},
+          // Plays a client's SSH_FXP_INIT, whose length is read first and then the rest
+          read_channel{mock_ssh_channel_read,
+                       [](ssh_channel, void* dest, uint32_t count, int) {
+                           const unsigned char init[]{0, 0, 0, 5, SSH_FXP_INIT, 0, 0, 0, LIBSFTP_VERSION};
+                           const auto offset = count == 4 ? 0u : 4u;
+                           count = std::min<uint32_t>(count, sizeof(init) - offset);
+                           std::memcpy(dest, init + offset, count);
+                           return static_cast<int>(count);
+                       }},
+          write_channel{mock_ssh_channel_write,
+                        [](ssh_channel, const void*, uint32_t len) { return static_cast<int>(len); }}
     {
         connect.returnValue(SSH_OK);
         is_connected.returnValue(true);
         open_session.returnValue(SSH_OK);
         request_exec.returnValue(SSH_OK);
-        init_sftp.returnValue(SSH_OK);
         reply_status.returnValue(SSH_OK);
         get_client_msg.returnValue(nullptr);
         handle_sftp.returnValue(nullptr);
@@ -89,12 +103,13 @@ struct SftpServerTest : public testing::Test
     decltype(MOCK(ssh_is_connected)) is_connected{MOCK(ssh_is_connected)};
     decltype(MOCK(ssh_channel_open_session)) open_session{MOCK(ssh_channel_open_session)};
     decltype(MOCK(ssh_channel_request_exec)) request_exec{MOCK(ssh_channel_request_exec)};
-    decltype(MOCK(sftp_server_init)) init_sftp{MOCK(sftp_server_init)};
     decltype(MOCK(sftp_reply_status)) reply_status{MOCK(sftp_reply_status)};
     decltype(MOCK(sftp_get_client_message)) get_client_msg{MOCK(sftp_get_client_message)};
     decltype(MOCK(sftp_client_message_free)) msg_free{MOCK(sftp_client_message_free)};
     decltype(MOCK(sftp_handle)) handle_sftp{MOCK(sftp_handle)};
     MockScope<decltype(mock_sftp_free)> free_sftp;
+    MockScope<decltype(mock_ssh_channel_read)> read_channel;
+    MockScope<decltype(mock_ssh_channel_write)> write_channel;
 };
 } // namespace test
 } // namespace multipass
@@ -33,6 +33,10 @@ struct StubURLDownloader : public multipass::URLDownloader
                      const multipass::ProgressMonitor&) override
     {
     }
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const multipass::ProgressMonitor&) override
+    {
+    }
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/sshfs_mount/attribute_cache.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+
+#include <chrono>
+#include <thread>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+namespace
+{
+struct AttributeCache : public Test
+{
+    mp::AttributeCache::Compute counting_compute(uint64_t size)
+    {
+        return [this, size] {
+            ++num_computes;
+            sftp_attributes_struct attr{};
+            attr.size = size;
+            return mp::AttributeCache::Attributes{attr};
+        };
+    }
+
+    mpt::TempDir temp_dir;
+    mp::AttributeCache cache;
+    int num_computes{0};
+};
+} // namespace
+
+TEST_F(AttributeCache, computes_once_per_path)
+{
+    const auto file_name = (temp_dir.path() + "/test-file").toStdString();
+    mpt::make_file_with_content(QString::fromStdString(file_name));
+
+    auto first = cache.get(file_name, counting_compute(42));
+    auto second = cache.get(file_name, counting_compute(0));
+
+    ASSERT_TRUE(first && second);
+    EXPECT_THAT(second->size, Eq(42u));
+    EXPECT_THAT(num_computes, Eq(1));
+}
+
+TEST_F(AttributeCache, remembers_missing_paths)
+{
+    const auto file_name = (temp_dir.path() + "/no-such-file").toStdString();
+    auto missing = [this] {
+        ++num_computes;
+        return mp::AttributeCache::Attributes{};
+    };
+
+    EXPECT_FALSE(cache.get(file_name, missing));
+    EXPECT_FALSE(cache.get(file_name, missing));
+    EXPECT_THAT(num_computes, Eq(1));
+}
+
+TEST_F(AttributeCache, does_not_cache_unnormalized_paths)
+{
+    const auto file_name = (temp_dir.path() + "/./test-file").toStdString();
+
+    cache.get(file_name, counting_compute(42));
+    cache.get(file_name, counting_compute(42));
+
+    EXPECT_THAT(num_computes, Eq(2));
+    EXPECT_THAT(cache.size(), Eq(0u));
+}
+
+TEST_F(AttributeCache, invalidate_drops_path_parent_and_children)
+{
+    const auto dir = temp_dir.path().toStdString();
+    const auto sub_dir = dir + "/sub";
+    const auto file_name = sub_dir + "/test-file";
+    const auto sibling = dir + "/sub-sibling";
+    ASSERT_TRUE(QDir().mkpath(QString::fromStdString(sub_dir)));
+
+    cache.get(dir, counting_compute(1));
+    cache.get(sub_dir, counting_compute(2));
+    cache.get(file_name, counting_compute(3));
+    cache.get(sibling, counting_compute(4));
+    ASSERT_THAT(cache.size(), Eq(4u));
+
+    cache.invalidate(sub_dir);
+
+    EXPECT_THAT(cache.size(), Eq(1u));
+    cache.get(sibling, counting_compute(0));
+    EXPECT_THAT(num_computes, Eq(4));
+}
+
+TEST_F(AttributeCache, invalidate_removes_watches_of_path_and_below)
+{
+    const auto dir = temp_dir.path().toStdString();
+    const auto sub_dir = dir + "/sub";
+    const auto sub_sub_dir = sub_dir + "/sub";
+    ASSERT_TRUE(QDir().mkpath(QString::fromStdString(sub_sub_dir)));
+
+    cache.get(sub_sub_dir, counting_compute(1));
+    ASSERT_THAT(cache.watch_count(), Eq(2u)); // sub_dir and sub_sub_dir
+
+    cache.get(dir + "/test-file", counting_compute(2));
+    ASSERT_THAT(cache.watch_count(), Eq(3u)); // dir as well
+
+    cache.invalidate(sub_dir);
+
+    EXPECT_THAT(cache.watch_count(), Eq(1u)); // dir stays for test-file
+}
+
+TEST_F(AttributeCache, clear_removes_all_watches)
+{
+    const auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    cache.get(file_name.toStdString(), counting_compute(42));
+    ASSERT_THAT(cache.watch_count(), Gt(0u));
+
+    cache.clear();
+
+    EXPECT_THAT(cache.size(), Eq(0u));
+    EXPECT_THAT(cache.watch_count(), Eq(0u));
+}
+
+TEST_F(AttributeCache, host_changes_invalidate_entries)
+{
+    const auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    cache.get(file_name.toStdString(), counting_compute(42));
+    ASSERT_THAT(cache.size(), Eq(1u));
+
+    QFile file(file_name);
+    ASSERT_TRUE(file.open(QFile::Append));
+    file.write("changed on the host");
+    file.close();
+
+    // Changes are noticed asynchronously
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cache.size() > 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    EXPECT_THAT(cache.size(), Eq(0u));
+}
@@ -831,6 +831,25 @@ TEST_F(Client, mount_cmd_fails_invalid_host_int_uid_map)
                 Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, mount_cmd_good_valid_uid_range_map)
+{
+    auto has_range = [](const mp::MountRequest& request) {
+        const auto& ranges = request.mount_maps().uid_ranges();
+        return ranges.size() == 1 && ranges[0].host_id() == 1000 && ranges[0].instance_id() == 2000 &&
+               ranges[0].count() == 1000;
+    };
+
+    EXPECT_CALL(mock_daemon, mount(_, Truly(has_range), _));
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "-u", "1000-1999:2000", "test-vm:test"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, mount_cmd_fails_reversed_uid_range_map)
+{
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "-u", "1999-1000:2000", "test-vm:test"}),
+                Eq(mp::ReturnCode::CommandLineError));
+}
+
 TEST_F(Client, mount_cmd_good_valid_gid_map)
 {
     EXPECT_CALL(mock_daemon, mount(_, _, _));
@@ -857,6 +876,37 @@ TEST_F(Client, mount_cmd_fails_invalid_host_int_gid_map)
                 Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, mount_cmd_native_type_sets_request_type)
+{
+    EXPECT_CALL(mock_daemon, mount(_, Property(&mp::MountRequest::mount_type, mp::MountRequest::NATIVE), _));
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "--type", "native", "test-vm:test"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, mount_cmd_native_type_sends_no_id_maps)
+{
+    auto has_no_maps = [](const mp::MountRequest& request) {
+        return request.mount_maps().uid_map().empty() && request.mount_maps().gid_map().empty();
+    };
+
+    EXPECT_CALL(mock_daemon, mount(_, Truly(has_no_maps), _));
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "--type", "native", "test-vm:test"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, mount_cmd_native_type_fails_with_id_maps)
+{
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "--type", "native", "-u", "1000:501",
+                              "test-vm:test"}),
+                Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, mount_cmd_fails_invalid_type)
+{
+    EXPECT_THAT(send_command({"mount", mpt::test_data_path().toStdString(), "-t", "nfs", "test-vm:test"}),
+                Eq(mp::ReturnCode::CommandLineError));
+}
+
 // recover cli tests
 TEST_F(Client, recover_cmd_fails_no_args)
 {
@@ -1529,7 +1579,10 @@ TEST_P(TestBasicGetSetOptions, set_cmd_allows_empty_val)
 }
 
 INSTANTIATE_TEST_SUITE_P(Client, TestBasicGetSetOptions,
-                         Values(mp::petenv_key, mp::driver_key, mp::autostart_key, mp::hotkey_key));
+                         Values(mp::petenv_key, mp::driver_key, mp::autostart_key, mp::hotkey_key,
+                                mp::image_overlays_key, mp::image_prefetch_key, mp::instance_pool_key,
+                                mp::telemetry_interval_key, mp::mount_workers_key, mp::mount_write_buffer_key,
+                                mp::mount_attribute_cache_key));
 
 TEST_F(Client, get_cmd_fails_with_no_arguments)
 {
@@ -1645,6 +1698,64 @@ TEST_F(Client, set_cmd_rejects_bad_autostart_values)
     aux_set_cmd_rejects_bad_val(mp::autostart_key, "");
 }
 
+TEST_F(Client, get_returns_disabled_image_overlays_by_default)
+{
+    EXPECT_THAT(get_setting(mp::image_overlays_key), Eq("false"));
+}
+
+TEST_F(Client, set_cmd_rejects_bad_image_overlays_values)
+{
+    aux_set_cmd_rejects_bad_val(mp::image_overlays_key, "asdf");
+    aux_set_cmd_rejects_bad_val(mp::image_overlays_key, "");
+}
+
+TEST_F(Client, get_returns_no_images_to_prefetch_by_default)
+{
+    EXPECT_THAT(get_setting(mp::image_prefetch_key), Eq(""));
+}
+
+TEST_F(Client, set_cmd_rejects_bad_image_prefetch_values)
+{
+    aux_set_cmd_rejects_bad_val(mp::image_prefetch_key, "daily:");
+    aux_set_cmd_rejects_bad_val(mp::image_prefetch_key, "lts,a:b:c");
+}
+
+TEST_F(Client, get_returns_no_spare_instances_by_default)
+{
+    EXPECT_THAT(get_setting(mp::instance_pool_key), Eq("0"));
+}
+
+TEST_F(Client, set_cmd_rejects_bad_instance_pool_values)
+{
+    aux_set_cmd_rejects_bad_val(mp::instance_pool_key, "-1");
+    aux_set_cmd_rejects_bad_val(mp::instance_pool_key, "some");
+}
+
+TEST_F(Client, get_returns_no_telemetry_interval_by_default)
+{
+    EXPECT_THAT(get_setting(mp::telemetry_interval_key), Eq("0"));
+}
+
+TEST_F(Client, set_cmd_rejects_bad_telemetry_interval_values)
+{
+    aux_set_cmd_rejects_bad_val(mp::telemetry_interval_key, "-1");
+    aux_set_cmd_rejects_bad_val(mp::telemetry_interval_key, "1m");
+}
+
+TEST_F(Client, get_returns_mount_tuning_enabled_by_default)
+{
+    EXPECT_THAT(get_setting(mp::mount_workers_key), Eq("4"));
+    EXPECT_THAT(get_setting(mp::mount_write_buffer_key), Eq("1048576"));
+    EXPECT_THAT(get_setting(mp::mount_attribute_cache_key), Eq("true"));
+}
+
+TEST_F(Client, set_cmd_rejects_bad_mount_tuning_values)
+{
+    aux_set_cmd_rejects_bad_val(mp::mount_workers_key, "-1");
+    aux_set_cmd_rejects_bad_val(mp::mount_write_buffer_key, "1M");
+    aux_set_cmd_rejects_bad_val(mp::mount_attribute_cache_key, "sometimes");
+}
+
 TEST_F(Client, get_and_set_can_read_and_write_autostart_flag)
 {
     const auto orig = get_setting((mp::autostart_key));
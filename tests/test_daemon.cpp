@@ -31,9 +31,12 @@
 #include <multipass/vm_image_host.h>
 
 #include "extra_assertions.h"
+#include "file_operations.h"
 #include "mock_environment_helpers.h"
 #include "mock_process_factory.h"
+#include "mock_settings.h"
 #include "mock_standard_paths.h"
+#include "mock_virtual_machine.h"
 #include "mock_virtual_machine_factory.h"
 #include "mock_vm_image_vault.h"
 #include "stub_cert_store.h"
@@ -56,10 +59,12 @@
 
 #include <scope_guard.hpp>
 
+#include <chrono>
 #include <memory>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpt = multipass::test;
@@ -135,6 +140,20 @@ struct StubNameGenerator : public mp::NameGenerator
     std::string name;
 };
 
+// Hands out the names in order, then keeps repeating the last one
+struct NameSequenceGenerator : public mp::NameGenerator
+{
+    explicit NameSequenceGenerator(std::vector<std::string> names) : names{std::move(names)}
+    {
+    }
+    std::string make_name() override
+    {
+        return next < names.size() - 1 ? names[next++] : names.back();
+    }
+    std::vector<std::string> names;
+    std::size_t next{0};
+};
+
 class TestCreate final : public mp::cmd::Command
 {
 public:
@@ -443,6 +462,105 @@ TEST_F(Daemon, data_path_with_storage_valid)
     EXPECT_EQ(config->cache_directory.toStdString(), storage_dir.filePath("cache").toStdString());
 }
 
+TEST_F(Daemon, prefetches_configured_images_on_startup)
+{
+    ON_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::image_prefetch_key)))
+        .WillByDefault(Return("lts, daily:devel"));
+
+    auto mock_image_vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    EXPECT_CALL(*mock_image_vault,
+                fetch_image(_, AllOf(Field(&mp::Query::release, "lts"), Field(&mp::Query::remote_name, "")), _, _));
+    EXPECT_CALL(*mock_image_vault,
+                fetch_image(_, AllOf(Field(&mp::Query::release, "devel"), Field(&mp::Query::remote_name, "daily")), _,
+                            _));
+
+    config_builder.vault = std::move(mock_image_vault);
+    mp::Daemon daemon{config_builder.build()}; // prefetching is waited for on destruction
+}
+
+TEST_F(Daemon, stops_updating_images_on_destruction)
+{
+    ON_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::image_prefetch_key))).WillByDefault(Return("lts"));
+
+    // Stands for a download that only ends when its monitor says so
+    auto mock_image_vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    ON_CALL(*mock_image_vault, update_images(_, _, _)).WillByDefault([](const auto&, const auto&, const auto& monitor) {
+        while (monitor(mp::LaunchProgress::IMAGE, 0))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    EXPECT_CALL(*mock_image_vault, fetch_image(_, _, _, _)).Times(0);
+
+    config_builder.vault = std::move(mock_image_vault);
+    mp::Daemon daemon{config_builder.build()};
+}
+
+TEST_F(Daemon, launches_spare_instance_of_the_pool)
+{
+    ON_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::instance_pool_key))).WillByDefault(Return("1"));
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.name_generator = std::make_unique<StubNameGenerator>("spare");
+
+    // Only the spare gets created: the one to replace it cannot get a name of its own here
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .WillOnce([this](const auto&...) -> mp::VirtualMachine::UPtr {
+            loop.quit();
+            return std::make_unique<mpt::StubVirtualMachine>();
+        });
+
+    mp::Daemon daemon{config_builder.build()};
+    loop.exec(); // until the spare is created
+
+    std::stringstream stream;
+    send_command({"launch"}, stream);
+    EXPECT_THAT(stream.str(), HasSubstr("spare"));
+}
+
+TEST_F(Daemon, launch_does_not_claim_spare_instance_that_does_not_match)
+{
+    ON_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::instance_pool_key))).WillByDefault(Return("1"));
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.name_generator = std::make_unique<NameSequenceGenerator>(std::vector<std::string>{"spare", "other"});
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "spare"), _))
+        .WillOnce([this](const auto&...) -> mp::VirtualMachine::UPtr {
+            loop.quit();
+            return std::make_unique<mpt::StubVirtualMachine>();
+        });
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "other"), _));
+
+    mp::Daemon daemon{config_builder.build()};
+    loop.exec(); // until the spare is created
+
+    // Spares have the default number of cores
+    std::stringstream stream;
+    send_command({"launch", "--cpus", "4"}, stream);
+    EXPECT_THAT(stream.str(), HasSubstr("other"));
+}
+
+TEST_F(Daemon, removes_spare_instances_no_longer_wanted)
+{
+    // A spare kept from when the pool setting was higher
+    mpt::make_file_with_content(QDir{data_dir.path()}.filePath("multipassd-vm-instances.json"), R"({
+        "spare": {"num_cores": 1, "mem_size": "1073741824", "disk_space": "5368709120",
+                  "mac_addr": "52:54:00:00:00:01", "ssh_username": "ubuntu", "state": 0, "deleted": false,
+                  "metadata": {}, "mounts": [], "spare_for": "default"}
+    })");
+    ON_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::instance_pool_key))).WillByDefault(Return("0"));
+
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>(); // which knows of every instance
+
+    auto mock_factory = use_a_mock_vm_factory();
+    EXPECT_CALL(*mock_factory, create_virtual_machine(Field(&mp::VirtualMachineDescription::vm_name, "spare"), _))
+        .WillOnce([this](const auto&...) -> mp::VirtualMachine::UPtr {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>("spare");
+            EXPECT_CALL(*vm, shutdown).WillOnce([this] { loop.quit(); });
+            return vm;
+        });
+
+    mp::Daemon daemon{config_builder.build()};
+    loop.exec(); // until the spare is shut down
+}
+
 namespace
 {
 struct DaemonCreateLaunchTestSuite : public Daemon, public WithParamInterface<std::string>
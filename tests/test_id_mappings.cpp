@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/cli/client_platform.h>
+#include <multipass/id_mappings.h>
+
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <stdexcept>
+
+namespace mp = multipass;
+using namespace testing;
+
+TEST(IdMappings, starts_empty)
+{
+    mp::IdMappings mappings;
+
+    EXPECT_TRUE(mappings.empty());
+    EXPECT_FALSE(mappings.instance_id_for(1000));
+    EXPECT_EQ(mappings.to_string(), "");
+}
+
+TEST(IdMappings, maps_ids_within_ranges)
+{
+    mp::IdMappings mappings;
+    mappings.add(1000, 2000, 10);
+    mappings.add(5, 0);
+
+    EXPECT_EQ(mappings.instance_id_for(1000), 2000);
+    EXPECT_EQ(mappings.instance_id_for(1009), 2009);
+    EXPECT_EQ(mappings.instance_id_for(5), 0);
+    EXPECT_FALSE(mappings.instance_id_for(1010));
+    EXPECT_FALSE(mappings.instance_id_for(999));
+    EXPECT_FALSE(mappings.instance_id_for(4));
+    EXPECT_FALSE(mappings.instance_id_for(6));
+}
+
+TEST(IdMappings, merges_consecutive_ids_into_one_range)
+{
+    const mp::IdMappings mappings{{1002, 2002}, {1000, 2000}, {1001, 2001}, {3000, 1}};
+
+    ASSERT_EQ(mappings.ranges().size(), 2u);
+    EXPECT_EQ(mappings.ranges()[0].host_id, 1000);
+    EXPECT_EQ(mappings.ranges()[0].instance_id, 2000);
+    EXPECT_EQ(mappings.ranges()[0].count, 3);
+    EXPECT_EQ(mappings.ranges()[1].host_id, 3000);
+    EXPECT_EQ(mappings.ranges()[1].count, 1);
+}
+
+TEST(IdMappings, merges_a_range_filling_a_gap)
+{
+    mp::IdMappings mappings;
+    mappings.add(0, 100, 10);
+    mappings.add(20, 120, 10);
+    mappings.add(10, 110, 10);
+
+    ASSERT_EQ(mappings.ranges().size(), 1u);
+    EXPECT_EQ(mappings.ranges()[0].count, 30);
+}
+
+TEST(IdMappings, does_not_merge_ids_that_map_apart)
+{
+    const mp::IdMappings mappings{{1000, 2000}, {1001, 3000}};
+
+    EXPECT_EQ(mappings.ranges().size(), 2u);
+}
+
+TEST(IdMappings, maps_whole_range_to_default_id)
+{
+    const mp::IdMappings mappings{{1000, mp::default_id}, {1001, mp::default_id}, {1002, 1}};
+
+    EXPECT_EQ(mappings.ranges().size(), 2u);
+    EXPECT_EQ(mappings.instance_id_for(1001), mp::default_id);
+    EXPECT_EQ(mappings.instance_id_for(1002), 1);
+}
+
+TEST(IdMappings, throws_on_overlapping_ranges)
+{
+    mp::IdMappings mappings;
+    mappings.add(1000, 2000, 10);
+
+    EXPECT_THROW(mappings.add(1005, 0), std::invalid_argument);
+    EXPECT_THROW(mappings.add(990, 0, 11), std::invalid_argument);
+    EXPECT_NO_THROW(mappings.add(990, 0, 10));
+}
+
+TEST(IdMappings, throws_on_out_of_range_ids)
+{
+    mp::IdMappings mappings;
+
+    EXPECT_THROW(mappings.add(-5, 0), std::invalid_argument);
+    EXPECT_THROW(mappings.add(0, -5), std::invalid_argument);
+    EXPECT_THROW(mappings.add(0, 0, 0), std::invalid_argument);
+    EXPECT_THROW(mappings.add(std::numeric_limits<int>::max(), 0, 2), std::invalid_argument);
+    EXPECT_TRUE(mappings.empty());
+}
+
+TEST(IdMappings, string_round_trip_preserves_mappings)
+{
+    mp::IdMappings mappings{{5, mp::default_id}, {6, 10}};
+    mappings.add(1000, 2000, 1000);
+
+    EXPECT_EQ(mappings.to_string(), "5:-1,6:10,1000-1999:2000");
+    EXPECT_EQ(mp::IdMappings::from_string(mappings.to_string()), mappings);
+}
+
+TEST(IdMappings, from_string_accepts_trailing_separator)
+{
+    EXPECT_EQ(mp::IdMappings::from_string("1:2,3:4,"), (mp::IdMappings{{1, 2}, {3, 4}}));
+}
+
+TEST(IdMappings, from_string_throws_on_bad_input)
+{
+    EXPECT_THROW(mp::IdMappings::from_string("foo:bar"), std::invalid_argument);
+    EXPECT_THROW(mp::IdMappings::from_string("1:2:3"), std::invalid_argument);
+    EXPECT_THROW(mp::IdMappings::from_string("10-5:0"), std::invalid_argument);
+    EXPECT_THROW(mp::IdMappings::from_string("1-2-3:0"), std::invalid_argument);
+    EXPECT_THROW(mp::IdMappings::from_string("1-10:0,5:0"), std::invalid_argument);
+}
+
+TEST(IdMappings, interned_mappings_share_a_table)
+{
+    const auto first = mp::IdMappings::intern({{1000, 1000}});
+    const auto second = mp::IdMappings::intern({{1000, 1000}});
+    const auto other = mp::IdMappings::intern({{1000, 0}});
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, other);
+    EXPECT_EQ(*other, (mp::IdMappings{{1000, 0}}));
+}
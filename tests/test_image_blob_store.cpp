@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/image_blob_store.h>
+#include <multipass/utils.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto image_hash = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+constexpr auto image_data = "multipass image data";
+
+struct ImageBlobStore : public Test
+{
+    mpt::TempDir temp_dir;
+    QDir dir{temp_dir.path()};
+    QString image_path{dir.filePath("image.img")};
+    mp::vault::ImageBlobStore blob_store{dir.filePath("blobs")};
+};
+} // namespace
+
+TEST_F(ImageBlobStore, fetches_added_image)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add(image_hash, image_path);
+
+    const auto fetched_path = dir.filePath("fetched.img");
+    ASSERT_TRUE(blob_store.fetch(image_hash, fetched_path));
+
+    EXPECT_EQ(mp::utils::contents_of(fetched_path), image_data);
+}
+
+TEST_F(ImageBlobStore, does_not_fetch_unknown_image)
+{
+    EXPECT_FALSE(blob_store.fetch(image_hash, image_path));
+    EXPECT_FALSE(QFile::exists(image_path));
+}
+
+TEST_F(ImageBlobStore, only_keeps_images_by_sha256)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add("not-a-hash", image_path);
+
+    EXPECT_FALSE(blob_store.fetch("not-a-hash", dir.filePath("fetched.img")));
+    EXPECT_FALSE(QFile::exists(dir.filePath("blobs/not-a-hash")));
+}
+
+TEST_F(ImageBlobStore, counts_references_to_blob)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add(image_hash, image_path);
+    ASSERT_TRUE(blob_store.fetch(image_hash, dir.filePath("fetched.img")));
+
+    EXPECT_EQ(blob_store.reference_count(image_hash), 2);
+
+    QFile::remove(image_path);
+    QFile::remove(dir.filePath("fetched.img"));
+
+    EXPECT_EQ(blob_store.reference_count(image_hash), 0);
+}
+
+TEST_F(ImageBlobStore, prune_keeps_referenced_blobs)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add(image_hash, image_path);
+
+    blob_store.prune(mp::days{0});
+
+    EXPECT_TRUE(blob_store.fetch(image_hash, dir.filePath("fetched.img")));
+}
+
+TEST_F(ImageBlobStore, prune_removes_unreferenced_blobs)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add(image_hash, image_path);
+    QFile::remove(image_path);
+
+    blob_store.prune(mp::days{0});
+
+    EXPECT_FALSE(blob_store.fetch(image_hash, dir.filePath("fetched.img")));
+}
+
+TEST_F(ImageBlobStore, prune_keeps_recently_used_blobs)
+{
+    mpt::make_file_with_content(image_path, image_data);
+    blob_store.add(image_hash, image_path);
+    QFile::remove(image_path);
+
+    blob_store.prune(mp::days{1});
+
+    EXPECT_TRUE(blob_store.fetch(image_hash, dir.filePath("fetched.img")));
+}
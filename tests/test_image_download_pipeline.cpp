@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "temp_dir.h"
+
+#include <multipass/image_download_pipeline.h>
+#include <multipass/utils.h>
+
+#include <gmock/gmock.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+const std::string image_data{"multipass image data\nmultipass image data\nmultipass image data\nmultipass image data\n"};
+
+// image_data, xz compressed with a CRC64 check
+constexpr char xz_image_data[] =
+    "\xfd\x37\x7a\x58\x5a\x00\x00\x04\xe6\xd6\xb4\x46\x02\x00\x21\x01\x16\x00\x00\x00\x74\x2f\xe5\xa3\xe0\x00\x53"
+    "\x00\x1c\x5d\x00\x36\x9d\x49\xbd\x02\xfa\xf9\xfa\x3d\x04\x51\x51\x62\x8b\x4e\x4a\x34\xda\x76\x54\x2b\x5a\xf0"
+    "\xbc\x68\xa8\x00\x00\x00\x6c\xec\xaf\x7e\x32\xca\x36\xfc\x00\x01\x38\x54\x3d\x9c\x1f\x5b\x1f\xb6\xf3\x7d\x01"
+    "\x00\x00\x00\x00\x04\x59\x5a";
+
+QString sha256_of(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+}
+
+struct ImageDownloadPipeline : public Test
+{
+    // Hands the data over in small pieces, the way it arrives from the network
+    void push_in_chunks(mp::vault::ImageDownloadPipeline& pipeline, const QByteArray& data, int chunk_size = 7)
+    {
+        for (int pos = 0; pos < data.size(); pos += chunk_size)
+            ASSERT_TRUE(pipeline.push(data.mid(pos, chunk_size)));
+    }
+
+    mpt::TempDir temp_dir;
+    QString image_path{QDir{temp_dir.path()}.filePath("image.img")};
+    const QByteArray xz_data{xz_image_data, sizeof(xz_image_data) - 1};
+};
+} // namespace
+
+TEST_F(ImageDownloadPipeline, writes_data_as_is)
+{
+    const auto data = QByteArray::fromStdString(image_data);
+
+    mp::vault::ImageDownloadPipeline pipeline{image_path, sha256_of(data), false};
+    push_in_chunks(pipeline, data);
+    pipeline.finish();
+
+    EXPECT_EQ(mp::utils::contents_of(image_path), image_data);
+}
+
+TEST_F(ImageDownloadPipeline, decodes_xz_data)
+{
+    mp::vault::ImageDownloadPipeline pipeline{image_path, sha256_of(xz_data), true};
+    push_in_chunks(pipeline, xz_data);
+    pipeline.finish();
+
+    EXPECT_EQ(mp::utils::contents_of(image_path), image_data);
+}
+
+TEST_F(ImageDownloadPipeline, skips_verification_without_hash)
+{
+    mp::vault::ImageDownloadPipeline pipeline{image_path, "", false};
+    push_in_chunks(pipeline, "anything");
+
+    EXPECT_NO_THROW(pipeline.finish());
+}
+
+TEST_F(ImageDownloadPipeline, throws_on_hash_mismatch)
+{
+    mp::vault::ImageDownloadPipeline pipeline{image_path, sha256_of("something else"), false};
+    push_in_chunks(pipeline, QByteArray::fromStdString(image_data));
+
+    EXPECT_THROW(pipeline.finish(), std::runtime_error);
+}
+
+TEST_F(ImageDownloadPipeline, throws_on_truncated_xz_data)
+{
+    mp::vault::ImageDownloadPipeline pipeline{image_path, "", true};
+    push_in_chunks(pipeline, xz_data.left(xz_data.size() - 10));
+
+    EXPECT_THROW(pipeline.finish(), std::runtime_error);
+}
+
+TEST_F(ImageDownloadPipeline, stops_taking_data_once_decoding_failed)
+{
+    mp::vault::ImageDownloadPipeline pipeline{image_path, "", true};
+
+    // Not xz at all; the decoder fails on its own thread, so keep pushing until it is noticed
+    bool accepted{true};
+    for (int i = 0; i < 1000 && accepted; ++i)
+        accepted = pipeline.push("not xz data");
+
+    EXPECT_THROW(pipeline.throw_if_failed(), std::runtime_error);
+    EXPECT_FALSE(pipeline.push("more data"));
+    EXPECT_THROW(pipeline.finish(), std::runtime_error);
+}
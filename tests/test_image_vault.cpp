@@ -22,18 +22,22 @@
 #include "file_operations.h"
 #include "mock_image_host.h"
 #include "mock_process_factory.h"
+#include "mock_settings.h"
 #include "path.h"
 #include "stub_url_downloader.h"
 #include "temp_dir.h"
 #include "tracking_url_downloader.h"
 
+#include <multipass/constants.h>
 #include <multipass/exceptions/aborted_download_exception.h>
 #include <multipass/exceptions/create_image_exception.h>
+#include <multipass/exceptions/download_exception.h>
 #include <multipass/format.h>
 #include <multipass/query.h>
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QThread>
 #include <QUrl>
@@ -60,6 +64,13 @@ struct BadURLDownloader : public mp::URLDownloader
         mpt::make_file_with_content(file_name, "Bad hash");
     }
 
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const mp::ProgressMonitor&) override
+    {
+        mpt::make_file_with_content(file_name, "Bad hash");
+        sink("Bad hash");
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -79,6 +90,14 @@ struct HttpURLDownloader : public mp::URLDownloader
         downloaded_files << file_name;
     }
 
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const mp::ProgressMonitor&) override
+    {
+        mpt::make_file_with_content(file_name, "");
+        downloaded_urls << url.toString();
+        downloaded_files << file_name;
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -107,12 +126,86 @@ struct RunningURLDownloader : public mp::URLDownloader
         throw mp::AbortedDownloadException("Aborted!");
     }
 
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const mp::ProgressMonitor& monitor) override
+    {
+        download_to(url, file_name, size, download_type, monitor);
+    }
+
+    QByteArray download(const QUrl& url) override
+    {
+        return {};
+    }
+};
+
+struct FailingURLDownloader : public mp::URLDownloader
+{
+    FailingURLDownloader() : mp::URLDownloader{std::chrono::seconds(10)}
+    {
+    }
+
+    void download_to(const QUrl& url, const QString& file_name, int64_t size, const int download_type,
+                     const mp::ProgressMonitor&) override
+    {
+        mpt::make_file_with_content(file_name, "partial");
+        throw mp::DownloadException{url.toString().toStdString(), "Network timeout"};
+    }
+
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const mp::ProgressMonitor&) override
+    {
+        mpt::make_file_with_content(file_name, "partial");
+        sink("partial");
+        throw mp::DownloadException{url.toString().toStdString(), "Network timeout"};
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};
     }
 };
 
+// Gets through half of the content before the network fails, then carries on from whatever is in the file already,
+// handing all of it over in order as the real downloader does
+struct InterruptedURLDownloader : public mp::URLDownloader
+{
+    InterruptedURLDownloader(const QByteArray& content)
+        : mp::URLDownloader{std::chrono::seconds(10)}, content{content}
+    {
+    }
+
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const mp::ProgressMonitor&) override
+    {
+        QFile file{file_name};
+        file.open(QIODevice::ReadWrite | QIODevice::Append);
+        resumed_from.push_back(file.size());
+
+        if (file.size() == 0)
+        {
+            const auto first_half = content.left(content.size() / 2);
+            file.write(first_half);
+            sink(first_half);
+            throw mp::DownloadException{url.toString().toStdString(), "Network timeout"};
+        }
+
+        file.seek(0);
+        sink(file.readAll());
+
+        const auto rest = content.mid(file.size());
+        file.write(rest);
+        sink(rest);
+    }
+
+    QByteArray download(const QUrl& url) override
+    {
+        return {};
+    }
+
+    const QByteArray content;
+    std::vector<qint64> resumed_from;
+};
+
 struct ImageVault : public testing::Test
 {
     void SetUp()
@@ -163,6 +256,13 @@ struct ImageVault : public testing::Test
     mp::ProgressMonitor stub_monitor{[](int, int) { return true; }};
     mp::VMImageVault::PrepareAction stub_prepare{
         [](const mp::VMImage& source_image) -> mp::VMImage { return source_image; }};
+    // Leaves images in a format that only qemu-img knows about
+    mp::VMImageVault::PrepareAction vhdx_prepare{[](const mp::VMImage& source_image) -> mp::VMImage {
+        QFile image_file{source_image.image_path};
+        image_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        image_file.write("vhdxfile");
+        return source_image;
+    }};
     mpt::TempDir cache_dir;
     mpt::TempDir data_dir;
     std::string instance_name{"valley-pied-piper"};
@@ -175,10 +275,32 @@ TEST_F(ImageVault, downloads_image)
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
     auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.image.url()));
 }
 
+TEST_F(ImageVault, uses_image_from_blob_store_instead_of_downloading)
+{
+    constexpr auto expected_data = "12345-pied-piper-rats";
+    mp::utils::make_dir(cache_dir.path(), "blobs");
+    mpt::make_file_with_content(QDir{cache_dir.path()}.filePath(QString("blobs/%1").arg(mpt::default_id)),
+                                expected_data);
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_TRUE(url_downloader.downloaded_urls.isEmpty());
+    EXPECT_THAT(mp::utils::contents_of(vm_image.image_path), StrEq(expected_data));
+}
+
+TEST_F(ImageVault, keeps_downloaded_image_in_blob_store)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_TRUE(QFileInfo::exists(QDir{cache_dir.path()}.filePath(QString("blobs/%1").arg(mpt::default_id))));
+}
+
 TEST_F(ImageVault, returned_image_contains_instance_name)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
@@ -192,7 +314,7 @@ TEST_F(ImageVault, downloads_kernel_and_initrd)
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
     auto vm_image = vault.fetch_image(mp::FetchType::ImageKernelAndInitrd, default_query, stub_prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(3));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(3));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.image.url()));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.kernel.url()));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.initrd.url()));
@@ -226,7 +348,7 @@ TEST_F(ImageVault, records_instanced_images)
     auto vm_image1 = vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
     auto vm_image2 = vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Eq(vm_image2.image_path));
     EXPECT_THAT(vm_image1.id, Eq(vm_image2.id));
@@ -246,7 +368,7 @@ TEST_F(ImageVault, caches_prepared_images)
     another_query.name = "valley-pied-piper-chat";
     auto vm_image2 = vault.fetch_image(mp::FetchType::ImageOnly, another_query, prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
 
     EXPECT_THAT(vm_image1.image_path, Ne(vm_image2.image_path));
@@ -267,7 +389,7 @@ TEST_F(ImageVault, remembers_instance_images)
     mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
     auto vm_image2 = another_vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Eq(vm_image2.image_path));
 }
@@ -288,7 +410,7 @@ TEST_F(ImageVault, remembers_prepared_images)
     mp::DefaultVMImageVault another_vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
     auto vm_image2 = another_vault.fetch_image(mp::FetchType::ImageOnly, another_query, prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Ne(vm_image2.image_path));
     EXPECT_THAT(vm_image1.id, Eq(vm_image2.id));
@@ -334,6 +456,31 @@ TEST_F(ImageVault, image_purged_expired)
     EXPECT_FALSE(QFileInfo::exists(file_name));
 }
 
+TEST_F(ImageVault, expired_image_is_kept_while_it_backs_instance_images)
+{
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
+    QDir images_dir{mp::utils::make_dir(cache_dir.path(), "vault/images/mock_image")};
+    auto file_name = images_dir.filePath("mock_image.img");
+
+    auto prepare = [&file_name](const mp::VMImage& source_image) -> mp::VMImage {
+        mpt::make_file_with_content(file_name);
+        return {file_name, "", "", source_image.id, "", "", "", {}};
+    };
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
+
+    // Stand in for an overlay on top of the prepared image
+    QFile::remove(vm_image.image_path);
+    mpt::make_qcow2_overlay_header(vm_image.image_path, file_name);
+
+    vault.prune_expired_images();
+    EXPECT_TRUE(QFileInfo::exists(file_name));
+
+    vault.remove(instance_name);
+    vault.prune_expired_images();
+    EXPECT_FALSE(QFileInfo::exists(file_name));
+}
+
 TEST_F(ImageVault, image_exists_not_expired)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
@@ -392,16 +539,44 @@ TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(custom_image_url_downloads))
 
     vault.fetch_image(mp::FetchType::ImageOnly, query, stub_prepare, stub_monitor);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(QString::fromStdString(query.release)));
 }
 
-TEST_F(ImageVault, missing_downloaded_image_throws)
+TEST_F(ImageVault, failed_image_download_throws_and_removes_image)
 {
-    mpt::StubURLDownloader stub_url_downloader;
-    mp::DefaultVMImageVault vault{hosts, &stub_url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    FailingURLDownloader failing_url_downloader;
+    mp::DefaultVMImageVault vault{hosts, &failing_url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
+    QStringList source_images;
+    auto prepare = [&source_images](const mp::VMImage& source_image) {
+        source_images << source_image.image_path;
+        return source_image;
+    };
+
+    EXPECT_THROW(vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor),
+                 mp::CreateImageException);
+    EXPECT_TRUE(source_images.isEmpty());
+
+    QDir image_dir{QDir{cache_dir.path()}.filePath(QString("vault/images/bionic-%1").arg(mpt::default_version))};
+    EXPECT_TRUE(image_dir.isEmpty());
+}
+
+TEST_F(ImageVault, interrupted_download_resumes_on_next_fetch)
+{
+    const QByteArray content{"12345-pied-piper-rats"};
+    host.mock_bionic_image_info.id = QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex();
+
+    InterruptedURLDownloader interrupted_url_downloader{content};
+    mp::DefaultVMImageVault vault{hosts, &interrupted_url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+
     EXPECT_THROW(vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor),
                  mp::CreateImageException);
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(interrupted_url_downloader.resumed_from, ElementsAre(0, content.size() / 2));
+    EXPECT_THAT(mp::utils::contents_of(vm_image.image_path), StrEq(content.toStdString()));
+    EXPECT_TRUE(QDir{QDir{cache_dir.path()}.filePath("vault/partial")}.isEmpty());
 }
 
 TEST_F(ImageVault, hash_mismatch_throws)
@@ -468,10 +643,16 @@ TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(http_download_returns_expected_i
 
 TEST_F(ImageVault, image_update_creates_new_dir_and_removes_old)
 {
+    QStringList source_images;
+    auto prepare = [&source_images](const mp::VMImage& source_image) {
+        source_images << source_image.image_path;
+        return source_image;
+    };
+
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
-    vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
 
-    auto original_file{url_downloader.downloaded_files[0]};
+    auto original_file{source_images[0]};
     auto original_absolute_path{QFileInfo(original_file).absolutePath()};
     EXPECT_TRUE(QFileInfo::exists(original_file));
     EXPECT_TRUE(original_absolute_path.contains(mpt::default_version));
@@ -482,9 +663,9 @@ TEST_F(ImageVault, image_update_creates_new_dir_and_removes_old)
     host.mock_bionic_image_info.version = new_date_string;
     host.mock_bionic_image_info.verify = false;
 
-    vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
+    vault.update_images(mp::FetchType::ImageOnly, prepare, stub_monitor);
 
-    auto updated_file{url_downloader.downloaded_files[1]};
+    auto updated_file{source_images[1]};
     EXPECT_TRUE(QFileInfo::exists(updated_file));
     EXPECT_TRUE(QFileInfo(updated_file).absolutePath().contains(new_date_string));
 
@@ -504,7 +685,7 @@ TEST_F(ImageVault, aborted_download_throws)
                  mp::AbortedDownloadException);
 }
 
-TEST_F(ImageVault, minimum_image_size_returns_expected_size)
+TEST_F(ImageVault, minimum_image_size_asks_qemuimg_about_other_formats)
 {
     const mp::MemorySize image_size{"1048576"};
     const mp::ProcessState qemuimg_exit_status{0, mp::nullopt};
@@ -512,13 +693,31 @@ TEST_F(ImageVault, minimum_image_size_returns_expected_size)
     auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
 
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
-    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, vhdx_prepare, stub_monitor);
 
     const auto size = vault.minimum_image_size_for(vm_image.id);
 
     EXPECT_EQ(image_size, size);
 }
 
+TEST_F(ImageVault, minimum_image_size_reads_raw_image_size_itself)
+{
+    const mp::MemorySize image_size{"1048576"};
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback(
+        [](mpt::MockProcess* process) { ADD_FAILURE() << "unexpected " << process->program().toStdString(); });
+
+    mp::VMImageVault::PrepareAction resize_prepare{[&image_size](const mp::VMImage& source_image) -> mp::VMImage {
+        QFile{source_image.image_path}.resize(image_size.in_bytes());
+        return source_image;
+    }};
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, resize_prepare, stub_monitor);
+
+    EXPECT_EQ(vault.minimum_image_size_for(vm_image.id), image_size);
+}
+
 TEST_F(ImageVault, minimum_image_size_throws_when_not_cached)
 {
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{1}};
@@ -536,7 +735,7 @@ TEST_F(ImageVault, minimum_image_size_throws_when_qemuimg_info_crashes)
     auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
 
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
-    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, vhdx_prepare, stub_monitor);
 
     MP_EXPECT_THROW_THAT(
         vault.minimum_image_size_for(vm_image.id), std::runtime_error,
@@ -550,7 +749,7 @@ TEST_F(ImageVault, minimum_image_size_throws_when_qemuimg_info_cannot_find_the_i
     auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
 
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
-    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, vhdx_prepare, stub_monitor);
 
     MP_EXPECT_THROW_THAT(
         vault.minimum_image_size_for(vm_image.id), std::runtime_error,
@@ -564,8 +763,62 @@ TEST_F(ImageVault, minimum_image_size_throws_when_qemuimg_info_does_not_understa
     auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
 
     mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
-    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, stub_prepare, stub_monitor);
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, vhdx_prepare, stub_monitor);
 
     MP_EXPECT_THROW_THAT(vault.minimum_image_size_for(vm_image.id), std::runtime_error,
                          Property(&std::runtime_error::what, HasSubstr("Could not obtain image's virtual size")));
 }
+
+TEST_F(ImageVault, instance_image_is_copied_when_overlay_cannot_be_created)
+{
+    constexpr auto expected_data = "12345-pied-piper-rats";
+
+    QDir dir{cache_dir.path()};
+    auto file_name = dir.filePath("prepared-image");
+    mpt::make_file_with_content(file_name, expected_data);
+
+    auto prepare = [&file_name](const mp::VMImage& source_image) -> mp::VMImage {
+        return {file_name, "", "", source_image.id, "", "", "", {}};
+    };
+
+    EXPECT_CALL(mpt::MockSettings::mock_instance(), get(Eq(mp::image_overlays_key))).WillRepeatedly(Return("true"));
+
+    // Not a qcow2 image, so qemu-img refuses to put an overlay on top of it
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([](mpt::MockProcess* process) {
+        ASSERT_EQ(process->program().toStdString(), "qemu-img");
+        EXPECT_EQ(process->arguments().constFirst(), "create");
+        EXPECT_CALL(*process, execute).WillOnce(Return(mp::ProcessState{1, mp::nullopt}));
+    });
+
+    mp::DefaultVMImageVault vault{hosts, &url_downloader, cache_dir.path(), data_dir.path(), mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly, default_query, prepare, stub_monitor);
+
+    EXPECT_THAT(mp::utils::contents_of(vm_image.image_path), StrEq(expected_data));
+    EXPECT_TRUE(mp::vault::backing_file_of(vm_image.image_path).isEmpty());
+}
+
+TEST_F(ImageVault, backing_file_of_reads_qcow2_header)
+{
+    const auto overlay_path = QDir{data_dir.path()}.filePath("overlay.img");
+    mpt::make_qcow2_overlay_header(overlay_path, "/path/to/backing.img");
+
+    EXPECT_EQ(mp::vault::backing_file_of(overlay_path), "/path/to/backing.img");
+}
+
+TEST_F(ImageVault, backing_file_of_resolves_relative_names)
+{
+    const auto overlay_path = QDir{data_dir.path()}.filePath("overlay.img");
+    mpt::make_qcow2_overlay_header(overlay_path, "backing.img");
+
+    EXPECT_EQ(mp::vault::backing_file_of(overlay_path), QDir{data_dir.path()}.absoluteFilePath("backing.img"));
+}
+
+TEST_F(ImageVault, backing_file_of_other_images_is_empty)
+{
+    const auto image_path = QDir{data_dir.path()}.filePath("image.img");
+    mpt::make_file_with_content(image_path);
+
+    EXPECT_TRUE(mp::vault::backing_file_of(image_path).isEmpty());
+    EXPECT_TRUE(mp::vault::backing_file_of(QDir{data_dir.path()}.filePath("missing.img")).isEmpty());
+}
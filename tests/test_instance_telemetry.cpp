@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/daemon/instance_telemetry.h"
+
+#include <gmock/gmock.h>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct InstanceTelemetry : public Test
+{
+    mp::TelemetrySample sample_at(std::chrono::system_clock::duration age, const std::string& load)
+    {
+        return {now - age, load, "", "", "", "", ""};
+    }
+
+    std::vector<std::string> loads_since(std::chrono::system_clock::duration age)
+    {
+        std::vector<std::string> loads;
+        for (const auto& sample : telemetry.history("foo", now - age))
+            loads.push_back(sample.load);
+
+        return loads;
+    }
+
+    const std::chrono::system_clock::time_point now{std::chrono::system_clock::now()};
+    mp::InstanceTelemetry telemetry{3};
+};
+} // namespace
+
+TEST_F(InstanceTelemetry, has_nothing_for_unknown_instances)
+{
+    EXPECT_FALSE(telemetry.latest("foo"));
+    EXPECT_THAT(telemetry.history("foo", now - 1h), IsEmpty());
+}
+
+TEST_F(InstanceTelemetry, returns_latest_sample)
+{
+    telemetry.record("foo", sample_at(2min, "0.1 0.1 0.1"));
+    telemetry.record("foo", sample_at(1min, "0.2 0.2 0.2"));
+    telemetry.record("bar", sample_at(0min, "0.3 0.3 0.3"));
+
+    ASSERT_TRUE(telemetry.latest("foo"));
+    EXPECT_EQ(telemetry.latest("foo")->load, "0.2 0.2 0.2");
+}
+
+TEST_F(InstanceTelemetry, keeps_only_latest_samples_oldest_first)
+{
+    for (auto minutes = 5; minutes >= 0; --minutes)
+        telemetry.record("foo", sample_at(std::chrono::minutes{minutes}, std::to_string(minutes)));
+
+    EXPECT_THAT(loads_since(1h), ElementsAre("2", "1", "0"));
+    EXPECT_EQ(telemetry.latest("foo")->load, "0");
+}
+
+TEST_F(InstanceTelemetry, leaves_out_samples_before_the_given_time)
+{
+    telemetry.record("foo", sample_at(20min, "old"));
+    telemetry.record("foo", sample_at(5min, "recent"));
+
+    EXPECT_THAT(loads_since(10min), ElementsAre("recent"));
+}
+
+TEST_F(InstanceTelemetry, forgets_instances)
+{
+    telemetry.record("foo", sample_at(1min, "0.1 0.1 0.1"));
+    telemetry.forget("foo");
+
+    EXPECT_FALSE(telemetry.latest("foo"));
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/daemon/json_journal.h"
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct JsonJournal : public Test
+{
+    QJsonObject load_snapshot()
+    {
+        return QJsonDocument::fromJson(mpt::load(db_path)).object();
+    }
+
+    mpt::TempDir temp_dir;
+    QString db_path{QDir{temp_dir.path()}.filePath("records.json")};
+    QString journal_path{db_path + ".journal"};
+    QJsonObject record{{"path", "/some/image.img"}};
+};
+} // namespace
+
+TEST_F(JsonJournal, appends_changes_without_rewriting_the_file)
+{
+    mpt::make_file_with_content(db_path, R"({"old": {"path": "/old.img"}})");
+
+    mp::JsonJournal journal{db_path};
+    journal.insert("new", record);
+    journal.remove("old");
+
+    EXPECT_TRUE(load_snapshot().contains("old"));
+    EXPECT_FALSE(load_snapshot().contains("new"));
+    EXPECT_EQ(mpt::load(journal_path).count('\n'), 2);
+}
+
+TEST_F(JsonJournal, replays_the_journal_on_load)
+{
+    {
+        mpt::make_file_with_content(db_path, R"({"old": {"path": "/old.img"}})");
+
+        mp::JsonJournal journal{db_path};
+        journal.insert("new", record);
+        journal.remove("old");
+    }
+
+    mp::JsonJournal journal{db_path};
+
+    EXPECT_EQ(journal.records(), (QJsonObject{{"new", record}}));
+    EXPECT_EQ(load_snapshot(), journal.records());
+    EXPECT_FALSE(QFile::exists(journal_path));
+}
+
+TEST_F(JsonJournal, drops_torn_entry_at_end_of_journal)
+{
+    mpt::make_file_with_content(journal_path, R"({"key": "new", "record": {"path": "/new.img"}})"
+                                              "\n"
+                                              R"({"key": "torn", "rec)");
+
+    mp::JsonJournal journal{db_path};
+
+    EXPECT_TRUE(journal.records().contains("new"));
+    EXPECT_FALSE(journal.records().contains("torn"));
+}
+
+TEST_F(JsonJournal, compacts_once_journal_outgrows_records)
+{
+    mp::JsonJournal journal{db_path};
+    for (auto i = 0; i < 100; ++i)
+        journal.insert(QString::number(i % 5), record);
+
+    EXPECT_EQ(load_snapshot().size(), 5);
+    EXPECT_LT(mpt::load(journal_path).count('\n'), 64);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sshfs_mount/mount_stats.h>
+
+#include <gmock/gmock.h>
+
+#include <QJsonArray>
+
+namespace mp = multipass;
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(MountStats, starts_empty)
+{
+    mp::MountStats stats;
+    const auto snapshot = stats.snapshot();
+
+    EXPECT_EQ(snapshot.bytes_read, 0u);
+    EXPECT_EQ(snapshot.bytes_written, 0u);
+    for (const auto& op : snapshot.operations)
+    {
+        EXPECT_EQ(op.count, 0u);
+        EXPECT_EQ(op.errors, 0u);
+        EXPECT_THAT(op.latency_histogram, Each(0u));
+    }
+}
+
+TEST(MountStats, records_operations_in_latency_buckets)
+{
+    mp::MountStats stats;
+    stats.record(mp::MountStats::read, 0us);
+    stats.record(mp::MountStats::read, 3us);
+    stats.record(mp::MountStats::read, 1000us);
+    stats.record_error(mp::MountStats::read);
+
+    const auto read = stats.snapshot().operations[mp::MountStats::read];
+    EXPECT_EQ(read.count, 3u);
+    EXPECT_EQ(read.errors, 1u);
+    EXPECT_EQ(read.latency_histogram[0], 1u);  // under 1us
+    EXPECT_EQ(read.latency_histogram[2], 1u);  // under 4us
+    EXPECT_EQ(read.latency_histogram[10], 1u); // under 1024us
+
+    EXPECT_EQ(stats.snapshot().operations[mp::MountStats::write].count, 0u);
+}
+
+TEST(MountStats, slowest_bucket_takes_everything_slower)
+{
+    mp::MountStats stats;
+    stats.record(mp::MountStats::stat, 1h);
+
+    EXPECT_EQ(stats.snapshot().operations[mp::MountStats::stat].latency_histogram.back(), 1u);
+}
+
+TEST(MountStats, counts_bytes)
+{
+    mp::MountStats stats;
+    stats.add_bytes_read(10);
+    stats.add_bytes_read(5);
+    stats.add_bytes_written(7);
+
+    const auto snapshot = stats.snapshot();
+    EXPECT_EQ(snapshot.bytes_read, 15u);
+    EXPECT_EQ(snapshot.bytes_written, 7u);
+}
+
+TEST(MountStats, latency_percentile_returns_bucket_upper_bound)
+{
+    mp::MountStats::LatencyHistogram histogram{};
+    histogram[3] = 98;
+    histogram[12] = 2;
+
+    EXPECT_EQ(mp::MountStats::latency_percentile(histogram, 0.5), 8u);
+    EXPECT_EQ(mp::MountStats::latency_percentile(histogram, 0.98), 8u);
+    EXPECT_EQ(mp::MountStats::latency_percentile(histogram, 0.99), 4096u);
+}
+
+TEST(MountStats, latency_percentile_of_empty_histogram_is_zero)
+{
+    EXPECT_EQ(mp::MountStats::latency_percentile(mp::MountStats::LatencyHistogram{}, 0.99), 0u);
+}
+
+TEST(MountStats, json_round_trip_preserves_snapshot)
+{
+    mp::MountStats stats;
+    stats.record(mp::MountStats::open, 20us);
+    stats.record(mp::MountStats::write, 300us);
+    stats.record_error(mp::MountStats::rename);
+    stats.add_bytes_read(uint64_t{1} << 60);
+    stats.add_bytes_written(42);
+
+    const auto snapshot = stats.snapshot();
+    const auto restored = mp::MountStats::from_json(mp::MountStats::to_json(snapshot));
+
+    EXPECT_EQ(restored.bytes_read, snapshot.bytes_read);
+    EXPECT_EQ(restored.bytes_written, snapshot.bytes_written);
+    for (std::size_t i = 0; i < mp::MountStats::operation_count; ++i)
+    {
+        EXPECT_EQ(restored.operations[i].count, snapshot.operations[i].count);
+        EXPECT_EQ(restored.operations[i].errors, snapshot.operations[i].errors);
+        EXPECT_EQ(restored.operations[i].latency_histogram, snapshot.operations[i].latency_histogram);
+    }
+}
+
+TEST(MountStats, json_leaves_out_unused_operations)
+{
+    mp::MountStats stats;
+    stats.record(mp::MountStats::readdir, 1us);
+
+    const auto operations = mp::MountStats::to_json(stats.snapshot())["operations"].toObject();
+    EXPECT_EQ(operations.keys(), QStringList{"readdir"});
+    EXPECT_EQ(operations["readdir"].toObject()["latency_histogram"].toArray().size(),
+              static_cast<int>(mp::MountStats::latency_buckets));
+}
@@ -144,6 +144,93 @@ auto construct_single_instance_info_reply()
     return info_reply;
 }
 
+auto construct_info_reply_with_io_stats()
+{
+    mp::InfoReply info_reply;
+
+    auto info_entry = info_reply.add_info();
+    info_entry->set_name("foo");
+    info_entry->mutable_instance_status()->set_status(mp::InstanceStatus::RUNNING);
+
+    auto mount_info = info_entry->mutable_mount_info();
+    mount_info->set_longest_path_len(14);
+
+    auto mount_entry = mount_info->add_mount_paths();
+    mount_entry->set_source_path("/home/user/foo");
+    mount_entry->set_target_path("foo");
+
+    auto io_stats = mount_entry->mutable_io_stats();
+    io_stats->set_bytes_read(1048576);
+    io_stats->set_bytes_written(512);
+
+    auto op = io_stats->add_operations();
+    op->set_operation("read");
+    op->set_count(2);
+    op->set_median_latency_us(2);
+    op->set_p99_latency_us(2);
+    op->add_latency_histogram(0);
+    op->add_latency_histogram(2);
+
+    op = io_stats->add_operations();
+    op->set_operation("stat");
+    op->set_count(1);
+    op->set_errors(1);
+    op->set_median_latency_us(1);
+    op->set_p99_latency_us(1);
+    op->add_latency_histogram(1);
+
+    return info_reply;
+}
+
+auto construct_info_reply_with_id_ranges()
+{
+    mp::InfoReply info_reply;
+
+    auto info_entry = info_reply.add_info();
+    info_entry->set_name("foo");
+    info_entry->mutable_instance_status()->set_status(mp::InstanceStatus::RUNNING);
+
+    auto mount_info = info_entry->mutable_mount_info();
+    mount_info->set_longest_path_len(14);
+
+    auto mount_entry = mount_info->add_mount_paths();
+    mount_entry->set_source_path("/home/user/foo");
+    mount_entry->set_target_path("foo");
+    (*mount_entry->mutable_mount_maps()->mutable_uid_map())[1000] = 1000;
+
+    auto range = mount_entry->mutable_mount_maps()->add_uid_ranges();
+    range->set_host_id(2000);
+    range->set_instance_id(3000);
+    range->set_count(100);
+
+    range = mount_entry->mutable_mount_maps()->add_gid_ranges();
+    range->set_host_id(100);
+    range->set_instance_id(-1);
+    range->set_count(10);
+
+    return info_reply;
+}
+
+auto construct_info_reply_with_load_history()
+{
+    mp::InfoReply info_reply;
+
+    auto info_entry = info_reply.add_info();
+    info_entry->set_name("foo");
+    info_entry->mutable_instance_status()->set_status(mp::InstanceStatus::RUNNING);
+    info_entry->set_load("0.5 0.52 0.16");
+
+    auto sample = info_entry->add_load_history();
+    sample->set_timestamp(1600000000);
+    sample->set_load("0.45 0.51 0.15");
+
+    sample = info_entry->add_load_history();
+    sample->set_timestamp(1600000060);
+    sample->set_load("0.5 0.52 0.16");
+
+    return info_reply;
+}
+
 auto construct_multiple_instances_info_reply()
 {
     mp::InfoReply info_reply;
@@ -334,6 +421,9 @@ const auto unsorted_list_reply = construct_unsorted_list_reply();
 const auto empty_info_reply = mp::InfoReply();
 const auto single_instance_info_reply = construct_single_instance_info_reply();
 const auto multiple_instances_info_reply = construct_multiple_instances_info_reply();
+const auto info_reply_with_io_stats = construct_info_reply_with_io_stats();
+const auto info_reply_with_id_ranges = construct_info_reply_with_id_ranges();
+const auto info_reply_with_load_history = construct_info_reply_with_load_history();
 
 const std::vector<FormatterParamType> orderable_list_info_formatter_outputs{
     {&table_formatter, &empty_list_reply, "No instances found.\n", "table_list_empty"},
@@ -393,6 +483,31 @@ const std::vector<FormatterParamType> orderable_list_info_formatter_outputs{
      "Disk usage:     --\n"
      "Memory usage:   --\n",
      "table_info_multiple"},
+    {&table_formatter, &info_reply_with_io_stats,
+     "Name:           foo\n"
+     "State:          Running\n"
+     "IPv4:           --\n"
+     "Release:        --\n"
+     "Image hash:     Not Available\n"
+     "Load:           --\n"
+     "Disk usage:     --\n"
+     "Memory usage:   --\n"
+     "Mounts:         /home/user/foo => foo\n"
+     "                        I/O: 3 ops, 1 errors, 1.0M read, 512B written\n",
+     "table_info_io_stats"},
+    {&table_formatter, &info_reply_with_id_ranges,
+     "Name:           foo\n"
+     "State:          Running\n"
+     "IPv4:           --\n"
+     "Release:        --\n"
+     "Image hash:     Not Available\n"
+     "Load:           --\n"
+     "Disk usage:     --\n"
+     "Memory usage:   --\n"
+     "Mounts:         /home/user/foo => foo\n"
+     "                    UID map: 1000:1000, 2000-2099:3000\n"
+     "                    GID map: 100-109:default\n",
+     "table_info_id_ranges"},
     {&csv_formatter, &empty_list_reply, "Name,State,IPv4,IPv6,Release\n", "csv_list_empty"},
     {&csv_formatter, &single_instance_list_reply,
      "Name,State,IPv4,IPv6,Release\n"
@@ -712,7 +827,112 @@ const std::vector<FormatterParamType> non_orderable_list_info_formatter_outputs{
      "        }\n"
      "    }\n"
      "}\n",
-     "json_info_multiple"}};
+     "json_info_multiple"},
+    {&json_formatter, &info_reply_with_io_stats,
+     "{\n"
+     "    \"errors\": [\n"
+     "    ],\n"
+     "    \"info\": {\n"
+     "        \"foo\": {\n"
+     "            \"disks\": {\n"
+     "                \"sda1\": {\n"
+     "                }\n"
+     "            },\n"
+     "            \"image_hash\": \"\",\n"
+     "            \"image_release\": \"\",\n"
+     "            \"ipv4\": [\n"
+     "            ],\n"
+     "            \"load\": [\n"
+     "            ],\n"
+     "            \"memory\": {\n"
+     "            },\n"
+     "            \"mounts\": {\n"
+     "                \"foo\": {\n"
+     "                    \"gid_mappings\": [\n"
+     "                    ],\n"
+     "                    \"io_stats\": {\n"
+     "                        \"bytes_read\": 1048576,\n"
+     "                        \"bytes_written\": 512,\n"
+     "                        \"operations\": {\n"
+     "                            \"read\": {\n"
+     "                                \"count\": 2,\n"
+     "                                \"errors\": 0,\n"
+     "                                \"latency_histogram\": [\n"
+     "                                    0,\n"
+     "                                    2\n"
+     "                                ],\n"
+     "                                \"median_latency_us\": 2,\n"
+     "                                \"p99_latency_us\": 2\n"
+     "                            },\n"
+     "                            \"stat\": {\n"
+     "                                \"count\": 1,\n"
+     "                                \"errors\": 1,\n"
+     "                                \"latency_histogram\": [\n"
+     "                                    1\n"
+     "                                ],\n"
+     "                                \"median_latency_us\": 1,\n"
+     "                                \"p99_latency_us\": 1\n"
+     "                            }\n"
+     "                        }\n"
+     "                    },\n"
+     "                    \"source_path\": \"/home/user/foo\",\n"
+     "                    \"uid_mappings\": [\n"
+     "                    ]\n"
+     "                }\n"
+     "            },\n"
+     "            \"release\": \"\",\n"
+     "            \"state\": \"Running\"\n"
+     "        }\n"
+     "    }\n"
+     "}\n",
+     "json_info_io_stats"},
+    {&json_formatter, &info_reply_with_load_history,
+     "{\n"
+     "    \"errors\": [\n"
+     "    ],\n"
+     "    \"info\": {\n"
+     "        \"foo\": {\n"
+     "            \"disks\": {\n"
+     "                \"sda1\": {\n"
+     "                }\n"
+     "            },\n"
+     "            \"image_hash\": \"\",\n"
+     "            \"image_release\": \"\",\n"
+     "            \"ipv4\": [\n"
+     "            ],\n"
+     "            \"load\": [\n"
+     "                0.5,\n"
+     "                0.52,\n"
+     "                0.16\n"
+     "            ],\n"
+     "            \"load_history\": [\n"
+     "                {\n"
+     "                    \"load\": [\n"
+     "                        0.45,\n"
+     "                        0.51,\n"
+     "                        0.15\n"
+     "                    ],\n"
+     "                    \"timestamp\": 1600000000\n"
+     "                },\n"
+     "                {\n"
+     "                    \"load\": [\n"
+     "                        0.5,\n"
+     "                        0.52,\n"
+     "                        0.16\n"
+     "                    ],\n"
+     "                    \"timestamp\": 1600000060\n"
+     "                }\n"
+     "            ],\n"
+     "            \"memory\": {\n"
+     "            },\n"
+     "            \"mounts\": {\n"
+     "            },\n"
+     "            \"release\": \"\",\n"
+     "            \"state\": \"Running\"\n"
+     "        }\n"
+     "    }\n"
+     "}\n",
+     "json_info_load_history"}};
 
 const auto empty_find_reply = mp::FindReply();
 const auto find_one_reply = construct_find_one_reply();
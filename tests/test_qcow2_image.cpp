@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/qcow2_image.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+constexpr qint64 cluster_size = 65536;
+
+// Looks a guest cluster up through the L1 and L2 tables of a qcow2 image; unallocated clusters come back empty
+QByteArray read_cluster(const QString& qcow2_path, qint64 cluster)
+{
+    constexpr quint64 offset_mask = 0x00fffffffffffe00ULL;
+    const auto image = mpt::load(qcow2_path);
+
+    const auto l1_table_offset = qFromBigEndian<quint64>(image.constData() + 40);
+    const auto l2_table_offset =
+        qFromBigEndian<quint64>(image.constData() + l1_table_offset + cluster / (cluster_size / 8) * 8) & offset_mask;
+    if (!l2_table_offset)
+        return {};
+
+    const auto data_offset =
+        qFromBigEndian<quint64>(image.constData() + l2_table_offset + cluster % (cluster_size / 8) * 8) & offset_mask;
+    return data_offset ? image.mid(data_offset, cluster_size) : QByteArray{};
+}
+
+struct Qcow2Image : public Test
+{
+    Qcow2Image()
+    {
+        // Some data, a cluster of zeros, then a partial cluster
+        std::string data(2 * cluster_size + 3, '\0');
+        data.replace(0, 3, "abc");
+        data.replace(2 * cluster_size, 3, "xyz");
+        mpt::make_file_with_content(raw_path, data);
+    }
+
+    mpt::TempDir temp_dir;
+    QString raw_path{QDir{temp_dir.path()}.filePath("image.img")};
+    QString qcow2_path{QDir{temp_dir.path()}.filePath("image.img.qcow2")};
+};
+} // namespace
+
+TEST_F(Qcow2Image, reads_raw_image_info)
+{
+    const auto info = mp::vault::read_image_info(raw_path);
+
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->format, "raw");
+    EXPECT_EQ(info->virtual_size, 2 * cluster_size + 3);
+    EXPECT_TRUE(info->backing_file.isEmpty());
+}
+
+TEST_F(Qcow2Image, leaves_other_formats_to_qemuimg)
+{
+    const auto vhdx_path = QDir{temp_dir.path()}.filePath("image.vhdx");
+    mpt::make_file_with_content(vhdx_path, "vhdxfile and more");
+
+    EXPECT_FALSE(mp::vault::read_image_info(vhdx_path));
+    EXPECT_FALSE(mp::vault::read_image_info(QDir{temp_dir.path()}.filePath("missing.img")));
+}
+
+TEST_F(Qcow2Image, converts_raw_image)
+{
+    mp::vault::convert_raw_to_qcow2(raw_path, qcow2_path);
+
+    const auto info = mp::vault::read_image_info(qcow2_path);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->format, "qcow2");
+    EXPECT_EQ(info->virtual_size, 2 * cluster_size + 3);
+
+    EXPECT_TRUE(read_cluster(qcow2_path, 0).startsWith("abc"));
+    EXPECT_TRUE(read_cluster(qcow2_path, 1).isEmpty());
+    EXPECT_TRUE(read_cluster(qcow2_path, 2).startsWith("xyz"));
+}
+
+TEST_F(Qcow2Image, grows_raw_image)
+{
+    ASSERT_TRUE(mp::vault::grow_image(raw_path, 10 * cluster_size));
+
+    EXPECT_EQ(QFile{raw_path}.size(), 10 * cluster_size);
+}
+
+TEST_F(Qcow2Image, grows_qcow2_image)
+{
+    constexpr auto size = Q_INT64_C(10) * 1024 * 1024 * 1024; // takes more L1 entries than the converted image has
+    mp::vault::convert_raw_to_qcow2(raw_path, qcow2_path);
+
+    ASSERT_TRUE(mp::vault::grow_image(qcow2_path, size));
+
+    EXPECT_EQ(mp::vault::read_image_info(qcow2_path)->virtual_size, size);
+    EXPECT_EQ(qFromBigEndian<quint32>(mpt::load(qcow2_path).constData() + 36), 20u);
+    EXPECT_TRUE(read_cluster(qcow2_path, 0).startsWith("abc"));
+}
+
+TEST_F(Qcow2Image, leaves_shrinking_to_qemuimg)
+{
+    EXPECT_FALSE(mp::vault::grow_image(raw_path, cluster_size));
+    EXPECT_EQ(QFile{raw_path}.size(), 2 * cluster_size + 3);
+}
@@ -29,7 +29,10 @@
 
 #include <gmock/gmock.h>
 
+#include <atomic>
+#include <limits>
 #include <queue>
+#include <set>
 
 namespace mp = multipass;
 namespace mpt = multipass::test;
@@ -47,10 +50,12 @@ struct SftpServer : public mp::test::SftpServerTest
         return make_sftpserver("");
     }
 
-    mp::SftpServer make_sftpserver(const std::string& path)
+    mp::SftpServer make_sftpserver(const std::string& path, int num_workers = 0, std::size_t write_buffer_size = 0,
+                                   bool cache_attributes = false)
     {
         mp::SSHSession session{"a", 42};
-        return {std::move(session), path, path, default_map, default_map, default_id, default_id, "sshfs"};
+        return {std::move(session), path,        path,    default_map, default_map,      default_id,
+                default_id,         "sshfs",     num_workers, write_buffer_size, cache_attributes};
     }
 
     auto make_msg(uint8_t type = SFTP_BAD_MESSAGE)
@@ -239,10 +244,25 @@ bool compare_permission(uint32_t ssh_permissions, const QFileInfo& file, Permiss
 
 TEST_F(SftpServer, throws_when_failed_to_init)
 {
-    REPLACE(sftp_server_init, [](auto...) { return SSH_ERROR; });
+    REPLACE(ssh_channel_read, [](auto...) { return SSH_ERROR; });
     EXPECT_THROW(make_sftpserver(), std::runtime_error);
 }
 
+TEST_F(SftpServer, advertises_fsync_extension)
+{
+    std::string version_reply;
+    REPLACE(ssh_channel_write, [&version_reply](ssh_channel, const void* data, uint32_t len) {
+        version_reply.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+
+    auto sftp = make_sftpserver();
+
+    ASSERT_GT(version_reply.size(), 5u);
+    EXPECT_EQ(version_reply[4], SSH_FXP_VERSION);
+    EXPECT_THAT(version_reply, HasSubstr("fsync@openssh.com"));
+}
+
 TEST_F(SftpServer, throws_when_sshfs_errors_on_start)
 {
     bool invoked{false};
@@ -851,8 +871,60 @@ TEST_F(SftpServer, handles_readdir)
 
     EXPECT_THAT(eof_num_calls, Eq(1));
 
+    // Entries are streamed in the order the filesystem returns them
     std::vector<std::string> expected_entries = {".", "..", "test-dir-entry", "test-file"};
-    EXPECT_THAT(entries, ContainerEq(expected_entries));
+    EXPECT_THAT(entries, UnorderedElementsAreArray(expected_entries));
+}
+
+TEST_F(SftpServer, readdir_splits_large_directories_across_replies)
+{
+    mpt::TempDir temp_dir;
+    const int num_files{2000};
+    for (int i = 0; i < num_files; ++i)
+        mpt::make_file_with_content(temp_dir.path() + QString("/a-rather-long-file-name-to-fill-replies-%1").arg(i));
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_dir_msg = make_msg(SFTP_OPENDIR);
+    auto dir_name = name_as_char_array(temp_dir.path().toStdString());
+    open_dir_msg->filename = dir_name.data();
+
+    std::vector<std::unique_ptr<sftp_client_message_struct>> readdir_msgs;
+    for (int i = 0; i < 50; ++i)
+        readdir_msgs.push_back(make_msg(SFTP_READDIR));
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    std::set<std::string> entries;
+    int num_added{0};
+    auto reply_names_add = [&entries, &num_added](sftp_client_message, const char* file, const char*,
+                                                  sftp_attributes) {
+        entries.insert(file);
+        ++num_added;
+        return SSH_OK;
+    };
+
+    int num_replies{0};
+    auto reply_names = [&num_replies](auto...) {
+        ++num_replies;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_names_add, reply_names_add);
+    REPLACE(sftp_reply_names, reply_names);
+
+    sftp.run();
+
+    EXPECT_THAT(num_replies, Gt(1));
+    EXPECT_THAT(num_added, Eq(num_files + 2));
+    EXPECT_THAT(entries.size(), Eq(num_files + 2u));
 }
 
 TEST_F(SftpServer, handles_readdir_attributes_preserved)
@@ -921,6 +993,58 @@ TEST_F(SftpServer, handles_readdir_attributes_preserved)
     EXPECT_TRUE(compare_permission(test_file_attrs->permissions, test_file_info, Permission::Other));
 }
 
+TEST_F(SftpServer, readdir_longname_shows_mapped_ids)
+{
+    mpt::TempDir temp_dir;
+
+    const auto test_file_name = "test-file";
+    auto test_file = temp_dir.path() + "/" + test_file_name;
+    mpt::make_file_with_content(test_file);
+
+    QFileInfo test_file_info(test_file);
+    const std::unordered_map<int, int> uid_map{{static_cast<int>(test_file_info.ownerId()), 1234}};
+    const std::unordered_map<int, int> gid_map{{static_cast<int>(test_file_info.groupId()), 5678}};
+
+    mp::SSHSession session{"a", 42};
+    const auto path = temp_dir.path().toStdString();
+    mp::SftpServer sftp{std::move(session), path, path, gid_map, uid_map, default_id, default_id, "sshfs"};
+
+    auto open_dir_msg = make_msg(SFTP_OPENDIR);
+    auto dir_name = name_as_char_array(path);
+    open_dir_msg->filename = dir_name.data();
+
+    auto readdir_msg = make_msg(SFTP_READDIR);
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    std::string test_file_longname;
+    auto get_test_file_longname = [&test_file_longname, &test_file_name](sftp_client_message, const char* file,
+                                                                         const char* longname, sftp_attributes attr) {
+        if (strcmp(file, test_file_name) == 0)
+        {
+            EXPECT_EQ(attr->uid, 1234u);
+            EXPECT_EQ(attr->gid, 5678u);
+            test_file_longname = longname;
+        }
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_names_add, get_test_file_longname);
+    REPLACE(sftp_reply_names, [](auto...) { return SSH_OK; });
+
+    sftp.run();
+
+    EXPECT_THAT(test_file_longname, HasSubstr(" 1 1234 5678 "));
+}
+
 TEST_F(SftpServer, handles_close)
 {
     mpt::TempDir temp_dir;
@@ -1069,6 +1193,42 @@ TEST_F(SftpServer, handles_setstat)
     EXPECT_THAT(file.size(), Eq(expected_size));
 }
 
+TEST_F(SftpServer, cached_stat_reflects_setstat)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    const auto original_size = mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString(), 0, 0, true);
+    auto name = name_as_char_array(file_name.toStdString());
+
+    auto stat_before = make_msg(SFTP_LSTAT);
+    stat_before->filename = name.data();
+
+    auto setstat = make_msg(SFTP_SETSTAT);
+    sftp_attributes_struct attr{};
+    const uint64_t expected_size = 7777;
+    attr.size = expected_size;
+    attr.flags = SSH_FILEXFER_ATTR_SIZE;
+    setstat->filename = name.data();
+    setstat->attr = &attr;
+
+    auto stat_after = make_msg(SFTP_LSTAT);
+    stat_after->filename = name.data();
+
+    std::vector<uint64_t> sizes;
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_reply_attr, [&sizes](sftp_client_message, sftp_attributes attr) {
+        sizes.push_back(attr->size);
+        return SSH_OK;
+    });
+
+    sftp.run();
+
+    EXPECT_THAT(sizes, ElementsAre(static_cast<uint64_t>(original_size), expected_size));
+}
+
 TEST_F(SftpServer, setstat_in_invalid_dir_fails)
 {
     mpt::TempDir temp_dir;
@@ -1139,6 +1299,110 @@ TEST_F(SftpServer, handles_writes)
     EXPECT_TRUE(content_match(file_name, "The answer is always 42"));
 }
 
+TEST_F(SftpServer, buffered_writes_reach_file_on_close)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString(), 0, 1024);
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+
+    open_msg->filename = name.data();
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    auto write_msg1 = make_msg(SFTP_WRITE);
+    auto data1 = make_data("The answer is ");
+    write_msg1->data = data1.get();
+    write_msg1->offset = 0;
+
+    auto write_msg2 = make_msg(SFTP_WRITE);
+    auto data2 = make_data("always 42");
+    write_msg2->data = data2.get();
+    write_msg2->offset = ssh_string_len(data1.get());
+
+    auto close_msg = make_msg(SFTP_CLOSE);
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    int num_calls{0};
+    auto reply_status = [&num_calls, &file_name, &close_msg](sftp_client_message msg, uint32_t status, const char*) {
+        EXPECT_TRUE(status == SSH_FX_OK);
+        if (msg != close_msg.get())
+            EXPECT_THAT(QFileInfo(file_name).size(), Eq(0));
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_handle_remove, [](auto...) {});
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+
+    sftp.run();
+
+    ASSERT_THAT(num_calls, Eq(3));
+    EXPECT_TRUE(content_match(file_name, "The answer is always 42"));
+}
+
+TEST_F(SftpServer, stat_fails_when_buffered_writes_fail)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString(), 0, 1024);
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+
+    open_msg->filename = name.data();
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    // Held back by the buffer, then refused by pwrite for being at a negative offset
+    auto write_msg = make_msg(SFTP_WRITE);
+    auto data = make_data("The answer is always 42");
+    write_msg->data = data.get();
+    write_msg->offset = std::numeric_limits<uint64_t>::max() - 1024;
+
+    auto stat_msg = make_msg(SFTP_STAT);
+    stat_msg->filename = name.data();
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    int num_calls{0};
+    auto reply_status = [&num_calls, &stat_msg](sftp_client_message msg, uint32_t status, const char*) {
+        const uint32_t expected_status = msg == stat_msg.get() ? SSH_FX_FAILURE : SSH_FX_OK;
+        EXPECT_THAT(status, Eq(expected_status));
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls, Eq(2));
+}
+
 TEST_F(SftpServer, handles_reads)
 {
     mpt::TempDir temp_dir;
@@ -1184,6 +1448,219 @@ TEST_F(SftpServer, handles_reads)
     ASSERT_THAT(num_calls, Eq(1));
 }
 
+TEST_F(SftpServer, reads_are_counted_in_stats)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    auto size = mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto read_msg = make_msg(SFTP_READ);
+    read_msg->len = size;
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_data, [](auto...) { return SSH_OK; });
+
+    sftp.run();
+
+    const auto stats = sftp.stats();
+    EXPECT_EQ(stats.bytes_read, static_cast<uint64_t>(size));
+    EXPECT_EQ(stats.bytes_written, 0u);
+    EXPECT_EQ(stats.operations[mp::MountStats::open].count, 1u);
+    EXPECT_EQ(stats.operations[mp::MountStats::read].count, 1u);
+    EXPECT_EQ(stats.operations[mp::MountStats::read].errors, 0u);
+}
+
+TEST_F(SftpServer, failed_requests_are_counted_in_stats)
+{
+    mpt::TempDir temp_dir;
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto msg = make_msg(SFTP_READLINK);
+    auto invalid_path = name_as_char_array("/foo/bar");
+    msg->filename = invalid_path.data();
+
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, [](auto...) { return SSH_OK; });
+
+    sftp.run();
+
+    const auto stats = sftp.stats();
+    EXPECT_EQ(stats.operations[mp::MountStats::readlink].count, 1u);
+    EXPECT_EQ(stats.operations[mp::MountStats::readlink].errors, 1u);
+}
+
+TEST_F(SftpServer, reads_are_capped_at_max_read_size)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name, std::string(2 * mp::SftpServer::max_read_size, 'x'));
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto read_msg = make_msg(SFTP_READ);
+    read_msg->offset = 0;
+    read_msg->len = 4 * mp::SftpServer::max_read_size;
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    int num_calls{0};
+    auto reply_data = [&num_calls](sftp_client_message, const void*, int len) {
+        EXPECT_THAT(len, Eq(static_cast<int>(mp::SftpServer::max_read_size)));
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_data, reply_data);
+
+    sftp.run();
+
+    ASSERT_THAT(num_calls, Eq(1));
+}
+
+TEST_F(SftpServer, handles_reads_with_workers)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString(), 2);
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    const int num_reads{5};
+    std::vector<std::unique_ptr<sftp_client_message_struct>> read_msgs;
+    for (int i = 0; i < num_reads; ++i)
+    {
+        auto read_msg = make_msg(SFTP_READ);
+        read_msg->offset = 10;
+        read_msg->len = 9;
+        read_msgs.push_back(std::move(read_msg));
+    }
+
+    std::atomic<void*> id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    // The open must be answered before the reads are pulled off the channel, as sshfs would do
+    auto channel_poll = [this, &id](auto...) {
+        if (messages.empty())
+            return SSH_EOF;
+        return messages.front()->type == SFTP_READ && id == nullptr ? 0 : 1;
+    };
+
+    std::atomic<int> num_calls{0};
+    auto reply_data = [&num_calls](sftp_client_message, const void* data, int len) {
+        std::string data_read{reinterpret_cast<const char*>(data), static_cast<std::string::size_type>(len)};
+        EXPECT_THAT(data_read, StrEq("test file"));
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(ssh_channel_poll_timeout, channel_poll);
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id.load(); });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_data, reply_data);
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls.load(), Eq(num_reads));
+}
+
+TEST_F(SftpServer, stat_with_workers_comes_after_writes_on_the_same_file)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString(), 4);
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+
+    open_msg->filename = name.data();
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    const auto data = make_data("The answer is always 42");
+    const int num_writes{8};
+    std::vector<std::unique_ptr<sftp_client_message_struct>> write_msgs;
+    for (int i = 0; i < num_writes; ++i)
+    {
+        auto write_msg = make_msg(SFTP_WRITE);
+        write_msg->data = data.get();
+        write_msg->offset = i * ssh_string_len(data.get());
+        write_msgs.push_back(std::move(write_msg));
+    }
+
+    auto stat_msg = make_msg(SFTP_STAT);
+    stat_msg->filename = name.data();
+
+    std::atomic<void*> id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return nullptr;
+    };
+
+    // The open must be answered before the writes are pulled off the channel, as sshfs would do
+    auto channel_poll = [this, &id](auto...) {
+        if (messages.empty())
+            return SSH_EOF;
+        return messages.front()->type != SFTP_OPEN && id == nullptr ? 0 : 1;
+    };
+
+    const uint64_t expected_size = num_writes * ssh_string_len(data.get());
+    std::atomic<int> num_calls{0};
+    auto reply_attr = [&num_calls, expected_size](sftp_client_message, sftp_attributes attr) {
+        EXPECT_THAT(attr->size, Eq(expected_size));
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(ssh_channel_poll_timeout, channel_poll);
+    REPLACE(sftp_reply_attr, reply_attr);
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id.load(); });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls.load(), Eq(1));
+}
+
 TEST_F(SftpServer, handle_extended_link)
 {
     mpt::TempDir temp_dir;
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "sftp_server_test_fixture.h"
+
+#include <multipass/auto_join_thread.h>
+#include <multipass/ssh/ssh_session.h>
+#include <multipass/sshfs_mount/shared_ssh_session.h>
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+struct SharedSSHSession : public mp::test::SftpServerTest
+{
+    // Counts how many times the waiter came back from waiting for data
+    mp::AutoJoinThread start_waiter(std::atomic<int>& wakeups)
+    {
+        return mp::AutoJoinThread{[this, &wakeups] {
+            std::unique_lock<std::mutex> lock{shared_session.mutex};
+            while (!stop)
+            {
+                shared_session.wait_for_data(lock);
+                ++wakeups;
+            }
+        }};
+    }
+
+    void wait_for(const std::atomic<int>& wakeups, int expected)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (wakeups < expected && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(1ms);
+    }
+
+    void stop_waiters()
+    {
+        stop = true;
+        shared_session.interrupt();
+    }
+
+    mp::SharedSSHSession shared_session{mp::SSHSession{"a", 42}};
+    std::atomic<bool> stop{false};
+};
+} // namespace
+
+TEST_F(SharedSSHSession, waiters_sleep_while_the_session_is_idle)
+{
+    std::atomic<int> wakeups{0};
+    {
+        auto waiter = start_waiter(wakeups);
+        auto other_waiter = start_waiter(wakeups);
+
+        std::this_thread::sleep_for(100ms);
+        EXPECT_THAT(wakeups.load(), Eq(0));
+
+        stop_waiters();
+    }
+
+    EXPECT_THAT(wakeups.load(), Eq(2));
+}
+
+TEST_F(SharedSSHSession, notifying_wakes_every_waiter)
+{
+    std::atomic<int> wakeups{0};
+    auto waiter = start_waiter(wakeups);
+    auto other_waiter = start_waiter(wakeups);
+    std::this_thread::sleep_for(10ms);
+
+    {
+        mp::SharedSSHSession::Lock lock{shared_session};
+    }
+    wait_for(wakeups, 2);
+    EXPECT_THAT(wakeups.load(), Ge(2));
+
+    stop_waiters();
+}
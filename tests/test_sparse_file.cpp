@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/sparse_file.h>
+#include <multipass/utils.h>
+#include <multipass/vm_image_vault.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// Data blocks separated by, and ending with, blocks of zeros
+std::string image_data()
+{
+    const std::string zeros(3 * mp::sparse_block_size, '\0');
+    return std::string(100, 'a') + zeros + std::string(mp::sparse_block_size + 10, 'b') + zeros;
+}
+
+struct SparseFile : public Test
+{
+    mpt::TempDir temp_dir;
+    QString source_path{QDir{temp_dir.path()}.filePath("source.img")};
+    QString destination_path{QDir{temp_dir.path()}.filePath("destination.img")};
+};
+} // namespace
+
+TEST_F(SparseFile, written_data_reads_back_the_same)
+{
+    const auto data = image_data();
+
+    QFile file{destination_path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    ASSERT_TRUE(mp::write_sparse(file, data.data(), data.size()));
+    ASSERT_TRUE(mp::finish_sparse_write(file));
+    file.close();
+
+    EXPECT_EQ(mp::utils::contents_of(destination_path), data);
+}
+
+TEST_F(SparseFile, skipped_zeros_at_the_end_extend_the_file)
+{
+    const std::string zeros(2 * mp::sparse_block_size, '\0');
+
+    QFile file{destination_path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    ASSERT_TRUE(mp::write_sparse(file, zeros.data(), zeros.size()));
+    ASSERT_TRUE(mp::finish_sparse_write(file));
+
+    EXPECT_EQ(file.size(), static_cast<qint64>(zeros.size()));
+}
+
+TEST_F(SparseFile, writes_partial_zero_blocks)
+{
+    const std::string data(mp::sparse_block_size / 2, '\0');
+
+    QFile file{destination_path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    ASSERT_TRUE(mp::write_sparse(file, data.data(), data.size()));
+
+    EXPECT_EQ(file.size(), static_cast<qint64>(data.size()));
+}
+
+TEST_F(SparseFile, copies_data_and_holes)
+{
+    mpt::make_file_with_content(source_path, image_data());
+
+    mp::vault::sparse_copy(source_path, destination_path);
+
+    EXPECT_EQ(mp::utils::contents_of(destination_path), image_data());
+}
+
+TEST_F(SparseFile, copies_file_that_is_all_hole)
+{
+    {
+        QFile source{source_path};
+        ASSERT_TRUE(source.open(QIODevice::WriteOnly));
+        ASSERT_TRUE(source.resize(5 * mp::sparse_block_size));
+    }
+
+    mp::vault::sparse_copy(source_path, destination_path);
+
+    EXPECT_EQ(mp::utils::contents_of(destination_path), std::string(5 * mp::sparse_block_size, '\0'));
+}
+
+TEST_F(SparseFile, copy_throws_on_missing_source)
+{
+    EXPECT_THROW(mp::vault::sparse_copy(source_path, destination_path), std::runtime_error);
+}
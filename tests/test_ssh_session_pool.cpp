@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "mock_ssh.h"
+#include "stub_ssh_key_provider.h"
+
+#include <multipass/ssh/ssh_session_pool.h>
+
+#include <gmock/gmock.h>
+
+#include <optional>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct SSHSessionPool : public Test
+{
+    SSHSessionPool()
+    {
+        connect.returnValue(SSH_OK);
+        auth.returnValue(SSH_AUTH_SUCCESS);
+        is_connected.returnValue(true);
+        open_session.returnValue(SSH_OK);
+    }
+
+    void use_session(mp::SSHSessionPool& pool, const std::string& host = "10.0.0.1")
+    {
+        pool.acquire("foo", host, 22, "ubuntu");
+    }
+
+    decltype(MOCK(ssh_connect)) connect{MOCK(ssh_connect)};
+    decltype(MOCK(ssh_userauth_publickey)) auth{MOCK(ssh_userauth_publickey)};
+    decltype(MOCK(ssh_is_connected)) is_connected{MOCK(ssh_is_connected)};
+    decltype(MOCK(ssh_channel_open_session)) open_session{MOCK(ssh_channel_open_session)};
+    mpt::StubSSHKeyProvider key_provider;
+    mp::SSHSessionPool pool{key_provider};
+};
+} // namespace
+
+TEST_F(SSHSessionPool, reuses_sessions_given_back)
+{
+    use_session(pool);
+    use_session(pool);
+
+    connect.expectCalled(1);
+}
+
+TEST_F(SSHSessionPool, does_not_lend_a_session_twice)
+{
+    auto first = pool.acquire("foo", "10.0.0.1", 22, "ubuntu");
+    auto second = pool.acquire("foo", "10.0.0.1", 22, "ubuntu");
+
+    EXPECT_NE(&*first, &*second);
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, connects_again_when_address_changed)
+{
+    use_session(pool, "10.0.0.1");
+    use_session(pool, "10.0.0.2");
+
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, connects_again_when_idle_session_is_broken)
+{
+    use_session(pool);
+
+    open_session.returnValue(SSH_ERROR);
+    use_session(pool);
+
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, closes_sessions_idle_for_too_long)
+{
+    mp::SSHSessionPool short_lived_pool{key_provider, 0ms};
+    use_session(short_lived_pool);
+    use_session(short_lived_pool);
+
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, closes_idle_sessions_of_every_instance_when_expiring)
+{
+    mp::SSHSessionPool short_lived_pool{key_provider, 0ms};
+    short_lived_pool.acquire("foo", "10.0.0.1", 22, "ubuntu");
+    short_lived_pool.acquire("bar", "10.0.0.2", 22, "ubuntu");
+
+    auto free = MOCK(ssh_free);
+    short_lived_pool.expire_idle_sessions();
+
+    free.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, keeps_sessions_lent_out_when_expiring)
+{
+    mp::SSHSessionPool short_lived_pool{key_provider, 0ms};
+    auto lease = short_lived_pool.acquire("foo", "10.0.0.1", 22, "ubuntu");
+
+    auto free = MOCK(ssh_free);
+    short_lived_pool.expire_idle_sessions();
+
+    free.expectCalled(0);
+}
+
+TEST_F(SSHSessionPool, does_not_take_back_sessions_of_forgotten_instances)
+{
+    {
+        auto lease = pool.acquire("foo", "10.0.0.1", 22, "ubuntu");
+        pool.forget("foo");
+    }
+    use_session(pool);
+
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, does_not_take_back_sessions_taken_for_good)
+{
+    auto session = pool.acquire("foo", "10.0.0.1", 22, "ubuntu").take();
+    use_session(pool);
+
+    connect.expectCalled(2);
+}
+
+TEST_F(SSHSessionPool, keeps_sessions_of_an_instance_used_again_after_being_forgotten)
+{
+    std::optional<mp::SSHSessionPool::Lease> before{pool.acquire("foo", "10.0.0.1", 22, "ubuntu")};
+    pool.forget("foo");
+    use_session(pool);
+    before.reset();
+    use_session(pool);
+
+    connect.expectCalled(2);
+}
@@ -17,6 +17,7 @@
 
 #include <src/platform/backends/shared/sshfs_server_process_spec.h>
 
+#include <multipass/constants.h>
 #include <multipass/sshfs_server_config.h>
 
 #include "mock_environment_helpers.h"
@@ -40,7 +41,8 @@ struct TestSSHFSServerProcessSpec : public Test
                                  "source_path",
                                  "target_path",
                                  {{1, 2}, {3, 4}},
-                                 {{5, -1}, {6, 10}}};
+                                 {{5, -1}, {6, 10}},
+                                 {}};
 };
 
 TEST_F(TestSSHFSServerProcessSpec, program_correct)
@@ -58,9 +60,8 @@ TEST_F(TestSSHFSServerProcessSpec, arguments_correct)
     EXPECT_EQ(spec.arguments()[2], "username");
     EXPECT_EQ(spec.arguments()[3], "source_path");
     EXPECT_EQ(spec.arguments()[4], "target_path");
-    // Ordering of below options not guaranteed, hence the or-s.
-    EXPECT_TRUE(spec.arguments()[5] == "6:10,5:-1," || spec.arguments()[5] == "5:-1,6:10,");
-    EXPECT_TRUE(spec.arguments()[6] == "3:4,1:2," || spec.arguments()[6] == "1:2,3:4,");
+    EXPECT_EQ(spec.arguments()[5], "5:-1,6:10");
+    EXPECT_EQ(spec.arguments()[6], "1:2,3:4");
 }
 
 TEST_F(TestSSHFSServerProcessSpec, environment_correct)
@@ -71,6 +72,18 @@ TEST_F(TestSSHFSServerProcessSpec, environment_correct)
     EXPECT_EQ(spec.environment().value("KEY"), "private_key");
 }
 
+TEST_F(TestSSHFSServerProcessSpec, environment_carries_mount_settings)
+{
+    config.workers = 3;
+    config.write_buffer_size = 4096;
+    config.cache_attributes = true;
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_EQ(spec.environment().value(mp::sftp_workers_env_var), "3");
+    EXPECT_EQ(spec.environment().value(mp::sftp_write_buffer_env_var), "4096");
+    EXPECT_EQ(spec.environment().value(mp::sftp_attribute_cache_env_var), "1");
+}
+
 TEST_F(TestSSHFSServerProcessSpec, snap_confined_apparmor_profile_returns_expected_data)
 {
     mpt::TempDir bin_dir;
@@ -103,3 +116,15 @@ TEST_F(TestSSHFSServerProcessSpec, unconfined_apparmor_profile_returns_expected_
     EXPECT_TRUE(apparmor_profile.contains(current_dir.absolutePath() + "/{usr/,}lib/**"));
     EXPECT_TRUE(apparmor_profile.contains("signal (receive) peer=unconfined"));
 }
+
+TEST_F(TestSSHFSServerProcessSpec, apparmor_profile_covers_additional_source_paths)
+{
+    config.additional_source_paths = {"/other/source", "/another/source"};
+    mp::SSHFSServerProcessSpec spec(config);
+
+    const auto apparmor_profile = spec.apparmor_profile();
+
+    EXPECT_TRUE(apparmor_profile.contains("source_path/** rwlk,"));
+    EXPECT_TRUE(apparmor_profile.contains("/other/source/** rwlk,"));
+    EXPECT_TRUE(apparmor_profile.contains("/another/source/** rwlk,"));
+}
@@ -198,7 +198,7 @@ struct SshfsMount : public mp::test::SftpServerTest
         {"id -u", "1000\n"},
         {"id -g", "1000\n"},
         {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave -o transform_symlinks -o allow_other -o "
-         "Compression=no -o dcache_timeout=3 :\"source\" "
+         "Compression=no -o max_read=262144 -o dcache_timeout=3 :\"source\" "
          "\"target\"",
          "don't care\n"}};
 };
@@ -294,19 +294,21 @@ INSTANTIATE_TEST_SUITE_P(SshfsMountThrowWhenError, SshfsMountFail,
 CommandVector old_fuse_cmds = {
     {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -V", "FUSE library version: 2.9.0\n"},
     {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave -o transform_symlinks -o "
-     "allow_other -o Compression=no -o nonempty -o cache_timeout=3 :\"source\" \"/home/ubuntu/target\"",
+     "allow_other -o Compression=no -o max_read=262144 -o nonempty -o cache_timeout=3 :\"source\" "
+     "\"/home/ubuntu/target\"",
      "don't care\n"}};
 
 // Commands to check that a version of FUSE at least 3.0.0 gives a correct answer.
 CommandVector new_fuse_cmds = {{"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -V", "FUSE library version: 3.0.0\n"},
                                {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave -o transform_symlinks -o "
-                                "allow_other -o Compression=no -o dcache_timeout=3 :\"source\" \"/home/ubuntu/target\"",
+                                "allow_other -o Compression=no -o max_read=262144 -o dcache_timeout=3 :\"source\" "
+                                "\"/home/ubuntu/target\"",
                                 "don't care\n"}};
 
 // Commands to check that an unknown version of FUSE gives a correct answer.
 CommandVector unk_fuse_cmds = {{"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -V", "weird fuse version\n"},
                                {"sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave -o transform_symlinks -o "
-                                "allow_other -o Compression=no :\"source\" \"/home/ubuntu/target\"",
+                                "allow_other -o Compression=no -o max_read=262144 :\"source\" \"/home/ubuntu/target\"",
                                 "don't care\n"}};
 
 // Commands to check that the server correctly creates the mount target.
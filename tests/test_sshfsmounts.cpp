@@ -27,6 +27,8 @@
 #include <QTimer>
 #include <gmock/gmock.h>
 
+#include <vector>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 
@@ -56,6 +58,18 @@ struct SSHFSMountsTest : public ::Test
             // Ensure process_state() does not have an exit code set (i.e. still running)
             mp::ProcessState running_state;
             ON_CALL(*process, process_state()).WillByDefault(Return(running_state));
+
+            // Have "sshfs_server" connect every further mount it is asked for
+            ON_CALL(*process, write(_)).WillByDefault([process](const QByteArray& request) {
+                const auto fields = request.trimmed().split(' ');
+                if (fields.value(0) == "mount")
+                {
+                    ON_CALL(*process, read_all_standard_output())
+                        .WillByDefault(Return("Connected " + fields.value(2) + "\n"));
+                    QTimer::singleShot(0, process, [process]() { emit process->ready_read_standard_output(); });
+                }
+                return request.size();
+            });
         }
     };
 };
@@ -84,9 +98,8 @@ TEST_F(SSHFSMountsTest, mount_creates_sshfs_process)
     EXPECT_EQ(sshfs_command.arguments[2], "ubuntu");
     EXPECT_EQ(sshfs_command.arguments[3], "/my/source/path");
     EXPECT_EQ(sshfs_command.arguments[4], "/the/target/path");
-    // Ordering of below options not guaranteed, hence the or-s.
-    EXPECT_TRUE(sshfs_command.arguments[5] == "6:10,5:-1," || sshfs_command.arguments[5] == "5:-1,6:10,");
-    EXPECT_TRUE(sshfs_command.arguments[6] == "3:4,1:2," || sshfs_command.arguments[6] == "1:2,3:4,");
+    EXPECT_EQ(sshfs_command.arguments[5], "5:-1,6:10");
+    EXPECT_EQ(sshfs_command.arguments[6], "1:2,3:4");
 }
 
 TEST_F(SSHFSMountsTest, sshfs_process_failing_with_return_code_9_causes_exception)
@@ -193,6 +206,165 @@ TEST_F(SSHFSMountsTest, stop_all_mounts_terminates_all_sshfs_processes)
     sshfs_mounts.stop_all_mounts_for_instance(vm.vm_name);
 }
 
+TEST_F(SSHFSMountsTest, mounts_of_one_instance_share_sshfs_process)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    std::vector<QByteArray> requests;
+    factory->register_callback([this, &requests](mpt::MockProcess* process) {
+        sshfs_prints_connected(process);
+
+        if (process->program().contains("sshfs_server"))
+        {
+            EXPECT_CALL(*process, write(_)).WillRepeatedly([process, &requests](const QByteArray& request) {
+                requests.push_back(request);
+                if (request.startsWith("mount"))
+                {
+                    ON_CALL(*process, read_all_standard_output())
+                        .WillByDefault(Return("Connected " + request.trimmed().split(' ').value(2) + "\n"));
+                    QTimer::singleShot(0, process, [process]() { emit process->ready_read_standard_output(); });
+                }
+                return request.size();
+            });
+            EXPECT_CALL(*process, terminate).Times(0);
+        }
+    });
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_map, uid_map);
+    sshfs_mounts.start_mount(&vm, "/source/two", "/target two", gid_map, uid_map);
+
+    EXPECT_EQ(factory->process_list().size(), 1u);
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/one"));
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target two"));
+
+    EXPECT_TRUE(sshfs_mounts.stop_mount(vm.vm_name, "/target two"));
+    EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target two"));
+
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_TRUE(requests[0].startsWith("mount %2Fsource%2Ftwo %2Ftarget%20two "));
+    EXPECT_EQ(requests[1], "unmount %2Ftarget%20two\n");
+}
+
+TEST_F(SSHFSMountsTest, drops_additional_mount_that_disconnected)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    std::vector<QByteArray> requests;
+    mpt::MockProcess* sshfs_process{nullptr};
+    factory->register_callback([this, &requests, &sshfs_process](mpt::MockProcess* process) {
+        sshfs_prints_connected(process);
+
+        if (process->program().contains("sshfs_server"))
+        {
+            sshfs_process = process;
+            EXPECT_CALL(*process, write(_)).WillRepeatedly([process, &requests](const QByteArray& request) {
+                requests.push_back(request);
+                if (request.startsWith("mount"))
+                {
+                    ON_CALL(*process, read_all_standard_output())
+                        .WillByDefault(Return("Connected " + request.trimmed().split(' ').value(2) + "\n"));
+                    QTimer::singleShot(0, process, [process]() { emit process->ready_read_standard_output(); });
+                }
+                return request.size();
+            });
+            EXPECT_CALL(*process, terminate).Times(0);
+        }
+    });
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_map, uid_map);
+    sshfs_mounts.start_mount(&vm, "/source/two", "/target/two", gid_map, uid_map);
+
+    ASSERT_NE(sshfs_process, nullptr);
+    ON_CALL(*sshfs_process, read_all_standard_output()).WillByDefault(Return("Disconnected %2Ftarget%2Ftwo\n"));
+    emit sshfs_process->ready_read_standard_output();
+
+    EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/two"));
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/one"));
+
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[1], "unmount %2Ftarget%2Ftwo\n");
+}
+
+TEST_F(SSHFSMountsTest, failing_additional_mount_throws)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback([this](mpt::MockProcess* process) {
+        sshfs_prints_connected(process);
+
+        if (process->program().contains("sshfs_server"))
+        {
+            ON_CALL(*process, write(_)).WillByDefault([process](const QByteArray& request) {
+                ON_CALL(*process, read_all_standard_output())
+                    .WillByDefault(Return("Failed " + request.trimmed().split(' ').value(2) + " 1 Whoopsie\n"));
+                QTimer::singleShot(0, process, [process]() { emit process->ready_read_standard_output(); });
+                return request.size();
+            });
+        }
+    });
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, "/source/one", "/target/one", gid_map, uid_map);
+    EXPECT_THROW(try { sshfs_mounts.start_mount(&vm, "/source/two", "/target/two", gid_map, uid_map); } catch (
+                     const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Whoopsie");
+        throw;
+    },
+                 std::runtime_error);
+
+    EXPECT_FALSE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/two"));
+    EXPECT_TRUE(sshfs_mounts.has_instance_already_mounted(vm.vm_name, "/target/one"));
+}
+
+TEST_F(SSHFSMountsTest, mount_stats_are_read_from_sshfs_process)
+{
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback([this](mpt::MockProcess* process) {
+        sshfs_prints_connected(process);
+
+        if (process->program().contains("sshfs_server"))
+        {
+            EXPECT_CALL(*process, write(QByteArray{"stats\n"})).WillOnce([process](const QByteArray& request) {
+                const auto stats = QByteArray{R"({"/the/target/path":{"bytes_read":"42","bytes_written":"7",)"
+                                              R"("operations":{"read":{"count":"3","errors":"1"}}}})"};
+                ON_CALL(*process, read_all_standard_output())
+                    .WillByDefault(Return("Stopped %2Fother\nStats " + stats.toPercentEncoding() + "\n"));
+                QTimer::singleShot(0, process, [process]() { emit process->ready_read_standard_output(); });
+                return request.size();
+            });
+        }
+    });
+
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+
+    NiceMock<mpt::MockVirtualMachine> vm{"my_instance"};
+
+    sshfs_mounts.start_mount(&vm, source_path, target_path, gid_map, uid_map);
+    const auto stats = sshfs_mounts.mount_stats(vm.vm_name);
+
+    ASSERT_EQ(stats.size(), 1u);
+    const auto& mount_stats = stats.at(target_path);
+    EXPECT_EQ(mount_stats.bytes_read, 42u);
+    EXPECT_EQ(mount_stats.bytes_written, 7u);
+    EXPECT_EQ(mount_stats.operations[mp::MountStats::read].count, 3u);
+    EXPECT_EQ(mount_stats.operations[mp::MountStats::read].errors, 1u);
+}
+
+TEST_F(SSHFSMountsTest, mount_stats_are_empty_without_sshfs_process)
+{
+    mp::SSHFSMounts sshfs_mounts(key_provider);
+
+    EXPECT_TRUE(sshfs_mounts.mount_stats("my_instance").empty());
+}
+
 TEST_F(SSHFSMountsTest, has_instance_already_mounted_returns_true_when_found)
 {
     auto factory = mpt::MockProcessFactory::Inject();
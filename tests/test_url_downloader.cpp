@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/exceptions/download_exception.h>
+#include <multipass/url_downloader.h>
+#include <multipass/utils.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <unordered_map>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// Serves content over HTTP, answering range requests with 206 unless told to ignore them, and records the ranges
+// asked for
+class ContentServer
+{
+public:
+    explicit ContentServer(const QByteArray& content) : content{content}
+    {
+        server.listen(QHostAddress::LocalHost);
+        QObject::connect(&server, &QTcpServer::newConnection, [this] {
+            while (auto socket = server.nextPendingConnection())
+            {
+                QObject::connect(socket, &QTcpSocket::readyRead, [this, socket] { answer(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    QUrl url() const
+    {
+        return QUrl{QString("http://127.0.0.1:%1/image.img").arg(server.serverPort())};
+    }
+
+    bool honour_ranges{true};
+    QStringList ranges; // of the GET requests, empty for those without one
+
+private:
+    void answer(QTcpSocket* socket)
+    {
+        auto& request = requests[socket];
+        request += socket->readAll();
+        const auto end_of_headers = request.indexOf("\r\n\r\n");
+        if (end_of_headers < 0)
+            return;
+
+        const auto headers = QString::fromLatin1(request.left(end_of_headers));
+        request.remove(0, end_of_headers + 4);
+
+        const QRegularExpression range_regex{"Range: bytes=(\\d+)-(\\d+)", QRegularExpression::CaseInsensitiveOption};
+        const auto range_match = range_regex.match(headers);
+        const auto head = headers.startsWith("HEAD");
+        if (!head)
+            ranges << (range_match.hasMatch() ? range_match.captured(1) + "-" + range_match.captured(2) : QString{});
+
+        QByteArray status{"200 OK"}, body{content}, extra_headers;
+        if (!head && range_match.hasMatch() && honour_ranges)
+        {
+            const auto first = range_match.captured(1).toLongLong(), last = range_match.captured(2).toLongLong();
+            status = "206 Partial Content";
+            body = content.mid(first, last - first + 1);
+            extra_headers =
+                QString("Content-Range: bytes %1-%2/%3\r\n").arg(first).arg(last).arg(content.size()).toLatin1();
+        }
+
+        socket->write("HTTP/1.1 " + status + "\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n" +
+                      extra_headers + "\r\n");
+        if (!head)
+            socket->write(body);
+    }
+
+    const QByteArray content;
+    QTcpServer server;
+    std::unordered_map<QTcpSocket*, QByteArray> requests;
+};
+
+QByteArray make_content()
+{
+    QByteArray content;
+    for (int i = 0; content.size() < 64 * 1024; ++i)
+        content += QByteArray::number(i) + ' ';
+
+    return content;
+}
+
+struct URLDownloader : public Test
+{
+    // Leaves a partial download with the first half of the content, as an interrupted one would
+    void make_half_done_download()
+    {
+        QFile file{file_name};
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        file.write(content.left(content.size() / 2));
+        file.resize(content.size());
+
+        const QJsonObject segment{{"start", 0}, {"end", content.size()}, {"done", content.size() / 2}};
+        mpt::make_file_with_content(segments_path, QJsonDocument{QJsonObject{{"size", content.size()},
+                                                                             {"segments", QJsonArray{segment}}}}
+                                                        .toJson()
+                                                        .toStdString());
+    }
+
+    const QByteArray content{make_content()};
+    ContentServer server{content};
+    mpt::TempDir temp_dir;
+    const QString file_name{QDir{temp_dir.path()}.filePath("image.img")};
+    const QString segments_path{file_name + ".segments"};
+    mp::ProgressMonitor stub_monitor{[](int, int) { return true; }};
+    mp::URLDownloader downloader{std::chrono::seconds(10)};
+};
+} // namespace
+
+TEST_F(URLDownloader, downloads_over_range_requests)
+{
+    downloader.download_to(server.url(), file_name, content.size(), 0, stub_monitor);
+
+    EXPECT_EQ(mp::utils::contents_of(file_name), content.toStdString());
+    EXPECT_THAT(server.ranges, ElementsAre(QString("0-%1").arg(content.size() - 1)));
+    EXPECT_FALSE(QFile::exists(segments_path));
+}
+
+TEST_F(URLDownloader, resumes_where_saved_progress_stopped)
+{
+    make_half_done_download();
+
+    downloader.download_to(server.url(), file_name, content.size(), 0, stub_monitor);
+
+    EXPECT_EQ(mp::utils::contents_of(file_name), content.toStdString());
+    EXPECT_THAT(server.ranges, ElementsAre(QString("%1-%2").arg(content.size() / 2).arg(content.size() - 1)));
+    EXPECT_FALSE(QFile::exists(segments_path));
+}
+
+TEST_F(URLDownloader, starts_over_when_saved_progress_is_for_another_size)
+{
+    make_half_done_download();
+
+    downloader.download_to(server.url(), file_name, content.size() - 1, 0, stub_monitor);
+
+    EXPECT_THAT(server.ranges, ElementsAre(QString("0-%1").arg(content.size() - 2)));
+}
+
+TEST_F(URLDownloader, starts_over_as_a_whole_when_ranges_are_ignored)
+{
+    make_half_done_download();
+    server.honour_ranges = false;
+
+    downloader.download_to(server.url(), file_name, content.size(), 0, stub_monitor);
+
+    EXPECT_EQ(mp::utils::contents_of(file_name), content.toStdString());
+    EXPECT_THAT(server.ranges, ElementsAre(QString("%1-%2").arg(content.size() / 2).arg(content.size() - 1),
+                                           QString{}));
+    EXPECT_FALSE(QFile::exists(segments_path));
+}
+
+TEST_F(URLDownloader, streams_resumed_download_from_its_start)
+{
+    make_half_done_download();
+
+    QByteArray streamed;
+    downloader.stream_to(
+        server.url(), file_name,
+        [&streamed](const QByteArray& data) {
+            streamed += data;
+            return true;
+        },
+        content.size(), 0, stub_monitor);
+
+    EXPECT_EQ(streamed, content);
+    EXPECT_EQ(mp::utils::contents_of(file_name), content.toStdString());
+}
+
+TEST_F(URLDownloader, streams_every_byte_once_when_starting_over)
+{
+    make_half_done_download();
+    server.honour_ranges = false;
+
+    QByteArray streamed;
+    downloader.stream_to(
+        server.url(), file_name,
+        [&streamed](const QByteArray& data) {
+            streamed += data;
+            return true;
+        },
+        content.size(), 0, stub_monitor);
+
+    EXPECT_EQ(streamed, content);
+}
+
+TEST_F(URLDownloader, stops_when_sink_refuses_data)
+{
+    EXPECT_THROW(downloader.stream_to(server.url(), file_name, [](const QByteArray&) { return false; },
+                                      content.size(), 0, stub_monitor),
+                 mp::DownloadException);
+}
@@ -235,6 +235,37 @@ TEST(Utils, try_action_actually_times_out)
     EXPECT_TRUE(on_timeout_called);
 }
 
+TEST(Utils, try_action_retries_quickly_before_timing_out)
+{
+    bool on_timeout_called{false};
+    auto on_timeout = [&on_timeout_called] { on_timeout_called = true; };
+
+    auto tries = 0;
+    auto retry_action = [&tries] {
+        ++tries;
+        return mp::utils::TimeoutAction::retry;
+    };
+    mp::utils::try_action_for(on_timeout, std::chrono::milliseconds(500), retry_action);
+
+    EXPECT_TRUE(on_timeout_called);
+    EXPECT_GE(tries, 3);
+}
+
+TEST(Utils, try_action_stops_retrying_once_done)
+{
+    bool on_timeout_called{false};
+    auto on_timeout = [&on_timeout_called] { on_timeout_called = true; };
+
+    auto tries = 0;
+    auto eventual_action = [&tries] {
+        return ++tries < 3 ? mp::utils::TimeoutAction::retry : mp::utils::TimeoutAction::done;
+    };
+    mp::utils::try_action_for(on_timeout, std::chrono::seconds(5), eventual_action);
+
+    EXPECT_FALSE(on_timeout_called);
+    EXPECT_EQ(tries, 3);
+}
+
 TEST(Utils, try_action_does_not_timeout)
 {
     bool on_timeout_called{false};
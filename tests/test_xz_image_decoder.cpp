@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "file_operations.h"
+#include "path.h"
+#include "temp_dir.h"
+
+#include <multipass/utils.h>
+#include <multipass/xz_image_decoder.h>
+
+#include <multipass/format.h>
+
+#include <gmock/gmock.h>
+
+#include <QDir>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// What the images in test_data/xz_images decode to
+std::string expected_image_data()
+{
+    std::string data;
+    for (int i = 0; i < 3000; ++i)
+        data += fmt::format("line {} of the multipass test image\n", i);
+
+    return data;
+}
+
+struct XzImageDecoder : public Test
+{
+    mpt::TempDir temp_dir;
+    QString decoded_path{QDir{temp_dir.path()}.filePath("image.img")};
+    mp::ProgressMonitor stub_monitor{[](int, int) { return true; }};
+};
+} // namespace
+
+TEST_F(XzImageDecoder, reads_index_of_multi_block_image)
+{
+    QFile xz_file{mpt::test_data_path_for("xz_images/multi_block.img.xz")};
+    ASSERT_TRUE(xz_file.open(QIODevice::ReadOnly));
+
+    const auto stream_index = mp::read_stream_index(xz_file);
+
+    ASSERT_EQ(stream_index.blocks.size(), 7u);
+    EXPECT_EQ(stream_index.decoded_size, static_cast<qint64>(expected_image_data().size()));
+    EXPECT_EQ(stream_index.blocks.front().offset, 12);
+    EXPECT_EQ(stream_index.blocks.front().decoded_offset, 0);
+    EXPECT_EQ(stream_index.blocks[1].decoded_offset, stream_index.blocks[0].decoded_size);
+}
+
+TEST_F(XzImageDecoder, index_of_garbage_has_no_blocks)
+{
+    const auto garbage_path = QDir{temp_dir.path()}.filePath("garbage.xz");
+    mpt::make_file_with_content(garbage_path, std::string(1024, 'x'));
+
+    QFile xz_file{garbage_path};
+    ASSERT_TRUE(xz_file.open(QIODevice::ReadOnly));
+
+    EXPECT_TRUE(mp::read_stream_index(xz_file).blocks.empty());
+}
+
+TEST_F(XzImageDecoder, decodes_multi_block_image)
+{
+    mp::XzImageDecoder decoder{mpt::test_data_path_for("xz_images/multi_block.img.xz")};
+    decoder.decode_to(decoded_path, stub_monitor);
+
+    EXPECT_EQ(mp::utils::contents_of(decoded_path), expected_image_data());
+}
+
+TEST_F(XzImageDecoder, decodes_single_block_image)
+{
+    mp::XzImageDecoder decoder{mpt::test_data_path_for("xz_images/single_block.img.xz")};
+    decoder.decode_to(decoded_path, stub_monitor);
+
+    EXPECT_EQ(mp::utils::contents_of(decoded_path), expected_image_data());
+}
+
+TEST_F(XzImageDecoder, throws_on_corrupt_block)
+{
+    QFile original{mpt::test_data_path_for("xz_images/multi_block.img.xz")};
+    ASSERT_TRUE(original.open(QIODevice::ReadOnly));
+    auto data = original.readAll();
+    data[100] = static_cast<char>(data[100] ^ 0xff);
+
+    const auto corrupt_path = QDir{temp_dir.path()}.filePath("corrupt.img.xz");
+    mpt::make_file_with_content(corrupt_path, data.toStdString());
+
+    mp::XzImageDecoder decoder{corrupt_path};
+    EXPECT_THROW(decoder.decode_to(decoded_path, stub_monitor), std::runtime_error);
+}
+
+TEST_F(XzImageDecoder, stream_decoder_keeps_output_of_every_chunk)
+{
+    QFile xz_file{mpt::test_data_path_for("xz_images/single_block.img.xz")};
+    ASSERT_TRUE(xz_file.open(QIODevice::ReadOnly));
+    const auto data = xz_file.readAll();
+
+    QFile decoded_file{decoded_path};
+    ASSERT_TRUE(decoded_file.open(QIODevice::WriteOnly));
+
+    // The image decodes to more than the decoder's output buffer holds, and chunks seldom end where the buffer fills
+    ASSERT_GT(expected_image_data().size(), 65536u);
+    mp::XzStreamDecoder stream_decoder;
+    constexpr auto chunk_size = 97;
+    auto more = true;
+    for (int pos = 0; more && pos < data.size(); pos += chunk_size)
+    {
+        const auto size = std::min<int>(chunk_size, data.size() - pos);
+        more = stream_decoder.decode(data.constData() + pos, size, decoded_file);
+    }
+    decoded_file.close();
+
+    EXPECT_FALSE(more);
+    EXPECT_EQ(mp::utils::contents_of(decoded_path), expected_image_data());
+}
@@ -44,6 +44,15 @@ struct TrackingURLDownloader : public URLDownloader
         downloaded_files << file_name;
     }
 
+    void stream_to(const QUrl& url, const QString& file_name, const DataSink& sink, int64_t size,
+                   const int download_type, const ProgressMonitor&) override
+    {
+        make_file_with_content(file_name, content);
+        sink(QByteArray::fromStdString(content));
+        downloaded_urls << url.toString();
+        downloaded_files << file_name;
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};